@@ -161,6 +161,13 @@ int main(int argc, char **argv)
         QCommandLineOption subtitleOption("subtitle", "Subtitle file.", "file");
         parser.addOption(subtitleOption);
 
+        QCommandLineOption segmentsOption("segments", "Number of segments rendered by parallel processes and joined without re-encoding.", "count",
+                                          QString::number(1));
+        parser.addOption(segmentsOption);
+
+        QCommandLineOption splitOption("split", "Comma separated frames where segments should preferably start, like guides.", "frames");
+        parser.addOption(splitOption);
+
         parser.process(app);
         args = parser.positionalArguments();
 
@@ -232,6 +239,12 @@ int main(int argc, char **argv)
         QString subtitleFile = parser.value(subtitleOption);
 
         auto *rJob = new RenderJob(render, playlist, target, pid, in, out, subtitleFile, &app);
+        QVector<int> cuts;
+        const QStringList splitFrames = parser.value(splitOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+        for (const QString &frame : splitFrames) {
+            cuts << frame.toInt();
+        }
+        rJob->setSegments(parser.value(segmentsOption).toInt(), cuts);
         QObject::connect(rJob, &RenderJob::renderingFinished, rJob, [&]() {
             rJob->deleteLater();
             app.quit();
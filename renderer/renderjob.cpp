@@ -16,6 +16,7 @@
 #endif
 #include <QDebug>
 #include <QDir>
+#include <QDomDocument>
 #include <QElapsedTimer>
 #include <QStandardPaths>
 #include <utility>
@@ -49,6 +50,8 @@ RenderJob::RenderJob(const QString &render, const QString &scenelist, const QStr
     , m_pid(pid)
     , m_dualpass(false)
     , m_subtitleFile(subtitleFile)
+    , m_segmentCount(1)
+    , m_runningSegments(0)
 {
     m_renderProcess = new QProcess(&m_looper);
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -81,6 +84,12 @@ RenderJob::~RenderJob()
     m_logfile.close();
 }
 
+void RenderJob::setSegments(int count, const QVector<int> &cuts)
+{
+    m_segmentCount = count;
+    m_cuts = cuts;
+}
+
 void RenderJob::slotAbort(const QString &url)
 {
     if (m_dest == url) {
@@ -107,7 +116,7 @@ void RenderJob::sendFinish(int status, const QString &error)
         args["status"] = status;
         args["error"] = error;
         method["setRenderingFinished"] = args;
-        m_kdenlivesocket->write(QJsonDocument(method).toJson());
+        m_kdenlivesocket->write(QJsonDocument(method).toJson(QJsonDocument::Compact) + '\n');
         m_kdenlivesocket->flush();
     }
 #endif
@@ -119,6 +128,11 @@ void RenderJob::sendFinish(int status, const QString &error)
 void RenderJob::slotAbort()
 {
     m_renderProcess->kill();
+    for (QProcess *process : qAsConst(m_segmentProcesses)) {
+        process->disconnect(this);
+        process->kill();
+    }
+    m_segmentDir.reset();
     sendFinish(-3, QString());
     if (m_erase) {
         QFile(m_scenelist).remove();
@@ -192,7 +206,7 @@ void RenderJob::updateProgress(int speed)
         args["progress"] = m_progress;
         args["frame"] = m_frame;
         method["setRenderingProgress"] = args;
-        m_kdenlivesocket->write(QJsonDocument(method).toJson());
+        m_kdenlivesocket->write(QJsonDocument(method).toJson(QJsonDocument::Compact) + '\n');
         m_kdenlivesocket->flush();
     }
 #endif
@@ -249,14 +263,14 @@ void RenderJob::start()
     }
 #else
     connect(m_kdenlivesocket, &QLocalSocket::connected, this, [this]() {
-        m_kdenlivesocket->write(QJsonDocument({{"url", m_dest}}).toJson());
+        m_kdenlivesocket->write(QJsonDocument({{"url", m_dest}}).toJson(QJsonDocument::Compact) + '\n');
         m_kdenlivesocket->flush();
         QJsonObject method, args;
         args["url"] = m_dest;
         args["progress"] = 0;
         args["frame"] = 0;
         method["setRenderingProgress"] = args;
-        m_kdenlivesocket->write(QJsonDocument(method).toJson());
+        m_kdenlivesocket->write(QJsonDocument(method).toJson(QJsonDocument::Compact) + '\n');
         m_kdenlivesocket->flush();
     });
     connect(m_kdenlivesocket, &QLocalSocket::readyRead, this, [this]() {
@@ -271,14 +285,198 @@ void RenderJob::start()
     }
 #endif
 
-    // Because of the logging, we connect to stderr in all cases.
-    connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
-    m_renderProcess->start(m_prog, m_args);
-    m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+    if (!startSegments()) {
+        // Because of the logging, we connect to stderr in all cases.
+        connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
+        m_renderProcess->start(m_prog, m_args);
+        m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+    }
     m_logstream.flush();
     m_looper.exec();
 }
 
+bool RenderJob::startSegments()
+{
+    if (m_segmentCount < 2) {
+        return false;
+    }
+    m_ffmpeg = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    if (m_ffmpeg.isEmpty()) {
+        m_logstream << "FFmpeg not found, rendering in a single process\n";
+        return false;
+    }
+    QFile file(m_scenelist);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        return false;
+    }
+    file.close();
+    const QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    if (!RenderSegments::canSegment(consumer)) {
+        m_logstream << "Rendering in a single process, the output cannot be joined\n";
+        return false;
+    }
+    m_segments = RenderSegments::split(m_framein, m_frameout, m_segmentCount, consumer.attribute(QStringLiteral("g")).toInt(), m_cuts);
+    if (m_segments.size() < 2) {
+        return false;
+    }
+    m_segmentDir.reset(new QTemporaryDir(QFileInfo(m_dest).absoluteDir().absoluteFilePath(QStringLiteral(".kdenlive-segments-XXXXXX"))));
+    if (!m_segmentDir->isValid()) {
+        m_segmentDir.reset();
+        return false;
+    }
+    m_format = consumer.attribute(QStringLiteral("f"));
+    const QString extension = QFileInfo(m_dest).suffix();
+    const bool audio = RenderSegments::hasAudio(consumer);
+    QList<QDomDocument> playlists;
+    for (int i = 0; i < m_segments.size(); ++i) {
+        const QString target = m_segmentDir->filePath(QStringLiteral("segment-%1.%2").arg(i, 4, 10, QLatin1Char('0')).arg(extension));
+        playlists << RenderSegments::segmentPlaylist(doc, m_segments.at(i), target,
+                                                     audio ? RenderSegments::Stream::VideoOnly : RenderSegments::Stream::All);
+        m_segmentFiles << target;
+    }
+    if (audio) {
+        // The audio is rendered in one piece, so that there is no gap at the seams
+        m_audioFile = m_segmentDir->filePath(QStringLiteral("audio.%1").arg(extension));
+        playlists << RenderSegments::segmentPlaylist(doc, {m_framein, m_frameout}, m_audioFile, RenderSegments::Stream::AudioOnly);
+    }
+    QStringList playlistFiles;
+    for (int i = 0; i < playlists.size(); ++i) {
+        QFile playlist(m_segmentDir->filePath(QStringLiteral("segment-%1.mlt").arg(i)));
+        if (!playlist.open(QIODevice::WriteOnly | QIODevice::Text) || playlist.write(playlists.at(i).toString().toUtf8()) < 0) {
+            m_segmentFiles.clear();
+            m_audioFile.clear();
+            m_segmentDir.reset();
+            return false;
+        }
+        playlistFiles << playlist.fileName();
+    }
+
+    m_segmentProgress.fill(0, playlistFiles.size());
+    m_runningSegments = playlistFiles.size();
+    for (int i = 0; i < playlistFiles.size(); ++i) {
+        auto *process = new QProcess(&m_looper);
+        process->setReadChannel(QProcess::StandardError);
+        connect(process, &QProcess::readyReadStandardError, this, [this, i]() { receivedSegmentStderr(i); });
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, i](int exitCode, QProcess::ExitStatus status) { segmentFinished(i, exitCode, status); });
+        connect(process, &QProcess::errorOccurred, this, [this, i](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                segmentFinished(i, -1, QProcess::CrashExit);
+            }
+        });
+        m_segmentProcesses << process;
+        const QStringList args = {QStringLiteral("-progress"), playlistFiles.at(i)};
+        process->start(m_prog, args);
+        m_logstream << "Started segment process: " << m_prog << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    }
+    return true;
+}
+
+void RenderJob::receivedSegmentStderr(int index)
+{
+    QString result = QString::fromLocal8Bit(m_segmentProcesses.at(index)->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+        return;
+    }
+    int progress = result.section(QLatin1Char(' '), -1).toInt();
+    if (progress <= m_segmentProgress.at(index) || progress > 100) {
+        return;
+    }
+    m_segmentProgress[index] = progress;
+    // The progress of the job is the one of the video, the audio is much faster to render
+    qint64 done = 0;
+    qint64 total = 0;
+    for (int i = 0; i < m_segments.size(); ++i) {
+        done += qint64(m_segmentProgress.at(i)) * m_segments.at(i).length();
+        total += m_segments.at(i).length();
+    }
+    // Keep 100% for the end of the join
+    progress = int(qMin(done / total, qint64(99)));
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    const int frame = m_framein + int(done / 100);
+    qint64 elapsedTime = m_startTime.secsTo(QDateTime::currentDateTime());
+    if (elapsedTime == m_seconds) {
+        return;
+    }
+    int speed = (frame - m_frame) / (elapsedTime - m_seconds);
+    m_seconds = elapsedTime;
+    m_frame = frame;
+    updateProgress(speed);
+}
+
+void RenderJob::segmentFinished(int index, int exitCode, QProcess::ExitStatus status)
+{
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        m_logstream << "Segment process " << index << " failed\n";
+        // Stop the other segments, the job failed
+        for (QProcess *process : qAsConst(m_segmentProcesses)) {
+            process->disconnect(this);
+            process->kill();
+        }
+        finishSegments(false);
+        return;
+    }
+    m_segmentProcesses.at(index)->disconnect(this);
+    if (--m_runningSegments == 0) {
+        finishSegments(true);
+    }
+}
+
+void RenderJob::finishSegments(bool success)
+{
+    if (m_erase) {
+        QFile(m_scenelist).remove();
+    }
+    if (success) {
+        success = joinSegments();
+    }
+    m_segmentDir.reset();
+    if (!success) {
+        sendFinish(-2, m_errorMessage);
+        QString error = tr("Rendering of %1 aborted, resulting video will probably be corrupted.").arg(m_dest);
+        m_logstream << error << "\n";
+        QProcess::startDetached(QStringLiteral("kdialog"), {QStringLiteral("--error"), error});
+    } else {
+        m_logstream << "Rendering of " << m_dest << " finished"
+                    << "\n";
+        m_logstream.flush();
+        m_logfile.remove();
+        if (embedSubtitles()) {
+            return;
+        }
+        sendFinish(-1, QString());
+    }
+    Q_EMIT renderingFinished();
+    m_looper.quit();
+}
+
+bool RenderJob::joinSegments()
+{
+    QFile list(m_segmentDir->filePath(QStringLiteral("segments.ffconcat")));
+    if (!list.open(QIODevice::WriteOnly) || list.write(RenderSegments::concatList(m_segmentFiles)) < 0) {
+        return false;
+    }
+    list.close();
+    const QStringList args = RenderSegments::joinArguments(list.fileName(), m_audioFile, m_format, m_dest);
+    m_logstream << "Joining segments: " << m_ffmpeg << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    QProcess join;
+    join.setProcessChannelMode(QProcess::MergedChannels);
+    join.start(m_ffmpeg, args);
+    if (!join.waitForStarted(-1) || !join.waitForFinished(-1) || join.exitStatus() != QProcess::NormalExit || join.exitCode() != 0) {
+        const QString output = QString::fromLocal8Bit(join.readAll()).simplified();
+        m_errorMessage.append(output + QStringLiteral("<br>"));
+        m_logstream << output << "\n";
+        return false;
+    }
+    return true;
+}
+
 #ifndef NODBUS
 void RenderJob::initKdenliveDbusInterface()
 {
@@ -350,27 +548,8 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
             deleteLater();
         } else {
             m_logfile.remove();
-            if (!m_subtitleFile.isEmpty()) {
-                // Embed subtitles
-                QString ffmpegExe = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
-                if (!ffmpegExe.isEmpty()) {
-                    QFileInfo videoRender(m_dest);
-                    m_temporaryRenderFile = QDir::temp().absoluteFilePath(videoRender.fileName());
-                    QStringList args = {
-                        "-y", "-v", "quiet", "-stats", "-i", m_dest, "-i", m_subtitleFile, "-c", "copy", "-f", "matroska", m_temporaryRenderFile};
-                    qDebug() << "::: JOB ARGS: " << args;
-                    m_progress = 0;
-                    disconnect(m_renderProcess, &QProcess::stateChanged, this, &RenderJob::slotCheckProcess);
-                    disconnect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
-                    m_subsProcess = new QProcess(&m_looper);
-                    m_subsProcess->setProcessChannelMode(QProcess::MergedChannels);
-                    connect(m_subsProcess, &QProcess::readyReadStandardOutput, this, &RenderJob::receivedSubtitleProgress);
-                    m_subsProcess->start(ffmpegExe, args);
-                    m_subsProcess->waitForStarted(-1);
-                    m_subsProcess->waitForFinished(-1);
-                    slotCheckSubtitleProcess(m_subsProcess->exitCode(), m_subsProcess->exitStatus());
-                    return;
-                }
+            if (embedSubtitles()) {
+                return;
             }
             sendFinish(-1, QString());
         }
@@ -379,6 +558,32 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
     m_looper.quit();
 }
 
+bool RenderJob::embedSubtitles()
+{
+    if (m_subtitleFile.isEmpty()) {
+        return false;
+    }
+    QString ffmpegExe = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    if (ffmpegExe.isEmpty()) {
+        return false;
+    }
+    QFileInfo videoRender(m_dest);
+    m_temporaryRenderFile = QDir::temp().absoluteFilePath(videoRender.fileName());
+    QStringList args = {"-y", "-v", "quiet", "-stats", "-i", m_dest, "-i", m_subtitleFile, "-c", "copy", "-f", "matroska", m_temporaryRenderFile};
+    qDebug() << "::: JOB ARGS: " << args;
+    m_progress = 0;
+    disconnect(m_renderProcess, &QProcess::stateChanged, this, &RenderJob::slotCheckProcess);
+    disconnect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
+    m_subsProcess = new QProcess(&m_looper);
+    m_subsProcess->setProcessChannelMode(QProcess::MergedChannels);
+    connect(m_subsProcess, &QProcess::readyReadStandardOutput, this, &RenderJob::receivedSubtitleProgress);
+    m_subsProcess->start(ffmpegExe, args);
+    m_subsProcess->waitForStarted(-1);
+    m_subsProcess->waitForFinished(-1);
+    slotCheckSubtitleProcess(m_subsProcess->exitCode(), m_subsProcess->exitStatus());
+    return true;
+}
+
 void RenderJob::receivedSubtitleProgress()
 {
     QString outputData = QString::fromLocal8Bit(m_subsProcess->readAllStandardOutput()).simplified();
@@ -11,11 +11,14 @@
 #else
 #include <QDBusInterface>
 #endif
+#include "../src/lib/renderSegments.h"
 #include <QDateTime>
 #include <QEventLoop>
 #include <QFile>
 #include <QObject>
 #include <QProcess>
+#include <QTemporaryDir>
+#include <memory>
 // Testing
 #include <QTextStream>
 
@@ -27,6 +30,8 @@ public:
     RenderJob(const QString &render, const QString &scenelist, const QString &target, int pid = -1, int in = -1, int out = -1,
               const QString &subtitleFile = QString(), QObject *parent = nullptr);
     ~RenderJob() override;
+    /** @brief Render in @param count segments by parallel processes, starting preferably on the @param cuts frames. */
+    void setSegments(int count, const QVector<int> &cuts);
 
 public Q_SLOTS:
     void start();
@@ -72,12 +77,36 @@ private:
     QStringList m_args;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
+    int m_segmentCount;
+    /** @brief Frames where segments should preferably start. */
+    QVector<int> m_cuts;
+    QVector<RenderSegments::Segment> m_segments;
+    /** @brief The video segment processes, followed by the audio one. */
+    QList<QProcess *> m_segmentProcesses;
+    QVector<int> m_segmentProgress;
+    int m_runningSegments;
+    QStringList m_segmentFiles;
+    QString m_audioFile;
+    QString m_format;
+    QString m_ffmpeg;
+    /** @brief Holds the segment playlists and renders, next to the destination. */
+    std::unique_ptr<QTemporaryDir> m_segmentDir;
 #ifdef NODBUS
     void fromServer();
 #else
     void initKdenliveDbusInterface();
 #endif
     void sendFinish(int status, const QString &error);
+    /** @brief Start the segment processes, returns false if the job has to be rendered by a single process. */
+    bool startSegments();
+    void receivedSegmentStderr(int index);
+    void segmentFinished(int index, int exitCode, QProcess::ExitStatus status);
+    /** @brief All processes are over, join the segments and report the result. */
+    void finishSegments(bool success);
+    /** @brief Join the video segments and the audio into the destination file. */
+    bool joinSegments();
+    /** @brief Embed the subtitles in the rendered file, returns true if this took over the end of the job. */
+    bool embedSubtitles();
     void updateProgress(int speed = -1);
     void sendProgress();
 
@@ -96,6 +96,9 @@ protected:
     /** @brief Returns the path to the assets' preferred list*/
     virtual QString assetPreferredListPath() const = 0;
 
+    /** @brief Returns the name of the asset catalog, used for its cache file */
+    virtual QString assetCacheName() const = 0;
+
     std::unordered_map<QString, Info> m_assets;
 
     QSet<QString> m_blacklist;
@@ -3,15 +3,19 @@
  * SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
  */
 
+#include "assetcatalogcache.hpp"
 #include "xml/xml.hpp"
 #include "kdenlivesettings.h"
 #include "core.h"
+#include "kdenlive_debug.h"
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QStandardPaths>
 #include <QString>
 #include <QTextStream>
+#include <QThreadPool>
 #include <KLocalizedString>
 
 #include <locale>
@@ -23,6 +27,14 @@ template <typename AssetType> AbstractAssetsRepository<AssetType>::AbstractAsset
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 {
+    // Time spent in each phase, reported once the catalog is ready
+    QElapsedTimer total;
+    total.start();
+    QElapsedTimer timer;
+    timer.start();
+    QStringList phases;
+    auto phaseDone = [&timer, &phases](const QString &phase) { phases << QStringLiteral("%1 %2ms").arg(phase).arg(timer.restart()); };
+
     // Parse blacklist
     parseAssetList(assetBlackListPath(), m_blacklist);
 
@@ -31,12 +43,47 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 
     // Retrieve the list of MLT's available assets.
     QScopedPointer<Mlt::Properties> assets(retrieveListFromMlt());
-    QStringList emptyMetaAssets;
+    QStringList services;
     int max = assets->count();
-    QString sox = QStringLiteral("sox.");
+    services.reserve(max);
     for (int i = 0; i < max; ++i) {
+        services << QString(assets->get_name(i));
+    }
+
+    // Set the directories to look into for effects.
+    QStringList asset_dirs = assetDirs();
+
+    const QString cachePath = AssetCatalogCache::cachePath(assetCacheName());
+    const QByteArray cacheKey = AssetCatalogCache::catalogKey(services, asset_dirs);
+    phaseDone(QStringLiteral("lists"));
+
+    // Use the catalog built by a previous run if nothing changed since
+    QVector<AssetCatalogCache::Entry> entries;
+    if (AssetCatalogCache::load(cachePath, cacheKey, entries)) {
+        m_assets.reserve(size_t(entries.size()));
+        for (const auto &entry : qAsConst(entries)) {
+            Info info;
+            info.id = entry.id;
+            info.mltId = entry.mltId;
+            info.name = entry.name;
+            info.description = entry.description;
+            info.author = entry.author;
+            info.version_str = entry.versionStr;
+            info.version = entry.version;
+            info.type = AssetType(entry.type);
+            info.xml = entry.xml;
+            m_assets[info.id] = info;
+        }
+        phaseDone(QStringLiteral("cached catalog"));
+        qCDebug(KDENLIVE_LOG) << "Loaded" << m_assets.size() << assetCacheName() << "from cache in" << total.elapsed()
+                              << "ms:" << phases.join(QStringLiteral(", "));
+        return;
+    }
+
+    QStringList emptyMetaAssets;
+    QString sox = QStringLiteral("sox.");
+    for (const QString &name : qAsConst(services)) {
         Info info;
-        QString name = assets->get_name(i);
         info.id = name;
         if (name.startsWith(sox)) {
             // sox effects are not usage directly (parameters not available)
@@ -54,12 +101,10 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
             }
         }
     }
+    phaseDone(QStringLiteral("MLT metadata"));
 
     // We now parse custom effect xml
 
-    // Set the directories to look into for effects.
-    QStringList asset_dirs = assetDirs();
-
     /* Parsing of custom xml works as follows: we parse all custom files.
        Each of them contains a tag, which is the corresponding mlt asset, and an id that is the name of the asset. Note that several custom files can correspond
        to the same tag, and in that case they must have different ids. We do the parsing in a map from ids to parse info, and then we add them to the asset
@@ -77,9 +122,12 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
             parseCustomAssetFile(path, customAssets);
         }
     }
+    phaseDone(QStringLiteral("custom assets"));
 
     // We add the custom assets
     QStringList missingDependency;
+    // Names of all MLT filters and transitions, only listed if an asset has a dependency
+    QSet<QString> mltServices;
     for (const auto &custom : customAssets) {
         // Custom assets should override default ones
         if (emptyMetaAssets.contains(custom.second.mltId)) {
@@ -90,26 +138,18 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 
         QString dependency = custom.second.xml.attribute(QStringLiteral("dependency"), QString());
         if(!dependency.isEmpty()) {
-            bool found = false;
-            QScopedPointer<Mlt::Properties> effects(pCore->getMltRepository()->filters());
-            for(int i = 0; i < effects->count(); ++i) {
-                if(effects->get_name(i) == dependency) {
-                    found = true;
-                    break;
+            if (mltServices.isEmpty()) {
+                QScopedPointer<Mlt::Properties> effects(pCore->getMltRepository()->filters());
+                for(int i = 0; i < effects->count(); ++i) {
+                    mltServices.insert(effects->get_name(i));
                 }
-            }
-
-            if(!found) {
                 QScopedPointer<Mlt::Properties> transitions(pCore->getMltRepository()->transitions());
                 for(int i = 0; i < transitions->count(); ++i) {
-                    if(transitions->get_name(i) == dependency) {
-                        found = true;
-                        break;
-                    }
+                    mltServices.insert(transitions->get_name(i));
                 }
             }
 
-            if(!found) {
+            if(!mltServices.contains(dependency)) {
                 // asset depends on another asset that is invalid so remove this asset too
                 missingDependency << custom.first;
                 qDebug() << "Asset" << custom.first << "has invalid dependency" << dependency << "and is going to be removed";
@@ -123,6 +163,19 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
     for (const auto &invalid : qAsConst(emptyMetaAssets)) {
         m_assets.erase(invalid);
     }
+    phaseDone(QStringLiteral("dependencies"));
+
+    // Store the catalog for the next startup, the file is written in the background
+    entries.reserve(int(m_assets.size()));
+    for (const auto &asset : m_assets) {
+        const Info &info = asset.second;
+        entries.append({info.id, info.mltId, info.name, info.description, info.author, info.version_str, info.version, int(info.type), info.xml});
+    }
+    const QByteArray data = AssetCatalogCache::serialize(cacheKey, entries);
+    QThreadPool::globalInstance()->start([cachePath, data]() { AssetCatalogCache::write(cachePath, data); });
+    phaseDone(QStringLiteral("catalog serialization"));
+    qCDebug(KDENLIVE_LOG) << "Built" << m_assets.size() << assetCacheName() << "catalog in" << total.elapsed()
+                          << "ms:" << phases.join(QStringLiteral(", "));
 }
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::parseAssetList(const QString &filePath, QSet<QString> &destination)
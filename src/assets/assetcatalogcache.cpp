@@ -0,0 +1,173 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "assetcatalogcache.hpp"
+#include "config-kdenlive.h"
+
+#include <KLocalizedString>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <mlt++/Mlt.h>
+
+namespace {
+const quint32 cacheMagic = 0x4b444143; // KDAC
+const quint32 cacheVersion = 1;
+
+/** @brief Folders of the plugins exposed as MLT services: the MLT modules, and the frei0r, LADSPA and LV2 plugins.
+    An environment variable replaces the default folders of a plugin type, like the plugin loaders do.
+ */
+QStringList pluginDirs()
+{
+    QStringList dirs;
+    const char *repository = mlt_environment("MLT_REPOSITORY");
+    if (repository != nullptr) {
+        dirs << QString::fromLocal8Bit(repository);
+    }
+    const QString home = QDir::homePath();
+    const QList<QPair<const char *, QStringList>> plugins = {
+        {"FREI0R_PATH",
+         {home + QStringLiteral("/.frei0r-1/lib"), QStringLiteral("/usr/local/lib/frei0r-1"), QStringLiteral("/usr/lib/frei0r-1"),
+          QStringLiteral("/usr/lib64/frei0r-1")}},
+        {"LADSPA_PATH", {QStringLiteral("/usr/local/lib/ladspa"), QStringLiteral("/usr/lib/ladspa"), QStringLiteral("/usr/lib64/ladspa")}},
+        {"LV2_PATH", {home + QStringLiteral("/.lv2"), QStringLiteral("/usr/local/lib/lv2"), QStringLiteral("/usr/lib/lv2"), QStringLiteral("/usr/lib64/lv2")}}};
+    for (const auto &plugin : plugins) {
+        const QString path = qEnvironmentVariable(plugin.first);
+        dirs << (path.isEmpty() ? plugin.second : path.split(QDir::listSeparator(), Qt::SkipEmptyParts));
+    }
+    return dirs;
+}
+} // namespace
+
+QString AssetCatalogCache::cachePath(const QString &name)
+{
+    const QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    return cacheDir.absoluteFilePath(QStringLiteral("%1.catalog").arg(name));
+}
+
+QByteArray AssetCatalogCache::catalogKey(const QStringList &services, const QStringList &assetDirs)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    // Names and descriptions are translated when parsing
+    stream << cacheVersion << QStringLiteral(KDENLIVE_VERSION) << QString::fromUtf8(mlt_version_get_string()) << KLocalizedString::languages();
+    stream << services;
+    // Installing, updating or removing a plugin changes the modification time of its folder, even when the service names stay
+    const QStringList plugins = pluginDirs();
+    for (const QString &dir : plugins) {
+        const QFileInfo info(dir);
+        stream << dir << (info.exists() ? info.lastModified().toMSecsSinceEpoch() : qint64(-1));
+    }
+    for (const QString &dir : assetDirs) {
+        stream << dir;
+        // Adding, removing or editing an asset file changes the key
+        const QFileInfoList files = QDir(dir).entryInfoList({QStringLiteral("*.xml")}, QDir::Files, QDir::Name);
+        for (const QFileInfo &file : files) {
+            stream << file.fileName() << file.size() << file.lastModified().toMSecsSinceEpoch();
+        }
+    }
+    hash.addData(data);
+    return hash.result();
+}
+
+bool AssetCatalogCache::load(const QString &path, const QByteArray &key, QVector<Entry> &entries)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray storedKey;
+    stream >> magic >> version;
+    if (magic != cacheMagic || version != cacheVersion) {
+        qWarning() << "Discarding invalid asset catalog" << path;
+        return false;
+    }
+    stream >> storedKey;
+    if (storedKey != key) {
+        return false;
+    }
+    QByteArray xml;
+    quint32 count = 0;
+    stream >> xml >> count;
+    // All the asset descriptions are stored in a single document, parsed at once
+    QDomDocument doc;
+    if (stream.status() != QDataStream::Ok || !doc.setContent(xml)) {
+        qWarning() << "Discarding corrupted asset catalog" << path;
+        return false;
+    }
+    QVector<QDomElement> elements;
+    for (QDomElement e = doc.documentElement().firstChildElement(); !e.isNull(); e = e.nextSiblingElement()) {
+        elements.append(e);
+    }
+    QVector<Entry> result;
+    result.reserve(int(count));
+    for (quint32 i = 0; i < count; ++i) {
+        Entry entry;
+        qint32 index = -1;
+        stream >> entry.id >> entry.mltId >> entry.name >> entry.description >> entry.author >> entry.versionStr >> entry.version >> entry.type >> index;
+        if (stream.status() != QDataStream::Ok || index >= elements.size()) {
+            qWarning() << "Discarding corrupted asset catalog" << path;
+            return false;
+        }
+        if (index >= 0) {
+            entry.xml = elements.at(index);
+        }
+        result.append(entry);
+    }
+    entries = result;
+    return true;
+}
+
+QByteArray AssetCatalogCache::serialize(const QByteArray &key, const QVector<Entry> &entries)
+{
+    QDomDocument doc;
+    QDomElement root = doc.createElement(QStringLiteral("catalog"));
+    doc.appendChild(root);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    QByteArray assets;
+    QDataStream assetStream(&assets, QIODevice::WriteOnly);
+    assetStream.setVersion(QDataStream::Qt_5_15);
+    qint32 elements = 0;
+    for (const Entry &entry : entries) {
+        qint32 index = -1;
+        if (!entry.xml.isNull()) {
+            root.appendChild(doc.importNode(entry.xml, true));
+            index = elements++;
+        }
+        assetStream << entry.id << entry.mltId << entry.name << entry.description << entry.author << entry.versionStr << entry.version << entry.type
+                    << index;
+    }
+    stream << cacheMagic << cacheVersion << key << doc.toByteArray(-1) << quint32(entries.size());
+    data.append(assets);
+    return data;
+}
+
+bool AssetCatalogCache::write(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write asset catalog" << path;
+        return false;
+    }
+    file.write(data);
+    return file.commit();
+}
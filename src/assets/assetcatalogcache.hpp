@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QDomElement>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/** @class AssetCatalogCache
+    @brief Persistent copy of the parsed effect or transition catalog.
+    Building the catalog queries the MLT metadata of every service and parses every custom asset file, which is a large part of
+    the startup time. The resulting catalog is written to a single cache file, tagged with a key identifying everything it was
+    built from: Kdenlive and MLT versions, translation languages, available MLT services, the modification times of the MLT
+    module and plugin folders, and the asset files of each folder.
+    On the next startup the key is computed again, which only lists the asset folders, and the catalog is read back with one
+    file read and one XML parse if the key matches.
+ */
+class AssetCatalogCache
+{
+public:
+    /** @brief One asset of the catalog, mirroring AbstractAssetsRepository::Info */
+    struct Entry
+    {
+        QString id;
+        QString mltId;
+        QString name;
+        QString description;
+        QString author;
+        QString versionStr;
+        int version{0};
+        int type{0};
+        QDomElement xml;
+    };
+
+    /** @brief Path of the cache file of the catalog called @param name in the user cache folder */
+    static QString cachePath(const QString &name);
+    /** @brief Compute the key identifying the inputs of a catalog.
+        The MLT modules, frei0r, LADSPA and LV2 folders are read from the environment, so that an updated plugin invalidates the key.
+        @param services names of the MLT services of the catalog
+        @param assetDirs folders containing the custom asset XML files
+     */
+    static QByteArray catalogKey(const QStringList &services, const QStringList &assetDirs);
+    /** @brief Read a catalog from @param path into @param entries
+        @return false if the file is missing, invalid, or was built for another @param key
+     */
+    static bool load(const QString &path, const QByteArray &key, QVector<Entry> &entries);
+    /** @brief Contents of a cache file storing @param entries under @param key.
+        The XML elements are serialized in the calling thread, so that the data can then be written from another thread.
+     */
+    static QByteArray serialize(const QByteArray &key, const QVector<Entry> &entries);
+    /** @brief Atomically replace the cache file at @param path with @param data */
+    static bool write(const QString &path, const QByteArray &data);
+};
@@ -0,0 +1,264 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "keyframecurve.hpp"
+#include "keyframemodel.hpp"
+#include "rotoscoping/rotohelper.hpp"
+#include "utils/qcolorutils.h"
+
+#include <QLineF>
+#include <QRegularExpression>
+#include <algorithm>
+#include <mlt++/Mlt.h>
+
+namespace {
+// Same spline as MLT's smooth keyframes
+double catmullRom(double y0, double y1, double y2, double y3, double t)
+{
+    const double t2 = t * t;
+    const double a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+    const double a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+    const double a2 = -0.5 * y0 + 0.5 * y2;
+    const double a3 = y1;
+    return a0 * t * t2 + a1 * t2 + a2 * t + a3;
+}
+
+// Parse the numbers of a rect value like MLT does: any non numeric character is a separator
+bool parseRect(const QString &value, bool useOpacity, double *components)
+{
+    static const QRegularExpression numberExp(QStringLiteral("[-+]?(\\d+\\.?\\d*|\\.\\d+)([eE][-+]?\\d+)?(%?)"));
+    QRegularExpressionMatchIterator it = numberExp.globalMatch(value);
+    int count = 0;
+    while (it.hasNext() && count < 5) {
+        const QRegularExpressionMatch match = it.next();
+        if (!match.captured(3).isEmpty()) {
+            // Percentages depend on the profile, let MLT handle them
+            return false;
+        }
+        components[count++] = match.captured(0).toDouble();
+    }
+    if (count < 4 || (useOpacity && count < 5)) {
+        return false;
+    }
+    if (count == 4) {
+        components[4] = 1.;
+    }
+    return true;
+}
+} // namespace
+
+// static
+std::shared_ptr<const KeyframeCurve> KeyframeCurve::compile(const KeyframeList &keyframes, ParamType type, double fps, bool useOpacity,
+                                                            const QSize &frameSize, const std::shared_ptr<Mlt::Properties> &colorAnimation)
+{
+    std::shared_ptr<KeyframeCurve> curve(new KeyframeCurve());
+    curve->m_type = type;
+    curve->m_fps = fps;
+    curve->m_frameSize = frameSize;
+    curve->m_useOpacity = useOpacity;
+    switch (type) {
+    case ParamType::KeyframeParam:
+    case ParamType::ColorWheel:
+        curve->m_components = 1;
+        break;
+    case ParamType::AnimatedRect:
+        curve->m_components = 5;
+        break;
+    case ParamType::Color:
+        if (colorAnimation == nullptr) {
+            return curve;
+        }
+        curve->m_components = 0;
+        curve->m_colorAnimation = colorAnimation;
+        break;
+    case ParamType::Roto_spline:
+        if (frameSize.isEmpty()) {
+            return curve;
+        }
+        curve->m_components = 0;
+        break;
+    default:
+        return curve;
+    }
+    const size_t count = keyframes.size();
+    curve->m_frames.reserve(count);
+    curve->m_types.reserve(count);
+    curve->m_keyValues.reserve(count);
+    curve->m_values.reserve(count * size_t(curve->m_components));
+    for (const auto &keyframe : keyframes) {
+        const int frame = keyframe.first.frames(fps);
+        const QVariant &value = keyframe.second.second;
+        curve->m_frames.push_back(frame);
+        curve->m_types.push_back(int(keyframe.second.first));
+        curve->m_keyValues.push_back(value);
+        switch (type) {
+        case ParamType::AnimatedRect: {
+            double rect[5];
+            if (!parseRect(value.toString(), useOpacity, rect)) {
+                return curve;
+            }
+            curve->m_values.insert(curve->m_values.end(), rect, rect + 5);
+            break;
+        }
+        case ParamType::Color:
+            curve->m_colorAnimation->anim_set("key", value.toString().toUtf8().constData(), frame);
+            break;
+        case ParamType::Roto_spline:
+            curve->m_points.push_back(RotoHelper::getPoints(value, frameSize));
+            break;
+        default: {
+            bool ok = false;
+            const double val = value.toDouble(&ok);
+            if (!ok) {
+                return curve;
+            }
+            curve->m_values.push_back(val);
+            break;
+        }
+        }
+    }
+    if (type == ParamType::Color && count > 0) {
+        // Apply the keyframe types once all keyframes are in the animation
+        Mlt::Animation anim = curve->m_colorAnimation->get_animation("key");
+        for (int i = 0; i < int(count); ++i) {
+            anim.key_set_type(i, mlt_keyframe_type(curve->m_types.at(size_t(i))));
+        }
+    }
+    curve->m_supported = true;
+    return curve;
+}
+
+bool KeyframeCurve::isSupported() const
+{
+    return m_supported;
+}
+
+bool KeyframeCurve::matches(double fps, const QSize &frameSize) const
+{
+    return qFuzzyCompare(m_fps, fps) && m_frameSize == frameSize;
+}
+
+int KeyframeCurve::keyframeCount() const
+{
+    return int(m_frames.size());
+}
+
+int KeyframeCurve::segmentIndex(int frame) const
+{
+    auto it = std::upper_bound(m_frames.begin(), m_frames.end(), frame);
+    return int(std::distance(m_frames.begin(), it)) - 1;
+}
+
+double KeyframeCurve::interpolate(int ix, int frame, int component) const
+{
+    const int count = int(m_frames.size());
+    auto valueAt = [this, component](int keyframe) { return m_values.at(size_t(keyframe * m_components + component)); };
+    if (ix < 0) {
+        return valueAt(0);
+    }
+    if (ix >= count - 1 || m_types.at(size_t(ix)) == int(KeyframeType::Discrete)) {
+        return valueAt(ix);
+    }
+    const double progress = double(frame - m_frames.at(size_t(ix))) / (m_frames.at(size_t(ix + 1)) - m_frames.at(size_t(ix)));
+    const double y1 = valueAt(ix);
+    const double y2 = valueAt(ix + 1);
+    if (m_types.at(size_t(ix)) == int(KeyframeType::Curve)) {
+        const double y0 = ix > 0 ? valueAt(ix - 1) : y1;
+        const double y3 = ix + 2 < count ? valueAt(ix + 2) : y2;
+        return catmullRom(y0, y1, y2, y3, progress);
+    }
+    return y1 + (y2 - y1) * progress;
+}
+
+QVariant KeyframeCurve::rotoValue(int ix, int frame) const
+{
+    const int count = int(m_frames.size());
+    if (ix < 0) {
+        return m_keyValues.front();
+    }
+    if (ix >= count - 1) {
+        return m_keyValues.back();
+    }
+    const QList<BPoint> &p1 = m_points.at(size_t(ix));
+    const QList<BPoint> &p2 = m_points.at(size_t(ix + 1));
+    // relPos is 0 on the previous keyframe and 1 on the next one
+    const qreal relPos = qreal(frame - m_frames.at(size_t(ix))) / (m_frames.at(size_t(ix + 1)) - m_frames.at(size_t(ix)));
+    const int points = qMin(p1.count(), p2.count());
+    QList<QVariant> vlist;
+    for (int i = 0; i < points; ++i) {
+        BPoint bp;
+        QList<QVariant> pl;
+        for (int j = 0; j < 3; ++j) {
+            if (p1.at(i)[j] != p2.at(i)[j]) {
+                bp[j] = QLineF(p1.at(i)[j], p2.at(i)[j]).pointAt(relPos);
+            } else {
+                bp[j] = p1.at(i)[j];
+            }
+            pl << QVariant(QList<QVariant>() << QVariant(bp[j].x() / m_frameSize.width()) << QVariant(bp[j].y() / m_frameSize.height()));
+        }
+        vlist << QVariant(pl);
+    }
+    return vlist;
+}
+
+QVariant KeyframeCurve::value(int frame) const
+{
+    if (!m_supported || m_frames.empty()) {
+        return QVariant();
+    }
+    const int ix = segmentIndex(frame);
+    if (ix >= 0 && m_frames.at(size_t(ix)) == frame) {
+        return m_keyValues.at(size_t(ix));
+    }
+    switch (m_type) {
+    case ParamType::Roto_spline:
+        return rotoValue(ix, frame);
+    case ParamType::Color: {
+        QMutexLocker lock(&m_colorMutex);
+        mlt_color mltColor = m_colorAnimation->anim_get_color("key", frame);
+        QColor color(mltColor.r, mltColor.g, mltColor.b, mltColor.a);
+        return QVariant(QColorUtils::colorToString(color, true));
+    }
+    case ParamType::AnimatedRect: {
+        QString res = QStringLiteral("%1 %2 %3 %4")
+                          .arg(int(interpolate(ix, frame, 0)))
+                          .arg(int(interpolate(ix, frame, 1)))
+                          .arg(int(interpolate(ix, frame, 2)))
+                          .arg(int(interpolate(ix, frame, 3)));
+        if (m_useOpacity) {
+            res.append(QStringLiteral(" %1").arg(QString::number(interpolate(ix, frame, 4), 'f')));
+        }
+        return QVariant(res);
+    }
+    default:
+        return QVariant(interpolate(ix, frame, 0));
+    }
+}
+
+double KeyframeCurve::component(int frame, int component) const
+{
+    if (!m_supported || m_frames.empty() || component < 0 || component >= m_components) {
+        return 0.;
+    }
+    return interpolate(segmentIndex(frame), frame, component);
+}
+
+QVector<double> KeyframeCurve::componentRange(int start, int end, int component) const
+{
+    QVector<double> result;
+    if (!m_supported || m_frames.empty() || component < 0 || component >= m_components || end < start) {
+        return result;
+    }
+    result.reserve(end - start + 1);
+    const int count = int(m_frames.size());
+    int ix = segmentIndex(start);
+    for (int frame = start; frame <= end; ++frame) {
+        while (ix + 1 < count && m_frames.at(size_t(ix + 1)) <= frame) {
+            ix++;
+        }
+        result << interpolate(ix, frame, component);
+    }
+    return result;
+}
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "assets/bpoint.h"
+#include "definitions.h"
+#include "utils/gentime.h"
+
+#include <QList>
+#include <QMutex>
+#include <QSize>
+#include <QVariant>
+#include <QVector>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Mlt {
+class Properties;
+}
+
+enum class KeyframeType;
+
+/** @class KeyframeCurve
+    @brief Immutable compiled form of the keyframes of a parameter, used to evaluate interpolated values without going through MLT.
+    A curve is built once per revision of a KeyframeModel and dropped when a keyframe changes. Since it is never modified after being built,
+    double, rect and spline values can be evaluated from any thread without locking, in O(log k) for k keyframes.
+    Double and rect values are interpolated like MLT's animation: discrete keyframes hold their value, linear ones interpolate linearly and
+    smooth ones use a Catmull-Rom spline through the neighbour keyframes. Values before the first and after the last keyframe are clamped.
+    Rotoscoping splines are interpolated point by point. Colors are evaluated by an MLT animation built once with the curve and owned by it.
+    Color queries are not lock free: they are serialized by m_colorMutex since MLT updates the animation cache of the properties when reading it.
+    Values that cannot be reproduced exactly (like percentages in rects) produce an unsupported curve, callers then fall back to MLT.
+ */
+class KeyframeCurve
+{
+public:
+    using KeyframeList = std::map<GenTime, std::pair<KeyframeType, QVariant>>;
+
+    /** @brief Build the curve of a keyframe list
+        @param useOpacity for rects, whether the opacity is part of the value
+        @param frameSize for rotoscoping, the size of the frame used to scale the spline points
+        @param colorAnimation for colors, the properties (locale, fps) in which the MLT animation of the keyframes is built
+    */
+    static std::shared_ptr<const KeyframeCurve> compile(const KeyframeList &keyframes, ParamType type, double fps, bool useOpacity = false,
+                                                        const QSize &frameSize = QSize(), const std::shared_ptr<Mlt::Properties> &colorAnimation = nullptr);
+
+    /** @brief False if this curve cannot evaluate its keyframes, in which case the MLT animation must be used */
+    bool isSupported() const;
+    /** @brief True if this curve was built for the given project settings */
+    bool matches(double fps, const QSize &frameSize) const;
+    int keyframeCount() const;
+
+    /** @brief Returns the value at a frame, formatted like the parameter value */
+    QVariant value(int frame) const;
+    /** @brief Returns one numeric component of the value at a frame (x, y, w, h, opacity for rects) */
+    double component(int frame, int component = 0) const;
+    /** @brief Returns a numeric component for each frame in [start, end], walking the keyframes only once. Used to draw curves */
+    QVector<double> componentRange(int start, int end, int component = 0) const;
+
+private:
+    KeyframeCurve() = default;
+    /** @brief Index of the keyframe starting the segment containing frame, or -1 before the first keyframe */
+    int segmentIndex(int frame) const;
+    /** @brief Interpolate a component in the segment starting at keyframe ix */
+    double interpolate(int ix, int frame, int component) const;
+    QVariant rotoValue(int ix, int frame) const;
+
+    ParamType m_type{ParamType::KeyframeParam};
+    bool m_supported{false};
+    double m_fps{0.};
+    QSize m_frameSize;
+    bool m_useOpacity{false};
+    /** @brief Number of numeric components per keyframe */
+    int m_components{1};
+    std::vector<int> m_frames;
+    std::vector<int> m_types;
+    /** @brief m_components values per keyframe */
+    std::vector<double> m_values;
+    /** @brief The original keyframe values, returned as is on keyframes */
+    std::vector<QVariant> m_keyValues;
+    std::vector<QList<BPoint>> m_points;
+    std::shared_ptr<Mlt::Properties> m_colorAnimation;
+    /** @brief Protects m_colorAnimation, which is not safe to query from several threads */
+    mutable QMutex m_colorMutex;
+};
@@ -6,6 +6,7 @@
 #include "keyframemodel.hpp"
 #include "../../bpoint.h"
 #include "core.h"
+#include "keyframecurve.hpp"
 #include "doc/docundostack.hpp"
 #include "macros.hpp"
 #include "profiles/profilemodel.hpp"
@@ -532,6 +533,7 @@ Fun KeyframeModel::updateKeyframe_lambda(GenTime pos, KeyframeType type, const Q
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateCurve();
         if (notify) Q_EMIT dataChanged(index(row), index(row), {ValueRole, NormalizedValueRole, TypeRole});
         return true;
     };
@@ -552,6 +554,7 @@ Fun KeyframeModel::addKeyframe_lambda(GenTime pos, KeyframeType type, const QVar
         if (notify) beginInsertRows(QModelIndex(), insertionRow, insertionRow);
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateCurve();
         if (notify) endInsertRows();
         return true;
     };
@@ -568,6 +571,7 @@ Fun KeyframeModel::deleteKeyframe_lambda(GenTime pos, bool notify)
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         if (notify) beginRemoveRows(QModelIndex(), row, row);
         m_keyframeList.erase(pos);
+        invalidateCurve();
         if (notify) endRemoveRows();
         qDebug() << "after" << getAnimProperty();
         return true;
@@ -623,35 +627,7 @@ QVariant KeyframeModel::data(const QModelIndex &index, int role) const
         if (m_paramType == ParamType::Roto_spline) {
             return 0.5;
         }
-        double val = it->second.second.toDouble();
-        if (auto ptr = m_model.lock()) {
-            Q_ASSERT(m_index.isValid());
-            double min = ptr->data(m_index, AssetParameterModel::VisualMinRole).toDouble();
-            double max = ptr->data(m_index, AssetParameterModel::VisualMaxRole).toDouble();
-            if (qFuzzyIsNull(min) && qFuzzyIsNull(max)) {
-                min = ptr->data(m_index, AssetParameterModel::MinRole).toDouble();
-                max = ptr->data(m_index, AssetParameterModel::MaxRole).toDouble();
-            }
-            double factor = ptr->data(m_index, AssetParameterModel::FactorRole).toDouble();
-            double norm = ptr->data(m_index, AssetParameterModel::DefaultRole).toDouble();
-            int logRole = ptr->data(m_index, AssetParameterModel::ScaleRole).toInt();
-            double linear = val * factor;
-            if (logRole == -1) {
-                // Logarythmic scale
-                // transform current value to 0..1 scale
-                if (linear >= norm) {
-                    double scaled = (linear - norm) / (max * factor - norm);
-                    return 0.5 + pow(scaled, 0.6) * 0.5;
-                }
-                double scaled = (linear - norm) / (min * factor - norm);
-                // Log scale
-                return 0.5 - pow(scaled, 0.6) * 0.5;
-            }
-            return (linear - min) / (max - min);
-        } else {
-            qDebug() << "// CANNOT LOCK effect MODEL";
-        }
-        return 1;
+        return normalizeValues({it->second.second.toDouble()}).constFirst();
     }
     case PosRole:
         return it->first.seconds();
@@ -1102,6 +1078,44 @@ QVariant KeyframeModel::getNormalizedValue(double newVal) const
     return QVariant();
 }
 
+void KeyframeModel::invalidateCurve()
+{
+    m_revision++;
+    std::atomic_store(&m_curve, std::shared_ptr<const KeyframeCurve>());
+}
+
+std::shared_ptr<const KeyframeCurve> KeyframeModel::compiledCurve() const
+{
+    const double fps = pCore->getCurrentFps();
+    const QSize frameSize = m_paramType == ParamType::Roto_spline ? pCore->getCurrentFrameSize() : QSize();
+    std::shared_ptr<const KeyframeCurve> curve = std::atomic_load(&m_curve);
+    if (curve && curve->matches(fps, frameSize)) {
+        return curve;
+    }
+    KeyframeCurve::KeyframeList keyframes;
+    int revision;
+    {
+        READ_LOCK();
+        keyframes = m_keyframeList;
+        revision = m_revision;
+    }
+    bool useOpacity = false;
+    std::shared_ptr<Mlt::Properties> colorAnimation;
+    if (auto ptr = m_model.lock()) {
+        useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
+        if (m_paramType == ParamType::Color) {
+            colorAnimation = std::make_shared<Mlt::Properties>();
+            ptr->passProperties(*colorAnimation.get());
+        }
+    }
+    curve = KeyframeCurve::compile(keyframes, m_paramType, fps, useOpacity, frameSize, colorAnimation);
+    if (m_revision == revision) {
+        // Don't keep a curve if the keyframes changed while compiling it
+        std::atomic_store(&m_curve, curve);
+    }
+    return curve;
+}
+
 QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
 {
     if (m_keyframeList.count(pos) > 0) {
@@ -1110,6 +1124,102 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
     if (m_keyframeList.size() == 0) {
         return QVariant();
     }
+    std::shared_ptr<const KeyframeCurve> curve = compiledCurve();
+    if (curve->isSupported()) {
+        return curve->value(pos.frames(pCore->getCurrentFps()));
+    }
+    return getMltInterpolatedValue(pos);
+}
+
+QVector<double> KeyframeModel::getInterpolatedRange(int start, int end, int component) const
+{
+    if (m_keyframeList.size() == 0 || end < start) {
+        return QVector<double>();
+    }
+    std::shared_ptr<const KeyframeCurve> curve = compiledCurve();
+    if (curve->isSupported()) {
+        return curve->componentRange(start, end, component);
+    }
+    QVector<double> result;
+    if (m_paramType != ParamType::KeyframeParam && m_paramType != ParamType::ColorWheel && m_paramType != ParamType::AnimatedRect) {
+        return result;
+    }
+    result.reserve(end - start + 1);
+    for (int frame = start; frame <= end; ++frame) {
+        const QVariant value = getInterpolatedValue(frame);
+        if (m_paramType == ParamType::AnimatedRect) {
+            result << value.toString().split(QLatin1Char(' '), Qt::SkipEmptyParts).value(component).toDouble();
+        } else {
+            result << value.toDouble();
+        }
+    }
+    return result;
+}
+
+QVariantList KeyframeModel::getNormalizedRange(int start, int end, int step) const
+{
+    QVariantList result;
+    if (step < 1 || m_paramType == ParamType::Roto_spline) {
+        return result;
+    }
+    // Rects are drawn through their opacity, which is already normalized
+    const bool isRect = m_paramType == ParamType::AnimatedRect;
+    const QVector<double> range = getInterpolatedRange(start, end, isRect ? 4 : 0);
+    QVector<double> values;
+    values.reserve(range.size() / step + 1);
+    for (int i = 0; i < range.size(); i += step) {
+        values << range.at(i);
+    }
+    if (!isRect) {
+        values = normalizeValues(values);
+    }
+    result.reserve(values.size());
+    for (double value : qAsConst(values)) {
+        result << value;
+    }
+    return result;
+}
+
+QVector<double> KeyframeModel::normalizeValues(QVector<double> values) const
+{
+    auto ptr = m_model.lock();
+    if (!ptr) {
+        qDebug() << "// CANNOT LOCK effect MODEL";
+        values.fill(1.);
+        return values;
+    }
+    Q_ASSERT(m_index.isValid());
+    double min = ptr->data(m_index, AssetParameterModel::VisualMinRole).toDouble();
+    double max = ptr->data(m_index, AssetParameterModel::VisualMaxRole).toDouble();
+    if (qFuzzyIsNull(min) && qFuzzyIsNull(max)) {
+        min = ptr->data(m_index, AssetParameterModel::MinRole).toDouble();
+        max = ptr->data(m_index, AssetParameterModel::MaxRole).toDouble();
+    }
+    double factor = ptr->data(m_index, AssetParameterModel::FactorRole).toDouble();
+    double norm = ptr->data(m_index, AssetParameterModel::DefaultRole).toDouble();
+    int logRole = ptr->data(m_index, AssetParameterModel::ScaleRole).toInt();
+    for (double &val : values) {
+        double linear = val * factor;
+        if (logRole == -1) {
+            // Logarythmic scale
+            // transform current value to 0..1 scale
+            if (linear >= norm) {
+                double scaled = (linear - norm) / (max * factor - norm);
+                val = 0.5 + pow(scaled, 0.6) * 0.5;
+            } else {
+                double scaled = (linear - norm) / (min * factor - norm);
+                // Log scale
+                val = 0.5 - pow(scaled, 0.6) * 0.5;
+            }
+        } else {
+            val = (linear - min) / (max - min);
+        }
+    }
+    return values;
+}
+
+QVariant KeyframeModel::getMltInterpolatedValue(const GenTime &pos) const
+{
     Mlt::Properties mlt_prop;
     QString animData;
     int out = 0;
@@ -13,10 +13,12 @@
 #include <QAbstractListModel>
 #include <QReadWriteLock>
 
+#include <atomic>
 #include <map>
 #include <memory>
 
 class AssetParameterModel;
+class KeyframeCurve;
 class DocUndoStack;
 class EffectItemModel;
 
@@ -142,6 +144,14 @@ public:
     /** @brief Return the interpolated value at given pos */
     QVariant getInterpolatedValue(int pos) const;
     QVariant getInterpolatedValue(const GenTime &pos) const;
+    /** @brief Return a numeric component (x, y, w, h, opacity for rects) of the interpolated value for each frame in [start, end].
+        This is much faster than calling getInterpolatedValue on each frame, for example to draw the curve of a parameter
+     */
+    QVector<double> getInterpolatedRange(int start, int end, int component = 0) const;
+    /** @brief Return the interpolated value on the 0..1 scale of the keyframe view, for one frame out of @param step in [start, end].
+        Used by the timeline to draw the curve of smooth keyframes
+     */
+    Q_INVOKABLE QVariantList getNormalizedRange(int start, int end, int step = 1) const;
     QVariant updateInterpolated(const QVariant &interpValue, double val);
     /** @brief Return the real value from a normalized one */
     QVariant getNormalizedValue(double newVal) const;
@@ -193,6 +203,15 @@ protected:
     void parseAnimProperty(const QString &prop);
     void parseRotoProperty(const QString &prop);
 
+    /** @brief Returns the compiled curve of the keyframes, built on first use after a modification */
+    std::shared_ptr<const KeyframeCurve> compiledCurve() const;
+    /** @brief Drop the compiled curve, must be called whenever m_keyframeList changes */
+    void invalidateCurve();
+    /** @brief Convert parameter values to the 0..1 scale of the keyframe view (NormalizedValueRole) */
+    QVector<double> normalizeValues(QVector<double> values) const;
+    /** @brief Interpolate a value through an MLT animation, for the values the compiled curve cannot handle */
+    QVariant getMltInterpolatedValue(const GenTime &pos) const;
+
 private:
     std::weak_ptr<AssetParameterModel> m_model;
     std::weak_ptr<DocUndoStack> m_undoStack;
@@ -203,6 +222,10 @@ private:
     mutable QReadWriteLock m_lock;
 
     std::map<GenTime, std::pair<KeyframeType, QVariant>> m_keyframeList;
+    /** @brief Compiled form of m_keyframeList, only accessed with std::atomic_load / std::atomic_store */
+    mutable std::shared_ptr<const KeyframeCurve> m_curve;
+    /** @brief Incremented on each change of m_keyframeList, so that a curve compiled during a change is not kept */
+    std::atomic<int> m_revision{0};
     bool moveOneKeyframe(GenTime oldPos, GenTime pos, QVariant newVal, Fun &undo, Fun &redo, bool updateView = true);
 
 Q_SIGNALS:
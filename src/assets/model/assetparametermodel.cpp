@@ -10,6 +10,7 @@
 #include "kdenlivesettings.h"
 #include "klocalizedstring.h"
 #include "profiles/profilemodel.hpp"
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QDirIterator>
@@ -17,8 +18,16 @@
 #include <QJsonObject>
 #include <QRegularExpression>
 #include <QString>
+#include <QThread>
 #define DEBUG_LOCALE false
 
+namespace {
+/** @brief Interval in ms between two notifications of parameter changes, about one display frame */
+const int updateTickInterval = 16;
+/** @brief Delay in ms without parameter change before an effect is rebuilt */
+const int replugDelay = 250;
+} // namespace
+
 AssetParameterModel::AssetParameterModel(std::unique_ptr<Mlt::Properties> asset, const QDomElement &assetXml, const QString &assetId, ObjectId ownerId,
                                          const QString &originalDecimalPoint, QObject *parent)
     : QAbstractListModel(parent)
@@ -32,6 +41,9 @@ AssetParameterModel::AssetParameterModel(std::unique_ptr<Mlt::Properties> asset,
     , m_filterProgress(0)
 {
     Q_ASSERT(m_asset->is_valid());
+    m_replugTimer.setSingleShot(true);
+    m_replugTimer.setInterval(replugDelay);
+    connect(&m_replugTimer, &QTimer::timeout, this, [this]() { Q_EMIT replugEffect(shared_from_this()); });
     QDomNodeList parameterNodes = assetXml.elementsByTagName(QStringLiteral("parameter"));
     m_hideKeyframesByDefault = assetXml.hasAttribute(QStringLiteral("hideKeyframes"));
     m_isAudio = assetXml.attribute(QStringLiteral("type")) == QLatin1String("audio");
@@ -275,22 +287,93 @@ void AssetParameterModel::setParameter(const QString &name, int value, bool upda
             effectParam << m_asset->get(pName.toUtf8().constData());
         }
         m_asset->set("effect", effectParam.join(QLatin1Char(' ')).toUtf8().constData());
-        Q_EMIT replugEffect(shared_from_this());
+        requestReplug();
     } else if (m_assetId.startsWith(QStringLiteral("ladspa"))) {
         // these effects don't understand param change and need to be rebuild
-        Q_EMIT replugEffect(shared_from_this());
+        requestReplug();
     }
     if (update) {
         Q_EMIT modelChanged();
-        Q_EMIT dataChanged(index(0, 0), index(m_rows.count() - 1, 0), {});
-        // Update fades in timeline
+        notifyOwner(true);
+    }
+}
+
+void AssetParameterModel::requestReplug()
+{
+    if (QThread::currentThread() != m_replugTimer.thread()) {
+        Q_EMIT replugEffect(shared_from_this());
+        return;
+    }
+    // Restart the timer, so that a slider drag only rebuilds the effect once released
+    m_replugTimer.start();
+}
+
+AssetParameterModel::PendingUpdates &AssetParameterModel::pendingUpdates()
+{
+    static PendingUpdates updates;
+    return updates;
+}
+
+void AssetParameterModel::sendPendingUpdates()
+{
+    PendingUpdates &pending = pendingUpdates();
+    const QVector<QPointer<AssetParameterModel>> models = pending.models;
+    const QVector<QPair<ObjectId, QString>> items = pending.items;
+    const QVector<ObjectId> renders = pending.renders;
+    pending.models.clear();
+    pending.items.clear();
+    pending.renders.clear();
+    for (const auto &model : models) {
+        if (model) {
+            Q_EMIT model->dataChanged(model->index(0, 0), model->index(model->m_rows.count() - 1, 0), {});
+        }
+    }
+    for (const auto &item : items) {
+        pCore->updateItemModel(item.first, item.second);
+    }
+    for (const auto &owner : renders) {
+        pCore->refreshProjectItem(owner);
+        pCore->invalidateItem(owner);
+    }
+}
+
+void AssetParameterModel::notifyOwner(bool allRowsChanged)
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (app == nullptr || QThread::currentThread() != app->thread()) {
+        if (allRowsChanged) {
+            Q_EMIT dataChanged(index(0, 0), index(m_rows.count() - 1, 0), {});
+        }
         pCore->updateItemModel(m_ownerId, m_assetId);
         if (!m_isAudio) {
-            // Trigger monitor refresh
             pCore->refreshProjectItem(m_ownerId);
-            // Invalidate timeline preview
             pCore->invalidateItem(m_ownerId);
         }
+        return;
+    }
+    PendingUpdates &pending = pendingUpdates();
+    if (allRowsChanged && !pending.models.contains(this)) {
+        // Every parameter widget of the asset is refreshed, once per tick is enough to follow a drag
+        pending.models.append(this);
+    }
+    const QPair<ObjectId, QString> item(m_ownerId, m_assetId);
+    if (!pending.items.contains(item)) {
+        // Update fades in timeline
+        pending.items.append(item);
+    }
+    if (!m_isAudio && !pending.renders.contains(m_ownerId)) {
+        // Trigger monitor refresh and invalidate timeline preview
+        pending.renders.append(m_ownerId);
+    }
+    if (pending.timer == nullptr) {
+        pending.timer = new QTimer(app);
+        pending.timer->setSingleShot(true);
+        pending.timer->setInterval(updateTickInterval);
+        QObject::connect(pending.timer, &QTimer::timeout, app, &AssetParameterModel::sendPendingUpdates);
+    }
+    // Don't restart an active timer, a continuous drag still refreshes the monitor on each tick
+    if (!pending.timer->isActive()) {
+        pending.timer->start();
     }
 }
 
@@ -393,14 +476,13 @@ void AssetParameterModel::setParameter(const QString &name, const QString &param
             effectParam << m_asset->get(pName.toUtf8().constData());
         }
         m_asset->set("effect", effectParam.join(QLatin1Char(' ')).toUtf8().constData());
-        Q_EMIT replugEffect(shared_from_this());
+        requestReplug();
         updateChildRequired = false;
     } else if (m_assetId.startsWith(QStringLiteral("ladspa"))) {
         // these effects don't understand param change and need to be rebuild
-        Q_EMIT replugEffect(shared_from_this());
+        requestReplug();
         updateChildRequired = false;
     } else if (update) {
-        qDebug() << "// SENDING DATA CHANGE....";
         if (paramIndex.isValid()) {
             Q_EMIT dataChanged(paramIndex, paramIndex);
         } else {
@@ -417,14 +499,7 @@ void AssetParameterModel::setParameter(const QString &name, const QString &param
         // Used for generator clips
         if (!update) Q_EMIT modelChanged();
     } else {
-        // Update fades in timeline
-        pCore->updateItemModel(m_ownerId, m_assetId);
-        if (!m_isAudio) {
-            // Trigger monitor refresh
-            pCore->refreshProjectItem(m_ownerId);
-            // Invalidate timeline preview
-            pCore->invalidateItem(m_ownerId);
-        }
+        notifyOwner();
     }
 }
 
@@ -889,6 +964,20 @@ bool AssetParameterModel::isActive() const
     return m_active;
 }
 
+qint64 AssetParameterModel::memoryCost() const
+{
+    // Each parameter also holds its xml definition, count a few hundred bytes for it
+    const qint64 paramCost = 512;
+    qint64 cost = qint64(sizeof(AssetParameterModel));
+    for (const auto &param : m_params) {
+        cost += paramCost + (param.first.size() + param.second.value.toString().size()) * qint64(sizeof(QChar));
+    }
+    for (const auto &fixed : m_fixedParams) {
+        cost += (fixed.first.size() + fixed.second.toString().size()) * qint64(sizeof(QChar));
+    }
+    return cost;
+}
+
 QVector<QPair<QString, QVariant>> AssetParameterModel::getAllParameters() const
 {
     QVector<QPair<QString, QVariant>> res;
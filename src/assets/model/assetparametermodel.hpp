@@ -10,6 +10,8 @@
 #include <QAbstractListModel>
 #include <QDomElement>
 #include <QJsonDocument>
+#include <QPointer>
+#include <QTimer>
 #include <unordered_map>
 
 #include <memory>
@@ -148,6 +150,8 @@ public:
 
     /** @brief Return all the parameters as pairs (parameter name, parameter value) */
     QVector<QPair<QString, QVariant>> getAllParameters() const;
+    /** @brief Estimated memory used by this asset and its parameter values, reported when an undo command keeps it alive */
+    qint64 memoryCost() const;
     /** @brief Get a parameter value from its name */
     const QVariant getParamFromName(const QString &paramName);
     /** @brief Returns a json definition of the effect with all param values
@@ -258,6 +262,28 @@ protected:
      *  building an effect in the constructor, so that we don't call shared_from_this
      */
     void internalSetParameter(const QString &name, const QString &paramValue, const QModelIndex &paramIndex = QModelIndex());
+    /** @brief Effects that don't understand parameter changes (sox, ladspa) are rebuilt once their parameters stop changing */
+    QTimer m_replugTimer;
+    /** @brief Request a rebuild of the effect after a parameter change */
+    void requestReplug();
+    /** @brief Notify the owner of the asset that its rendering changed: timeline fades, monitor refresh and timeline preview.
+     *  The notifications of all the assets are sent at most once per display frame while parameters are changed interactively
+     *  @param allRowsChanged if true, the dataChanged signal of all the rows is also delayed to the next tick */
+    void notifyOwner(bool allRowsChanged = false);
+    /** @brief Notifications collected during the current tick, for all the assets */
+    struct PendingUpdates
+    {
+        QTimer *timer = nullptr;
+        /** @brief Models whose rows all changed */
+        QVector<QPointer<AssetParameterModel>> models;
+        /** @brief Owners and asset ids whose timeline representation may change (fades) */
+        QVector<QPair<ObjectId, QString>> items;
+        /** @brief Owners requiring a monitor refresh and a timeline preview invalidation */
+        QVector<ObjectId> renders;
+    };
+    static PendingUpdates &pendingUpdates();
+    /** @brief Send the notifications collected during the tick */
+    static void sendPendingUpdates();
 
 Q_SIGNALS:
     void modelChanged();
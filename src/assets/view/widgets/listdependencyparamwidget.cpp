@@ -7,6 +7,7 @@
 #include "assets/model/assetparametermodel.hpp"
 #include "core.h"
 #include "mainwindow.h"
+#include "utils/lumathumbnailcache.hpp"
 
 #include <QDir>
 #include <QDomDocument>
@@ -155,7 +156,6 @@ void ListDependencyParamWidget::slotRefresh()
     m_lastProcessedAlgo = value;
     if (values.first() == QLatin1String("%lumaPaths")) {
         // Special case: Luma files
-        // Create thumbnails
         if (pCore->getCurrentFrameSize().width() > 1000) {
             // HD project
             values = MainWindow::m_lumaFiles.value(QStringLiteral("16_9"));
@@ -173,12 +173,8 @@ void ListDependencyParamWidget::slotRefresh()
             const QString &entry = values.at(j);
             const QString name = values.at(j).section(QLatin1Char('/'), -1);
             m_list->addItem(pCore->nameForLumaFile(name), entry);
-            if (!entry.isEmpty() && (entry.endsWith(QLatin1String(".png")) || entry.endsWith(QLatin1String(".pgm")))) {
-                if (MainWindow::m_lumacache.contains(entry)) {
-                    m_list->setItemIcon(j + 1, QPixmap::fromImage(MainWindow::m_lumacache.value(entry)));
-                }
-            }
         }
+        LumaThumbnailCache::get()->setComboIcons(m_list);
         if (!value.isEmpty() && values.contains(value)) {
             m_list->setCurrentIndex(values.indexOf(value) + 1);
         }
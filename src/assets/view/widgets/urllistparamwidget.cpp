@@ -9,6 +9,7 @@
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
 #include "mltconnection.h"
+#include "utils/lumathumbnailcache.hpp"
 
 #include <QDirIterator>
 #include <QFileDialog>
@@ -186,22 +187,10 @@ void UrlListParamWidget::slotRefresh()
     QMapIterator<QString, QString> i(entryMap);
     while (i.hasNext()) {
         i.next();
-        const QString &entry = i.value();
-        m_list->addItem(i.key(), entry);
-        int ix = m_list->findData(entry);
-        // Create thumbnails
-        if (!entry.isEmpty() && (entry.toLower().endsWith(QLatin1String(".png")) || entry.toLower().endsWith(QLatin1String(".pgm")))) {
-            if (MainWindow::m_lumacache.contains(entry)) {
-                m_list->setItemIcon(ix, QPixmap::fromImage(MainWindow::m_lumacache.value(entry)));
-            } else {
-                QImage pix(entry);
-                if (!pix.isNull()) {
-                    MainWindow::m_lumacache.insert(entry, pix.scaled(50, 30, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                    m_list->setItemIcon(ix, QPixmap::fromImage(MainWindow::m_lumacache.value(entry)));
-                }
-            }
-        }
+        m_list->addItem(i.key(), i.value());
     }
+    // Thumbnails are loaded in the background
+    LumaThumbnailCache::get()->setComboIcons(m_list);
     m_list->addItem(i18n("Custom…"), QStringLiteral("custom_file"));
 
     // select current value
@@ -187,6 +187,17 @@ void AudioLevelWidget::setAudioValues(const QVector<double> &values)
     update();
 }
 
+void AudioLevelWidget::setLoudness(double momentary, double shortTerm, double integrated, double truePeak)
+{
+    m_loudness = {momentary, shortTerm, integrated, truePeak};
+}
+
+QString AudioLevelWidget::loudnessText(double momentary, double shortTerm, double integrated, double truePeak)
+{
+    return i18n("Momentary: %1 LUFS\nShort term: %2 LUFS\nIntegrated: %3 LUFS\nTrue peak: %4 dBTP", QString::number(momentary, 'f', 1),
+                QString::number(shortTerm, 'f', 1), QString::number(integrated, 'f', 1), QString::number(truePeak, 'f', 1));
+}
+
 void AudioLevelWidget::setVisibility(bool enable)
 {
     if (enable) {
@@ -243,5 +254,8 @@ void AudioLevelWidget::updateToolTip()
             tip.append(i18nc("R as in Right", "\nR:"));
         }
     }
+    if (!m_loudness.isEmpty()) {
+        tip.append(QLatin1Char('\n') + loudnessText(m_loudness.at(0), m_loudness.at(1), m_loudness.at(2), m_loudness.at(3)));
+    }
     QToolTip::showText(QCursor::pos(), tip, this);
 }
@@ -21,6 +21,8 @@ public:
     void refreshPixmap();
     int audioChannels;
     void setVisibility(bool enable);
+    /** @brief Describe the loudness in LUFS and true peak in dBTP of the measured audio */
+    static QString loudnessText(double momentary, double shortTerm, double integrated, double truePeak);
 
 protected:
     void paintEvent(QPaintEvent *) override;
@@ -45,10 +47,14 @@ private:
     int m_channelDistance;
     int m_channelFillWidth;
     bool m_displayToolTip;
+    /** @brief Momentary, short term, integrated loudness and true peak displayed in the tooltip, empty if not measured */
+    QVector<double> m_loudness;
     void drawBackground(int channels = 2);
     /** @brief Update tooltip with current dB values */
     void updateToolTip();
 
 public Q_SLOTS:
     void setAudioValues(const QVector<double> &values);
+    /** @brief Display the loudness in LUFS and true peak in dBTP of the measured audio */
+    void setLoudness(double momentary, double shortTerm, double integrated, double truePeak);
 };
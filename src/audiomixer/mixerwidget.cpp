@@ -44,21 +44,22 @@ static inline int fromDB(double level)
     return value;
 }
 
+constexpr int MixerWidget::MaxChannels;
+
 void MixerWidget::property_changed(mlt_service, MixerWidget *widget, mlt_event_data data)
 {
     if (widget && !strcmp(Mlt::EventData(data).to_string(), "_position")) {
         mlt_properties filter_props = MLT_FILTER_PROPERTIES(widget->m_monitorFilter->get_filter());
-        int pos = mlt_properties_get_int(filter_props, "_position");
-        if (!widget->m_levels.contains(pos)) {
-            QVector<double> levels;
-            for (int i = 0; i < widget->m_channels; i++) {
+        FrameLevels levels;
+        levels.position = mlt_properties_get_int(filter_props, "_position");
+        if (levels.position != widget->m_lastQueued) {
+            for (size_t i = 0; i < widget->m_levelProperties.size(); i++) {
                 // NOTE: this is an approximation. To get the real peak level, we need version 2 of audiolevel MLT filter, see property_changedV2
-                levels << log10(mlt_properties_get_double(filter_props, QString("_audio_level.%1").arg(i).toUtf8().constData()) / 1.18) * 20;
-            }
-            widget->m_levels[pos] = std::move(levels);
-            if (widget->m_levels.size() > widget->m_maxLevels) {
-                widget->m_levels.erase(widget->m_levels.begin());
+                levels.levels[i] = log10(mlt_properties_get_double(filter_props, widget->m_levelProperties[i].constData()) / 1.18) * 20;
             }
+            widget->m_lastQueued = levels.position;
+            // Never wait for the GUI in the consumer thread, drop the levels if it is late
+            widget->m_levels.push(levels);
         }
     }
 }
@@ -67,16 +68,14 @@ void MixerWidget::property_changedV2(mlt_service, MixerWidget *widget, mlt_event
 {
     if (widget && !strcmp(Mlt::EventData(data).to_string(), "_position")) {
         mlt_properties filter_props = MLT_FILTER_PROPERTIES(widget->m_monitorFilter->get_filter());
-        int pos = mlt_properties_get_int(filter_props, "_position");
-        if (!widget->m_levels.contains(pos)) {
-            QVector<double> levels;
-            for (int i = 0; i < widget->m_channels; i++) {
-                levels << mlt_properties_get_double(filter_props, QString("_audio_level.%1").arg(i).toUtf8().constData());
-            }
-            widget->m_levels[pos] = std::move(levels);
-            if (widget->m_levels.size() > widget->m_maxLevels) {
-                widget->m_levels.erase(widget->m_levels.begin());
+        FrameLevels levels;
+        levels.position = mlt_properties_get_int(filter_props, "_position");
+        if (levels.position != widget->m_lastQueued) {
+            for (size_t i = 0; i < widget->m_levelProperties.size(); i++) {
+                levels.levels[i] = mlt_properties_get_double(filter_props, widget->m_levelProperties[i].constData());
             }
+            widget->m_lastQueued = levels.position;
+            widget->m_levels.push(levels);
         }
     }
 }
@@ -91,6 +90,8 @@ MixerWidget::MixerWidget(int tid, std::shared_ptr<Mlt::Tractor> service, QString
     , m_channels(pCore->audioChannels())
     , m_balanceSlider(nullptr)
     , m_maxLevels(qMax(30, int(service->get_fps() * 1.5)))
+    , m_levels(size_t(m_maxLevels))
+    , m_lastQueued(-1)
     , m_solo(nullptr)
     , m_collapse(nullptr)
     , m_monitor(nullptr)
@@ -113,6 +114,8 @@ MixerWidget::MixerWidget(int tid, Mlt::Tractor *service, QString trackTag, const
     , m_balanceSpin(nullptr)
     , m_balanceSlider(nullptr)
     , m_maxLevels(qMax(30, int(service->get_fps() * 1.5)))
+    , m_levels(size_t(m_maxLevels))
+    , m_lastQueued(-1)
     , m_solo(nullptr)
     , m_collapse(nullptr)
     , m_monitor(nullptr)
@@ -141,6 +144,10 @@ void MixerWidget::buildUI(Mlt::Tractor *service, const QString &trackName)
         m_audioData << -100;
     }
     m_audioMeterWidget->setAudioValues(m_audioData);
+    // Property names are built once, they are read for each frame
+    for (int i = 0; i < qMin(m_channels, int(MaxChannels)); i++) {
+        m_levelProperties.push_back(QStringLiteral("_audio_level.%1").arg(i).toUtf8());
+    }
 
     // Build volume widget
     m_volumeSlider = new QSlider(Qt::Vertical, this);
@@ -354,7 +361,7 @@ void MixerWidget::buildUI(Mlt::Tractor *service, const QString &trackName)
             m_volumeSpin->setValue(dbValue);
             m_levelFilter->set("level", dbValue);
             m_levelFilter->set("disable", value == 60 ? 1 : 0);
-            m_levels.clear();
+            clear();
             Q_EMIT m_manager->purgeCache();
             pCore->setDocumentModified();
         }
@@ -366,7 +373,7 @@ void MixerWidget::buildUI(Mlt::Tractor *service, const QString &trackName)
             if (m_balanceFilter != nullptr) {
                 m_balanceFilter->set("start", (value + 50) / 100.);
                 m_balanceFilter->set("disable", value == 0 ? 1 : 0);
-                m_levels.clear();
+                clear();
                 Q_EMIT m_manager->purgeCache();
                 pCore->setDocumentModified();
             }
@@ -476,10 +483,22 @@ void MixerWidget::updateLabel()
 
 void MixerWidget::updateAudioLevel(int pos)
 {
-    QMutexLocker lk(&m_storeMutex);
-    if (m_levels.contains(pos)) {
-        m_audioMeterWidget->setAudioValues(m_levels.value(pos));
-        // m_levels.remove(pos);
+    if (pos < m_displayed.position) {
+        // Seeking back, the queued levels are outdated
+        m_levels.clear();
+        m_displayed.position = -1;
+    }
+    // Skip the levels of frames that were not displayed
+    while (const FrameLevels *next = m_levels.front()) {
+        if (next->position > pos) {
+            break;
+        }
+        m_levels.pop(m_displayed);
+    }
+    if (m_displayed.position == pos) {
+        QVector<double> values(int(m_levelProperties.size()));
+        std::copy(m_displayed.levels.begin(), m_displayed.levels.begin() + values.size(), values.begin());
+        m_audioMeterWidget->setAudioValues(values);
     } else {
         m_audioMeterWidget->setAudioValues(m_audioData);
     }
@@ -487,15 +506,14 @@ void MixerWidget::updateAudioLevel(int pos)
 
 void MixerWidget::reset()
 {
-    QMutexLocker lk(&m_storeMutex);
-    m_levels.clear();
+    clear();
     m_audioMeterWidget->setAudioValues(m_audioData);
 }
 
 void MixerWidget::clear()
 {
-    QMutexLocker lk(&m_storeMutex);
     m_levels.clear();
+    m_displayed.position = -1;
 }
 
 bool MixerWidget::isMute() const
@@ -581,6 +599,7 @@ void MixerWidget::connectMixer(bool doConnect)
         if (m_tid == -1) {
             // Master level
             connect(pCore.get(), &Core::audioLevelsAvailable, m_audioMeterWidget.get(), &AudioLevelWidget::setAudioValues);
+            connect(pCore.get(), &Core::audioLoudnessAvailable, m_audioMeterWidget.get(), &AudioLevelWidget::setLoudness);
         } else if (m_listener == nullptr) {
             m_listener = m_monitorFilter->listen("property-changed", this,
                                                  m_manager->audioLevelV2() ? reinterpret_cast<mlt_listener>(property_changedV2)
@@ -589,6 +608,7 @@ void MixerWidget::connectMixer(bool doConnect)
     } else {
         if (m_tid == -1) {
             disconnect(pCore.get(), &Core::audioLevelsAvailable, m_audioMeterWidget.get(), &AudioLevelWidget::setAudioValues);
+            disconnect(pCore.get(), &Core::audioLoudnessAvailable, m_audioMeterWidget.get(), &AudioLevelWidget::setLoudness);
         } else {
             delete m_listener;
             m_listener = nullptr;
@@ -7,11 +7,13 @@
 
 #include "definitions.h"
 #include "mlt++/MltService.h"
+#include "utils/spscqueue.hpp"
 
-#include <QMutex>
 #include <QWidget>
+#include <array>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 class KDualAction;
 class AudioLevelWidget;
@@ -77,13 +79,27 @@ protected:
     std::shared_ptr<Mlt::Filter> m_levelFilter;
     std::shared_ptr<Mlt::Filter> m_monitorFilter;
     std::shared_ptr<Mlt::Filter> m_balanceFilter;
-    QMap<int, QVector<double>> m_levels;
     int m_channels;
     KDualAction *m_muteAction;
     QSpinBox *m_balanceSpin;
     QSlider *m_balanceSlider;
     QDoubleSpinBox *m_volumeSpin;
     int m_maxLevels;
+    static constexpr int MaxChannels = 8;
+    /** @brief Audio levels of a frame, in dB */
+    struct FrameLevels
+    {
+        int position{-1};
+        std::array<double, MaxChannels> levels;
+    };
+    /** @brief Levels read by the monitor filter in the MLT consumer thread, waiting for the frame to be displayed */
+    SpscQueue<FrameLevels> m_levels;
+    /** @brief Names of the audio level properties of the monitor filter, one per channel */
+    std::vector<QByteArray> m_levelProperties;
+    /** @brief Position of the last queued levels, only used by the MLT consumer thread */
+    int m_lastQueued;
+    /** @brief Levels currently displayed, only used by the GUI thread */
+    FrameLevels m_displayed;
 
 private:
     std::shared_ptr<AudioLevelWidget> m_audioMeterWidget;
@@ -92,7 +108,6 @@ private:
     QToolButton *m_collapse;
     QToolButton *m_monitor;
     KSqueezedTextLabel *m_trackLabel;
-    QMutex m_storeMutex;
     double m_lastVolume;
     QVector<double> m_audioData;
     Mlt::Event *m_listener;
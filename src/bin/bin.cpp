@@ -1060,7 +1060,11 @@ void SmallJobLabel::slotSetJobCount(int jobCount)
     if (jobCount > 0) {
         // prepare animation
         setText(i18np("%1 job", "%1 jobs", jobCount));
-        setToolTip(i18np("%1 pending job", "%1 pending jobs", jobCount));
+        // Show the scheduler queue depth and latency to help diagnose slow thumbnails and waveforms
+        const TaskManagerStatistics stats = pCore->taskManager.statistics();
+        setToolTip(i18np("%1 pending job", "%1 pending jobs", jobCount) + QLatin1Char('\n') +
+                   i18n("Waiting: %1, urgent: %2, paused: %3", stats.pending, stats.urgent, stats.preempted) + QLatin1Char('\n') +
+                   i18n("Average wait: %1 ms, longest wait: %2 ms", stats.averageWait, stats.maxWait));
 
         if (style()->styleHint(QStyle::SH_Widget_Animate, nullptr, this) != 0) {
             setFixedWidth(sizeHint().width());
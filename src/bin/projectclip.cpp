@@ -19,6 +19,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "jobs/cliploadtask.h"
 #include "jobs/proxytask.h"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioLevelsPyramid.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
 #include "mltcontroller/clippropertiescontroller.h"
@@ -30,7 +31,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "projectitemmodel.h"
 #include "projectsubclip.h"
 #include "timeline2/model/snapmodel.hpp"
+#include "timeline2/view/previewmanager.h"
+#include "utils/filefingerprintcache.hpp"
 #include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailproducerpool.hpp"
 #include "utils/timecode.h"
 #include "xml/xml.hpp"
 
@@ -51,6 +55,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QMimeDatabase>
 #include <QPainter>
 #include <QProcess>
+#include <QSaveFile>
 #include <QtMath>
 
 #ifdef CRASH_AUTO_TEST
@@ -71,6 +76,37 @@ RTTR_REGISTRATION
 }
 #endif
 
+namespace {
+/** @brief Decode a thumbnail with the producers of the thumbnail pool */
+QImage renderThumbnail(Mlt::Producer &producer, int position)
+{
+    producer.seek(position);
+    QScopedPointer<Mlt::Frame> frame(producer.get_frame());
+    if (frame == nullptr || !frame->is_valid()) {
+        return QImage();
+    }
+    frame->set("consumer.deinterlacer", "onefield");
+    frame->set("consumer.top_field_first", -1);
+    frame->set("consumer.rescale", "nearest");
+    int fullWidth = qFuzzyCompare(pCore->getCurrentSar(), 1.0) ? 0 : qRound(pCore->thumbProfile()->height() * pCore->getCurrentDar());
+    if (fullWidth % 2 > 0) {
+        fullWidth++;
+    }
+    return KThumb::getFrame(frame.data(), 0, 0, fullWidth);
+}
+
+bool writeXmlFile(const QString &path, const QByteArray &xml)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write to file: " << path;
+        return false;
+    }
+    file.write(xml);
+    return file.commit();
+}
+} // namespace
+
 ProjectClip::ProjectClip(const QString &id, const QIcon &thumb, const std::shared_ptr<ProjectItemModel> &model, std::shared_ptr<Mlt::Producer> &producer)
     : AbstractProjectItem(AbstractProjectItem::ClipItem, id, model)
     , ClipController(id, producer)
@@ -111,12 +147,12 @@ ProjectClip::ProjectClip(const QString &id, const QIcon &thumb, const std::share
                 m_masterProducer->set("kdenlive:uuid", m_sequenceUuid.toString().toUtf8().constData());
                 m_masterProducer->parent().set("kdenlive:uuid", m_sequenceUuid.toString().toUtf8().constData());
             }
-            m_sequenceThumbFile.setFileTemplate(QDir::temp().absoluteFilePath(QStringLiteral("thumbs-%1-XXXXXX.mlt").arg(m_binId)));
         }
         m_thumbnail = thumb;
     }
     // Make sure we have a hash for this clip
     hash();
+    resetThumbProducers();
     m_boundaryTimer.setSingleShot(true);
     m_boundaryTimer.setInterval(500);
     if (hasLimitedDuration()) {
@@ -195,6 +231,7 @@ ProjectClip::ProjectClip(const QString &id, const QDomElement &description, cons
     m_boundaryTimer.setInterval(500);
     connect(m_markerModel.get(), &MarkerListModel::modelChanged, this,
             [&]() { setProducerProperty(QStringLiteral("kdenlive:markers"), m_markerModel->toJson()); });
+    resetThumbProducers();
 }
 
 std::shared_ptr<ProjectClip> ProjectClip::construct(const QString &id, const QDomElement &description, const QIcon &thumb,
@@ -398,7 +435,8 @@ size_t ProjectClip::frameDuration() const
 
 void ProjectClip::resetSequenceThumbnails()
 {
-    m_thumbsProducer.reset();
+    clearSequenceXml();
+    resetThumbProducers();
     ThumbnailCache::get()->invalidateThumbsForClip(m_binId);
     m_uuid = QUuid::createUuid();
     updateTimelineClips({TimelineModel::ClipThumbRole});
@@ -415,7 +453,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
         ThumbnailCache::get()->invalidateThumbsForClip(m_binId);
         pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::LOADJOB, true);
         pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::CACHEJOB);
-        m_thumbsProducer.reset();
+        resetThumbProducers();
         // Reset uuid to enforce reloading thumbnails from qml cache
         m_uuid = QUuid::createUuid();
         updateTimelineClips({TimelineModel::ClipThumbRole});
@@ -440,7 +478,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
         }
         if (!xml.isNull()) {
             bool hashChanged = false;
-            m_thumbsProducer.reset();
+            resetThumbProducers();
             ClipType::ProducerType type = clipType();
             if (type != ClipType::Color && type != ClipType::Image && type != ClipType::SlideShow) {
                 xml.removeAttribute("out");
@@ -463,7 +501,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudio
                 discardAudioThumb();
             }
             m_clipStatus = FileStatus::StatusWaiting;
-            m_thumbsProducer.reset();
+            resetThumbProducers();
             ClipLoadTask::start({ObjectType::BinClip, m_binId.toInt()}, xml, false, -1, -1, this);
         }
     }
@@ -589,7 +627,7 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool gene
     isReloading = false;
     getFileHash();
     Q_EMIT producerChanged(m_binId, m_masterProducer);
-    m_thumbsProducer.reset();
+    resetThumbProducers();
     connectEffectStack();
 
     // Update info
@@ -635,10 +673,6 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool gene
         // Generate video thumb
         ClipLoadTask::start({ObjectType::BinClip, m_binId.toInt()}, QDomElement(), true, -1, -1, this);
     }
-    if (KdenliveSettings::audiothumbnails() &&
-        (m_clipType == ClipType::AV || m_clipType == ClipType::Audio || m_clipType == ClipType::Playlist || m_clipType == ClipType::Unknown)) {
-        AudioLevelsTask::start({ObjectType::BinClip, m_binId.toInt()}, this, false);
-    }
     pCore->bin()->reloadMonitorIfActive(clipId());
     if (clearTrackProducers) {
         for (auto &p : m_audioProducers) {
@@ -703,6 +737,11 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool gene
         QMetaObject::invokeMethod(pCore->currentDoc(), "slotProxyCurrentItem", Q_ARG(bool, true), Q_ARG(QList<std::shared_ptr<ProjectClip>>, clipList),
                                   Q_ARG(bool, false));
     }
+    // Started after the proxy task: if the proxy is already being generated, the audio levels come from the proxy decoding pass
+    if (KdenliveSettings::audiothumbnails() &&
+        (m_clipType == ClipType::AV || m_clipType == ClipType::Audio || m_clipType == ClipType::Playlist || m_clipType == ClipType::Unknown)) {
+        AudioLevelsTask::start({ObjectType::BinClip, m_binId.toInt()}, this, false);
+    }
     return true;
 }
 
@@ -786,44 +825,113 @@ std::shared_ptr<Mlt::Producer> ProjectClip::thumbProducer()
     if (m_thumbsProducer) {
         return m_thumbsProducer;
     }
+    QMutexLocker lock(&m_thumbMutex);
+    m_thumbsProducer = buildThumbProducer();
+    return m_thumbsProducer;
+}
+
+std::shared_ptr<Mlt::Producer> ProjectClip::buildThumbProducer()
+{
     if (clipType() == ClipType::Unknown || m_masterProducer == nullptr || m_clipStatus == FileStatus::StatusWaiting) {
         return nullptr;
     }
-    QMutexLocker lock(&m_thumbMutex);
+    std::shared_ptr<Mlt::Producer> thumbsProducer;
     if (KdenliveSettings::gpu_accel()) {
         // TODO: when the original producer changes, we must reload this thumb producer
-        m_thumbsProducer = softClone(ClipController::getPassPropertiesList());
+        thumbsProducer = softClone(ClipController::getPassPropertiesList());
     } else if (m_clipType == ClipType::Timeline) {
-        if (!m_sequenceThumbFile.isOpen() && !m_sequenceThumbFile.open()) {
-            // Something went wrong
-            qWarning() << "Cannot write to temporary file: " << m_sequenceThumbFile.fileName();
-            return nullptr;
-        }
-        cloneProducerToFile(m_sequenceThumbFile.fileName());
-        m_thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), "consumer", m_sequenceThumbFile.fileName().toUtf8().constData()));
+        // Load the sequence from memory, the consumer producer renders it in the project profile and scales it to the thumbnail size
+        const QByteArray resource = QByteArrayLiteral("xml-string:") + sequenceXml();
+        thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), "consumer", resource.constData()));
     } else {
         QString mltService = m_masterProducer->get("mlt_service");
         const QString mltResource = m_masterProducer->get("resource");
         if (mltService == QLatin1String("avformat")) {
             mltService = QStringLiteral("avformat-novalidate");
         }
-        m_thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
+        thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
     }
-    if (m_thumbsProducer->is_valid()) {
+    if (thumbsProducer->is_valid()) {
         Mlt::Properties original(m_masterProducer->get_properties());
-        Mlt::Properties cloneProps(m_thumbsProducer->get_properties());
+        Mlt::Properties cloneProps(thumbsProducer->get_properties());
         cloneProps.pass_list(original, ClipController::getPassPropertiesList());
         Mlt::Filter scaler(*pCore->thumbProfile(), "swscale");
         Mlt::Filter padder(*pCore->thumbProfile(), "resize");
         Mlt::Filter converter(*pCore->thumbProfile(), "avcolor_space");
-        m_thumbsProducer->set("audio_index", -1);
+        thumbsProducer->set("audio_index", -1);
         // Required to make get_playtime() return > 1
-        m_thumbsProducer->set("out", m_thumbsProducer->get_length() - 1);
-        m_thumbsProducer->attach(scaler);
-        m_thumbsProducer->attach(padder);
-        m_thumbsProducer->attach(converter);
+        thumbsProducer->set("out", thumbsProducer->get_length() - 1);
+        thumbsProducer->attach(scaler);
+        thumbsProducer->attach(padder);
+        thumbsProducer->attach(converter);
     }
-    return m_thumbsProducer;
+    return thumbsProducer;
+}
+
+QImage ProjectClip::fetchThumbnail(int frame)
+{
+    if (m_clipType == ClipType::Timeline) {
+        // Decoding the timeline preview of the sequence is much cheaper than rendering its tracks
+        int offset = 0;
+        const QString chunk = PreviewManager::renderedChunkFile(m_sequenceUuid, frame, &offset);
+        if (!chunk.isEmpty()) {
+            Mlt::Producer producer(*pCore->thumbProfile(), "avformat-novalidate", chunk.toUtf8().constData());
+            if (producer.is_valid()) {
+                producer.set("audio_index", -1);
+                const QImage img = renderThumbnail(producer, offset);
+                if (!img.isNull()) {
+                    return img;
+                }
+            }
+        }
+    }
+    return m_thumbPool->requestFrame(frame);
+}
+
+QByteArray ProjectClip::sequenceXml()
+{
+    QMutexLocker lock(&m_sequenceXmlMutex);
+    if (m_sequenceXml.isEmpty()) {
+        m_sequenceXml = cloneProducerToXml();
+    }
+    return m_sequenceXml;
+}
+
+void ProjectClip::clearSequenceXml()
+{
+    QMutexLocker lock(&m_sequenceXmlMutex);
+    m_sequenceXml.clear();
+}
+
+void ProjectClip::releaseIdleThumbProducers(qint64 idleMs)
+{
+    if (m_thumbPool) {
+        m_thumbPool->releaseIdle(idleMs);
+    }
+}
+
+int ProjectClip::thumbPoolSize() const
+{
+    // Each sequence thumbnail producer loads the whole sequence, and gpu clones share the master producer
+    if (m_clipType == ClipType::Timeline || KdenliveSettings::gpu_accel()) {
+        return 1;
+    }
+    return ThumbnailProducerPool::defaultSize();
+}
+
+void ProjectClip::resetThumbProducers()
+{
+    m_thumbsProducer.reset();
+    if (m_thumbPool) {
+        m_thumbPool->clear(thumbPoolSize());
+        return;
+    }
+    m_thumbPool.reset(new ThumbnailProducerPool(
+        [this]() {
+            QMutexLocker lock(&m_thumbMutex);
+            return buildThumbProducer();
+        },
+        renderThumbnail, thumbPoolSize()));
 }
 
 void ProjectClip::createDisabledMasterProducer()
@@ -1087,7 +1195,7 @@ std::shared_ptr<Mlt::Producer> ProjectClip::getTimelineProducer(int trackId, int
             }
             resource = sequenceFolder.absoluteFilePath(QString("sequence-%1.mlt").arg(m_sequenceUuid.toString()));
             if (!QFileInfo::exists(resource)) {
-                cloneProducerToFile(resource);
+                writeXmlFile(resource, sequenceXml());
             }
         }
         if (timeremap) {
@@ -1273,13 +1381,12 @@ std::pair<std::shared_ptr<Mlt::Producer>, bool> ProjectClip::giveMasterAndGetTim
 
 void ProjectClip::cloneProducerToFile(const QString &path)
 {
-    Mlt::Consumer c(*pCore->getProjectProfile(), "xml", path.toUtf8().constData());
-    // Mlt::Service s(m_masterProducer->get_service());
-    /*int ignore = s.get_int("ignore_points");
-    if (ignore) {
-        s.set("ignore_points", 0);
-    }
-    c.connect(s);*/
+    writeXmlFile(path, cloneProducerToXml());
+}
+
+QByteArray ProjectClip::cloneProducerToXml()
+{
+    Mlt::Consumer c(*pCore->getProjectProfile(), "xml", "string");
     c.set("time_format", "frames");
     c.set("no_meta", 1);
     c.set("no_root", 1);
@@ -1291,23 +1398,11 @@ void ProjectClip::cloneProducerToFile(const QString &path)
     c.set("store", "kdenlive");
     c.connect(m_masterProducer->parent());
     c.run();
-    /*if (ignore) {
-        s.set("ignore_points", ignore);
-    }*/
+    QByteArray xml = c.get("string");
     if (m_usesProxy) {
-        QFile file(path);
-        if (file.open(QIODevice::ReadOnly)) {
-            QTextStream in(&file);
-            QString content = in.readAll();
-            file.close();
-            content.replace(getProducerProperty(QStringLiteral("resource")), getProducerProperty(QStringLiteral("kdenlive:originalurl")));
-            if (file.open(QIODevice::WriteOnly)) {
-                QTextStream out(&file);
-                out << content;
-                file.close();
-            }
-        }
+        xml.replace(getProducerProperty(QStringLiteral("resource")).toUtf8(), getProducerProperty(QStringLiteral("kdenlive:originalurl")).toUtf8());
     }
+    return xml;
 }
 
 void ProjectClip::saveZone(QPoint zone, const QDir &dir)
@@ -1567,28 +1662,7 @@ const QString ProjectClip::getFileHash()
 
 const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString &path)
 {
-    QFile file(path);
-    QByteArray fileHash;
-    qint64 fSize = 0;
-    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-        /*
-         * 1 MB = 1 second per 450 files (or faster)
-         * 10 MB = 9 seconds per 450 files (or faster)
-         */
-        QByteArray fileData;
-        fSize = file.size();
-        if (fSize > 2000000) {
-            fileData = file.read(1000000);
-            if (file.seek(file.size() - 1000000)) {
-                fileData.append(file.readAll());
-            }
-        } else {
-            fileData = file.readAll();
-        }
-        file.close();
-        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-    }
-    return {fileHash, fSize};
+    return FileFingerprintCache::get()->fileHash(path);
 }
 
 double ProjectClip::getOriginalFps() const
@@ -1956,7 +2030,7 @@ void ProjectClip::discardAudioThumb()
     QList<int> streams = m_audioInfo->streams().keys();
     // Delete audio thumbnail data
     for (int &st : streams) {
-        audioThumbPath = getAudioThumbPath(st);
+        audioThumbPath = getAudioPeaksPath(st);
         if (!audioThumbPath.isEmpty()) {
             QFile::remove(audioThumbPath);
         }
@@ -2010,6 +2084,15 @@ const QString ProjectClip::getAudioThumbPath(int stream)
     return audioPath;
 }
 
+const QString ProjectClip::getAudioPeaksPath(int stream)
+{
+    QString audioPath = getAudioThumbPath(stream);
+    if (!audioPath.isEmpty()) {
+        audioPath.replace(audioPath.length() - 4, 4, QStringLiteral(".peaks"));
+    }
+    return audioPath;
+}
+
 QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString &data, int offset)
 {
     if (data.isEmpty()) {
@@ -2332,6 +2415,9 @@ void ProjectClip::reloadTimeline()
     // Release audio producers
     m_audioProducers.clear();
     m_videoProducers.clear();
+    if (m_clipType == ClipType::Timeline) {
+        clearSequenceXml();
+    }
     if (m_timewarpProducers.size() > 0) {
         if (m_clipType == ClipType::Timeline) {
             bool ok;
@@ -2491,6 +2577,26 @@ int ProjectClip::getAudioMax(int stream)
     return int(max);
 }
 
+std::shared_ptr<const AudioLevelsPyramid> ProjectClip::audioPeaks(int stream)
+{
+    if (stream == -1) {
+        if (m_audioInfo) {
+            stream = m_audioInfo->ffmpeg_audio_index();
+        } else {
+            return nullptr;
+        }
+    }
+    const QString key = QString("_kdenlive:audiopeaks%1").arg(stream);
+    std::shared_ptr<const AudioLevelsPyramid> peaks;
+    m_masterProducer->lock();
+    auto *data = static_cast<std::shared_ptr<const AudioLevelsPyramid> *>(m_masterProducer->get_data(key.toUtf8().constData()));
+    if (data) {
+        peaks = *data;
+    }
+    m_masterProducer->unlock();
+    return peaks;
+}
+
 const QVector<uint8_t> ProjectClip::audioFrameCache(int stream)
 {
     QVector<uint8_t> audioLevels;
@@ -20,10 +20,12 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QUuid>
 #include <memory>
 
+class AudioLevelsPyramid;
 class ClipPropertiesController;
 class ProjectFolder;
 class ProjectSubClip;
 class QDomElement;
+class ThumbnailProducerPool;
 
 namespace Mlt {
 class Producer;
@@ -145,6 +147,11 @@ public:
 
     /** @brief Returns this clip's producer. */
     std::shared_ptr<Mlt::Producer> thumbProducer() override;
+    /** @brief Returns the thumbnail image of a frame, decoded by one of the producers of this clip's thumbnail pool.
+     *  Several threads can request thumbnails of the same clip concurrently. */
+    QImage fetchThumbnail(int frame);
+    /** @brief Close the thumbnail producers not used during the last idleMs milliseconds */
+    void releaseIdleThumbProducers(qint64 idleMs);
 
     /** @brief Recursively disable/enable bin effects. */
     void setBinEffectsEnabled(bool enabled) override;
@@ -183,6 +190,8 @@ public:
     void discardAudioThumb();
     /** @brief Get path for this clip's audio thumbnail */
     const QString getAudioThumbPath(int stream);
+    /** @brief Get path for this clip's audio peaks cache file */
+    const QString getAudioPeaksPath(int stream);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
 
@@ -207,6 +216,8 @@ public:
 
     std::shared_ptr<Mlt::Producer> cloneProducer(bool removeEffects = false);
     void cloneProducerToFile(const QString &path);
+    /** @brief Returns the MLT xml of the producer, with the original clips instead of proxies */
+    QByteArray cloneProducerToXml();
     static std::shared_ptr<Mlt::Producer> cloneProducer(const std::shared_ptr<Mlt::Producer> &producer);
     std::shared_ptr<Mlt::Producer> softClone(const char *list);
     /** @brief Returns a clone of the producer, useful for movit clip jobs
@@ -225,6 +236,9 @@ public:
     /** @brief Return audio cache for a stream
      */
     const QVector <uint8_t> audioFrameCache(int stream = -1);
+    /** @brief Return the audio peaks pyramid for a stream, shared with the waveform painters
+     */
+    std::shared_ptr<const AudioLevelsPyramid> audioPeaks(int stream = -1);
     /** @brief Return FFmpeg's audio stream index for an MLT audio stream index
      */
     int getAudioStreamFfmpegIndex(int mltStream);
@@ -337,6 +351,21 @@ private:
     const QString getFileHash();
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
+    /** @brief Producers used to extract thumbnails from several threads */
+    std::unique_ptr<ThumbnailProducerPool> m_thumbPool;
+    /** @brief Create a new producer for thumbnails, or nullptr if the clip is not ready. m_thumbMutex must be locked */
+    std::shared_ptr<Mlt::Producer> buildThumbProducer();
+    /** @brief Drop the thumbnail producers, for example when the clip changed */
+    void resetThumbProducers();
+    /** @brief Number of thumbnail producers allowed for this clip */
+    int thumbPoolSize() const;
+    /** @brief The serialized sequence, shared by the thumbnail and speed producers of a sequence clip until its timeline changes */
+    QByteArray m_sequenceXml;
+    QMutex m_sequenceXmlMutex;
+    /** @brief Returns the serialized sequence, only built again after the sequence changed. Can be called from any thread */
+    QByteArray sequenceXml();
+    /** @brief The sequence timeline changed, its serialized copy is obsolete */
+    void clearSequenceXml();
     const QString geometryWithOffset(const QString &data, int offset);
     QMap <QString, QByteArray> m_audioLevels;
     /** @brief If true, all timeline occurrences of this clip will be replaced from a fresh producer on reload. */
@@ -359,7 +388,6 @@ private:
     QUuid m_uuid;
     // The sequence unique identifier
     QUuid m_sequenceUuid;
-    QTemporaryFile m_sequenceThumbFile;
 
 Q_SIGNALS:
     void producerChanged(const QString &, const std::shared_ptr<Mlt::Producer> &);
@@ -56,6 +56,9 @@ ProjectItemModel::ProjectItemModel(QObject *parent)
     connect(m_fileWatcher.get(), &FileWatcher::binClipModified, this, &ProjectItemModel::reloadClip);
     connect(m_fileWatcher.get(), &FileWatcher::binClipWaiting, this, &ProjectItemModel::setClipWaiting);
     connect(m_fileWatcher.get(), &FileWatcher::binClipMissing, this, &ProjectItemModel::setClipInvalid);
+    m_idleProducersTimer.setInterval(30000);
+    connect(&m_idleProducersTimer, &QTimer::timeout, this, &ProjectItemModel::releaseIdleThumbProducers);
+    m_idleProducersTimer.start();
 }
 
 std::shared_ptr<ProjectItemModel> ProjectItemModel::construct(QObject *parent)
@@ -463,13 +466,20 @@ std::shared_ptr<ProjectClip> ProjectItemModel::getClipByBinID(const QString &bin
 {
     READ_LOCK();
     if (binId.contains(QLatin1Char('_'))) {
-        return getClipByBinID(binId.section(QLatin1Char('_'), 0, 0));
+        return getIndexedClip(binId.section(QLatin1Char('_'), 0, 0));
     }
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::ClipItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectClip>(c);
-        }
+    return getIndexedClip(binId);
+}
+
+std::shared_ptr<ProjectClip> ProjectItemModel::getIndexedClip(const QString &binId) const
+{
+    auto it = m_binIdIndex.find(binId);
+    if (it == m_binIdIndex.end()) {
+        return nullptr;
+    }
+    auto c = it->second.lock();
+    if (c && c->itemType() == AbstractProjectItem::ClipItem) {
+        return std::static_pointer_cast<ProjectClip>(c);
     }
     return nullptr;
 }
@@ -477,26 +487,26 @@ std::shared_ptr<ProjectClip> ProjectItemModel::getClipByBinID(const QString &bin
 const QVector<uint8_t> ProjectItemModel::getAudioLevelsByBinID(const QString &binId, int stream)
 {
     READ_LOCK();
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::ClipItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectClip>(c)->audioFrameCache(stream);
-        }
+    if (auto clip = getIndexedClip(binId)) {
+        return clip->audioFrameCache(stream);
     }
     return QVector<uint8_t>();
 }
 
+std::shared_ptr<const AudioLevelsPyramid> ProjectItemModel::getAudioPeaksByBinID(const QString &binId, int stream)
+{
+    READ_LOCK();
+    if (auto clip = getIndexedClip(binId)) {
+        return clip->audioPeaks(stream);
+    }
+    return nullptr;
+}
+
 double ProjectItemModel::getAudioMaxLevel(const QString &binId, int stream)
 {
     READ_LOCK();
-    for (const auto &item : m_allItems) {
-        auto i = std::static_pointer_cast<AbstractProjectItem>(item.second.lock());
-        if (i->itemType() == AbstractProjectItem::ClipItem && i->clipId() == binId) {
-            auto clip = std::static_pointer_cast<ProjectClip>(i);
-            if (clip) {
-                return clip->getAudioMax(stream);
-            }
-        }
+    if (auto clip = getIndexedClip(binId)) {
+        return clip->getAudioMax(stream);
     }
     return 0;
 }
@@ -510,11 +520,13 @@ bool ProjectItemModel::hasClip(const QString &binId)
 std::shared_ptr<ProjectFolder> ProjectItemModel::getFolderByBinId(const QString &binId)
 {
     READ_LOCK();
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::FolderItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectFolder>(c);
-        }
+    auto it = m_binIdIndex.find(binId);
+    if (it == m_binIdIndex.end()) {
+        return nullptr;
+    }
+    auto c = it->second.lock();
+    if (c && c->itemType() == AbstractProjectItem::FolderItem) {
+        return std::static_pointer_cast<ProjectFolder>(c);
     }
     return nullptr;
 }
@@ -547,13 +559,11 @@ const QString ProjectItemModel::getFolderIdByName(const QString &folderName)
 std::shared_ptr<AbstractProjectItem> ProjectItemModel::getItemByBinId(const QString &binId)
 {
     READ_LOCK();
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->clipId() == binId) {
-            return c;
-        }
+    auto it = m_binIdIndex.find(binId);
+    if (it == m_binIdIndex.end()) {
+        return nullptr;
     }
-    return nullptr;
+    return it->second.lock();
 }
 
 void ProjectItemModel::setBinEffectsEnabled(bool enabled)
@@ -733,6 +743,7 @@ void ProjectItemModel::registerItem(const std::shared_ptr<TreeItem> &item)
     auto clip = std::static_pointer_cast<AbstractProjectItem>(item);
     m_binPlaylist->manageBinItemInsertion(clip);
     AbstractTreeModel::registerItem(item);
+    m_binIdIndex[clip->clipId()] = clip;
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = std::static_pointer_cast<ProjectClip>(clip);
         updateWatcher(clipItem);
@@ -751,9 +762,11 @@ void ProjectItemModel::deregisterItem(int id, TreeItem *item)
     m_binPlaylist->manageBinItemDeletion(clip);
     // TODO : here, we should suspend jobs belonging to the item we delete. They can be restarted if the item is reinserted by undo
     AbstractTreeModel::deregisterItem(id, item);
+    m_binIdIndex.erase(clip->clipId());
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = static_cast<ProjectClip *>(clip);
         m_fileWatcher->removeFile(clipItem->clipId());
+        unindexClipFile(clipItem->clipId());
     }
 }
 
@@ -1035,6 +1048,17 @@ std::vector<QString> ProjectItemModel::getAllClipIds() const
     return result;
 }
 
+void ProjectItemModel::releaseIdleThumbProducers()
+{
+    READ_LOCK();
+    for (const auto &clip : m_allItems) {
+        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
+        if (c && c->itemType() == AbstractProjectItem::ClipItem) {
+            std::static_pointer_cast<ProjectClip>(c)->releaseIdleThumbProducers(60000);
+        }
+    }
+}
+
 void ProjectItemModel::updateCacheThumbnail(std::unordered_map<QString, std::vector<int>> &thumbData)
 {
     READ_LOCK();
@@ -1054,12 +1078,11 @@ QStringList ProjectItemModel::getClipByUrl(const QFileInfo &url) const
 {
     READ_LOCK();
     QStringList result;
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::ClipItem) {
-            if (QFileInfo(std::static_pointer_cast<ProjectClip>(c)->clipUrl()) == url) {
-                result << c->clipId();
-            }
+    auto range = m_pathIndex.equal_range(pathIndexKey(url));
+    for (auto it = range.first; it != range.second; ++it) {
+        auto clip = getIndexedClip(it->second);
+        if (clip && QFileInfo(clip->clipUrl()) == url) {
+            result << clip->clipId();
         }
     }
     return result;
@@ -1137,13 +1160,7 @@ bool ProjectItemModel::isIdFree(const QString &id) const
     if (id.isEmpty()) {
         return false;
     }
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->clipId() == id) {
-            return false;
-        }
-    }
-    return true;
+    return m_binIdIndex.count(id) == 0;
 }
 
 void ProjectItemModel::loadBinPlaylist(Mlt::Service *documentTractor, std::unordered_map<QString, QString> &binIdCorresp, QStringList &expandedFolders,
@@ -1494,6 +1511,7 @@ void ProjectItemModel::setClipInvalid(const QString &binId)
 void ProjectItemModel::updateWatcher(const std::shared_ptr<ProjectClip> &clipItem)
 {
     QWriteLocker locker(&m_lock);
+    indexClipFile(clipItem);
     ClipType::ProducerType type = clipItem->clipType();
     if (type == ClipType::AV || type == ClipType::Audio || type == ClipType::Image || type == ClipType::Video || type == ClipType::Playlist ||
         type == ClipType::TextTemplate || type == ClipType::Animation) {
@@ -1506,6 +1524,53 @@ void ProjectItemModel::updateWatcher(const std::shared_ptr<ProjectClip> &clipIte
     }
 }
 
+void ProjectItemModel::indexClipFile(const std::shared_ptr<ProjectClip> &clip)
+{
+    QWriteLocker locker(&m_lock);
+    const QString binId = clip->clipId();
+    unindexClipFile(binId);
+    // Don't compute a missing hash here, it is done when the clip is loaded
+    const QString hash = clip->hash(false);
+    const QString url = clip->clipUrl();
+    const QString path = url.isEmpty() ? QString() : pathIndexKey(QFileInfo(url));
+    if (!hash.isEmpty()) {
+        m_hashIndex.emplace(hash, binId);
+    }
+    if (!path.isEmpty()) {
+        m_pathIndex.emplace(path, binId);
+    }
+    m_clipFileKeys[binId] = {hash, path};
+}
+
+void ProjectItemModel::unindexClipFile(const QString &binId)
+{
+    QWriteLocker locker(&m_lock);
+    auto keys = m_clipFileKeys.find(binId);
+    if (keys == m_clipFileKeys.end()) {
+        return;
+    }
+    auto removeFrom = [&binId](std::unordered_multimap<QString, QString> &index, const QString &key) {
+        auto range = index.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == binId) {
+                index.erase(it);
+                break;
+            }
+        }
+    };
+    removeFrom(m_hashIndex, keys->second.first);
+    removeFrom(m_pathIndex, keys->second.second);
+    m_clipFileKeys.erase(keys);
+}
+
+// static
+QString ProjectItemModel::pathIndexKey(const QFileInfo &info)
+{
+    // QFileInfo comparison uses the canonical path of existing files
+    const QString canonical = info.canonicalFilePath();
+    return canonical.isEmpty() ? info.absoluteFilePath() : canonical;
+}
+
 void ProjectItemModel::setDragType(PlaylistState::ClipState type)
 {
     QWriteLocker locker(&m_lock);
@@ -1532,8 +1597,15 @@ QString ProjectItemModel::validateClipInFolder(const QString &folderId, const QS
 {
     QWriteLocker locker(&m_lock);
     std::shared_ptr<ProjectFolder> folder = getFolderByBinId(folderId);
-    if (folder) {
-        return folder->childByHash(clipHash);
+    if (!folder) {
+        return QString();
+    }
+    auto range = m_hashIndex.equal_range(clipHash);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto clip = getIndexedClip(it->second);
+        if (clip && clip->statusReady() && clip->hash() == clipHash && clip->hasAncestor(folder->getId())) {
+            return clip->clipId();
+        }
     }
     return QString();
 }
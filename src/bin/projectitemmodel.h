@@ -18,8 +18,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QIcon>
 #include <QReadWriteLock>
 #include <QSize>
+#include <QTimer>
 #include <QUuid>
 
+class AudioLevelsPyramid;
 class BinPlaylist;
 class FileWatcher;
 class MarkerListModel;
@@ -58,6 +60,8 @@ public:
     std::shared_ptr<ProjectClip> getClipByBinID(const QString &binId);
     /** @brief Returns audio levels for a clip from its id */
     const QVector <uint8_t>getAudioLevelsByBinID(const QString &binId, int stream);
+    /** @brief Returns the audio peaks pyramid of a bin clip's stream, without copying the data */
+    std::shared_ptr<const AudioLevelsPyramid> getAudioPeaksByBinID(const QString &binId, int stream);
     double getAudioMaxLevel(const QString &binId, int stream);
 
     /** @brief Returns a list of clips using the given url */
@@ -248,7 +252,7 @@ protected:
     /** @brief Helper function to add a given item to the tree */
     bool addItem(const std::shared_ptr<AbstractProjectItem> &item, const QString &parentId, Fun &undo, Fun &redo);
 
-    /** @brief Function to be called when the url of a clip changes */
+    /** @brief Function to be called when the url of a clip changes, updates the file watcher and the file indexes */
     void updateWatcher(const std::shared_ptr<ProjectClip> &item);
 
 public Q_SLOTS:
@@ -268,8 +272,25 @@ private:
     /** @brief Return column number(s) responsible for a specific data type*/
     QList<int> mapDataToColumn(AbstractProjectItem::DataType type) const;
 
+    /** @brief Returns the clip with this exact bin id, using the index. Must be called with m_lock held */
+    std::shared_ptr<ProjectClip> getIndexedClip(const QString &binId) const;
+    /** @brief Index a clip by its current file hash and resource path */
+    void indexClipFile(const std::shared_ptr<ProjectClip> &clip);
+    /** @brief Remove a clip from the hash and resource path indexes */
+    void unindexClipFile(const QString &binId);
+    /** @brief The key of a file in the resource path index */
+    static QString pathIndexKey(const QFileInfo &info);
+
     mutable QReadWriteLock m_lock; // This is a lock that ensures safety in case of concurrent access
 
+    /** @brief All the bin items by bin id, kept in sync with m_allItems in registerItem / deregisterItem */
+    std::unordered_map<QString, std::weak_ptr<AbstractProjectItem>> m_binIdIndex;
+    /** @brief Clip bin ids by file hash and by resource path, updated when the producer of a clip changes */
+    std::unordered_multimap<QString, QString> m_hashIndex;
+    std::unordered_multimap<QString, QString> m_pathIndex;
+    /** @brief For each indexed clip, the hash and path keys it was indexed with */
+    std::unordered_map<QString, std::pair<QString, QString>> m_clipFileKeys;
+
     std::unique_ptr<BinPlaylist> m_binPlaylist;
 
     std::unique_ptr<FileWatcher> m_fileWatcher;
@@ -282,6 +303,10 @@ private:
     QUuid m_uuid;
     /** @brief The id of the folder where new sequences will be created, -1 if none */
     int m_sequenceFolderId;
+    /** @brief Periodically closes the thumbnail producers of clips that are not displayed anymore */
+    QTimer m_idleProducersTimer;
+    /** @brief Close the thumbnail producers unused for a while */
+    void releaseIdleThumbProducers();
 
 Q_SIGNALS:
     /** @brief thumbs of the given clip were modified, request update of the monitor if need be */
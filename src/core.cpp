@@ -279,19 +279,6 @@ void Core::buildDocks()
     m_guidesList = new GuidesList(m_mainWindow);
 }
 
-void Core::buildLumaThumbs(const QStringList &values)
-{
-    for (auto &entry : values) {
-        if (MainWindow::m_lumacache.contains(entry)) {
-            continue;
-        }
-        QImage pix(entry);
-        if (!pix.isNull()) {
-            MainWindow::m_lumacache.insert(entry, pix.scaled(50, 30, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-        }
-    }
-}
-
 QString Core::openExternalApp(QString appPath, QStringList args)
 {
     QProcess process;
@@ -356,8 +356,6 @@ public Q_SLOTS:
     /** @brief display a user info/warning message in the project bin */
     void displayBinMessage(const QString &text, int type, const QList<QAction *> &actions = QList<QAction *>(), bool showClose = false, BinMessage::BinCategory messageCategory = BinMessage::BinCategory::NoMessage);
     void displayBinLogMessage(const QString &text, int type, const QString logInfo);
-    /** @brief Create small thumbnails for luma used in compositions */
-    void buildLumaThumbs(const QStringList &values);
     /** @brief Try to find a display name for the given filename.
      *  This is espacally helpfull for mlt's dynamically created luma files without thumb (luma01.pgm, luma02.pgm,...),
      *  but also for others as it makes the visible name translatable.
@@ -412,6 +410,8 @@ Q_SIGNALS:
     void clipInstanceResized(const QString &binId);
     /** @brief Contains the project audio levels */
     void audioLevelsAvailable(const QVector<double>& levels);
+    /** @brief Contains the project loudness in LUFS and highest true peak in dBTP */
+    void audioLoudnessAvailable(double momentary, double shortTerm, double integrated, double truePeak);
     /** @brief A frame was displayed in monitor, update audio mixer */
     void updateMixerLevels(int pos);
     /** @brief Audio recording was started or stopped*/
@@ -349,6 +349,7 @@ void KdenliveSettingsDialog::initEnviromentPage()
     connect(m_configEnv.kcfg_librarytodefaultfolder, &QAbstractButton::clicked, this, &KdenliveSettingsDialog::slotEnableLibraryFolder);
 
     m_configEnv.kcfg_proxythreads->setMaximum(qMax(1, QThread::idealThreadCount() - 1));
+    m_configEnv.kcfg_previewworkers->setMaximum(qMax(1, QThread::idealThreadCount()));
 
     // Script rendering files folder
     m_configEnv.videofolderurl->setMode(KFile::Directory);
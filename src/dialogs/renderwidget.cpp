@@ -61,6 +61,7 @@
 #include <QTemporaryFile>
 #include <QThread>
 #include <QTreeWidgetItem>
+#include <QXmlStreamReader>
 #include <QtGlobal>
 
 #ifdef KF5_USE_PURPOSE
@@ -84,7 +85,8 @@ enum {
     LastTimeRole,
     LastFrameRole,
     OpenBrowserRole,
-    PlayAfterRole
+    PlayAfterRole,
+    ThreadsRole
 };
 
 // Running job status
@@ -237,6 +239,9 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     m_view.processing_threads->setValue(KdenliveSettings::processingthreads());
     connect(m_view.processing_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setProcessingthreads);
     connect(m_view.processing_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RenderWidget::refreshParams);
+    m_view.render_segments->setMaximum(QThread::idealThreadCount());
+    m_view.render_segments->setValue(KdenliveSettings::rendersegments());
+    connect(m_view.render_segments, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setRendersegments);
     if (!KdenliveSettings::parallelrender()) {
         m_view.processing_warning->hide();
     }
@@ -290,6 +295,12 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     connect(m_view.start_job, &QAbstractButton::clicked, this, &RenderWidget::slotStartCurrentJob);
     connect(m_view.clean_up, &QAbstractButton::clicked, this, &RenderWidget::slotCleanUpJobs);
     connect(m_view.hide_log, &QAbstractButton::clicked, this, &RenderWidget::slotHideLog);
+    m_view.parallel_jobs->setMaximum(QThread::idealThreadCount());
+    m_view.parallel_jobs->setValue(KdenliveSettings::maxrenderjobs());
+    connect(m_view.parallel_jobs, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int jobs) {
+        KdenliveSettings::setMaxrenderjobs(jobs);
+        checkRenderStatus();
+    });
 
     connect(m_view.buttonClose, &QAbstractButton::clicked, this, &QWidget::hide);
     connect(m_view.buttonClose2, &QAbstractButton::clicked, this, &QWidget::hide);
@@ -1061,6 +1072,21 @@ RenderJobItem *RenderWidget::createRenderJob(const QString &playlist, const QStr
     if (!subtitleFile.isEmpty()) {
         argsJob << QStringLiteral("--subtitle") << subtitleFile;
     }
+    if (m_view.processing_box->isChecked() && KdenliveSettings::rendersegments() > 1 && !m_view.checkTwoPass->isChecked()) {
+        // Render in parallel segments, preferably split on the guides
+        argsJob << QStringLiteral("--segments") << QString::number(KdenliveSettings::rendersegments());
+        if (auto ptr = m_guidesModel.lock()) {
+            const double fps = pCore->getCurrentProfile()->fps();
+            const QList<CommentedTime> markers = ptr->getAllMarkers();
+            QStringList cuts;
+            for (const CommentedTime &marker : markers) {
+                cuts << QString::number(marker.time().frames(fps));
+            }
+            if (!cuts.isEmpty()) {
+                argsJob << QStringLiteral("--split") << cuts.join(QLatin1Char(','));
+            }
+        }
+    }
     renderItem->setData(1, ParametersRole, argsJob);
     qDebug() << "* CREATED JOB WITH ARGS: " << argsJob;
     renderItem->setData(1, OpenBrowserRole, m_view.open_browser->isChecked());
@@ -1082,49 +1108,149 @@ void RenderWidget::checkRenderStatus()
         return;
     }
 
-    // Make sure no other rendering is running
-    if (runningJobsCount() > 0) {
-        return;
-    }
-
+    // Several jobs can run together as long as their threads fit on the processor
+    const int maxJobs = qMax(1, KdenliveSettings::maxrenderjobs());
+    const int threadBudget = QThread::idealThreadCount();
+    int runningJobs = 0;
+    int usedThreads = 0;
     auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    while (item != nullptr) {
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB) {
+            runningJobs++;
+            usedThreads += jobThreads(item);
+        }
+        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+    }
 
     bool waitingJob = false;
-
-    // Find first waiting job
-    while (item != nullptr) {
-        if (item->status() == WAITINGJOB) {
-            QDateTime t = QDateTime::currentDateTime();
-            item->setData(1, StartTimeRole, t);
-            item->setData(1, LastTimeRole, t);
-            waitingJob = true;
-            startRendering(item);
-            // Check for 2 pass encoding
-            QStringList jobData = item->data(1, ParametersRole).toStringList();
-            if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
-                // Find and remove 1st pass job
-                QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
-                QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
-                while (above) {
-                    QStringList aboveData = above->data(1, ParametersRole).toStringList();
-                    qDebug() << "// GOT  JOB: " << aboveData.at(1);
-                    if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
-                        delete above;
-                        break;
-                    }
-                    above = m_view.running_jobs->itemAbove(above);
+    item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    // Start the waiting jobs in order, until the limits are reached
+    while (item != nullptr && runningJobs < maxJobs) {
+        auto *next = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+        if (item->status() != WAITINGJOB) {
+            item = next;
+            continue;
+        }
+        waitingJob = true;
+        if (isJobBlocked(item)) {
+            // Wait for the first pass or the other job writing the same file
+            item = next;
+            continue;
+        }
+        const int threads = jobThreads(item);
+        if (runningJobs > 0 && usedThreads + threads > threadBudget) {
+            // Don't let a later job overtake this one
+            break;
+        }
+        QDateTime t = QDateTime::currentDateTime();
+        item->setData(1, StartTimeRole, t);
+        item->setData(1, LastTimeRole, t);
+        startRendering(item);
+        // Check for 2 pass encoding
+        const QString playlist = jobPlaylist(item);
+        if (playlist.endsWith(QStringLiteral("-pass2.mlt"))) {
+            // Find and remove 1st pass job
+            QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
+            QString firstPassName = playlist.section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
+            while (above) {
+                if (jobPlaylist(static_cast<RenderJobItem *>(above)) == firstPassName) {
+                    delete above;
+                    break;
                 }
+                above = m_view.running_jobs->itemAbove(above);
             }
+        }
+        if (item->status() != FAILEDJOB) {
             item->setStatus(STARTINGJOB);
-            break;
+            runningJobs++;
+            usedThreads += threads;
         }
-        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+        item = next;
     }
-    if (!waitingJob && m_view.shutdown->isChecked()) {
+    if (!waitingJob && runningJobs == 0 && m_view.shutdown->isChecked()) {
         Q_EMIT shutdown();
     }
 }
 
+QString RenderWidget::jobPlaylist(RenderJobItem *item)
+{
+    const QStringList jobData = item->data(1, ParametersRole).toStringList();
+    return jobData.size() > 2 ? jobData.at(2) : QString();
+}
+
+int RenderWidget::jobThreads(RenderJobItem *item)
+{
+    const QVariant cached = item->data(1, ThreadsRole);
+    if (cached.isValid()) {
+        return cached.toInt();
+    }
+    // Read the processing and encoding threads from the consumer of the job playlist
+    int processing = 1;
+    int encoding = 0;
+    QFile file(jobPlaylist(item));
+    if (file.open(QIODevice::ReadOnly)) {
+        QXmlStreamReader reader(&file);
+        if (reader.readNextStartElement() && reader.name() == QLatin1String("mlt")) {
+            while (reader.readNextStartElement()) {
+                if (reader.name() == QLatin1String("consumer")) {
+                    const QXmlStreamAttributes attributes = reader.attributes();
+                    processing = qMax(1, qAbs(attributes.value(QLatin1String("real_time")).toInt()));
+                    encoding = attributes.value(QLatin1String("threads")).toInt();
+                    break;
+                }
+                reader.skipCurrentElement();
+            }
+        }
+    }
+    // Automatic encoder threads adapt to the load and are not counted
+    int threads = qMax(processing, encoding);
+    const QStringList jobData = item->data(1, ParametersRole).toStringList();
+    const int segmentsIndex = jobData.indexOf(QStringLiteral("--segments"));
+    if (segmentsIndex > 0 && segmentsIndex + 1 < jobData.size()) {
+        // Each segment is rendered by its own process
+        threads *= qMax(1, jobData.at(segmentsIndex + 1).toInt());
+    }
+    threads = qBound(1, threads, QThread::idealThreadCount());
+    item->setData(1, ThreadsRole, threads);
+    return threads;
+}
+
+bool RenderWidget::isJobBlocked(RenderJobItem *item) const
+{
+    const QString playlist = jobPlaylist(item);
+    const QString firstPass =
+        playlist.endsWith(QStringLiteral("-pass2.mlt")) ? playlist.section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt") : QString();
+    auto *other = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    while (other != nullptr) {
+        if (other != item) {
+            const int status = other->status();
+            if ((status == RUNNINGJOB || status == STARTINGJOB) && other->text(1) == item->text(1)) {
+                return true;
+            }
+            if (!firstPass.isEmpty() && (status == WAITINGJOB || status == RUNNINGJOB || status == STARTINGJOB) && jobPlaylist(other) == firstPass) {
+                return true;
+            }
+        }
+        other = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(other));
+    }
+    return false;
+}
+
+int RenderWidget::runningJobsProgress() const
+{
+    int count = 0;
+    int progress = 0;
+    auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    while (item != nullptr) {
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB) {
+            progress += item->data(1, ProgressRole).toInt();
+            count++;
+        }
+        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+    }
+    return count == 0 ? 100 : progress / count;
+}
+
 void RenderWidget::startRendering(RenderJobItem *item)
 {
     auto rendererArgs = item->data(1, ParametersRole).toStringList();
@@ -1634,6 +1760,10 @@ void RenderWidget::slotStartCurrentJob()
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
     if ((current != nullptr) && current->status() == WAITINGJOB) {
         startRendering(current);
+        if (current->status() != FAILEDJOB) {
+            // Count it in the running jobs until the renderer reports
+            current->setStatus(STARTINGJOB);
+        }
     }
     m_view.start_job->setEnabled(false);
 }
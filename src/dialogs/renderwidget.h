@@ -128,6 +128,8 @@ public:
     void updateDocumentPath();
     int waitingJobsCount() const;
     int runningJobsCount() const;
+    /** @brief Average progress of the running jobs, 100 if none is running. */
+    int runningJobsProgress() const;
     QString getFreeScriptName(const QUrl &projectName = QUrl(), const QString &prefix = QString());
     bool startWaitingRenderJobs();
     /** @brief Show / hide proxy settings. */
@@ -233,6 +235,12 @@ private:
     /** @brief Check if a job needs to be started. */
     void checkRenderStatus();
     void startRendering(RenderJobItem *item);
+    /** @brief The MLT playlist rendered by a job. */
+    static QString jobPlaylist(RenderJobItem *item);
+    /** @brief Number of threads a job is expected to keep busy, read from its playlist consumer. */
+    int jobThreads(RenderJobItem *item);
+    /** @brief Returns true if a job must wait for another one, writing the same file or doing its first pass. */
+    bool isJobBlocked(RenderJobItem *item) const;
     /** @brief Create a rendering profile from MLT preset. */
     QTreeWidgetItem *loadFromMltPreset(const QString &groupName, const QString &path, QString profileName, bool codecInName = false);
     void prepareRendering(bool delayedRendering);
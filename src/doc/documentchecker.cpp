@@ -7,10 +7,12 @@
 #include "documentchecker.h"
 #include "bin/binplaylist.hpp"
 #include "bin/projectclip.h"
+#include "doc/fileindex.h"
 #include "effects/effectsrepository.hpp"
 #include "kdenlivesettings.h"
 #include "kthumb.h"
 #include "titler/titlewidget.h"
+#include "utils/filefingerprintcache.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -19,11 +21,15 @@
 
 #include "kdenlive_debug.h"
 #include <QCryptographicHash>
+#include <QEventLoop>
 #include <QFile>
 #include <QFileDialog>
 #include <QFontDatabase>
+#include <QFutureWatcher>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QTreeWidgetItem>
+#include <QtConcurrent>
 #include <kurlrequester.h>
 #include <utility>
 
@@ -133,6 +139,28 @@ bool DocumentChecker::hasErrorInClips()
     QStringList missingPaths;
     QStringList serviceToCheck = {QStringLiteral("kdenlivetitle"), QStringLiteral("qimage"), QStringLiteral("pixbuf"), QStringLiteral("timewarp"),
                                   QStringLiteral("framebuffer"),   QStringLiteral("xml"),    QStringLiteral("qtext")};
+    // Hash the media files in parallel before checking them one by one, unchanged files are read from the fingerprint cache
+    QStringList filesToHash;
+    for (const QDomNodeList &list : {documentProducers, documentChains}) {
+        for (int i = 0; i < list.count(); ++i) {
+            const QDomElement e = list.item(i).toElement();
+            const QString service = Xml::getXmlProperty(e, QStringLiteral("mlt_service"));
+            if (!service.startsWith(QLatin1String("avformat")) && service != QLatin1String("qimage") && service != QLatin1String("pixbuf")) {
+                continue;
+            }
+            QString resource = Xml::getXmlProperty(e, QStringLiteral("resource"));
+            if (resource.isEmpty() || Xml::getXmlProperty(e, QStringLiteral("kdenlive:file_hash")).isEmpty() || resource.contains(QLatin1Char('?')) ||
+                resource.contains(QLatin1Char('%')) || resource.contains(QStringLiteral(".all."))) {
+                continue;
+            }
+            if (QFileInfo(resource).isRelative()) {
+                resource.prepend(root);
+            }
+            filesToHash << resource;
+        }
+    }
+    FileFingerprintCache::get()->prefetch(filesToHash);
+    FileFingerprintCache::get()->save();
     max = documentProducers.count();
     for (int i = 0; i < max; ++i) {
         QDomElement e = documentProducers.item(i).toElement();
@@ -934,21 +962,54 @@ void DocumentChecker::slotCheckClips()
 
 void DocumentChecker::slotSearchClips(const QString &newpath)
 {
+    QDomNodeList producers = m_doc.elementsByTagName(QStringLiteral("producer"));
+    // Sizes of the files we can match by content, only the indexed files with one of these sizes will be hashed
+    QList<qint64> sizes;
+    for (int ix = 0; ix < m_ui.treeWidget->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
+        const int status = child->data(0, statusRole).toInt();
+        if (status == SOURCEMISSING) {
+            for (int j = 0; j < child->childCount(); ++j) {
+                sizes << child->child(j)->data(0, sizeRole).toLongLong();
+            }
+        } else if (status == CLIPMISSING && child->data(0, clipTypeRole).toInt() != ClipType::SlideShow) {
+            sizes << child->data(0, sizeRole).toLongLong();
+        }
+    }
+
+    // Walk the folder once in a background thread, then resolve all missing items against the index
+    FileIndex index;
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+    QTimer progress;
+    progress.setInterval(200);
+    connect(&progress, &QTimer::timeout, this, [this, &index]() {
+        Q_EMIT showScanning(i18np("Scanning %1 folder", "Scanning %1 folders", index.scannedFolders()));
+    });
+    Q_EMIT showScanning(i18n("Scanning %1", newpath));
+    progress.start();
+    watcher.setFuture(QtConcurrent::run([this, &index, newpath, sizes]() {
+        if (index.build(newpath, &m_abortSearch)) {
+            index.prefetchHashes(sizes);
+        }
+    }));
+    if (!watcher.isFinished()) {
+        loop.exec();
+    }
+    progress.stop();
+
     int ix = 0;
     bool fixed = false;
     QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
-    QDir searchDir(newpath);
-    QDomNodeList producers = m_doc.elementsByTagName(QStringLiteral("producer"));
     while (child != nullptr) {
         if (m_abortSearch) {
             break;
         }
-        qApp->processEvents();
         if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
             for (int j = 0; j < child->childCount(); ++j) {
                 QTreeWidgetItem *subchild = child->child(j);
-                QString clipPath =
-                    searchFileRecursively(searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
+                QString clipPath = searchFile(index, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
                 if (!clipPath.isEmpty()) {
                     fixed = true;
                     subchild->setText(1, clipPath);
@@ -966,12 +1027,12 @@ void DocumentChecker::slotSearchClips(const QString &newpath)
             QString clipPath;
             if (type != ClipType::SlideShow) {
                 // Slideshows cannot be found with hash / size
-                clipPath = searchFileRecursively(searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
+                clipPath = searchFile(index, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
             } else {
-                clipPath = searchDirRecursively(searchDir, child->data(0, hashRole).toString(), child->text(1));
+                clipPath = searchDir(index, child->data(0, hashRole).toString(), child->text(1));
             }
             if (clipPath.isEmpty() && type != ClipType::SlideShow) {
-                clipPath = searchPathRecursively(searchDir, QUrl::fromLocalFile(child->text(1)).fileName(), type);
+                clipPath = searchPath(index, QUrl::fromLocalFile(child->text(1)).fileName(), type);
                 perfectMatch = false;
             }
             if (!clipPath.isEmpty()) {
@@ -982,7 +1043,7 @@ void DocumentChecker::slotSearchClips(const QString &newpath)
                 child->setData(0, statusRole, CLIPOK);
             }
         } else if (child->data(0, statusRole).toInt() == LUMAMISSING) {
-            QString fileName = searchLuma(searchDir, child->data(0, idRole).toString());
+            QString fileName = searchLuma(index, child->data(0, idRole).toString());
             if (!fileName.isEmpty()) {
                 fixed = true;
                 child->setText(1, fileName);
@@ -993,7 +1054,7 @@ void DocumentChecker::slotSearchClips(const QString &newpath)
         } else if (child->data(0, typeRole).toInt() == TITLE_IMAGE_ELEMENT && child->data(0, statusRole).toInt() == CLIPPLACEHOLDER) {
             // Search missing title images
             QString missingFileName = QUrl::fromLocalFile(child->text(1)).fileName();
-            QString newPath = searchPathRecursively(searchDir, missingFileName);
+            QString newPath = searchPath(index, missingFileName);
             if (!newPath.isEmpty()) {
                 // File found
                 fixed = true;
@@ -1006,6 +1067,7 @@ void DocumentChecker::slotSearchClips(const QString &newpath)
         ix++;
         child = m_ui.treeWidget->topLevelItem(ix);
     }
+    FileFingerprintCache::get()->save();
     m_ui.recursiveSearch->setChecked(false);
     m_ui.recursiveSearch->setEnabled(true);
     if (fixed) {
@@ -1068,150 +1130,49 @@ QString DocumentChecker::fixLuma(const QString &file)
     return QString();
 }
 
-QString DocumentChecker::searchLuma(const QDir &dir, const QString &file)
+QString DocumentChecker::searchLuma(const FileIndex &index, const QString &file)
 {
     // Try in user's chosen folder
     QString result = fixLuma(file);
-    return result.isEmpty() ? searchPathRecursively(dir, QFileInfo(file).fileName()) : result;
+    return result.isEmpty() ? searchPath(index, QFileInfo(file).fileName()) : result;
 }
 
-QString DocumentChecker::searchPathRecursively(const QDir &dir, const QString &fileName, ClipType::ProducerType type)
+QString DocumentChecker::searchPath(const FileIndex &index, const QString &fileName, ClipType::ProducerType type)
 {
-    QString foundFileName;
-    bool patternSlideshow = true;
-    QDir searchDir(dir);
-    QStringList filesAndDirs;
-    qApp->processEvents();
-    if (m_abortSearch) {
-        return QString();
+    if (type != ClipType::SlideShow) {
+        return index.findByName(fileName);
     }
-    if (type == ClipType::SlideShow) {
-        if (fileName.contains(QLatin1Char('%'))) {
-            searchDir.setNameFilters({fileName.section(QLatin1Char('%'), 0, -2) + QLatin1Char('*')});
-            filesAndDirs = searchDir.entryList(QDir::Files | QDir::Readable);
-
-        } else {
-            patternSlideshow = false;
-            QString slideDirName = QFileInfo(fileName).dir().dirName();
-            searchDir.setNameFilters({slideDirName});
-            filesAndDirs = searchDir.entryList(QDir::Dirs | QDir::Readable);
-        }
-    } else {
-        searchDir.setNameFilters({fileName});
-        filesAndDirs = searchDir.entryList(QDir::Files | QDir::Readable);
-    }
-    if (!filesAndDirs.isEmpty()) {
-        // File Found
-        if (type == ClipType::SlideShow) {
-            if (patternSlideshow) {
-                return searchDir.absoluteFilePath(fileName);
-            } else {
-                // mime type slideshow
-                searchDir.cd(filesAndDirs.first());
-                return searchDir.absoluteFilePath(QFileInfo(fileName).fileName());
-            }
-        } else {
-            return searchDir.absoluteFilePath(filesAndDirs.first());
-        }
+    if (fileName.contains(QLatin1Char('%'))) {
+        // Pattern slideshow, look for a folder containing the first images
+        const QString image = index.findByPattern(fileName.section(QLatin1Char('%'), 0, -2) + QLatin1Char('*'));
+        return image.isEmpty() ? QString() : QFileInfo(image).absoluteDir().absoluteFilePath(fileName);
     }
-    searchDir.setNameFilters(QStringList());
-    filesAndDirs = searchDir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchPathRecursively(searchDir.absoluteFilePath(filesAndDirs.at(i)), fileName, type);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    // mime type slideshow
+    const QString folder = index.findFolder(QFileInfo(fileName).dir().dirName());
+    return folder.isEmpty() ? QString() : QDir(folder).absoluteFilePath(QFileInfo(fileName).fileName());
 }
 
-QString DocumentChecker::searchDirRecursively(const QDir &dir, const QString &matchHash, const QString &fullName)
+QString DocumentChecker::searchDir(const FileIndex &index, const QString &matchHash, const QString &fullName)
 {
-    qApp->processEvents();
-    if (m_abortSearch) {
-        return QString();
-    }
-    Q_EMIT showScanning(i18n("Scanning %1", dir.absolutePath()));
-    QStringList filesAndDirs;
-    QString fileName = QFileInfo(fullName).fileName();
-    // Check main dir
-    QString fileHash = ProjectClip::getFolderHash(dir, fileName).toHex();
-    if (fileHash == matchHash) {
-        return dir.absoluteFilePath(fileName);
-    }
-    // Search subfolders
-    const QStringList subDirs = dir.entryList(QDir::AllDirs | QDir::NoDot | QDir::NoDotDot);
-    for (const QString &sub : subDirs) {
-        QDir subFolder(dir.absoluteFilePath(sub));
-        fileHash = ProjectClip::getFolderHash(subFolder, fileName).toHex();
-        if (fileHash == matchHash) {
-            return subFolder.absoluteFilePath(fileName);
+    const QString fileName = QFileInfo(fullName).fileName();
+    for (const QString &folder : index.folders()) {
+        if (m_abortSearch) {
+            return QString();
         }
-    }
-    if (m_abortSearch) {
-        return QString();
-    }
-    // Search inside subfolders
-    for (const QString &sub : subDirs) {
-        QDir subFolder(dir.absoluteFilePath(sub));
-        const QStringList subSubDirs = subFolder.entryList(QDir::AllDirs | QDir::NoDot | QDir::NoDotDot);
-        for (const QString &subsub : subSubDirs) {
-            QDir subDir(subFolder.absoluteFilePath(subsub));
-            QString result = searchDirRecursively(subDir, matchHash, fullName);
-            if (!result.isEmpty()) {
-                return result;
-            }
+        const QDir dir(folder);
+        if (ProjectClip::getFolderHash(dir, fileName).toHex() == matchHash) {
+            return dir.absoluteFilePath(fileName);
         }
     }
     return QString();
 }
 
-QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName)
+QString DocumentChecker::searchFile(const FileIndex &index, const QString &matchSize, const QString &matchHash, const QString &fileName)
 {
     if (matchSize.isEmpty() && matchHash.isEmpty()) {
-        return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
-    }
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        qApp->processEvents();
-        if (m_abortSearch) {
-            return QString();
-        }
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash, fileName);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
+        return searchPath(index, QUrl::fromLocalFile(fileName).fileName());
     }
-    return foundFileName;
+    return index.findFile(matchSize.toLongLong(), matchHash);
 }
 
 void DocumentChecker::slotEditItem(QTreeWidgetItem *item, int)
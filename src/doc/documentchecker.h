@@ -12,6 +12,9 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QDir>
 #include <QDomElement>
 #include <QUrl>
+#include <atomic>
+
+class FileIndex;
 
 class DocumentChecker : public QObject
 {
@@ -29,7 +32,7 @@ public:
      */
     bool hasErrorInClips();
     QString fixLuma(const QString &file);
-    QString searchLuma(const QDir &dir, const QString &file);
+    QString searchLuma(const FileIndex &index, const QString &file);
 
 private Q_SLOTS:
     void acceptDialog();
@@ -52,9 +55,12 @@ private:
     Ui::MissingClips_UI m_ui;
     QDialog *m_dialog;
     QPair<QString, QString> m_rootReplacement;
-    QString searchPathRecursively(const QDir &dir, const QString &fileName, ClipType::ProducerType type = ClipType::Unknown);
-    QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName);
-    QString searchDirRecursively(const QDir &dir, const QString &matchHash, const QString &fullName);
+    /** @brief Find a file by name in the index, or the folder of a slideshow */
+    QString searchPath(const FileIndex &index, const QString &fileName, ClipType::ProducerType type = ClipType::Unknown);
+    /** @brief Find a file by size and hash in the index, or by name if we don't know its hash */
+    QString searchFile(const FileIndex &index, const QString &matchSize, const QString &matchHash, const QString &fileName);
+    /** @brief Find the folder of a slideshow by its folder hash */
+    QString searchDir(const FileIndex &index, const QString &matchHash, const QString &fullName);
     void checkStatus();
     QMap<QString, QString> m_missingTitleImages;
     QMap<QString, QString> m_missingTitleFonts;
@@ -69,7 +75,7 @@ private:
     QList<QDomElement> m_missingProxies;
     // List clips who have a working proxy but no source clip
     QList<QDomElement> m_missingSources;
-    bool m_abortSearch;
+    std::atomic<bool> m_abortSearch;
     bool m_checkRunning;
 
     void fixClipItem(QTreeWidgetItem *child, const QDomNodeList &producers, const QDomNodeList &trans);
@@ -4,19 +4,146 @@
 */
 
 #include "docundostack.hpp"
+#include "kdenlive_debug.h"
+#include "kdenlivesettings.h"
+#include "undohelper.hpp"
 #include <QUndoCommand>
 #include <QUndoGroup>
 
 DocUndoStack::DocUndoStack(QUndoGroup *parent)
     : QUndoStack(parent)
+    , m_memoryBudget(qint64(KdenliveSettings::undomemorylimit()) * 1024 * 1024)
 {
+    // Queued, the stack cannot be modified while it is processing an undo
+    connect(this, &QUndoStack::indexChanged, this, &DocUndoStack::purgeDiscarded, Qt::QueuedConnection);
 }
 
 // TODO: custom undostack everywhere do that
 void DocUndoStack::push(QUndoCommand *cmd)
 {
-    if (index() < count()) {
-        Q_EMIT invalidate(index());
+    if (count() != m_countedCommands) {
+        recountMemoryUsage();
     }
+    // The commands that could be redone are deleted by the push
+    for (int i = index(); i < count(); ++i) {
+        m_memoryUsage -= commandCost(command(i));
+    }
+    const int expectedCount = index() + 1;
     QUndoStack::push(cmd);
+    if (count() == expectedCount) {
+        m_memoryUsage += commandCost(command(count() - 1));
+        m_countedCommands = count();
+    } else {
+        // The command was merged or deleted
+        recountMemoryUsage();
+    }
+    enforceMemoryBudget();
+    Q_EMIT memoryUsageChanged();
+}
+
+void DocUndoStack::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    enforceMemoryBudget();
+    Q_EMIT memoryUsageChanged();
+}
+
+qint64 DocUndoStack::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+qint64 DocUndoStack::commandCost(const QUndoCommand *cmd)
+{
+    qint64 cost = 0;
+    if (auto *functional = dynamic_cast<const FunctionalUndoCommand *>(cmd)) {
+        cost = functional->memoryCost();
+    } else {
+        cost = qint64(sizeof(QUndoCommand)) + cmd->text().size() * qint64(sizeof(QChar));
+    }
+    // Macros and parent commands hold their operations as children
+    for (int i = 0; i < cmd->childCount(); ++i) {
+        cost += commandCost(cmd->child(i));
+    }
+    return cost;
+}
+
+qint64 DocUndoStack::memoryUsage() const
+{
+    if (count() != m_countedCommands) {
+        recountMemoryUsage();
+    }
+    return m_memoryUsage;
+}
+
+void DocUndoStack::recountMemoryUsage() const
+{
+    m_memoryUsage = 0;
+    for (int i = 0; i < count(); ++i) {
+        m_memoryUsage += commandCost(command(i));
+    }
+    m_countedCommands = count();
+}
+
+int DocUndoStack::discardedCount() const
+{
+    int discarded = 0;
+    while (discarded < count() && command(discarded)->isObsolete()) {
+        discarded++;
+    }
+    return discarded;
+}
+
+void DocUndoStack::releaseCommand(QUndoCommand *cmd)
+{
+    if (auto *functional = dynamic_cast<FunctionalUndoCommand *>(cmd)) {
+        functional->releaseLambdas();
+    }
+    for (int i = 0; i < cmd->childCount(); ++i) {
+        releaseCommand(const_cast<QUndoCommand *>(cmd->child(i)));
+    }
+}
+
+void DocUndoStack::enforceMemoryBudget()
+{
+    if (m_memoryBudget <= 0) {
+        return;
+    }
+    if (memoryUsage() <= m_memoryBudget) {
+        return;
+    }
+    // Leave some room so that the history is not trimmed again on each new command
+    const qint64 target = m_memoryBudget / 4 * 3;
+    int discarded = 0;
+    // Only the commands below the current index can be discarded, and the last operation can always be undone
+    for (int i = discardedCount(); i < index() - 1 && m_memoryUsage > target; ++i) {
+        auto *cmd = const_cast<QUndoCommand *>(command(i));
+        m_memoryUsage -= commandCost(cmd);
+        releaseCommand(cmd);
+        // Obsolete commands are deleted by QUndoStack instead of being undone
+        cmd->setObsolete(true);
+        m_memoryUsage += commandCost(cmd);
+        discarded++;
+    }
+    if (discarded > 0) {
+        qCDebug(KDENLIVE_LOG) << "Undo history exceeds" << m_memoryBudget << "bytes, discarded" << discarded << "commands, now using" << m_memoryUsage;
+    }
+}
+
+void DocUndoStack::purgeDiscarded()
+{
+    // Discarded commands are always at the bottom of the stack, an undo of an obsolete command just deletes it
+    if (count() != m_countedCommands) {
+        recountMemoryUsage();
+    }
+    bool purged = false;
+    while (index() > 0 && command(index() - 1)->isObsolete()) {
+        m_memoryUsage -= commandCost(command(index() - 1));
+        undo();
+        m_countedCommands--;
+        purged = true;
+    }
+    if (purged) {
+        Q_EMIT memoryUsageChanged();
+    }
 }
@@ -10,12 +10,43 @@
 class QUndoGroup;
 class QUndoCommand;
 
+/** @class DocUndoStack
+    @brief The undo stack of a project.
+    The memory used by the history is estimated for each command. When it exceeds the memory budget, the oldest commands are
+    discarded: their data is freed and they are marked obsolete, so that they are removed from the stack instead of being undone.
+ */
 class DocUndoStack : public QUndoStack
 {
     Q_OBJECT
 public:
     explicit DocUndoStack(QUndoGroup *parent = Q_NULLPTR);
     void push(QUndoCommand *cmd);
+    /** @brief Set the memory available for the history in bytes, 0 for unlimited */
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    /** @brief Estimated memory used by the commands of the history, kept up to date as commands are pushed, discarded and purged */
+    qint64 memoryUsage() const;
+    /** @brief Number of commands at the bottom of the history that were discarded to respect the memory budget */
+    int discardedCount() const;
+    /** @brief Estimated memory used by @param cmd and its children */
+    static qint64 commandCost(const QUndoCommand *cmd);
+
 Q_SIGNALS:
-    void invalidate(int ix);
+    void memoryUsageChanged();
+
+private:
+    qint64 m_memoryBudget;
+    mutable qint64 m_memoryUsage{0};
+    /** @brief Number of commands counted in m_memoryUsage, if the stack has another size it was modified without us (cleared) */
+    mutable int m_countedCommands{0};
+    /** @brief Sum the cost of all the commands of the history */
+    void recountMemoryUsage() const;
+    /** @brief Discard the oldest commands until the history fits in 3/4 of the budget */
+    void enforceMemoryBudget();
+    /** @brief Free the data of @param cmd and its children */
+    static void releaseCommand(QUndoCommand *cmd);
+
+private Q_SLOTS:
+    /** @brief Remove the discarded commands reached by an undo, there is nothing left to undo below them */
+    void purgeDiscarded();
 };
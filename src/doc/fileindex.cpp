@@ -0,0 +1,149 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "fileindex.h"
+#include "utils/filefingerprintcache.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QtConcurrent>
+#include <vector>
+
+namespace {
+struct FolderScan
+{
+    QString path;
+    QStringList subFolders;
+    std::vector<std::pair<QString, qint64>> files;
+};
+} // namespace
+
+bool FileIndex::build(const QString &root, const std::atomic<bool> *abort)
+{
+    auto aborted = [abort]() { return abort != nullptr && abort->load(); };
+    QSet<QString> visited;
+    std::vector<FolderScan> level(1);
+    level.front().path = QDir(root).absolutePath();
+    while (!level.empty()) {
+        // List all the folders of a level in parallel, this is where network storage spends its time
+        QtConcurrent::blockingMap(level, [this, &aborted](FolderScan &scan) {
+            if (aborted()) {
+                return;
+            }
+            const QDir dir(scan.path);
+            const QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::Readable | QDir::NoDotAndDotDot, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                if (entry.isDir()) {
+                    if (entry.isExecutable()) {
+                        scan.subFolders << entry.absoluteFilePath();
+                    }
+                } else {
+                    scan.files.emplace_back(entry.fileName(), entry.size());
+                }
+            }
+            m_scannedFolders++;
+        });
+        if (aborted()) {
+            return false;
+        }
+        std::vector<FolderScan> next;
+        for (const FolderScan &scan : level) {
+            // Don't loop through symbolic links
+            const QString canonical = QFileInfo(scan.path).canonicalFilePath();
+            if (visited.contains(canonical)) {
+                continue;
+            }
+            visited.insert(canonical);
+            m_folders << scan.path;
+            m_foldersByName[QFileInfo(scan.path).fileName().toLower()] << scan.path;
+            const QDir dir(scan.path);
+            for (const auto &file : scan.files) {
+                const QString path = dir.absoluteFilePath(file.first);
+                m_bySize[file.second] << path;
+                // Names are matched case insensitively, like QDir name filters
+                const QString name = file.first.toLower();
+                QStringList &paths = m_byName[name];
+                if (paths.isEmpty()) {
+                    m_names << name;
+                }
+                paths << path;
+                m_fileCount++;
+            }
+            for (const QString &sub : scan.subFolders) {
+                FolderScan subScan;
+                subScan.path = sub;
+                next.push_back(std::move(subScan));
+            }
+        }
+        level = std::move(next);
+    }
+    return true;
+}
+
+int FileIndex::scannedFolders() const
+{
+    return m_scannedFolders;
+}
+
+int FileIndex::fileCount() const
+{
+    return m_fileCount;
+}
+
+void FileIndex::prefetchHashes(const QList<qint64> &sizes) const
+{
+    QStringList candidates;
+    for (qint64 size : sizes) {
+        auto it = m_bySize.find(size);
+        if (it != m_bySize.end()) {
+            candidates << it->second;
+        }
+    }
+    FileFingerprintCache::get()->prefetch(candidates);
+}
+
+QString FileIndex::findFile(qint64 size, const QString &hash) const
+{
+    auto it = m_bySize.find(size);
+    if (it == m_bySize.end()) {
+        return QString();
+    }
+    for (const QString &path : it->second) {
+        if (QString::fromLatin1(FileFingerprintCache::get()->fileHash(path).first.toHex()) == hash) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+QString FileIndex::findByName(const QString &fileName) const
+{
+    auto it = m_byName.constFind(fileName.toLower());
+    return it == m_byName.constEnd() ? QString() : it->constFirst();
+}
+
+QString FileIndex::findByPattern(const QString &pattern) const
+{
+    const QRegularExpression exp(QRegularExpression::wildcardToRegularExpression(pattern.toLower()));
+    for (const QString &name : m_names) {
+        if (exp.match(name).hasMatch()) {
+            return m_byName.value(name).constFirst();
+        }
+    }
+    return QString();
+}
+
+QString FileIndex::findFolder(const QString &dirName) const
+{
+    auto it = m_foldersByName.constFind(dirName.toLower());
+    return it == m_foldersByName.constEnd() ? QString() : it->constFirst();
+}
+
+const QStringList &FileIndex::folders() const
+{
+    return m_folders;
+}
@@ -0,0 +1,57 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <unordered_map>
+
+/** @class FileIndex
+    @brief Index of the files of a folder tree, used to relocate missing clips.
+    The tree is walked once, one depth level at a time with the folders of a level listed in parallel, and all missing files are
+    then resolved against the index instead of walking the tree once per clip. Files are indexed by size and by name, folders
+    by name, ignoring case. Paths are kept in the walk order, so that the files closest to the root are found first.
+    Files are only hashed when their size matches a searched file, through the fingerprint cache.
+ */
+class FileIndex
+{
+public:
+    FileIndex() = default;
+
+    /** @brief Index the files of @param root and its subfolders, can be called from any thread.
+        @param abort stops the walk when set, leaving a partial index
+        @returns false if the walk was aborted
+     */
+    bool build(const QString &root, const std::atomic<bool> *abort = nullptr);
+    /** @brief Number of folders listed so far, can be read while building */
+    int scannedFolders() const;
+    int fileCount() const;
+
+    /** @brief Hash in parallel the files having one of the @param sizes, so that later lookups do not read them */
+    void prefetchHashes(const QList<qint64> &sizes) const;
+    /** @brief Returns the first file with the given size and content hash (hex encoded), or an empty string */
+    QString findFile(qint64 size, const QString &hash) const;
+    /** @brief Returns the first file named @param fileName, or an empty string */
+    QString findByName(const QString &fileName) const;
+    /** @brief Returns the first file whose name matches a wildcard @param pattern, or an empty string */
+    QString findByPattern(const QString &pattern) const;
+    /** @brief Returns the first folder named @param dirName, or an empty string */
+    QString findFolder(const QString &dirName) const;
+    /** @brief All indexed folders, the root first */
+    const QStringList &folders() const;
+
+private:
+    std::unordered_map<qint64, QStringList> m_bySize;
+    QHash<QString, QStringList> m_byName;
+    QHash<QString, QStringList> m_foldersByName;
+    /** @brief Lower case file names in walk order, for pattern searches */
+    QStringList m_names;
+    QStringList m_folders;
+    std::atomic<int> m_scannedFolders{0};
+    int m_fileCount{0};
+};
@@ -28,6 +28,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "titler/titlewidget.h"
 #include "transitions/transitionsrepository.hpp"
+#include "utils/filefingerprintcache.hpp"
 #include <config-kdenlive.h>
 
 #include "utils/KMessageBox_KdenliveCompat.h"
@@ -48,6 +49,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QStandardPaths>
 #include <QUndoGroup>
 #include <QUndoStack>
+#include <QtConcurrent>
 #include <memory>
 #include <mlt++/Mlt.h>
 
@@ -75,7 +77,6 @@ KdenliveDoc::KdenliveDoc(QString projectFolder, QUndoGroup *undoGroup, const QSt
         connect(this, &KdenliveDoc::updateCompositionMode, parent, &MainWindow::slotUpdateCompositeAction);
     }
     connect(m_commandStack.get(), &QUndoStack::indexChanged, this, &KdenliveDoc::slotModified);
-    connect(m_commandStack.get(), &DocUndoStack::invalidate, this, &KdenliveDoc::checkPreviewStack, Qt::DirectConnection);
     // connect(m_commandStack, SIGNAL(cleanChanged(bool)), this, SLOT(setModified(bool)));
 
     initializeProperties();
@@ -129,7 +130,6 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, QDomDocument &newDom, QString projectF
         connect(this, &KdenliveDoc::updateCompositionMode, parent, &MainWindow::slotUpdateCompositeAction);
     }
     connect(m_commandStack.get(), &QUndoStack::indexChanged, this, &KdenliveDoc::slotModified);
-    connect(m_commandStack.get(), &DocUndoStack::invalidate, this, &KdenliveDoc::checkPreviewStack, Qt::DirectConnection);
 
     initializeProperties(false);
     updateClipsCount();
@@ -323,6 +323,7 @@ KdenliveDoc::~KdenliveDoc()
     m_timelines.clear();
     // qCDebug(KDENLIVE_LOG) << "// DEL CLP MAN done";
     if (m_autosave) {
+        waitForAutoSave();
         if (!m_autosave->fileName().isEmpty()) {
             m_autosave->remove();
         }
@@ -548,28 +549,70 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
            (width < 0 || width > m_documentProperties.value(QStringLiteral("proxyimageminsize")).toInt());
 }
 
-void KdenliveDoc::slotAutoSave(const QString &scene)
+void KdenliveDoc::slotAutoSave(const QString &scene, const QMap<QString, QString> &replacements)
 {
     if (m_autosave != nullptr) {
-        if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
+        if (scene.isEmpty()) {
+            // Make sure we don't save if scenelist is corrupted
+            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
+            return;
+        }
+        QMutexLocker lock(&m_autoSaveMutex);
+        // Opening the file creates its lock, do it from the GUI thread
+        if (!m_autoSaveRunning && !m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
             // show error: could not open the autosave file
             qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT CREATE AUTOSAVE FILE";
             pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
             return;
         }
-        if (scene.isEmpty()) {
-            // Make sure we don't save if scenelist is corrupted
-            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
-            return;
+        // An older scene that was not written yet is replaced
+        m_pendingAutoSave = scene;
+        m_pendingReplacements = replacements;
+        if (!m_autoSaveRunning) {
+            m_autoSaveRunning = true;
+            m_autoSaveTask = QtConcurrent::run([this]() { writeAutoSave(); });
         }
+    }
+}
+
+void KdenliveDoc::writeAutoSave()
+{
+    while (true) {
+        QString scene;
+        QMap<QString, QString> replacements;
+        {
+            QMutexLocker lock(&m_autoSaveMutex);
+            if (m_pendingAutoSave.isNull()) {
+                m_autoSaveRunning = false;
+                return;
+            }
+            scene.swap(m_pendingAutoSave);
+            replacements.swap(m_pendingReplacements);
+        }
+        QMapIterator<QString, QString> i(replacements);
+        while (i.hasNext()) {
+            i.next();
+            scene.replace(i.key(), i.value());
+        }
+        if (!scene.contains(QLatin1String("<track "))) {
+            // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
+            pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"), ErrorMessage);
+            continue;
+        }
+        const QByteArray data = scene.toUtf8();
         m_autosave->resize(0);
-        if (m_autosave->write(scene.toUtf8()) < 0) {
+        if (m_autosave->write(data) < 0) {
             pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
         }
         m_autosave->flush();
     }
 }
 
+void KdenliveDoc::waitForAutoSave()
+{
+    m_autoSaveTask.waitForFinished();
+}
+
 void KdenliveDoc::setZoom(const QUuid &uuid, int horizontal, int vertical)
 {
     setSequenceProperty(uuid, QStringLiteral("zoom"), QString::number(horizontal));
@@ -1047,34 +1090,16 @@ const QString KdenliveDoc::description(const QString suffix) const
 QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
 {
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-                qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
+        const QString filePath = dir.absoluteFilePath(filesAndDirs.at(i));
+        if (QString::number(QFileInfo(filePath).size()) == matchSize) {
+            const QByteArray fileHash = FileFingerprintCache::get()->fileHash(filePath).first;
+            if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
+                return filePath;
             }
+            qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
         }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
     }
     filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
@@ -1975,12 +2000,6 @@ void KdenliveDoc::initProxySettings()
     m_proxyExtension = params.section(QLatin1Char(';'), 1);
 }
 
-void KdenliveDoc::checkPreviewStack(int ix)
-{
-    // A command was pushed in the middle of the stack, remove all cached data from last undos
-    Q_EMIT removeInvalidUndo(ix);
-}
-
 void KdenliveDoc::initCacheDirs()
 {
     bool ok = false;
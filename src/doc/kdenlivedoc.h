@@ -14,8 +14,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <QAction>
 #include <QDir>
+#include <QFuture>
 #include <QList>
 #include <QMap>
+#include <QMutex>
 #include <QObject>
 #include <QUuid>
 #include <memory>
@@ -290,6 +292,8 @@ public:
     bool sequenceThumbRequiresRefresh(const QUuid &uuid) const;
     /** @brief Thumbnail for a sequence was updated, remove it from the update list.*/
     void sequenceThumbUpdated(const QUuid &uuid);
+    /** @brief Block until the queued autosave scenes are written, before accessing the autosave file from the GUI thread.*/
+    void waitForAutoSave();
 
 private:
     /** @brief Create a new KdenliveDoc using the provided QDomDocument (an
@@ -337,6 +341,15 @@ private:
     /** @brief A list of guide models for this project (one for each timeline). */
     QMap<QUuid, std::shared_ptr<TimelineItemModel>> m_timelines;
 
+    /** @brief Protects the pending autosave scene */
+    QMutex m_autoSaveMutex;
+    /** @brief The latest scene waiting to be written to the autosave file, null when there is none */
+    QString m_pendingAutoSave;
+    QMap<QString, QString> m_pendingReplacements;
+    /** @brief The task writing the autosave scenes */
+    QFuture<void> m_autoSaveTask;
+    bool m_autoSaveRunning{false};
+
     QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
 
     /** @brief Creates a new project. */
@@ -352,6 +365,8 @@ private:
     void updateProjectProfile(bool reloadProducers = false, bool reloadThumbs = false);
     /** @brief initialize proxy settings based on hw status */
     void initProxySettings();
+    /** @brief Write the pending autosave scenes, run in a worker thread */
+    void writeAutoSave();
 
 public Q_SLOTS:
     void slotCreateTextTemplateClip(const QString &group, const QString &groupId, QUrl path);
@@ -368,15 +383,15 @@ public Q_SLOTS:
                               QUndoCommand *masterCommand = nullptr);
     /** @brief Saves the current project at the autosave location.
      *
-     * The autosave files are in ~/.kde/data/stalefiles/kdenlive/ */
-    void slotAutoSave(const QString &scene);
+     * The autosave files are in ~/.kde/data/stalefiles/kdenlive/ \n
+     * The scene is written in a worker thread, after applying the @param replacements to it.
+     * If a scene is still being written, only the most recent of the scenes queued meanwhile is written after it. */
+    void slotAutoSave(const QString &scene, const QMap<QString, QString> &replacements = QMap<QString, QString>());
     void switchProfile(ProfileParam* pf, const QString &clipName);
 
 private Q_SLOTS:
     void slotModified();
     void slotSwitchProfile(const QString &profile_path, bool reloadThumbs);
-    /** @brief Check if we did a new action invalidating more recent undo items. */
-    void checkPreviewStack(int ix);
     /** @brief Display error message on failed move. */
     void slotMoveFinished(KJob *job);
     /** @brief Save the project guide categories in the document properties. */
@@ -398,8 +413,6 @@ Q_SIGNALS:
     void reloadEffects(const QStringList &paths);
     /** @brief Fps was changed, update timeline (changed = 1 means no change) */
     void updateFps(double changed);
-    /** @brief If a command is pushed when we are in the middle of undo stack, invalidate further undo history */
-    void removeInvalidUndo(int ix);
     /** @brief Update compositing info */
     void updateCompositionMode(bool);
 };
@@ -106,6 +106,7 @@ void EffectStackModel::removeAllEffects(Fun &undo, Fun &redo)
         Fun local_redo = removeItem_lambda(effect->getId());
         local_redo();
         UPDATE_UNDO_REDO(local_redo, local_undo, undo, redo);
+        addUndoPayload(effect->memoryCost());
     }
     std::unordered_set<int> fadeIns = m_fadeIns;
     std::unordered_set<int> fadeOuts = m_fadeOuts;
@@ -162,6 +163,7 @@ void EffectStackModel::removeEffect(const std::shared_ptr<EffectItemModel> &effe
     setActiveEffect(current);
     int currentRow = effect->row();
     Fun undo = addItem_lambda(effect, parentId);
+    addUndoPayload(effect->memoryCost());
     if (currentRow != rowCount() - 1) {
         Fun move = moveItem_lambda(effect->getId(), currentRow, true);
         PUSH_LAMBDA(move, undo);
@@ -266,6 +268,16 @@ QDomElement EffectStackModel::toXml(QDomDocument &document)
     return container;
 }
 
+qint64 EffectStackModel::memoryCost() const
+{
+    QReadLocker locker(&m_lock);
+    qint64 cost = qint64(sizeof(EffectStackModel));
+    for (int i = 0; i < rootItem->childCount(); ++i) {
+        cost += std::static_pointer_cast<EffectItemModel>(rootItem->child(i))->memoryCost();
+    }
+    return cost;
+}
+
 QDomElement EffectStackModel::rowToXml(const QUuid &uuid, int row, QDomDocument &document)
 {
     QDomElement container = document.createElement(QStringLiteral("effects"));
@@ -360,6 +372,7 @@ bool EffectStackModel::fromXml(const QDomElement &effectsXml, Fun &undo, Fun &re
         Fun local_undo = removeItem_lambda(effect->getId());
         // TODO the parent should probably not always be the root
         Fun local_redo = addItem_lambda(effect, rootItem->getId());
+        addUndoPayload(effect->memoryCost());
         effect->prepareKeyframes();
         connect(effect.get(), &AssetParameterModel::modelChanged, this, &EffectStackModel::modelChanged);
         connect(effect.get(), &AssetParameterModel::replugEffect, this, &EffectStackModel::replugEffect, Qt::DirectConnection);
@@ -443,6 +456,7 @@ bool EffectStackModel::copyEffect(const std::shared_ptr<AbstractEffectItem> &sou
     Fun local_undo = removeItem_lambda(effect->getId());
     // TODO the parent should probably not always be the root
     Fun local_redo = addItem_lambda(effect, rootItem->getId());
+    addUndoPayload(effect->memoryCost());
     effect->prepareKeyframes();
     connect(effect.get(), &AssetParameterModel::modelChanged, this, &EffectStackModel::modelChanged);
     connect(effect.get(), &AssetParameterModel::replugEffect, this, &EffectStackModel::replugEffect, Qt::DirectConnection);
@@ -510,6 +524,7 @@ bool EffectStackModel::appendEffect(const QString &effectId, bool makeCurrent)
     Fun undo = removeItem_lambda(effect->getId());
     // TODO the parent should probably not always be the root
     Fun redo = addItem_lambda(effect, rootItem->getId());
+    addUndoPayload(effect->memoryCost());
     effect->prepareKeyframes();
     connect(effect.get(), &AssetParameterModel::modelChanged, this, &EffectStackModel::modelChanged);
     connect(effect.get(), &AssetParameterModel::replugEffect, this, &EffectStackModel::replugEffect, Qt::DirectConnection);
@@ -1072,6 +1087,7 @@ void EffectStackModel::importEffects(const std::weak_ptr<Mlt::Service> &service,
             connect(effect.get(), &AssetParameterModel::replugEffect, this, &EffectStackModel::replugEffect, Qt::DirectConnection);
             connect(effect.get(), &AssetParameterModel::showEffectZone, this, &EffectStackModel::updateEffectZones);
             Fun redo = addItem_lambda(effect, rootItem->getId());
+            addUndoPayload(effect->memoryCost());
             effect->prepareKeyframes();
             if (redo()) {
                 if (effectId.startsWith(QLatin1String("fadein")) || effectId.startsWith(QLatin1String("fade_from_"))) {
@@ -1306,6 +1322,10 @@ void EffectStackModel::replugEffect(const std::shared_ptr<AssetParameterModel> &
     QWriteLocker locker(&m_lock);
     auto effectItem = std::static_pointer_cast<EffectItemModel>(asset);
     int oldRow = effectItem->row();
+    if (oldRow < 0) {
+        // The rebuild is delayed after parameter changes, the effect may have been removed since
+        return;
+    }
     int count = rowCount();
     for (int ix = oldRow; ix < count; ix++) {
         auto item = std::static_pointer_cast<EffectItemModel>(rootItem->child(ix));
@@ -1336,6 +1356,7 @@ void EffectStackModel::cleanFadeEffects(bool outEffects, Fun &undo, Fun &redo)
         if (operation()) {
             Fun reverse = addItem_lambda(effect, rootItem->getId());
             UPDATE_UNDO_REDO(operation, reverse, undo, redo);
+            addUndoPayload(effect->memoryCost());
         }
     }
     if (!toDelete.empty()) {
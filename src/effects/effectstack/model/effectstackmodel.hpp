@@ -120,6 +120,8 @@ public:
 
     /** @brief Returns an XML representation of the effect stack with all parameters */
     QDomElement toXml(QDomDocument &document);
+    /** @brief Estimated memory used by the effects of this stack, reported when an undo command keeps it alive */
+    qint64 memoryCost() const;
     /** @brief Returns an XML representation of one of the effect in the stack with all parameters */
     QDomElement rowToXml(const QUuid &uuid, int row, QDomDocument &document);
     /** @brief Load an effect stack from an XML representation */
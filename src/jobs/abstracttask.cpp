@@ -61,6 +61,10 @@ AbstractTask::AbstractTask(const ObjectId &owner, JOBTYPE type, QObject *object)
     case AbstractTask::SPEEDJOB:
         m_priority = 5;
         break;
+    case AbstractTask::CACHEJOB:
+        // Thumbnail caching is only useful later, when the clip is displayed
+        m_priority = 1;
+        break;
     default:
         m_priority = 5;
         break;
@@ -122,6 +126,13 @@ void AbstractTask::setPreferredPriority(qint64 pid)
 #endif
 }
 
+AbstractTaskDone::AbstractTaskDone(int cid, AbstractTask *task)
+    : m_cid(cid)
+    , m_task(task)
+{
+    pCore->taskManager.taskStarted(task);
+}
+
 AbstractTaskDone::~AbstractTaskDone() {
     pCore->taskManager.taskDone(m_cid, m_task);
 }
@@ -67,13 +67,11 @@ Q_SIGNALS:
 };
 
 /**
- * @brief When destroyed, notifies the taskManager that this task is done.
+ * @brief When created, notifies the taskManager that this task started, and when destroyed that this task is done.
  */
 class AbstractTaskDone {
 public:
-    AbstractTaskDone(int cid, AbstractTask *task)
-        : m_cid(cid)
-        , m_task(task) {}
+    AbstractTaskDone(int cid, AbstractTask *task);
     ~AbstractTaskDone();
 private:
     int m_cid;
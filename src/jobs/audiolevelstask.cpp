@@ -6,6 +6,7 @@
 */
 
 #include "audiolevelstask.h"
+#include "audio/audioLevelsPyramid.h"
 #include "audio/audioStreamInfo.h"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -27,11 +28,62 @@
 static QList<AudioLevelsTask *> tasksList;
 static QMutex tasksListMutex;
 
+constexpr int AudioLevelsTask::BinsPerFrame;
+
 static void deleteQVariantList(QVector<uint8_t> *list)
 {
     delete list;
 }
 
+static void deleteAudioPeaks(std::shared_ptr<const AudioLevelsPyramid> *peaks)
+{
+    delete peaks;
+}
+
+/** @brief Store the audio levels of a stream in the producer: the pyramid used for painting and the legacy per frame levels */
+static void storeAudioLevels(const std::shared_ptr<Mlt::Producer> &producer, int stream, const std::shared_ptr<const AudioLevelsPyramid> &peaks, bool storeMax)
+{
+    if (peaks == nullptr) {
+        return;
+    }
+    QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(peaks->frameLevels());
+    auto *peaksCopy = new std::shared_ptr<const AudioLevelsPyramid>(peaks);
+    producer->lock();
+    QString key = QString("_kdenlive:audio%1").arg(stream);
+    QString peaksKey = QString("_kdenlive:audiopeaks%1").arg(stream);
+    if (storeMax) {
+        QString key2 = QString("kdenlive:audio_max%1").arg(stream);
+        producer->set(key2.toUtf8().constData(), peaks->maxLevel());
+    }
+    producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
+    producer->set(peaksKey.toUtf8().constData(), peaksCopy, 0, (mlt_destructor)deleteAudioPeaks);
+    producer->unlock();
+}
+
+/** @brief Load audio levels from the PNG cache used by previous versions, with one value per frame stored in 4 channels pixels */
+static std::shared_ptr<const AudioLevelsPyramid> loadLegacyThumbnail(const QString &path, int channels)
+{
+    if (!QFile::exists(path)) {
+        return nullptr;
+    }
+    QImage image(path);
+    if (image.isNull() || image.height() != channels) {
+        return nullptr;
+    }
+    image = image.convertToFormat(QImage::Format_ARGB32);
+    QVector<uint8_t> levels;
+    int n = image.width() * image.height();
+    levels.reserve(4 * n);
+    for (int i = 0; n > 1 && i < n; i++) {
+        QRgb p = reinterpret_cast<const QRgb *>(image.constScanLine(i % channels))[i / channels];
+        levels << qRed(p);
+        levels << qGreen(p);
+        levels << qBlue(p);
+        levels << qAlpha(p);
+    }
+    return AudioLevelsPyramid::fromFrameLevels(levels, channels);
+}
+
 AudioLevelsTask::AudioLevelsTask(const ObjectId &owner, QObject *object)
     : AbstractTask(owner, AbstractTask::AUDIOTHUMBJOB, object)
 {
@@ -69,6 +121,12 @@ void AudioLevelsTask::run()
         // nothing to do
         return;
     }
+    if (!m_isForce && binClip->clipType() == ClipType::AV && pCore->taskManager.hasRunningJob(m_owner, AbstractTask::PROXYJOB)) {
+        // A running proxy task decodes the audio levels along with the proxy, and starts this task again when done.
+        // A proxy that is only queued does not delay the waveform
+        m_progress = 100;
+        return;
+    }
     std::shared_ptr<Mlt::Producer> producer = binClip->originalProducer();
     if ((producer == nullptr) || !producer->is_valid()) {
         QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection,
@@ -101,30 +159,21 @@ void AudioLevelsTask::run()
             channels = audioChannels.value(stream);
         }
         // Generate one thumb per stream
-        QString cachePath = binClip->getAudioThumbPath(stream);
-        QVector<uint8_t> mltLevels;
-        if (!m_isForce && QFile::exists(cachePath)) {
-            // Audio thumb already exists
-            QImage image(cachePath);
-            if (!m_isCanceled && !image.isNull()) {
-                // convert cached image
-                int n = image.width() * image.height();
-                for (int i = 0; n > 1 && i < n; i++) {
-                    QRgb p = image.pixel(i / channels, i % channels);
-                    mltLevels << qRed(p);
-                    mltLevels << qGreen(p);
-                    mltLevels << qBlue(p);
-                    mltLevels << qAlpha(p);
-                }
-                if (mltLevels.size() > 0) {
-                    QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                    producer->lock();
-                    QString key = QString("_kdenlive:audio%1").arg(stream);
-                    producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                    producer->unlock();
-                    continue;
+        const QString peaksPath = binClip->getAudioPeaksPath(stream);
+        if (!m_isForce) {
+            std::shared_ptr<const AudioLevelsPyramid> cached = AudioLevelsPyramid::load(peaksPath);
+            if (cached == nullptr && !m_isCanceled) {
+                // Convert the audio thumbnail image created by previous versions
+                const QString legacyPath = binClip->getAudioThumbPath(stream);
+                cached = loadLegacyThumbnail(legacyPath, channels);
+                if (cached && cached->save(peaksPath)) {
+                    QFile::remove(legacyPath);
                 }
             }
+            if (cached && cached->channels() == channels) {
+                storeAudioLevels(producer, stream, cached, true);
+                continue;
+            }
         }
         QString service = producer->get("mlt_service");
         if (service == QLatin1String("avformat-novalidate")) {
@@ -143,19 +192,15 @@ void AudioLevelsTask::run()
         audioProducer->set("audio_index", stream);
         Mlt::Filter chans(producer->get_profile(), "audiochannels");
         Mlt::Filter converter(producer->get_profile(), "audioconvert");
-        Mlt::Filter levels(producer->get_profile(), "audiolevel");
         audioProducer->attach(chans);
         audioProducer->attach(converter);
-        audioProducer->attach(levels);
 
         double framesPerSecond = audioProducer->get_fps();
         mlt_audio_format audioFormat = mlt_audio_s16;
-        QStringList keys;
-        keys.reserve(channels);
-        for (int i = 0; i < channels; i++) {
-            keys << "meta.media.audio_level." + QString::number(i);
-        }
-        uint maxLevel = 1;
+        // Finest pyramid level: for each bin of each frame, a high/low peak pair per channel
+        const int frameSize = BinsPerFrame * channels * 2;
+        QByteArray peaks;
+        peaks.reserve(lengthInFrames * frameSize);
         QElapsedTimer updateTime;
         updateTime.start();
         for (int z = 0; z < lengthInFrames && !m_isCanceled; ++z) {
@@ -164,73 +209,38 @@ void AudioLevelsTask::run()
                 m_progress = val;
                 QMetaObject::invokeMethod(m_object, "updateJobProgress");
             }
+            // Let the clips displayed in monitor and timeline load first
+            pCore->taskManager.yieldToUrgentTasks(this);
             QScopedPointer<Mlt::Frame> mltFrame(audioProducer->get_frame());
+            const int16_t *data = nullptr;
+            int samples = 0;
+            int frameChannels = channels;
             if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
-                int samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
-                mltFrame->get_audio(audioFormat, frequency, channels, samples);
-                for (int channel = 0; channel < channels; ++channel) {
-                    uint lev = 256 * qMin(mltFrame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                    mltLevels << lev;
-                    // double lev = mltFrame->get_double(keys.at(channel).toUtf8().constData());
-                    // mltLevels << lev;
-                    maxLevel = qMax(lev, maxLevel);
-                }
-            } else if (!mltLevels.isEmpty()) {
-                for (int channel = 0; channel < channels; channel++) {
-                    mltLevels << mltLevels.last();
-                }
+                samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
+                data = static_cast<const int16_t *>(mltFrame->get_audio(audioFormat, frequency, frameChannels, samples));
             }
+            AudioLevelsPyramid::appendFramePeaks(peaks, data, samples, frameChannels, channels, BinsPerFrame);
             // Incrementally update the audio levels every 3 seconds.
             if (updateTime.elapsed() > 3000 && !m_isCanceled) {
                 updateTime.restart();
-                QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                producer->lock();
-                QString key = QString("_kdenlive:audio%1").arg(stream);
-                producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                producer->unlock();
+                storeAudioLevels(producer, stream, AudioLevelsPyramid::fromPeaks(peaks, channels, BinsPerFrame, peaks.size() / frameSize), false);
                 QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
             }
         }
 
-        /*// Normalize
-        for (double &v : mltLevels) {
-            m_audioLevels << uchar(255 * v / maxLevel);
-        }*/
         if (m_isCanceled) {
-            mltLevels.clear();
+            peaks.clear();
             m_progress = 100;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
         }
-        if (mltLevels.size() > 0) {
-            QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-            producer->lock();
-            QString key = QString("_kdenlive:audio%1").arg(stream);
-            QString key2 = QString("kdenlive:audio_max%1").arg(stream);
-            producer->set(key2.toUtf8().constData(), int(maxLevel));
-            producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-            producer->unlock();
-            // qDebug()<<"=== FINISHED PRODUCING AUDIO FOR: "<<key<<", SIZE: "<<levelsCopy->size();
+        std::shared_ptr<const AudioLevelsPyramid> pyramid = AudioLevelsPyramid::fromPeaks(peaks, channels, BinsPerFrame, peaks.size() / frameSize);
+        if (pyramid) {
+            storeAudioLevels(producer, stream, pyramid, true);
+            // qDebug()<<"=== FINISHED PRODUCING AUDIO FOR: "<<stream<<", FRAMES: "<<pyramid->frameCount();
             m_progress = 100;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
-            // Put into an image for caching.
-            int count = mltLevels.size();
-            QImage image((count + 3) / 4 / channels, channels, QImage::Format_ARGB32);
-            int n = image.width() * image.height();
-            for (int i = 0; i < n; i++) {
-                QRgb p;
-                if ((4 * i + 3) < count) {
-                    p = qRgba(mltLevels.at(4 * i), mltLevels.at(4 * i + 1), mltLevels.at(4 * i + 2), mltLevels.at(4 * i + 3));
-                } else {
-                    int last = mltLevels.last();
-                    int r = (4 * i + 0) < count ? mltLevels.at(4 * i + 0) : last;
-                    int g = (4 * i + 1) < count ? mltLevels.at(4 * i + 1) : last;
-                    int b = (4 * i + 2) < count ? mltLevels.at(4 * i + 2) : last;
-                    int a = last;
-                    p = qRgba(r, g, b, a);
-                }
-                image.setPixel(i / channels, i % channels, p);
-            }
-            image.save(cachePath);
+            // Write the cache file
+            pyramid->save(peaksPath);
             audioCreated = true;
             QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
         }
@@ -18,6 +18,8 @@ class AudioLevelsTask : public AbstractTask
 public:
     AudioLevelsTask(const ObjectId &owner, QObject* object);
     static void start(const ObjectId &owner, QObject* object, bool force = false);
+    /** @brief Number of peak bins computed for each frame in the finest level of the audio pyramid */
+    static constexpr int BinsPerFrame = 4;
 
 protected:
     void run() override;
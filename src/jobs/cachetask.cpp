@@ -9,7 +9,6 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
-#include "doc/kthumb.h"
 #include "kdenlivesettings.h"
 #include "utils/thumbnailcache.hpp"
 
@@ -23,15 +22,11 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 CacheTask::CacheTask(const ObjectId &owner, int thumbsCount, int in, int out, QObject *object)
     : AbstractTask(owner, AbstractTask::CACHEJOB, object)
-    , m_fullWidth(qFuzzyCompare(pCore->getCurrentSar(), 1.0) ? 0 : qRound(pCore->thumbProfile()->height() * pCore->getCurrentDar()))
     , m_thumbsCount(thumbsCount)
     , m_in(in)
     , m_out(out)
 {
     m_description = i18n("Video thumbs");
-    if (m_fullWidth % 2 > 0) {
-        m_fullWidth++;
-    }
 }
 
 CacheTask::~CacheTask() {}
@@ -51,7 +46,6 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
 {
     // Fetch thumbnail
     if (binClip->clipType() != ClipType::Audio) {
-        std::shared_ptr<Mlt::Producer> thumbProd(nullptr);
         int duration = m_out > 0 ? m_out - m_in : binClip->getFramePlaytime();
         std::set<int> frames;
         int steps = qCeil(qMax(pCore->getCurrentFps(), double(duration) / m_thumbsCount));
@@ -67,30 +61,23 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
             m_progress = 100 * count / size;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
             count++;
+            // Let the clips displayed in monitor and timeline load first
+            pCore->taskManager.yieldToUrgentTasks(this);
             if (m_isCanceled || pCore->taskManager.isBlocked()) {
                 break;
             }
             if (ThumbnailCache::get()->hasThumbnail(clipId, i)) {
                 continue;
             }
-            if (thumbProd == nullptr) {
-                thumbProd = binClip->thumbProducer();
-            }
-            if (thumbProd == nullptr) {
+            // Frames are requested in ascending order, so the clip's thumbnail pool serves them on the same producer without backward seeks
+            QImage result = binClip->fetchThumbnail(i);
+            if (result.isNull()) {
                 // Thumb producer not available
                 break;
             }
-            thumbProd->seek(i);
-            QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
-            if (frame != nullptr && frame->is_valid()) {
-                frame->set("consumer.deinterlacer", "onefield");
-                frame->set("consumer.top_field_first", -1);
-                frame->set("consumer.rescale", "nearest");
-                QImage result = KThumb::getFrame(frame.data(), 0, 0, m_fullWidth);
-                if (!result.isNull() && !m_isCanceled) {
-                    qDebug() << "==== CACHING FRAME: " << i;
-                    ThumbnailCache::get()->storeThumbnail(clipId, i, result, true);
-                }
+            if (!m_isCanceled) {
+                qDebug() << "==== CACHING FRAME: " << i;
+                ThumbnailCache::get()->storeThumbnail(clipId, i, result, true);
             }
         }
     }
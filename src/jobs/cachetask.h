@@ -30,7 +30,6 @@ protected:
     void run() override;
 
 private:
-    int m_fullWidth;
     int m_thumbsCount;
     int m_in;
     int m_out;
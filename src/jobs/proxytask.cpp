@@ -5,6 +5,9 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "proxytask.h"
+#include "audio/audioLevelsPyramid.h"
+#include "audio/audioStreamInfo.h"
+#include "audiolevelstask.h"
 #include "bin/bin.h"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -15,6 +18,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "macros.hpp"
 
 #include <QProcess>
+#include <QScopeGuard>
 #include <QTemporaryFile>
 #include <QThread>
 
@@ -44,6 +48,18 @@ void ProxyTask::start(const ObjectId &owner, QObject *object, bool force)
 void ProxyTask::run()
 {
     AbstractTaskDone whenFinished(m_owner.second, this);
+    // The audio levels task skips clips waiting for their proxy, start it again once we are done, including when we are canceled before running
+    auto restartAudioLevels = qScopeGuard([this]() {
+        if (!KdenliveSettings::audiothumbnails() || pCore->taskManager.isBlocked()) {
+            return;
+        }
+        auto clip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.second));
+        if (clip && clip->clipType() == ClipType::AV) {
+            const ObjectId owner = m_owner;
+            QObject *object = m_object;
+            QMetaObject::invokeMethod(pCore.get(), [owner, object] { AudioLevelsTask::start(owner, object, false); });
+        }
+    });
     if (m_isCanceled || pCore->taskManager.isBlocked()) {
         return;
     }
@@ -53,6 +69,7 @@ void ProxyTask::run()
     if (binClip == nullptr) {
         return;
     }
+    ClipType::ProducerType type = binClip->clipType();
     const QString dest = binClip->getProducerProperty(QStringLiteral("kdenlive:proxy"));
     QFileInfo fInfo(dest);
     if (binClip->getProducerIntProperty(QStringLiteral("_overwriteproxy")) == 0 && fInfo.exists() && fInfo.size() > 0) {
@@ -63,7 +80,6 @@ void ProxyTask::run()
         return;
     }
 
-    ClipType::ProducerType type = binClip->clipType();
     m_progress = 0;
     bool result = false;
     QString source = binClip->getProducerProperty(QStringLiteral("kdenlive:originalurl"));
@@ -336,15 +352,73 @@ void ProxyTask::run()
         // Drop unknown streams instead of aborting
         parameters << QStringLiteral("-ignore_unknown");
         parameters << dest;
+
+        // Decode the audio levels of the first audio stream in the same pass, instead of reading the source again afterwards
+        int levelsStream = -1;
+        int levelsChannels = 0;
+        int levelsFrequency = 0;
+        const double fps = binClip->originalProducer()->get_fps();
+        if (type == ClipType::AV && KdenliveSettings::audiothumbnails() && fps > 0 && !binClip->audioThumbCreated() && binClip->audioInfo() &&
+            !pCore->taskManager.hasRunningJob(m_owner, AbstractTask::AUDIOTHUMBJOB)) {
+            const QMap<int, QString> streams = binClip->audioInfo()->streams();
+            if (!streams.isEmpty() && !QFileInfo::exists(binClip->getAudioPeaksPath(streams.firstKey()))) {
+                levelsStream = streams.firstKey();
+                levelsChannels = binClip->audioInfo()->streamChannels().value(levelsStream, binClip->audioInfo()->channels());
+                levelsChannels = levelsChannels <= 0 ? 2 : levelsChannels;
+                levelsFrequency = binClip->audioInfo()->samplingRate();
+                levelsFrequency = levelsFrequency <= 0 ? 48000 : levelsFrequency;
+                parameters << QStringLiteral("-map") << QStringLiteral("0:%1").arg(levelsStream) << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le")
+                           << QStringLiteral("-ar") << QString::number(levelsFrequency) << QStringLiteral("-ac") << QString::number(levelsChannels)
+                           << QStringLiteral("-f") << QStringLiteral("s16le") << QStringLiteral("pipe:1");
+            }
+        }
+        QByteArray samples;
+        QByteArray peaks;
+        int frame = 0;
         qDebug() << "/// FULL PROXY PARAMS:\n" << parameters << "\n------";
         m_jobProcess.reset(new QProcess);
         // m_jobProcess->setProcessChannelMode(QProcess::MergedChannels);
         QObject::connect(m_jobProcess.get(), &QProcess::readyReadStandardError, this, &ProxyTask::processLogInfo);
         QObject::connect(this, &ProxyTask::jobCanceled, m_jobProcess.get(), &QProcess::kill, Qt::DirectConnection);
+        if (levelsStream >= 0) {
+            // Slice the raw samples in frames as the MLT producer would, so that the levels match the ones of the audio levels task
+            QObject::connect(
+                m_jobProcess.get(), &QProcess::readyReadStandardOutput, m_jobProcess.get(),
+                [&]() {
+                    samples.append(m_jobProcess->readAllStandardOutput());
+                    int offset = 0;
+                    while (true) {
+                        const int count = mlt_audio_calculate_frame_samples(float(fps), levelsFrequency, frame);
+                        const int size = count * levelsChannels * int(sizeof(int16_t));
+                        if (samples.size() - offset < size) {
+                            break;
+                        }
+                        AudioLevelsPyramid::appendFramePeaks(peaks, reinterpret_cast<const int16_t *>(samples.constData() + offset), count, levelsChannels,
+                                                             levelsChannels, AudioLevelsTask::BinsPerFrame);
+                        offset += size;
+                        frame++;
+                    }
+                    samples.remove(0, offset);
+                },
+                Qt::DirectConnection);
+        }
         m_jobProcess->start(KdenliveSettings::ffmpegpath(), parameters, QIODevice::ReadOnly);
         AbstractTask::setPreferredPriority(m_jobProcess->processId());
         m_jobProcess->waitForFinished(-1);
         result = m_jobProcess->exitStatus() == QProcess::NormalExit;
+        if (levelsStream >= 0 && result && !m_isCanceled && m_jobProcess->exitCode() == 0 && frame > 0) {
+            // Pad to the producer length like the audio levels task does for missing frames
+            const int length = binClip->originalProducer()->get_length();
+            while (frame < length) {
+                AudioLevelsPyramid::appendFramePeaks(peaks, nullptr, 0, levelsChannels, levelsChannels, AudioLevelsTask::BinsPerFrame);
+                frame++;
+            }
+            std::shared_ptr<const AudioLevelsPyramid> pyramid = AudioLevelsPyramid::fromPeaks(peaks, levelsChannels, AudioLevelsTask::BinsPerFrame, frame);
+            if (pyramid) {
+                // Loaded from the cache by the audio levels task
+                pyramid->save(binClip->getAudioPeaksPath(levelsStream));
+            }
+        }
     }
     // remove temporary playlist if it exists
     m_progress = 100;
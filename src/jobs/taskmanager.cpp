@@ -18,15 +18,27 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QFuture>
 #include <QThread>
 
+namespace {
+// Priority boost of the tasks belonging to the clip displayed in Clip Monitor and to the clips visible in timeline
+const int displayedClipBoost = 100;
+const int visibleClipBoost = 50;
+} // namespace
+
 TaskManager::TaskManager(QObject *parent)
     : QObject(parent)
     , displayedClip(-1)
     , m_tasksListLock(QReadWriteLock::Recursive)
     , m_blockUpdates(false)
+    , m_preemptedTasks(0)
+    , m_startedTasks(0)
+    , m_totalWait(0)
+    , m_maxWait(0)
+    , m_displayedClipWait(-1)
 {
     int maxThreads = qMin(4, QThread::idealThreadCount() - 1);
     m_taskPool.setMaxThreadCount(qMax(maxThreads, 1));
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
+    m_clock.start();
 }
 
 TaskManager::~TaskManager()
@@ -44,6 +56,212 @@ void TaskManager::updateConcurrency()
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
 }
 
+int TaskManager::concurrency() const
+{
+    return m_taskPool.maxThreadCount();
+}
+
+QThreadPool &TaskManager::taskPool(const AbstractTask *task)
+{
+    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
+        return m_transcodePool;
+    }
+    return m_taskPool;
+}
+
+int TaskManager::effectivePriority(const AbstractTask *task) const
+{
+    const int clipId = task->m_owner.second;
+    if (clipId == displayedClip) {
+        return task->m_priority + displayedClipBoost;
+    }
+    if (m_visibleClips.count(clipId) > 0) {
+        return task->m_priority + visibleClipBoost;
+    }
+    return task->m_priority;
+}
+
+bool TaskManager::isUrgent(const AbstractTask *task) const
+{
+    // Only the tasks producing what is needed to show the clip are urgent, not the long processing jobs like proxies or stabilization
+    switch (task->m_type) {
+    case AbstractTask::LOADJOB:
+    case AbstractTask::THUMBJOB:
+    case AbstractTask::AUDIOTHUMBJOB:
+    case AbstractTask::CACHEJOB:
+        return task->m_owner.second == displayedClip || m_visibleClips.count(task->m_owner.second) > 0;
+    default:
+        return false;
+    }
+}
+
+void TaskManager::reprioritize(int clipId)
+{
+    auto tasks = m_taskList.find(clipId);
+    if (tasks == m_taskList.end()) {
+        return;
+    }
+    for (AbstractTask *task : tasks->second) {
+        if (m_pendingTasks.count(task) == 0) {
+            // Already running
+            continue;
+        }
+        QThreadPool &pool = taskPool(task);
+        // QThreadPool sorts tasks on insertion, so take the task out of the queue and insert it again with its new priority
+        if (pool.tryTake(task)) {
+            pool.start(task, effectivePriority(task));
+        }
+    }
+}
+
+void TaskManager::updateUrgentTasks()
+{
+    m_urgentTasks.clear();
+    for (const auto &tasks : m_taskList) {
+        for (AbstractTask *task : tasks.second) {
+            if (task->m_progress < 100 && !task->m_isCanceled && isUrgent(task)) {
+                m_urgentTasks.insert(task);
+            }
+        }
+    }
+    m_urgentCount.storeRelease(int(m_urgentTasks.size()));
+    if (m_urgentTasks.empty()) {
+        m_urgentDone.wakeAll();
+    }
+}
+
+void TaskManager::updateUrgentTasks(const std::vector<int> &clipIds)
+{
+    for (int clipId : clipIds) {
+        auto tasks = m_taskList.find(clipId);
+        if (tasks == m_taskList.end()) {
+            continue;
+        }
+        for (AbstractTask *task : tasks->second) {
+            if (task->m_progress < 100 && !task->m_isCanceled && isUrgent(task)) {
+                m_urgentTasks.insert(task);
+            } else {
+                m_urgentTasks.erase(task);
+            }
+        }
+    }
+    m_urgentCount.storeRelease(int(m_urgentTasks.size()));
+    if (m_urgentTasks.empty()) {
+        m_urgentDone.wakeAll();
+    }
+}
+
+bool TaskManager::hasQueuedUrgentTask(const QThreadPool &pool)
+{
+    for (AbstractTask *task : m_urgentTasks) {
+        if (m_pendingTasks.count(task) > 0 && &taskPool(task) == &pool) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskManager::setDisplayedClip(int clipId)
+{
+    QReadLocker lk(&m_tasksListLock);
+    QMutexLocker lock(&m_schedulerMutex);
+    if (clipId == displayedClip) {
+        return;
+    }
+    const int previous = displayedClip;
+    displayedClip = clipId;
+    reprioritize(previous);
+    reprioritize(clipId);
+    updateUrgentTasks({previous, clipId});
+}
+
+void TaskManager::setVisibleClips(const std::unordered_set<int> &clipIds)
+{
+    QReadLocker lk(&m_tasksListLock);
+    QMutexLocker lock(&m_schedulerMutex);
+    if (clipIds == m_visibleClips) {
+        return;
+    }
+    std::vector<int> changedClips;
+    for (int clipId : clipIds) {
+        if (m_visibleClips.count(clipId) == 0) {
+            changedClips.push_back(clipId);
+        }
+    }
+    for (int clipId : m_visibleClips) {
+        if (clipIds.count(clipId) == 0) {
+            changedClips.push_back(clipId);
+        }
+    }
+    m_visibleClips = clipIds;
+    for (int clipId : changedClips) {
+        reprioritize(clipId);
+    }
+    updateUrgentTasks(changedClips);
+}
+
+void TaskManager::yieldToUrgentTasks(AbstractTask *task)
+{
+    if (m_urgentCount.loadAcquire() == 0) {
+        return;
+    }
+    QMutexLocker lock(&m_schedulerMutex);
+    if (m_urgentTasks.empty() || m_urgentTasks.count(task) > 0) {
+        return;
+    }
+    QThreadPool &pool = taskPool(task);
+    int &releasedThreads = m_releasedThreads[&pool];
+    bool released = false;
+    m_preemptedTasks++;
+    while (!m_urgentTasks.empty() && !task->m_isCanceled && !m_blockUpdates) {
+        // Give our thread slot to the pool only if an urgent task is still queued, and at most one slot per pool thread.
+        // Otherwise the pool would start the next background task, which would pause in turn with its producer open.
+        if (!released && releasedThreads < pool.maxThreadCount() && hasQueuedUrgentTask(pool)) {
+            pool.releaseThread();
+            releasedThreads++;
+            released = true;
+        }
+        m_urgentDone.wait(&m_schedulerMutex, 100);
+    }
+    m_preemptedTasks--;
+    if (released) {
+        releasedThreads--;
+        lock.unlock();
+        pool.reserveThread();
+    }
+}
+
+void TaskManager::taskStarted(AbstractTask *task)
+{
+    QMutexLocker lock(&m_schedulerMutex);
+    auto pending = m_pendingTasks.find(task);
+    if (pending == m_pendingTasks.end()) {
+        return;
+    }
+    const qint64 wait = m_clock.elapsed() - pending->second;
+    m_pendingTasks.erase(pending);
+    m_startedTasks++;
+    m_totalWait += wait;
+    m_maxWait = qMax(m_maxWait, wait);
+    if (task->m_owner.second == displayedClip) {
+        m_displayedClipWait = wait;
+    }
+}
+
+TaskManagerStatistics TaskManager::statistics() const
+{
+    QMutexLocker lock(&m_schedulerMutex);
+    TaskManagerStatistics stats;
+    stats.pending = int(m_pendingTasks.size());
+    stats.urgent = int(m_urgentTasks.size());
+    stats.preempted = m_preemptedTasks;
+    stats.started = m_startedTasks;
+    stats.averageWait = m_startedTasks > 0 ? m_totalWait / m_startedTasks : 0;
+    stats.maxWait = m_maxWait;
+    stats.displayedClipWait = m_displayedClipWait;
+    return stats;
+}
+
 void TaskManager::discardJobs(const ObjectId &owner, AbstractTask::JOBTYPE type, bool softDelete, const QVector<AbstractTask::JOBTYPE> exceptions)
 {
     qDebug() << "========== READY FOR TASK DISCARD ON: " << owner.second;
@@ -116,6 +334,21 @@ bool TaskManager::hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE typ
     return false;
 }
 
+bool TaskManager::hasRunningJob(const ObjectId &owner, AbstractTask::JOBTYPE type) const
+{
+    QReadLocker lk(&m_tasksListLock);
+    if (m_taskList.find(owner.second) == m_taskList.end()) {
+        return false;
+    }
+    std::vector<AbstractTask *> taskList = m_taskList.at(owner.second);
+    for (AbstractTask *t : taskList) {
+        if (type == t->m_type && t->m_running && t->m_progress < 100 && !t->m_isCanceled) {
+            return true;
+        }
+    }
+    return false;
+}
+
 TaskManagerStatus TaskManager::jobStatus(const ObjectId &owner) const
 {
     QReadLocker lk(&m_tasksListLock);
@@ -156,6 +389,15 @@ void TaskManager::taskDone(int cid, AbstractTask *task)
     if (m_taskList[cid].size() == 0) {
         m_taskList.erase(cid);
     }
+    m_schedulerMutex.lock();
+    m_pendingTasks.erase(task);
+    if (m_urgentTasks.erase(task) > 0) {
+        m_urgentCount.storeRelease(int(m_urgentTasks.size()));
+        if (m_urgentTasks.empty()) {
+            m_urgentDone.wakeAll();
+        }
+    }
+    m_schedulerMutex.unlock();
     task->deleteLater();
     m_tasksListLock.unlock();
     QMetaObject::invokeMethod(this, "updateJobCount");
@@ -184,6 +426,9 @@ void TaskManager::slotCancelJobs(const QVector<AbstractTask::JOBTYPE> exceptions
         m_transcodePool.waitForDone();
         m_taskList.clear();
         m_taskPool.clear();
+        QMutexLocker lock(&m_schedulerMutex);
+        m_pendingTasks.clear();
+        updateUrgentTasks();
     }
     m_blockUpdates = false;
     updateJobCount();
@@ -203,12 +448,16 @@ void TaskManager::startTask(int ownerId, AbstractTask *task)
     } else {
         m_taskList[ownerId].emplace_back(task);
     }
-    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
-        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
-        m_transcodePool.start(task, task->m_priority);
-    } else {
-        m_taskPool.start(task, task->m_priority);
+    // We only want a limited concurrent jobs for transcode tasks as for example GPU usually only accept 2 concurrent encoding jobs
+    m_schedulerMutex.lock();
+    m_pendingTasks[task] = m_clock.elapsed();
+    if (isUrgent(task)) {
+        m_urgentTasks.insert(task);
+        m_urgentCount.storeRelease(int(m_urgentTasks.size()));
     }
+    const int priority = effectivePriority(task);
+    m_schedulerMutex.unlock();
+    taskPool(task).start(task, priority);
     m_tasksListLock.unlock();
     updateJobCount();
 }
@@ -12,14 +12,19 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "definitions.h"
 
 #include <QAbstractListModel>
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
+#include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
 #include <QThreadPool>
 #include <QUuid>
+#include <QWaitCondition>
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class AbstractTask;
@@ -27,8 +32,29 @@ class AbstractTask;
 enum class TaskManagerStatus { NoJob, Pending, Running, Finished, Canceled };
 Q_DECLARE_METATYPE(TaskManagerStatus)
 
+/** @brief Queue depth and latency of the task scheduler */
+struct TaskManagerStatistics
+{
+    /** @brief Number of tasks waiting for a thread */
+    int pending = 0;
+    /** @brief Number of unfinished tasks needed to display the clip monitor or timeline clips */
+    int urgent = 0;
+    /** @brief Number of background tasks currently paused to let the urgent tasks run */
+    int preempted = 0;
+    /** @brief Number of tasks started since the application start */
+    int started = 0;
+    /** @brief Average and maximum time between the creation and start of a task, in ms */
+    qint64 averageWait = 0;
+    qint64 maxWait = 0;
+    /** @brief Time waited by the last started task of the clip displayed in Clip Monitor, in ms, -1 if none */
+    qint64 displayedClipWait = -1;
+};
+
 /** @class TaskManager
     @brief This class is responsible for clip jobs management.
+    Tasks are scheduled by priority: the tasks of the clip displayed in Clip Monitor come first, then the tasks of the clips
+    visible in timeline, then the other tasks by type, background thumbnail caching being last. Long background tasks
+    periodically call yieldToUrgentTasks() so that they pause while the tasks needed to display a clip are processed.
  */
 class TaskManager : public QObject
 {
@@ -50,6 +76,12 @@ public:
      *  @param type The type of job that you want to query
      */
     bool hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE type = AbstractTask::NOJOBTYPE) const;
+
+    /** @brief Check if a job of this type is currently running (not merely queued) for a clip.
+     *  @param owner the owner item for this task
+     *  @param type The type of job that you want to query
+     */
+    bool hasRunningJob(const ObjectId &owner, AbstractTask::JOBTYPE type) const;
     
     TaskManagerStatus jobStatus(const ObjectId &owner) const;
 
@@ -65,12 +97,28 @@ public:
     /** @brief Update the number of concurrent jobs allowed */
     void updateConcurrency();
 
+    /** @brief Returns the number of concurrent jobs allowed */
+    int concurrency() const;
+
     /** @brief We are aborting all tasks and don't want them to send any updates */
     bool isBlocked() const;
 
     /** @brief The clip currently opened in Clip Monitor (to display clip jobs) */
     int displayedClip;
 
+    /** @brief Set the clip opened in Clip Monitor, its pending tasks are moved to the front of the queue */
+    void setDisplayedClip(int clipId);
+    /** @brief Set the bin clips visible in the timeline view, their pending tasks are processed before the other ones */
+    void setVisibleClips(const std::unordered_set<int> &clipIds);
+    /** @brief Called by long background tasks between 2 steps. While tasks needed to display a clip are not finished,
+     *  pause the calling task and let another task use its thread. Returns immediately if nothing is urgent.
+     */
+    void yieldToUrgentTasks(AbstractTask *task);
+    /** @brief A task started running, used to measure the queue latency */
+    void taskStarted(AbstractTask *task);
+    /** @brief Returns the current queue depth and latency statistics */
+    TaskManagerStatistics statistics() const;
+
 public Q_SLOTS:
     /** @brief Discard all running jobs. */
     void slotCancelJobs(const QVector<AbstractTask::JOBTYPE> exceptions = {});
@@ -85,6 +133,40 @@ private:
     std::unordered_map<int, std::vector<AbstractTask*> > m_taskList;
     mutable QReadWriteLock m_tasksListLock;
     bool m_blockUpdates;
+    /** @brief Protects the scheduling data below. When both are needed, m_tasksListLock must be locked first */
+    mutable QMutex m_schedulerMutex;
+    /** @brief Woken when the last urgent task is finished */
+    QWaitCondition m_urgentDone;
+    /** @brief The bin clips visible in the timeline view */
+    std::unordered_set<int> m_visibleClips;
+    /** @brief The tasks that did not start yet, with their creation time */
+    std::unordered_map<AbstractTask *, qint64> m_pendingTasks;
+    /** @brief The unfinished tasks needed to display a clip, preempting the background tasks */
+    std::unordered_set<AbstractTask *> m_urgentTasks;
+    /** @brief Size of m_urgentTasks, readable without locking */
+    QAtomicInt m_urgentCount;
+    QElapsedTimer m_clock;
+    int m_preemptedTasks;
+    /** @brief Number of thread slots given away by paused tasks, per pool */
+    std::unordered_map<const QThreadPool *, int> m_releasedThreads;
+    int m_startedTasks;
+    qint64 m_totalWait;
+    qint64 m_maxWait;
+    qint64 m_displayedClipWait;
+    /** @brief The pool processing this task */
+    QThreadPool &taskPool(const AbstractTask *task);
+    /** @brief The task priority, raised if it belongs to the displayed or a visible clip */
+    int effectivePriority(const AbstractTask *task) const;
+    /** @brief Returns true if the task is needed to display a clip in the monitor or timeline */
+    bool isUrgent(const AbstractTask *task) const;
+    /** @brief Requeue the pending tasks of a clip with their current priority */
+    void reprioritize(int clipId);
+    /** @brief Rebuild the list of urgent tasks */
+    void updateUrgentTasks();
+    /** @brief Update the urgent state of these clips' tasks after a priority change */
+    void updateUrgentTasks(const std::vector<int> &clipIds);
+    /** @brief Returns true if an urgent task of this pool is still waiting for a free thread slot */
+    bool hasQueuedUrgentTask(const QThreadPool &pool);
 
 Q_SIGNALS:
     void jobCount(int);
@@ -0,0 +1,204 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audioAlignment.h"
+#include "fftCorrelation.h"
+
+#include "kdenlive_debug.h"
+#include <KLocalizedString>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+// Length of the excerpt of each clip whose samples are correlated to refine the alignment
+constexpr double RefineSeconds = 3.;
+// Frames added on each side of the reference excerpt, to cover the error of the envelope correlation
+constexpr int RefineMargin = 3;
+} // namespace
+
+constexpr double AudioAlignment::LowConfidence;
+
+AudioAlignment::AudioAlignment(const QString &binId, int clipId, QObject *parent)
+    : QObject(parent)
+    , m_mainEnvelope(new AudioEnvelope(binId, clipId))
+{
+    connect(m_mainEnvelope.get(), &AudioEnvelope::envelopeReady, this, &AudioAlignment::slotEnvelopeReady);
+    connect(&m_watcher, &QFutureWatcherBase::progressValueChanged, this, [this](int progress) {
+        if (m_watcher.progressMaximum() > 0) {
+            Q_EMIT displayMessage(i18n("Aligning clips"), ProcessingJobMessage, 100 * progress / m_watcher.progressMaximum());
+        }
+    });
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] {
+        m_processing = false;
+        Q_EMIT finished();
+    });
+    // Start with the reference, its envelope will often be ready before the clips to align are chosen
+    m_mainEnvelope->startComputeEnvelope();
+}
+
+AudioAlignment::~AudioAlignment()
+{
+    m_watcher.cancel();
+    m_watcher.waitForFinished();
+}
+
+int AudioAlignment::referenceId() const
+{
+    return m_mainEnvelope->clipId();
+}
+
+void AudioAlignment::addChild(const QString &binId, int clipId, size_t offset, size_t length, size_t startPos)
+{
+    Q_ASSERT(!m_started);
+    // The producer is cloned here, in the GUI thread
+    m_children.emplace_back(new AudioEnvelope(binId, clipId, offset, length, startPos));
+    Result result;
+    result.clipId = clipId;
+    result.index = int(m_results.size());
+    m_results.push_back(result);
+}
+
+int AudioAlignment::childCount() const
+{
+    return int(m_children.size());
+}
+
+void AudioAlignment::start()
+{
+    if (m_started) {
+        return;
+    }
+    m_started = true;
+    // All envelopes are computed in parallel on the global thread pool
+    for (auto &envelope : m_children) {
+        connect(envelope.get(), &AudioEnvelope::envelopeReady, this, &AudioAlignment::slotEnvelopeReady);
+        envelope->startComputeEnvelope();
+    }
+    processIfReady();
+}
+
+bool AudioAlignment::hasStarted() const
+{
+    return m_started;
+}
+
+const std::vector<AudioAlignment::Result> &AudioAlignment::results() const
+{
+    return m_results;
+}
+
+void AudioAlignment::slotEnvelopeReady(AudioEnvelope *envelope)
+{
+    if (envelope == m_mainEnvelope.get()) {
+        m_mainReady = true;
+    } else {
+        m_readyChildren++;
+    }
+    processIfReady();
+}
+
+void AudioAlignment::processIfReady()
+{
+    if (!m_started || m_processing || !m_mainReady || m_readyChildren < int(m_children.size())) {
+        return;
+    }
+    m_processing = true;
+    m_watcher.setFuture(QtConcurrent::map(m_results, [this](Result &result) { align(result); }));
+}
+
+void AudioAlignment::align(Result &result) const
+{
+    AudioEnvelope *child = m_children.at(size_t(result.index)).get();
+    // Both envelopes are ready, this does not block
+    const std::vector<qint64> &envMain = m_mainEnvelope->envelope();
+    const std::vector<qint64> &envSub = child->envelope();
+    if (envMain.empty() || envSub.empty()) {
+        return;
+    }
+    const int childOffset = int(child->offset());
+    const int lag = coarseShift(envMain, envSub);
+    result.shift = lag + childOffset;
+    result.valid = true;
+
+    // Range of the reference overlapped by the clip
+    const int overlapStart = qMax(0, lag);
+    const int overlapEnd = qMin(int(envMain.size()), lag + int(envSub.size()));
+    if (overlapEnd > overlapStart) {
+        result.confidence =
+            qBound(0., normalizedCorrelation(envMain.data() + overlapStart, envSub.data() + overlapStart - lag, size_t(overlapEnd - overlapStart)), 1.);
+    }
+    const double fps = m_mainEnvelope->fps();
+    const int frequency = m_mainEnvelope->samplingRate();
+    if (fps <= 0. || frequency <= 0 || child->samplingRate() <= 0 || overlapEnd <= overlapStart) {
+        return;
+    }
+    result.sampleShift = std::llround(result.shift * double(frequency) / fps);
+
+    // Refine on the loudest excerpt of the clip overlapping the reference
+    const int window = qMin(overlapEnd - overlapStart, qMax(1, qRound(fps * RefineSeconds)));
+    const int firstCandidate = overlapStart - lag;
+    const int lastCandidate = overlapEnd - lag - window;
+    qint64 energy = 0;
+    for (int i = firstCandidate; i < firstCandidate + window; ++i) {
+        energy += envSub[size_t(i)];
+    }
+    qint64 bestEnergy = energy;
+    int first = firstCandidate;
+    for (int i = firstCandidate + 1; i <= lastCandidate; ++i) {
+        energy += envSub[size_t(i + window - 1)] - envSub[size_t(i - 1)];
+        if (energy > bestEnergy) {
+            bestEnergy = energy;
+            first = i;
+        }
+    }
+    const int mainFirst = qMax(0, first + lag - RefineMargin);
+    const int mainLast = qMin(int(envMain.size()), first + lag + window + RefineMargin);
+    const std::vector<float> subSamples = child->samples(first, window, frequency);
+    const std::vector<float> mainSamples = m_mainEnvelope->samples(mainFirst, mainLast - mainFirst, frequency);
+    if (subSamples.empty() || mainSamples.size() < subSamples.size()) {
+        return;
+    }
+    double confidence = 0.;
+    const qint64 sampleLag = bestLag(mainSamples, subSamples, &confidence);
+    // The first sample of the excerpt is at sampleLag in the reference excerpt
+    result.sampleShift = std::llround(mainFirst * double(frequency) / fps) + sampleLag - std::llround(first * double(frequency) / fps) +
+                         std::llround(childOffset * double(frequency) / fps);
+    result.shift = int(std::llround(result.sampleShift * fps / frequency));
+    result.confidence = qBound(0., confidence, 1.);
+}
+
+int AudioAlignment::coarseShift(const std::vector<qint64> &main, const std::vector<qint64> &sub)
+{
+    if (main.empty() || sub.empty()) {
+        return 0;
+    }
+    std::vector<float> correlation(main.size() + sub.size() + 1);
+    FFTCorrelation::correlate(main.data(), main.size(), sub.data(), sub.size(), correlation.data());
+    // The correlation of a lag L is at index L + sub size
+    const auto best = std::max_element(correlation.cbegin(), correlation.cend());
+    return int(best - correlation.cbegin()) - int(sub.size());
+}
+
+qint64 AudioAlignment::bestLag(const std::vector<float> &main, const std::vector<float> &sub, double *confidence)
+{
+    if (confidence != nullptr) {
+        *confidence = 0.;
+    }
+    if (sub.empty() || main.size() < sub.size()) {
+        return 0;
+    }
+    // Convolving with the reversed excerpt gives the correlation
+    const std::vector<float> reversed(sub.crbegin(), sub.crend());
+    std::vector<float> correlation(main.size() + sub.size() + 1);
+    FFTCorrelation::convolve(main.data(), main.size(), reversed.data(), reversed.size(), correlation.data());
+    // Only keep the lags where the excerpt is fully inside the reference
+    const auto begin = correlation.cbegin() + qint64(sub.size());
+    const auto best = std::max_element(begin, begin + qint64(main.size() - sub.size() + 1));
+    const qint64 lag = best - begin;
+    if (confidence != nullptr) {
+        *confidence = normalizedCorrelation(main.data() + lag, sub.data(), sub.size());
+    }
+    return lag;
+}
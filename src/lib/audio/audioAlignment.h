@@ -0,0 +1,120 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "audioEnvelope.h"
+#include "definitions.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/** @class AudioAlignment
+    @brief Aligns several clips at once on the audio of a reference clip.
+    The envelopes of the reference and of all the clips are computed in parallel (and reused from the envelope cache
+    when the same clip zone was already analysed). Each clip is then aligned in parallel in two passes: a coarse
+    FFT correlation of the envelopes gives the offset in frames, which is refined by correlating the samples of the
+    loudest few seconds of the clip with the reference around that offset. The normalized correlation of the
+    samples gives a confidence score, so that callers can report doubtful alignments.
+ */
+class AudioAlignment : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result
+    {
+        int clipId{-1};
+        /** @brief Offset in frames of the clip source start from the reference start, like AudioCorrelation::getShift */
+        int shift{0};
+        /** @brief The same offset in samples at the sampling rate of the reference */
+        qint64 sampleShift{0};
+        /** @brief Normalized correlation of the aligned audio, on [0,1] */
+        double confidence{0.};
+        bool valid{false};
+        /** @brief Index of the child envelope */
+        int index{-1};
+    };
+
+    /** @brief Below this confidence, an alignment is most probably wrong */
+    static constexpr double LowConfidence = 0.4;
+
+    /** @brief Starts computing the envelope of the reference clip */
+    explicit AudioAlignment(const QString &binId, int clipId, QObject *parent = nullptr);
+    ~AudioAlignment() override;
+
+    int referenceId() const;
+    /** @brief Adds a clip to align, using the zone of its source starting at @param offset
+        @param startPos the timeline position of the clip
+     */
+    void addChild(const QString &binId, int clipId, size_t offset, size_t length, size_t startPos);
+    int childCount() const;
+    /** @brief Computes all envelopes and aligns the clips, finished() is emitted when done */
+    void start();
+    bool hasStarted() const;
+    /** @brief The alignment of each clip, available once finished() was emitted */
+    const std::vector<Result> &results() const;
+
+    /** @brief Returns the lag in frames of @param sub in @param main maximizing the correlation of the envelopes, may be negative */
+    static int coarseShift(const std::vector<qint64> &main, const std::vector<qint64> &sub);
+    /** @brief Returns the lag in [0, main size - sub size] of @param sub in @param main maximizing the correlation of the samples
+        @param confidence if not null, receives the normalized correlation at that lag
+     */
+    static qint64 bestLag(const std::vector<float> &main, const std::vector<float> &sub, double *confidence = nullptr);
+    /** @brief Normalized (Pearson) correlation of two series of @param size values, 0 if one of them is constant */
+    template <typename T> static double normalizedCorrelation(const T *main, const T *sub, size_t size);
+
+private:
+    /** @brief Aligns one child, run in a worker thread once all envelopes are ready */
+    void align(Result &result) const;
+    void processIfReady();
+
+    std::unique_ptr<AudioEnvelope> m_mainEnvelope;
+    std::vector<std::unique_ptr<AudioEnvelope>> m_children;
+    std::vector<Result> m_results;
+    QFutureWatcher<void> m_watcher;
+    int m_readyChildren{0};
+    bool m_mainReady{false};
+    bool m_started{false};
+    bool m_processing{false};
+
+private Q_SLOTS:
+    void slotEnvelopeReady(AudioEnvelope *envelope);
+
+Q_SIGNALS:
+    void finished();
+    void displayMessage(const QString &, MessageType, int);
+};
+
+template <typename T> double AudioAlignment::normalizedCorrelation(const T *main, const T *sub, size_t size)
+{
+    if (size == 0) {
+        return 0.;
+    }
+    double meanMain = 0.;
+    double meanSub = 0.;
+    for (size_t i = 0; i < size; ++i) {
+        meanMain += double(main[i]);
+        meanSub += double(sub[i]);
+    }
+    meanMain /= double(size);
+    meanSub /= double(size);
+    double product = 0.;
+    double energyMain = 0.;
+    double energySub = 0.;
+    for (size_t i = 0; i < size; ++i) {
+        const double m = double(main[i]) - meanMain;
+        const double s = double(sub[i]) - meanSub;
+        product += m * s;
+        energyMain += m * m;
+        energySub += s * s;
+    }
+    if (energyMain <= 0. || energySub <= 0.) {
+        return 0.;
+    }
+    return product / std::sqrt(energyMain * energySub);
+}
@@ -12,12 +12,19 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "core.h"
 #include "kdenlive_debug.h"
 #include <KLocalizedString>
+#include <QCache>
 #include <QElapsedTimer>
 #include <QImage>
 #include <QtConcurrent>
 #include <algorithm>
 #include <cmath>
 
+namespace {
+// Normalized envelopes computed during this session, a two hours clip at 60 fps takes 3.5MB
+QMutex envelopeCacheMutex;
+QCache<QString, std::vector<qint64>> envelopeCache(64 * 1024 * 1024);
+} // namespace
+
 AudioEnvelope::AudioEnvelope(const QString &binId, int clipId, size_t offset, size_t length, size_t startPos)
     : m_offset(offset)
     , m_clipId(clipId)
@@ -31,6 +38,14 @@ AudioEnvelope::AudioEnvelope(const QString &binId, int clipId, size_t offset, si
         m_producer->set_in_and_out(int(offset), int(offset + length));
     }
     m_envelopeSize = size_t(m_producer->get_playtime());
+    const QString hash = clip->hash();
+    if (!hash.isEmpty()) {
+        m_cacheKey = QStringLiteral("%1:%2:%3:%4:%5")
+                         .arg(hash, QString::fromUtf8(m_producer->get("audio_index")))
+                         .arg(m_producer->get_in())
+                         .arg(m_producer->get_out())
+                         .arg(m_producer->get_fps());
+    }
 
     m_producer->set("set.test_image", 1);
     connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] { Q_EMIT envelopeReady(this); });
@@ -102,6 +117,18 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
     if (!m_info || m_info->size() < 1) {
         return summary;
     }
+    if (!m_cacheKey.isEmpty()) {
+        QMutexLocker lock(&envelopeCacheMutex);
+        const std::vector<qint64> *cached = envelopeCache.object(m_cacheKey);
+        if (cached != nullptr && cached->size() == m_envelopeSize) {
+            summary.audioAmplitudes = *cached;
+            for (qint64 value : summary.audioAmplitudes) {
+                summary.amplitudeMax = std::max(summary.amplitudeMax, qAbs(value));
+            }
+            qCDebug(KDENLIVE_LOG) << "Reusing cached envelope (" << m_envelopeSize << " frames)";
+            return summary;
+        }
+    }
     int samplingRate = m_info->info(0)->samplingRate();
     mlt_audio_format format_s16 = mlt_audio_s16;
     int channels = 1;
@@ -110,6 +137,7 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
     t.start();
     m_producer->seek(0);
     size_t max = summary.audioAmplitudes.size();
+    int progress = -1;
     for (size_t i = 0; i < max; ++i) {
         std::unique_ptr<Mlt::Frame> frame(m_producer->get_frame(int(i)));
         qint64 position = mlt_frame_get_position(frame->get_frame());
@@ -120,7 +148,10 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
         for (int k = 0; k < samples; ++k) {
             summary.audioAmplitudes[i] += abs(data[k]);
         }
-        pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, int(100 * i / max));
+        if (int(100 * i / max) != progress) {
+            progress = int(100 * i / max);
+            pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, progress);
+        }
     }
     qCDebug(KDENLIVE_LOG) << "Calculating the envelope (" << m_envelopeSize << " frames) took " << t.elapsed() << " ms.";
     qCDebug(KDENLIVE_LOG) << "Normalizing envelope …";
@@ -133,6 +164,10 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
         summary.audioAmplitudes[i] -= meanBeforeNormalization;
         summary.amplitudeMax = std::max(summary.amplitudeMax, qAbs(summary.audioAmplitudes[i]));
     }
+    if (!m_cacheKey.isEmpty()) {
+        QMutexLocker lock(&envelopeCacheMutex);
+        envelopeCache.insert(m_cacheKey, new std::vector<qint64>(summary.audioAmplitudes), int(max * sizeof(qint64)));
+    }
     pCore->displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage, 300);
     return summary;
 }
@@ -147,6 +182,47 @@ size_t AudioEnvelope::startPos() const
     return m_startpos;
 }
 
+int AudioEnvelope::samplingRate() const
+{
+    if (!m_info || m_info->size() < 1) {
+        return 0;
+    }
+    return m_info->info(0)->samplingRate();
+}
+
+double AudioEnvelope::fps() const
+{
+    return m_producer->get_fps();
+}
+
+std::vector<float> AudioEnvelope::samples(int firstFrame, int frames, int frequency)
+{
+    std::vector<float> result;
+    if (!m_info || m_info->size() < 1 || frames <= 0 || frequency <= 0) {
+        return result;
+    }
+    QMutexLocker lock(&m_producerMutex);
+    mlt_audio_format format_s16 = mlt_audio_s16;
+    int channels = 1;
+    const auto fps = float(m_producer->get_fps());
+    result.reserve(size_t(std::ceil(frames * frequency / fps)) + 1);
+    m_producer->seek(firstFrame);
+    for (int i = 0; i < frames; ++i) {
+        std::unique_ptr<Mlt::Frame> frame(m_producer->get_frame());
+        qint64 position = mlt_frame_get_position(frame->get_frame());
+        int samples = mlt_audio_calculate_frame_samples(fps, frequency, position);
+        auto *data = static_cast<qint16 *>(frame->get_audio(format_s16, frequency, channels, samples));
+        if (data == nullptr) {
+            result.insert(result.end(), size_t(samples), 0.f);
+            continue;
+        }
+        for (int k = 0; k < samples; ++k) {
+            result.push_back(data[k] / 32768.f);
+        }
+    }
+    return result;
+}
+
 QImage AudioEnvelope::drawEnvelope()
 {
     const AudioSummary &summary = audioSummary();
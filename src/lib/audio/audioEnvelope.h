@@ -9,6 +9,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "audioInfo.h"
 #include <QFutureWatcher>
+#include <QMutex>
 #include <QObject>
 #include <memory>
 #include <mlt++/Mlt.h>
@@ -21,6 +22,9 @@ class QImage;
   with frame resolution. One entry is calculated by the sum
   of the absolute values of all samples in the current frame.
 
+  Envelopes are cached by clip hash and zone for the session, so that
+  aligning several times on the same clip does not decode it again.
+
   See also: http://web.archive.org/web/20180626235917/http://bemasc.net/wordpress/2011/07/26/an-auto-aligner-for-pitivi/
   */
 class AudioEnvelope : public QObject
@@ -58,6 +62,15 @@ public:
     int clipId() const;
     size_t startPos() const;
 
+    /** @brief Sampling rate of the first audio stream, 0 if the clip has no audio */
+    int samplingRate() const;
+    double fps() const;
+    /**
+       Decodes the mono samples of @param frames envelope frames starting at @param firstFrame,
+       as floats on [-1,1]. Can be called from several threads once the envelope is computed.
+    */
+    std::vector<float> samples(int firstFrame, int frames, int frequency);
+
 private:
     struct AudioSummary
     {
@@ -94,6 +107,10 @@ private:
     const int m_clipId;
     const size_t m_startpos;
     size_t m_envelopeSize;
+    /** @brief Identifies the audio of the analysed zone in the envelope cache, empty to disable caching */
+    QString m_cacheKey;
+    /** @brief Protects m_producer when decoding samples */
+    QMutex m_producerMutex;
 
 Q_SIGNALS:
     void envelopeReady(AudioEnvelope *envelope);
@@ -0,0 +1,315 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audioLevelsPyramid.h"
+#include "audiomixer/iecscale.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+const char peaksMagic[4] = {'K', 'D', 'P', 'K'};
+const quint32 peaksVersion = 1;
+// magic, version, channels, bins per frame, frame count, level count, max level, reserved
+const int headerSize = 32;
+
+quint32 readHeaderValue(const uchar *data, int index)
+{
+    return qFromLittleEndian<quint32>(data + 4 * index);
+}
+
+void writeHeaderValue(uchar *data, int index, quint32 value)
+{
+    qToLittleEndian<quint32>(value, data + 4 * index);
+}
+} // namespace
+
+AudioLevelsPyramid::AudioLevelsPyramid()
+    : m_channels(0)
+    , m_binsPerFrame(0)
+    , m_frameCount(0)
+    , m_maxLevel(0)
+    , m_data(nullptr)
+    , m_size(0)
+{
+}
+
+AudioLevelsPyramid::~AudioLevelsPyramid() = default;
+
+qint64 AudioLevelsPyramid::computeLayout()
+{
+    m_levelOffsets.clear();
+    m_binCounts.clear();
+    if (m_channels <= 0 || m_binsPerFrame <= 0 || m_frameCount <= 0) {
+        return -1;
+    }
+    qint64 bins = qint64(m_frameCount) * m_binsPerFrame;
+    if (bins > std::numeric_limits<int>::max()) {
+        return -1;
+    }
+    const qint64 binSize = 2 * m_channels;
+    qint64 offset = headerSize;
+    while (true) {
+        m_levelOffsets.push_back(offset);
+        m_binCounts.push_back(int(bins));
+        offset += bins * binSize;
+        if (bins <= 1) {
+            break;
+        }
+        bins = (bins + 1) / 2;
+    }
+    return offset;
+}
+
+std::shared_ptr<const AudioLevelsPyramid> AudioLevelsPyramid::fromPeaks(const QByteArray &peaks, int channels, int binsPerFrame, int frameCount)
+{
+    std::shared_ptr<AudioLevelsPyramid> pyramid(new AudioLevelsPyramid());
+    pyramid->m_channels = channels;
+    pyramid->m_binsPerFrame = binsPerFrame;
+    pyramid->m_frameCount = frameCount;
+    const qint64 total = pyramid->computeLayout();
+    const int binSize = 2 * channels;
+    if (total < 0 || total > std::numeric_limits<int>::max() || peaks.size() < qint64(pyramid->m_binCounts.front()) * binSize) {
+        return nullptr;
+    }
+    QByteArray &storage = pyramid->m_storage;
+    storage.resize(int(total));
+    auto *data = reinterpret_cast<uchar *>(storage.data());
+    memcpy(data + headerSize, peaks.constData(), size_t(pyramid->m_binCounts.front()) * size_t(binSize));
+    // Fill the coarser levels, each bin merging 2 bins of the previous level
+    for (size_t level = 1; level < pyramid->m_binCounts.size(); ++level) {
+        const uchar *source = data + pyramid->m_levelOffsets.at(level - 1);
+        const int sourceBins = pyramid->m_binCounts.at(level - 1);
+        uchar *dest = data + pyramid->m_levelOffsets.at(level);
+        const int bins = pyramid->m_binCounts.at(level);
+        for (int bin = 0; bin < bins; ++bin) {
+            const uchar *first = source + 2 * bin * binSize;
+            const uchar *second = 2 * bin + 1 < sourceBins ? first + binSize : first;
+            uchar *target = dest + bin * binSize;
+            for (int i = 0; i < binSize; ++i) {
+                target[i] = std::max(first[i], second[i]);
+            }
+        }
+    }
+    // The top level contains a single bin covering the whole stream
+    const uchar *top = data + pyramid->m_levelOffsets.back();
+    pyramid->m_maxLevel = *std::max_element(top, top + binSize);
+    memcpy(data, peaksMagic, 4);
+    writeHeaderValue(data, 1, peaksVersion);
+    writeHeaderValue(data, 2, quint32(channels));
+    writeHeaderValue(data, 3, quint32(binsPerFrame));
+    writeHeaderValue(data, 4, quint32(frameCount));
+    writeHeaderValue(data, 5, quint32(pyramid->m_levelOffsets.size()));
+    writeHeaderValue(data, 6, quint32(pyramid->m_maxLevel));
+    writeHeaderValue(data, 7, 0);
+    pyramid->m_data = data;
+    pyramid->m_size = total;
+    return pyramid;
+}
+
+std::shared_ptr<const AudioLevelsPyramid> AudioLevelsPyramid::fromFrameLevels(const QVector<uint8_t> &levels, int channels)
+{
+    if (channels <= 0 || levels.size() < channels) {
+        return nullptr;
+    }
+    const int frameCount = levels.size() / channels;
+    QByteArray peaks(2 * channels * frameCount, Qt::Uninitialized);
+    // Legacy levels do not differentiate positive and negative samples
+    for (int i = 0; i < frameCount * channels; ++i) {
+        peaks[2 * i] = char(levels.at(i));
+        peaks[2 * i + 1] = char(levels.at(i));
+    }
+    return fromPeaks(peaks, channels, 1, frameCount);
+}
+
+std::shared_ptr<const AudioLevelsPyramid> AudioLevelsPyramid::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < headerSize) {
+        return nullptr;
+    }
+    std::shared_ptr<AudioLevelsPyramid> pyramid(new AudioLevelsPyramid());
+    const qint64 size = file.size();
+    // Read the whole pyramid at once and close the file
+    pyramid->m_storage = file.readAll();
+    file.close();
+    if (pyramid->m_storage.size() != size) {
+        return nullptr;
+    }
+    const uchar *data = reinterpret_cast<const uchar *>(pyramid->m_storage.constData());
+    if (memcmp(data, peaksMagic, 4) != 0 || readHeaderValue(data, 1) != peaksVersion) {
+        return nullptr;
+    }
+    pyramid->m_channels = int(readHeaderValue(data, 2));
+    pyramid->m_binsPerFrame = int(readHeaderValue(data, 3));
+    pyramid->m_frameCount = int(readHeaderValue(data, 4));
+    pyramid->m_maxLevel = int(readHeaderValue(data, 6));
+    if (pyramid->computeLayout() != size || pyramid->m_levelOffsets.size() != readHeaderValue(data, 5)) {
+        return nullptr;
+    }
+    pyramid->m_data = data;
+    pyramid->m_size = size;
+    return pyramid;
+}
+
+bool AudioLevelsPyramid::save(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(reinterpret_cast<const char *>(m_data), m_size) != m_size) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+uint8_t AudioLevelsPyramid::scaledLevel(double peak)
+{
+    if (peak <= 0.) {
+        return 0;
+    }
+    // Same scaling as the one previously applied on MLT's audiolevel filter output
+    double level = 256. * std::min(IEC_Scale(20. * log10(peak)) * 0.9, 1.);
+    return uint8_t(std::min(level, 255.));
+}
+
+void AudioLevelsPyramid::appendFramePeaks(QByteArray &peaks, const int16_t *samples, int sampleCount, int frameChannels, int channels, int binsPerFrame)
+{
+    const int frameSize = binsPerFrame * channels * 2;
+    if (samples == nullptr || sampleCount <= 0 || frameChannels != channels) {
+        if (peaks.isEmpty()) {
+            peaks.append(QByteArray(frameSize, '\0'));
+        } else {
+            // Repeat the previous frame
+            peaks.append(peaks.right(frameSize));
+        }
+        return;
+    }
+    for (int bin = 0; bin < binsPerFrame; ++bin) {
+        const int first = bin * sampleCount / binsPerFrame;
+        const int last = std::max(first + 1, (bin + 1) * sampleCount / binsPerFrame);
+        for (int channel = 0; channel < channels; ++channel) {
+            int high = 0;
+            int low = 0;
+            for (int sample = first; sample < last && sample < sampleCount; ++sample) {
+                const int value = samples[sample * channels + channel];
+                high = std::max(high, value);
+                low = std::min(low, value);
+            }
+            peaks.append(char(scaledLevel(high / 32768.)));
+            peaks.append(char(scaledLevel(-low / 32768.)));
+        }
+    }
+}
+
+int AudioLevelsPyramid::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevelsPyramid::binsPerFrame() const
+{
+    return m_binsPerFrame;
+}
+
+int AudioLevelsPyramid::frameCount() const
+{
+    return m_frameCount;
+}
+
+int AudioLevelsPyramid::levelCount() const
+{
+    return int(m_levelOffsets.size());
+}
+
+int AudioLevelsPyramid::binCount(int level) const
+{
+    if (level < 0 || level >= levelCount()) {
+        return 0;
+    }
+    return m_binCounts.at(size_t(level));
+}
+
+int AudioLevelsPyramid::maxLevel() const
+{
+    return m_maxLevel;
+}
+
+const uchar *AudioLevelsPyramid::levelData(int level) const
+{
+    return m_data + m_levelOffsets.at(size_t(level));
+}
+
+AudioLevelsPyramid::Peak AudioLevelsPyramid::peak(int level, int bin, int channel) const
+{
+    Peak result;
+    if (bin < 0 || bin >= binCount(level) || channel < 0 || channel >= m_channels) {
+        return result;
+    }
+    const uchar *data = levelData(level) + 2 * (bin * m_channels + channel);
+    result.high = data[0];
+    result.low = data[1];
+    return result;
+}
+
+AudioLevelsPyramid::Peak AudioLevelsPyramid::peakInRange(double startFrame, double endFrame, int channel) const
+{
+    Peak result;
+    if (endFrame < startFrame) {
+        std::swap(startFrame, endFrame);
+    }
+    const int totalBins = m_binCounts.front();
+    int first = int(std::floor(startFrame * m_binsPerFrame));
+    int last = int(std::ceil(endFrame * m_binsPerFrame)) - 1;
+    first = std::max(0, first);
+    last = std::min(totalBins - 1, std::max(first, last));
+    if (first >= totalBins) {
+        return result;
+    }
+    // Pick the finest level where the range overlaps at most 3 bins. Choosing the level from the range length alone is not enough,
+    // an unaligned range can overlap one more bin at each end
+    int level = 0;
+    while ((last >> level) - (first >> level) >= 3 && level + 1 < levelCount()) {
+        level++;
+    }
+    const uchar *data = levelData(level);
+    const int binSize = 2 * m_channels;
+    for (int bin = first >> level; bin <= last >> level; ++bin) {
+        const uchar *binData = data + bin * binSize;
+        for (int c = 0; c < m_channels; ++c) {
+            if (channel >= 0 && c != channel) {
+                continue;
+            }
+            result.merge({binData[2 * c], binData[2 * c + 1]});
+        }
+    }
+    return result;
+}
+
+QVector<uint8_t> AudioLevelsPyramid::frameLevels() const
+{
+    QVector<uint8_t> levels;
+    levels.reserve(m_frameCount * m_channels);
+    const uchar *data = levelData(0);
+    const int binSize = 2 * m_channels;
+    for (int frame = 0; frame < m_frameCount; ++frame) {
+        const uchar *frameData = data + frame * m_binsPerFrame * binSize;
+        for (int c = 0; c < m_channels; ++c) {
+            uchar level = 0;
+            for (int bin = 0; bin < m_binsPerFrame; ++bin) {
+                level = std::max({level, frameData[bin * binSize + 2 * c], frameData[bin * binSize + 2 * c + 1]});
+            }
+            levels << level;
+        }
+    }
+    return levels;
+}
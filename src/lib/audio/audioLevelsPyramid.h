@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** @class AudioLevelsPyramid
+    @brief Multi resolution peak store for the audio thumbnails of one audio stream.
+    The finest level stores binsPerFrame bins for each frame. For each bin and channel, we store the scaled magnitude of the highest positive
+    sample (high) and of the lowest negative sample (low), using the same 0-255 IEC scale as the legacy per frame audio levels.
+    Each coarser level merges 2 bins of the previous one. A frame range is answered from the finest level where it overlaps at most 3 bins,
+    so a query reads at most 3 bins per channel.
+    The whole pyramid is stored in a single buffer that is written as is to the cache file, and read back in one piece on load. It is not
+    memory mapped: a mapping keeps its file open, and a project can have thousands of audio streams.
+    Instances are immutable and meant to be shared through std::shared_ptr<const AudioLevelsPyramid>, so that painting code can hold a
+    reference without copying the data.
+ */
+class AudioLevelsPyramid
+{
+public:
+    struct Peak
+    {
+        uint8_t high = 0;
+        uint8_t low = 0;
+        /** @brief The magnitude of this peak, regardless of the sample sign */
+        uint8_t level() const { return high > low ? high : low; }
+        void merge(const Peak &other)
+        {
+            high = other.high > high ? other.high : high;
+            low = other.low > low ? other.low : low;
+        }
+    };
+
+    ~AudioLevelsPyramid();
+    AudioLevelsPyramid(const AudioLevelsPyramid &) = delete;
+    AudioLevelsPyramid &operator=(const AudioLevelsPyramid &) = delete;
+
+    /** @brief Build a pyramid from the finest level data
+        @param peaks interleaved high/low pairs: bin -> channel -> (high, low), so it must contain frameCount * binsPerFrame * channels * 2 bytes
+    */
+    static std::shared_ptr<const AudioLevelsPyramid> fromPeaks(const QByteArray &peaks, int channels, int binsPerFrame, int frameCount);
+    /** @brief Build a pyramid with one bin per frame from legacy per frame levels (frame -> channel) */
+    static std::shared_ptr<const AudioLevelsPyramid> fromFrameLevels(const QVector<uint8_t> &levels, int channels);
+    /** @brief Load a pyramid from a cache file. Returns nullptr if the file is missing or invalid */
+    static std::shared_ptr<const AudioLevelsPyramid> load(const QString &path);
+    /** @brief Write the pyramid to a cache file */
+    bool save(const QString &path) const;
+
+    /** @brief Convert a sample peak (0-1 range) to the 0-255 IEC scale used for the audio thumbnails */
+    static uint8_t scaledLevel(double peak);
+    /** @brief Append the finest level data of one frame to @param peaks
+        @param samples interleaved 16 bit samples, @param sampleCount per channel
+        @param frameChannels channels of the samples, the previous frame is repeated if it does not match @param channels
+     */
+    static void appendFramePeaks(QByteArray &peaks, const int16_t *samples, int sampleCount, int frameChannels, int channels, int binsPerFrame);
+
+    int channels() const;
+    int binsPerFrame() const;
+    int frameCount() const;
+    int levelCount() const;
+    /** @brief Number of bins in a level, level 0 being the finest one */
+    int binCount(int level) const;
+    /** @brief Highest level stored in this pyramid */
+    int maxLevel() const;
+
+    /** @brief Returns the peak of a channel for a bin in a level */
+    Peak peak(int level, int bin, int channel) const;
+    /** @brief Returns the peak for frames in the [startFrame, endFrame[ range, picking the pyramid level matching the range length.
+        @param channel the channel to read, or -1 to merge all channels
+    */
+    Peak peakInRange(double startFrame, double endFrame, int channel = -1) const;
+    /** @brief Returns the legacy one value per frame levels (frame -> channel) */
+    QVector<uint8_t> frameLevels() const;
+
+private:
+    AudioLevelsPyramid();
+    /** @brief Compute the level offsets from the header values. Returns the total buffer size or -1 if the header is invalid */
+    qint64 computeLayout();
+    const uchar *levelData(int level) const;
+
+    int m_channels;
+    int m_binsPerFrame;
+    int m_frameCount;
+    int m_maxLevel;
+    /** @brief Byte offset of each level, relative to the start of the buffer */
+    std::vector<qint64> m_levelOffsets;
+    std::vector<int> m_binCounts;
+    /** @brief Buffer holding the header and the levels, pointing to m_storage */
+    const uchar *m_data;
+    qint64 m_size;
+    QByteArray m_storage;
+};
@@ -0,0 +1,509 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audioMeter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIOMETER_DISPATCH
+#include <immintrin.h>
+// The scalar kernel bodies are inlined in the vector functions for the remaining samples
+#define KERNEL_INLINE __attribute__((always_inline)) inline
+#else
+#define KERNEL_INLINE inline
+#endif
+
+constexpr double AudioMeter::Silence;
+constexpr int AudioMeter::TruePeakTaps;
+constexpr int AudioMeter::Oversampling;
+constexpr int AudioMeter::SubBlocksPerMomentary;
+constexpr int AudioMeter::SubBlocksPerShortTerm;
+constexpr double AudioMeter::AbsoluteGate;
+constexpr int AudioMeter::HistogramBins;
+
+namespace {
+using PhaseFilters = std::array<std::array<float, AudioMeter::TruePeakTaps>, AudioMeter::Oversampling>;
+
+/** @brief Windowed sinc interpolation filter, split in one filter per phase of the oversampled signal */
+const PhaseFilters &truePeakFilters()
+{
+    static const PhaseFilters filters = []() {
+        PhaseFilters result;
+        const int length = AudioMeter::TruePeakTaps * AudioMeter::Oversampling;
+        const double center = (length - 1) / 2.;
+        for (int phase = 0; phase < AudioMeter::Oversampling; ++phase) {
+            double sum = 0.;
+            std::array<double, AudioMeter::TruePeakTaps> taps;
+            for (int k = 0; k < AudioMeter::TruePeakTaps; ++k) {
+                // Output phase q is computed from input sample n - k with the tap q + 4k, stored in reverse order
+                const int j = phase + AudioMeter::Oversampling * (AudioMeter::TruePeakTaps - 1 - k);
+                const double t = (j - center) / AudioMeter::Oversampling;
+                const double sinc = std::abs(t) < 1e-9 ? 1. : std::sin(M_PI * t) / (M_PI * t);
+                const double blackman = 0.42 - 0.5 * std::cos(2. * M_PI * j / (length - 1)) + 0.08 * std::cos(4. * M_PI * j / (length - 1));
+                taps[size_t(k)] = sinc * blackman;
+                sum += taps[size_t(k)];
+            }
+            // Unity gain on each phase
+            for (int k = 0; k < AudioMeter::TruePeakTaps; ++k) {
+                result[size_t(phase)][size_t(k)] = float(taps[size_t(k)] / sum);
+            }
+        }
+        return result;
+    }();
+    return filters;
+}
+
+KERNEL_INLINE float peakKernel(const float *samples, int count, float result)
+{
+    for (int i = 0; i < count; ++i) {
+        result = std::max(result, std::abs(samples[i]));
+    }
+    return result;
+}
+
+/** @brief Add the squares of the samples after @param i to the first partial sum and combine the 4 partial sums */
+KERNEL_INLINE double sumOfSquaresKernel(const double *samples, int i, int count, const double *sums)
+{
+    double first = sums[0];
+    for (; i < count; ++i) {
+        first += samples[i] * samples[i];
+    }
+    return (first + sums[1]) + (sums[2] + sums[3]);
+}
+
+KERNEL_INLINE void accumulateKernel(float *work, const float *source, float tap, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        work[i] += tap * source[i];
+    }
+}
+
+using PeakFunction = float (*)(const float *, int);
+using AccumulateFunction = void (*)(float *, const float *, float, int);
+
+float truePeakWith(const float *samples, int count, float *work, PeakFunction peak, AccumulateFunction accumulate)
+{
+    float result = 0.f;
+    for (const auto &taps : truePeakFilters()) {
+        std::fill(work, work + count, 0.f);
+        // One pass per tap over the whole buffer keeps the inner loop free of dependencies
+        for (int k = 0; k < AudioMeter::TruePeakTaps; ++k) {
+            accumulate(work, samples + k, taps[size_t(k)], count);
+        }
+        result = std::max(result, peak(work, count));
+    }
+    return result;
+}
+
+float peakScalar(const float *samples, int count)
+{
+    return peakKernel(samples, count, 0.f);
+}
+
+double sumOfSquaresScalar(const double *samples, int count)
+{
+    // Independent partial sums, so that the additions can run in parallel
+    double sums[4] = {0., 0., 0., 0.};
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sums[0] += samples[i] * samples[i];
+        sums[1] += samples[i + 1] * samples[i + 1];
+        sums[2] += samples[i + 2] * samples[i + 2];
+        sums[3] += samples[i + 3] * samples[i + 3];
+    }
+    return sumOfSquaresKernel(samples, i, count, sums);
+}
+
+void accumulateScalar(float *work, const float *source, float tap, int count)
+{
+    accumulateKernel(work, source, tap, count);
+}
+
+#ifdef AUDIOMETER_DISPATCH
+// The vector kernels run the operations of the scalar kernels lane by lane, without fused multiply-add. The partial sums of sumOfSquares
+// are kept in the same lanes as the scalar version, so the results are bit-exact with it.
+
+__attribute__((target("sse2"))) float peakSse2(const float *samples, int count)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 result = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        result = _mm_max_ps(result, _mm_and_ps(_mm_loadu_ps(samples + i), absMask));
+    }
+    result = _mm_max_ps(result, _mm_movehl_ps(result, result));
+    result = _mm_max_ss(result, _mm_shuffle_ps(result, result, 1));
+    return peakKernel(samples + i, count - i, _mm_cvtss_f32(result));
+}
+
+__attribute__((target("sse2"))) double sumOfSquaresSse2(const double *samples, int count)
+{
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128d a = _mm_loadu_pd(samples + i);
+        const __m128d b = _mm_loadu_pd(samples + i + 2);
+        low = _mm_add_pd(low, _mm_mul_pd(a, a));
+        high = _mm_add_pd(high, _mm_mul_pd(b, b));
+    }
+    double sums[4];
+    _mm_storeu_pd(sums, low);
+    _mm_storeu_pd(sums + 2, high);
+    return sumOfSquaresKernel(samples, i, count, sums);
+}
+
+__attribute__((target("sse2"))) void accumulateSse2(float *work, const float *source, float tap, int count)
+{
+    const __m128 vtap = _mm_set1_ps(tap);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(work + i, _mm_add_ps(_mm_loadu_ps(work + i), _mm_mul_ps(vtap, _mm_loadu_ps(source + i))));
+    }
+    accumulateKernel(work + i, source + i, tap, count - i);
+}
+
+__attribute__((target("avx2"))) float peakAvx2(const float *samples, int count)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 wide = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        wide = _mm256_max_ps(wide, _mm256_and_ps(_mm256_loadu_ps(samples + i), absMask));
+    }
+    __m128 result = _mm_max_ps(_mm256_castps256_ps128(wide), _mm256_extractf128_ps(wide, 1));
+    result = _mm_max_ps(result, _mm_movehl_ps(result, result));
+    result = _mm_max_ss(result, _mm_shuffle_ps(result, result, 1));
+    return peakKernel(samples + i, count - i, _mm_cvtss_f32(result));
+}
+
+__attribute__((target("avx2"))) double sumOfSquaresAvx2(const double *samples, int count)
+{
+    __m256d sum = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d a = _mm256_loadu_pd(samples + i);
+        sum = _mm256_add_pd(sum, _mm256_mul_pd(a, a));
+    }
+    double sums[4];
+    _mm256_storeu_pd(sums, sum);
+    return sumOfSquaresKernel(samples, i, count, sums);
+}
+
+__attribute__((target("avx2"))) void accumulateAvx2(float *work, const float *source, float tap, int count)
+{
+    const __m256 vtap = _mm256_set1_ps(tap);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(work + i, _mm256_add_ps(_mm256_loadu_ps(work + i), _mm256_mul_ps(vtap, _mm256_loadu_ps(source + i))));
+    }
+    accumulateKernel(work + i, source + i, tap, count - i);
+}
+#endif
+
+AudioMeter::SimdLevel detectSimdLevel()
+{
+#ifdef AUDIOMETER_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AudioMeter::SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return AudioMeter::SimdLevel::SSE2;
+    }
+#endif
+    return AudioMeter::SimdLevel::Scalar;
+}
+
+std::atomic<AudioMeter::SimdLevel> &currentLevel()
+{
+    static std::atomic<AudioMeter::SimdLevel> level(AudioMeter::supportedSimdLevel());
+    return level;
+}
+} // namespace
+
+AudioMeter::AudioMeter(int channels, int frequency)
+    : m_channels(qMax(1, channels))
+    , m_frequency(qMax(1, frequency))
+    , m_filterState(size_t(m_channels))
+    , m_input(size_t(m_channels))
+    , m_weighted(size_t(m_channels))
+    , m_peaks(size_t(m_channels), Silence)
+    , m_truePeaks(size_t(m_channels), Silence)
+    , m_subBlockSize(qMax(1, m_frequency / 10))
+    , m_histogramCount(HistogramBins)
+    , m_histogramPower(HistogramBins)
+{
+    // Channel weights of ITU-R BS.1770, MLT orders 5.1 as L R C LFE Ls Rs and quad as L R Ls Rs
+    m_weights.assign(size_t(m_channels), 1.);
+    if (m_channels == 6) {
+        m_weights[3] = 0.;
+        m_weights[4] = m_weights[5] = 1.41;
+    } else if (m_channels == 4) {
+        m_weights[2] = m_weights[3] = 1.41;
+    }
+    // K-weighting filters, computed for the sample rate from the analog prototypes of BS.1770
+    double f0 = 1681.974450955533;
+    const double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = std::tan(M_PI * f0 / m_frequency);
+    const double vh = std::pow(10., gain / 20.);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1. + k / q + k * k;
+    m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    m_shelf.b1 = 2. * (k * k - vh) / a0;
+    m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    m_shelf.a1 = 2. * (k * k - 1.) / a0;
+    m_shelf.a2 = (1. - k / q + k * k) / a0;
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(M_PI * f0 / m_frequency);
+    a0 = 1. + k / q + k * k;
+    m_highPass.b0 = 1.;
+    m_highPass.b1 = -2.;
+    m_highPass.b2 = 1.;
+    m_highPass.a1 = 2. * (k * k - 1.) / a0;
+    m_highPass.a2 = (1. - k / q + k * k) / a0;
+    reset();
+}
+
+void AudioMeter::reset()
+{
+    for (auto &state : m_filterState) {
+        state.fill(0.);
+    }
+    for (auto &input : m_input) {
+        input.assign(TruePeakTaps - 1, 0.f);
+    }
+    std::fill(m_peaks.begin(), m_peaks.end(), Silence);
+    std::fill(m_truePeaks.begin(), m_truePeaks.end(), Silence);
+    m_maxTruePeak = Silence;
+    m_subBlockFill = 0;
+    m_subBlockEnergy = 0.;
+    m_subBlocks.fill(0.);
+    m_subBlockCount = 0;
+    m_subBlockIndex = 0;
+    std::fill(m_histogramCount.begin(), m_histogramCount.end(), 0);
+    std::fill(m_histogramPower.begin(), m_histogramPower.end(), 0.);
+    m_gatedPower = 0.;
+    m_gatedBlocks = 0;
+}
+
+void AudioMeter::Biquad::run(double *samples, int count, double &z1, double &z2) const
+{
+    for (int i = 0; i < count; ++i) {
+        const double in = samples[i];
+        const double out = b0 * in + z1;
+        z1 = b1 * in - a1 * out + z2;
+        z2 = b2 * in - a2 * out;
+        samples[i] = out;
+    }
+}
+
+AudioMeter::SimdLevel AudioMeter::supportedSimdLevel()
+{
+    static const SimdLevel supported = detectSimdLevel();
+    return supported;
+}
+
+AudioMeter::SimdLevel AudioMeter::simdLevel()
+{
+    return currentLevel();
+}
+
+void AudioMeter::setSimdLevel(SimdLevel level)
+{
+    currentLevel() = qMin(level, supportedSimdLevel());
+}
+
+float AudioMeter::peak(const float *samples, int count)
+{
+    switch (simdLevel()) {
+#ifdef AUDIOMETER_DISPATCH
+    case SimdLevel::AVX2:
+        return peakAvx2(samples, count);
+    case SimdLevel::SSE2:
+        return peakSse2(samples, count);
+#endif
+    default:
+        return peakScalar(samples, count);
+    }
+}
+
+double AudioMeter::sumOfSquares(const double *samples, int count)
+{
+    switch (simdLevel()) {
+#ifdef AUDIOMETER_DISPATCH
+    case SimdLevel::AVX2:
+        return sumOfSquaresAvx2(samples, count);
+    case SimdLevel::SSE2:
+        return sumOfSquaresSse2(samples, count);
+#endif
+    default:
+        return sumOfSquaresScalar(samples, count);
+    }
+}
+
+float AudioMeter::truePeak(const float *samples, int count, float *work)
+{
+    switch (simdLevel()) {
+#ifdef AUDIOMETER_DISPATCH
+    case SimdLevel::AVX2:
+        return truePeakWith(samples, count, work, peakAvx2, accumulateAvx2);
+    case SimdLevel::SSE2:
+        return truePeakWith(samples, count, work, peakSse2, accumulateSse2);
+#endif
+    default:
+        return truePeakWith(samples, count, work, peakScalar, accumulateScalar);
+    }
+}
+
+void AudioMeter::process(const int16_t *samples, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    m_work.resize(size_t(count));
+    for (int c = 0; c < m_channels; ++c) {
+        std::vector<float> &input = m_input[size_t(c)];
+        input.resize(size_t(TruePeakTaps - 1 + count));
+        float *in = input.data() + TruePeakTaps - 1;
+        const int16_t *src = samples + c;
+        for (int i = 0; i < count; ++i) {
+            in[i] = src[i * m_channels] / 32768.f;
+        }
+        const double samplePeak = peak(in, count);
+        const double interPeak = std::max(samplePeak, double(truePeak(input.data(), count, m_work.data())));
+        m_peaks[size_t(c)] = toDb(samplePeak);
+        m_truePeaks[size_t(c)] = toDb(interPeak);
+        m_maxTruePeak = std::max(m_maxTruePeak, m_truePeaks[size_t(c)]);
+
+        std::vector<double> &weighted = m_weighted[size_t(c)];
+        weighted.resize(size_t(count));
+        if (m_weights[size_t(c)] > 0.) {
+            std::copy(in, in + count, weighted.begin());
+            std::array<double, 4> &state = m_filterState[size_t(c)];
+            m_shelf.run(weighted.data(), count, state[0], state[1]);
+            m_highPass.run(weighted.data(), count, state[2], state[3]);
+        }
+        // Keep the end of the buffer as history for the next one
+        std::copy(input.end() - (TruePeakTaps - 1), input.end(), input.begin());
+        input.resize(TruePeakTaps - 1);
+    }
+    // Accumulate the weighted power in 100ms blocks
+    int offset = 0;
+    while (offset < count) {
+        const int length = qMin(count - offset, m_subBlockSize - m_subBlockFill);
+        for (int c = 0; c < m_channels; ++c) {
+            if (m_weights[size_t(c)] > 0.) {
+                m_subBlockEnergy += m_weights[size_t(c)] * sumOfSquares(m_weighted[size_t(c)].data() + offset, length);
+            }
+        }
+        offset += length;
+        m_subBlockFill += length;
+        if (m_subBlockFill == m_subBlockSize) {
+            endSubBlock();
+        }
+    }
+}
+
+void AudioMeter::endSubBlock()
+{
+    m_subBlocks[size_t(m_subBlockIndex)] = m_subBlockEnergy / m_subBlockSize;
+    m_subBlockIndex = (m_subBlockIndex + 1) % SubBlocksPerShortTerm;
+    m_subBlockCount = qMin(m_subBlockCount + 1, SubBlocksPerShortTerm);
+    m_subBlockFill = 0;
+    m_subBlockEnergy = 0.;
+    if (m_subBlockCount < SubBlocksPerMomentary) {
+        return;
+    }
+    // A new 400ms gating block, blocks below the absolute gate are ignored
+    const double power = windowPower(SubBlocksPerMomentary);
+    const double loudness = toLufs(power);
+    if (loudness <= AbsoluteGate) {
+        return;
+    }
+    const int bin = qBound(0, int((loudness - AbsoluteGate) * 10.), HistogramBins - 1);
+    m_histogramCount[size_t(bin)]++;
+    m_histogramPower[size_t(bin)] += power;
+    m_gatedPower += power;
+    m_gatedBlocks++;
+}
+
+double AudioMeter::windowPower(int subBlocks) const
+{
+    // Missing blocks at the start of the stream count as silence
+    double power = 0.;
+    const int available = qMin(subBlocks, m_subBlockCount);
+    for (int i = 1; i <= available; ++i) {
+        power += m_subBlocks[size_t((m_subBlockIndex - i + SubBlocksPerShortTerm) % SubBlocksPerShortTerm)];
+    }
+    return power / subBlocks;
+}
+
+double AudioMeter::toDb(double amplitude)
+{
+    return amplitude > 0. ? std::max(Silence, 20. * std::log10(amplitude)) : Silence;
+}
+
+double AudioMeter::toLufs(double power)
+{
+    return power > 0. ? std::max(Silence, -0.691 + 10. * std::log10(power)) : Silence;
+}
+
+int AudioMeter::channels() const
+{
+    return m_channels;
+}
+
+int AudioMeter::frequency() const
+{
+    return m_frequency;
+}
+
+const std::vector<double> &AudioMeter::peaks() const
+{
+    return m_peaks;
+}
+
+const std::vector<double> &AudioMeter::truePeaks() const
+{
+    return m_truePeaks;
+}
+
+double AudioMeter::maxTruePeak() const
+{
+    return m_maxTruePeak;
+}
+
+double AudioMeter::momentary() const
+{
+    return toLufs(windowPower(SubBlocksPerMomentary));
+}
+
+double AudioMeter::shortTerm() const
+{
+    return toLufs(windowPower(SubBlocksPerShortTerm));
+}
+
+double AudioMeter::integrated() const
+{
+    if (m_gatedBlocks == 0) {
+        return Silence;
+    }
+    // Relative gate 10 LU below the loudness of the blocks above the absolute gate
+    const double relativeGate = toLufs(m_gatedPower / double(m_gatedBlocks)) - 10.;
+    const int first = qBound(0, int((relativeGate - AbsoluteGate) * 10.), HistogramBins - 1);
+    double power = 0.;
+    qint64 blocks = 0;
+    for (int i = first; i < HistogramBins; ++i) {
+        power += m_histogramPower[size_t(i)];
+        blocks += m_histogramCount[size_t(i)];
+    }
+    return blocks == 0 ? Silence : toLufs(power / double(blocks));
+}
@@ -0,0 +1,121 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/** @class AudioMeter
+    @brief Audio level and loudness measurement of a continuous stream, as done by broadcast meters.
+    Each buffer is read once to compute the sample peak and the true peak (4x oversampled, ITU-R BS.1770) of every channel,
+    and the K-weighted power used for the EBU R128 momentary (400ms), short-term (3s) and integrated (gated) loudness.
+    On x86 with GCC or Clang, the peak, true peak and power loops have SSE2 and AVX2 versions written with intrinsics, the best one supported
+    by the CPU is selected at runtime. Their results are bit-exact with the scalar version. The K-weighting filters are recursive and stay scalar.
+    The meter is not thread safe, it is meant to be fed by a single thread.
+ */
+class AudioMeter
+{
+public:
+    enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+    /** @brief The best instruction set supported by this CPU and build */
+    static SimdLevel supportedSimdLevel();
+    /** @brief The instruction set currently used by the buffer kernels */
+    static SimdLevel simdLevel();
+    /** @brief Force the instruction set used by the buffer kernels, for tests and benchmarks. Levels above the supported one are lowered */
+    static void setSimdLevel(SimdLevel level);
+
+    /** @brief Value reported for silence, in dB or LUFS */
+    static constexpr double Silence = -100.;
+
+    /** @brief Create a meter for interleaved audio with @param channels at @param frequency Hz */
+    AudioMeter(int channels, int frequency);
+
+    /** @brief Restart the measurement, for example after a seek */
+    void reset();
+    /** @brief Measure @param count interleaved samples per channel */
+    void process(const int16_t *samples, int count);
+
+    int channels() const;
+    int frequency() const;
+    /** @brief Sample peak of each channel in the last buffer, in dBFS */
+    const std::vector<double> &peaks() const;
+    /** @brief True peak of each channel in the last buffer, in dBTP */
+    const std::vector<double> &truePeaks() const;
+    /** @brief Highest true peak since the last reset, in dBTP */
+    double maxTruePeak() const;
+    /** @brief Loudness of the last 400ms, in LUFS */
+    double momentary() const;
+    /** @brief Loudness of the last 3s, in LUFS */
+    double shortTerm() const;
+    /** @brief Gated loudness since the last reset, in LUFS */
+    double integrated() const;
+
+    /** @brief Convert a linear amplitude to dB */
+    static double toDb(double amplitude);
+    /** @brief Convert a mean square power to LUFS */
+    static double toLufs(double power);
+    /** @brief Highest absolute value of @param count samples */
+    static float peak(const float *samples, int count);
+    /** @brief Sum of the squares of @param count samples */
+    static double sumOfSquares(const double *samples, int count);
+    /** @brief Polyphase interpolation of @param count samples, returns the highest absolute value of the oversampled signal.
+        @param samples must hold TruePeakTaps - 1 history samples before the @param count new ones
+        @param work buffer of at least @param count values
+     */
+    static float truePeak(const float *samples, int count, float *work);
+
+    /** @brief Taps of each phase of the true peak interpolation filter */
+    static constexpr int TruePeakTaps = 12;
+    static constexpr int Oversampling = 4;
+
+private:
+    struct Biquad
+    {
+        double b0{1.}, b1{0.}, b2{0.}, a1{0.}, a2{0.};
+        /** @brief Filter @param count samples in place, with a transposed direct form II */
+        void run(double *samples, int count, double &z1, double &z2) const;
+    };
+    // Each gating block is 400ms long, with a new block every 100ms
+    static constexpr int SubBlocksPerMomentary = 4;
+    static constexpr int SubBlocksPerShortTerm = 30;
+    // Integrated loudness histogram, 0.1 LU bins from the absolute gate
+    static constexpr double AbsoluteGate = -70.;
+    static constexpr int HistogramBins = 1000;
+
+    /** @brief Mean power of the last @param subBlocks 100ms blocks */
+    double windowPower(int subBlocks) const;
+    /** @brief A 100ms block is complete, update the gating histogram */
+    void endSubBlock();
+
+    int m_channels;
+    int m_frequency;
+    std::vector<double> m_weights;
+    Biquad m_shelf;
+    Biquad m_highPass;
+    /** @brief Filter states of each channel: shelf z1, z2 and high pass z1, z2 */
+    std::vector<std::array<double, 4>> m_filterState;
+    /** @brief Last input samples of each channel followed by the current buffer, for the true peak filter */
+    std::vector<std::vector<float>> m_input;
+    std::vector<float> m_work;
+    std::vector<std::vector<double>> m_weighted;
+    std::vector<double> m_peaks;
+    std::vector<double> m_truePeaks;
+    double m_maxTruePeak;
+    int m_subBlockSize;
+    int m_subBlockFill;
+    double m_subBlockEnergy;
+    /** @brief Ring of the last 100ms block powers */
+    std::array<double, SubBlocksPerShortTerm> m_subBlocks;
+    int m_subBlockCount;
+    int m_subBlockIndex;
+    std::vector<qint64> m_histogramCount;
+    std::vector<double> m_histogramPower;
+    double m_gatedPower;
+    qint64 m_gatedBlocks;
+};
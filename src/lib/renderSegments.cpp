@@ -0,0 +1,131 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "renderSegments.h"
+
+#include <QtGlobal>
+#include <cstdlib>
+
+constexpr int RenderSegments::MinimumLength;
+
+QVector<RenderSegments::Segment> RenderSegments::split(int in, int out, int count, int gopSize, const QVector<int> &cuts, int minimumLength)
+{
+    QVector<Segment> segments;
+    if (in < 0 || out < in) {
+        return segments;
+    }
+    const int length = out - in + 1;
+    minimumLength = qMax(1, minimumLength);
+    count = qMin(count, length / minimumLength);
+    if (count < 2) {
+        segments.append({in, out});
+        return segments;
+    }
+    const int tolerance = length / count / 2;
+    int start = in;
+    for (int i = 1; i < count; ++i) {
+        const int ideal = in + int(qint64(length) * i / count);
+        int boundary = -1;
+        int distance = tolerance + 1;
+        for (int cut : cuts) {
+            if (std::abs(cut - ideal) < distance) {
+                boundary = cut;
+                distance = std::abs(cut - ideal);
+            }
+        }
+        if (boundary < 0) {
+            boundary = ideal;
+            if (gopSize > 1) {
+                boundary = in + (ideal - in + gopSize / 2) / gopSize * gopSize;
+            }
+        }
+        if (boundary - start < minimumLength || out + 1 - boundary < minimumLength) {
+            continue;
+        }
+        segments.append({start, boundary - 1});
+        start = boundary;
+    }
+    segments.append({start, out});
+    return segments;
+}
+
+bool RenderSegments::canSegment(const QDomElement &consumer)
+{
+    if (consumer.isNull() || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat")) {
+        return false;
+    }
+    if (consumer.attribute(QStringLiteral("in"), QStringLiteral("-1")).toInt() < 0 ||
+        consumer.attribute(QStringLiteral("out"), QStringLiteral("-1")).toInt() <= consumer.attribute(QStringLiteral("in")).toInt()) {
+        return false;
+    }
+    // Two pass encoding needs the statistics of the whole range
+    if (consumer.hasAttribute(QStringLiteral("pass")) || consumer.attribute(QStringLiteral("x265-params")).contains(QLatin1String("pass="))) {
+        return false;
+    }
+    if (consumer.attribute(QStringLiteral("vn")).toInt() == 1 || consumer.attribute(QStringLiteral("video_off")).toInt() == 1) {
+        return false;
+    }
+    // Image sequences and animated images cannot be joined
+    const QString target = consumer.attribute(QStringLiteral("target"));
+    if (target.isEmpty() || target.contains(QLatin1Char('%'))) {
+        return false;
+    }
+    static const QStringList containers = {QStringLiteral("mp4"),    QStringLiteral("mov"), QStringLiteral("matroska"), QStringLiteral("webm"),
+                                           QStringLiteral("mpegts"), QStringLiteral("avi"), QStringLiteral("mxf")};
+    return containers.contains(consumer.attribute(QStringLiteral("f")));
+}
+
+bool RenderSegments::hasAudio(const QDomElement &consumer)
+{
+    return consumer.attribute(QStringLiteral("an")).toInt() != 1 && consumer.attribute(QStringLiteral("audio_off")).toInt() != 1;
+}
+
+QDomDocument RenderSegments::segmentPlaylist(const QDomDocument &playlist, const Segment &segment, const QString &target, Stream stream)
+{
+    QDomDocument doc = playlist.cloneNode(true).toDocument();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    consumer.setAttribute(QStringLiteral("in"), segment.in);
+    consumer.setAttribute(QStringLiteral("out"), segment.out);
+    consumer.setAttribute(QStringLiteral("target"), target);
+    switch (stream) {
+    case Stream::VideoOnly:
+        consumer.removeAttribute(QStringLiteral("acodec"));
+        consumer.setAttribute(QStringLiteral("an"), 1);
+        break;
+    case Stream::AudioOnly:
+        consumer.removeAttribute(QStringLiteral("vcodec"));
+        consumer.setAttribute(QStringLiteral("vn"), 1);
+        break;
+    case Stream::All:
+        break;
+    }
+    return doc;
+}
+
+QByteArray RenderSegments::concatList(const QStringList &files)
+{
+    QByteArray list("ffconcat version 1.0\n");
+    for (QString file : files) {
+        // Quotes are closed, escaped and reopened
+        file.replace(QLatin1Char('\''), QLatin1String("'\\''"));
+        list.append("file '" + file.toUtf8() + "'\n");
+    }
+    return list;
+}
+
+QStringList RenderSegments::joinArguments(const QString &listFile, const QString &audioFile, const QString &format, const QString &target)
+{
+    QStringList args = {QStringLiteral("-y"), QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-f"),  QStringLiteral("concat"),
+                        QStringLiteral("-safe"), QStringLiteral("0"),  QStringLiteral("-i"),    listFile};
+    if (!audioFile.isEmpty()) {
+        args << QStringLiteral("-i") << audioFile;
+    }
+    args << QStringLiteral("-map") << QStringLiteral("0:v");
+    if (!audioFile.isEmpty()) {
+        args << QStringLiteral("-map") << QStringLiteral("1:a");
+    }
+    args << QStringLiteral("-c") << QStringLiteral("copy") << QStringLiteral("-f") << format << target;
+    return args;
+}
@@ -0,0 +1,52 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QDomDocument>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/** @class RenderSegments
+    @brief Helpers to render a timeline in several segments encoded by parallel processes.
+    The video of each segment is encoded separately, each segment starting a new GOP, and the segments are joined by
+    ffmpeg's concat demuxer without re-encoding. The audio is encoded once for the whole range, so that the encoder
+    priming and padding of each segment do not create gaps at the seams, and muxed with the joined video.
+    Used by kdenlive_render, it only depends on QtCore and QtXml.
+ */
+class RenderSegments
+{
+public:
+    struct Segment
+    {
+        int in;
+        int out;
+        int length() const { return out - in + 1; }
+    };
+    enum class Stream { All, VideoOnly, AudioOnly };
+
+    /** @brief Shortest range worth a render process of its own, in frames */
+    static constexpr int MinimumLength = 250;
+
+    /** @brief Split the range from @param in to @param out in at most @param count contiguous segments.
+        A boundary is moved to the closest of the @param cuts (usually the guides) within half a segment, else it is placed on a
+        multiple of @param gopSize from the start, so that the keyframes are where a single process would have put them.
+        @param minimumLength the shortest segment to create
+     */
+    static QVector<Segment> split(int in, int out, int count, int gopSize, const QVector<int> &cuts = {}, int minimumLength = MinimumLength);
+    /** @brief Returns true if the render described by the @param consumer element can be done in segments */
+    static bool canSegment(const QDomElement &consumer);
+    /** @brief Returns true if the @param consumer element renders an audio stream */
+    static bool hasAudio(const QDomElement &consumer);
+    /** @brief A copy of the @param playlist rendering the @param stream of a @param segment to @param target */
+    static QDomDocument segmentPlaylist(const QDomDocument &playlist, const Segment &segment, const QString &target, Stream stream);
+    /** @brief Contents of a concat demuxer list joining @param files in order */
+    static QByteArray concatList(const QStringList &files);
+    /** @brief ffmpeg arguments joining the video listed in @param listFile and the optional @param audioFile into @param target,
+        using the @param format container
+     */
+    static QStringList joinArguments(const QString &listFile, const QString &audioFile, const QString &format, const QString &target);
+};
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "undohelper.hpp"
+
 /** This file contains a collection of macros that can be used in model related classes.
     The class only needs to have the following members:
     - For Push_undo : std::weak_ptr<DocUndoStack> m_undoStack;  this is a pointer to the undoStack
@@ -67,7 +69,8 @@ reading a Read-protected property. In that case, we try to write lock it first (
     redo = [operation, redo]() {                                                                                                                               \
         bool v = redo();                                                                                                                                       \
         return operation() && v;                                                                                                                               \
-    };
+    };                                                                                                                                                         \
+    addUndoPayload(2 * UndoLambdaCost);
 /** @brief This macro takes as parameter one atomic operation and its reverse, and update
  *  the undo and redo functional stacks/queue accordingly
  *  It will also ensure that operation and reverse are dealing with mutexes
@@ -96,6 +96,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QAction>
 #include <QClipboard>
 #include <QDialogButtonBox>
+#include <QLabel>
 #include <QFileDialog>
 #include <QMenu>
 #include <QMenuBar>
@@ -112,7 +113,6 @@ namespace Mlt {
 class Producer;
 }
 
-QMap<QString, QImage> MainWindow::m_lumacache;
 QMap<QString, QStringList> MainWindow::m_lumaFiles;
 
 /*static bool sortByNames(const QPair<QString, QAction *> &a, const QPair<QString, QAction*> &b)
@@ -440,11 +440,28 @@ void MainWindow::init(const QString &mltPath)
     m_clipMonitorDock = addDock(i18n("Clip Monitor"), QStringLiteral("clip_monitor"), m_clipMonitor);
     m_projectMonitorDock = addDock(i18n("Project Monitor"), QStringLiteral("project_monitor"), m_projectMonitor);
 
-    m_undoView = new QUndoView();
+    auto *undoWidget = new QWidget(this);
+    auto *undoLayout = new QVBoxLayout(undoWidget);
+    undoLayout->setContentsMargins(0, 0, 0, 0);
+    m_undoView = new QUndoView(undoWidget);
     m_undoView->setCleanIcon(QIcon::fromTheme(QStringLiteral("edit-clear")));
     m_undoView->setEmptyLabel(i18n("Clean"));
     m_undoView->setGroup(m_commandStack);
-    m_undoViewDock = addDock(i18n("Undo History"), QStringLiteral("undo_history"), m_undoView);
+    undoLayout->addWidget(m_undoView);
+    m_undoMemoryLabel = new QLabel(undoWidget);
+    m_undoMemoryLabel->setWordWrap(true);
+    // The tooltip walks the whole history, only build it when it is shown
+    m_undoMemoryLabel->installEventFilter(this);
+    undoLayout->addWidget(m_undoMemoryLabel);
+    m_undoViewDock = addDock(i18n("Undo History"), QStringLiteral("undo_history"), undoWidget);
+    connect(m_commandStack, &QUndoGroup::activeStackChanged, this, [this](QUndoStack *stack) {
+        if (auto *docStack = qobject_cast<DocUndoStack *>(stack)) {
+            connect(docStack, &DocUndoStack::memoryUsageChanged, this, &MainWindow::slotUpdateUndoMemory, Qt::UniqueConnection);
+        }
+        slotUpdateUndoMemory();
+    });
+    connect(m_commandStack, &QUndoGroup::indexChanged, this, &MainWindow::slotUpdateUndoMemory);
+    connect(m_undoViewDock, &QDockWidget::visibilityChanged, this, &MainWindow::slotUpdateUndoMemory);
 
     // Color and icon theme stuff
     connect(m_commandStack, &QUndoGroup::cleanChanged, m_saveAction, &QAction::setDisabled);
@@ -2277,18 +2294,22 @@ void MainWindow::slotCheckRenderStatus()
 
 void MainWindow::setRenderingProgress(const QString &url, int progress, int frame)
 {
-    Q_EMIT setRenderProgress(progress);
     if (m_renderWidget) {
         m_renderWidget->setRenderProgress(url, progress, frame);
+        // Several jobs may be running, report their overall progress
+        progress = m_renderWidget->runningJobsProgress();
     }
+    Q_EMIT setRenderProgress(progress);
 }
 
 void MainWindow::setRenderingFinished(const QString &url, int status, const QString &error)
 {
-    Q_EMIT setRenderProgress(100);
+    int progress = 100;
     if (m_renderWidget) {
         m_renderWidget->setRenderStatus(url, status, error);
+        progress = m_renderWidget->runningJobsProgress();
     }
+    Q_EMIT setRenderProgress(progress);
 }
 
 void MainWindow::addProjectClip(const QString &url, const QString &folder)
@@ -2594,6 +2615,58 @@ void MainWindow::updateConfiguration()
     // Update list of transcoding profiles
     buildDynamicActions();
     loadClipActions();
+
+    if (auto *docStack = qobject_cast<DocUndoStack *>(m_commandStack->activeStack())) {
+        docStack->setMemoryBudget(qint64(KdenliveSettings::undomemorylimit()) * 1024 * 1024);
+    }
+}
+
+void MainWindow::slotUpdateUndoMemory()
+{
+    auto *docStack = qobject_cast<DocUndoStack *>(m_commandStack->activeStack());
+    if (docStack == nullptr || m_undoViewDock->isHidden()) {
+        m_undoMemoryLabel->clear();
+        return;
+    }
+    const QLocale locale;
+    const qint64 usage = docStack->memoryUsage();
+    if (docStack->memoryBudget() > 0) {
+        m_undoMemoryLabel->setText(i18n("Memory: %1 of %2", locale.formattedDataSize(usage), locale.formattedDataSize(docStack->memoryBudget())));
+    } else {
+        m_undoMemoryLabel->setText(i18n("Memory: %1", locale.formattedDataSize(usage)));
+    }
+}
+
+QString MainWindow::undoMemoryToolTip() const
+{
+    auto *docStack = qobject_cast<DocUndoStack *>(m_commandStack->activeStack());
+    if (docStack == nullptr) {
+        return QString();
+    }
+    const QLocale locale;
+    // List the largest operations
+    QVector<QPair<qint64, int>> costs;
+    costs.reserve(docStack->count());
+    for (int i = 0; i < docStack->count(); ++i) {
+        costs.append({DocUndoStack::commandCost(docStack->command(i)), i});
+    }
+    const int listed = qMin(5, costs.size());
+    std::partial_sort(costs.begin(), costs.begin() + listed, costs.end(),
+                      [](const QPair<qint64, int> &a, const QPair<qint64, int> &b) { return a.first > b.first; });
+    QStringList largest;
+    for (int i = 0; i < listed; ++i) {
+        largest << QStringLiteral("%1: %2").arg(docStack->text(costs.at(i).second), locale.formattedDataSize(costs.at(i).first));
+    }
+    QString tooltip = i18n("Estimated memory used by the undo history.");
+    const int discarded = docStack->discardedCount();
+    if (discarded > 0) {
+        tooltip.append(QLatin1Char('\n') + i18np("%1 old operation was discarded to stay below the memory limit.",
+                                                 "%1 old operations were discarded to stay below the memory limit.", discarded));
+    }
+    if (!largest.isEmpty()) {
+        tooltip.append(QLatin1Char('\n') + i18n("Largest operations:") + QLatin1Char('\n') + largest.join(QLatin1Char('\n')));
+    }
+    return tooltip;
 }
 
 void MainWindow::slotSwitchVideoThumbs()
@@ -4539,6 +4612,11 @@ void MainWindow::slotCopyDebugInfo()
 bool MainWindow::eventFilter(QObject *object, QEvent *event)
 {
     switch (event->type()) {
+    case QEvent::ToolTip:
+        if (object == m_undoMemoryLabel) {
+            m_undoMemoryLabel->setToolTip(undoMemoryToolTip());
+        }
+        break;
     case QEvent::ShortcutOverride:
         if (static_cast<QKeyEvent *>(event)->key() == Qt::Key_Escape) {
             if (pCore->isMediaMonitoring()) {
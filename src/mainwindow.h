@@ -43,6 +43,7 @@ class EffectBasket;
 class EffectListWidget;
 class TransitionListWidget;
 class KIconLoader;
+class QLabel;
 class KdenliveDoc;
 class Monitor;
 class Render;
@@ -87,8 +88,6 @@ public:
     void init(const QString &mltPath);
     ~MainWindow() override;
 
-    /** @brief Cache for luma files thumbnails. */
-    static QMap<QString, QImage> m_lumacache;
     static QMap<QString, QStringList> m_lumaFiles;
 
     /** @brief Adds an action to the action collection and stores the name. */
@@ -117,6 +116,8 @@ public:
 
     QUndoGroup *m_commandStack;
     QUndoView *m_undoView;
+    /** @brief Shows the memory used by the undo history below the undo view */
+    QLabel *m_undoMemoryLabel;
     /** @brief holds info about whether movit is available on this system */
     bool m_gpuAllowed;
     int m_exitCode{EXIT_SUCCESS};
@@ -321,6 +322,8 @@ private:
     EffectBasket *m_effectBasket;
     /** @brief Update widget style. */
     void doChangeStyle();
+    /** @brief Build the tooltip of the undo memory label, listing the largest operations of the history. */
+    QString undoMemoryToolTip() const;
 
 public Q_SLOTS:
     void slotReloadEffects(const QStringList &paths);
@@ -387,6 +390,8 @@ private Q_SLOTS:
     void loadDockActions();
     /** @brief Reflects setting changes to the GUI. */
     void updateConfiguration();
+    /** @brief Display the memory used by the active undo history. */
+    void slotUpdateUndoMemory();
     void slotConnectMonitors();
     void slotUpdateMousePosition(int pos, int duration = -1);
     void slotSwitchMarkersComments();
@@ -12,7 +12,6 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <KLocalizedString>
 #include <KUrlRequester>
 #include <KUrlRequesterDialog>
-#include <QtConcurrent>
 
 #include <clocale>
 #include <lib/localeHandling.h>
@@ -268,7 +267,6 @@ void MltConnection::refreshLumas()
     customLumas.removeDuplicates();
     QStringList hdLumas;
     QStringList sdLumas;
-    QStringList allImagefiles;
     for (const QString &folder : qAsConst(customLumas)) {
         QDir topDir(folder);
         QStringList folders = topDir.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
@@ -292,7 +290,6 @@ void MltConnection::refreshLumas()
             } else {
                 sdLumas << imagefiles;
             }
-            allImagefiles << imagefiles;
         }
     }
     // Insert MLT builtin lumas (created on the fly)
@@ -302,10 +299,4 @@ void MltConnection::refreshLumas()
     }
     MainWindow::m_lumaFiles.insert(QStringLiteral("16_9"), hdLumas);
     MainWindow::m_lumaFiles.insert(QStringLiteral("PAL"), sdLumas);
-    allImagefiles.removeDuplicates();
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    QtConcurrent::run(pCore.get(), &Core::buildLumaThumbs, allImagefiles);
-#else
-    QtConcurrent::run(&Core::buildLumaThumbs, pCore.get(), allImagefiles);
-#endif
 }
@@ -7,6 +7,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include "definitions.h"
+#include "scopes/sharedframe.h"
 
 #include <cstdint>
 
@@ -87,6 +88,8 @@ protected:
 Q_SIGNALS:
     /** @brief Send a frame for analysis or title background display. */
     void frameUpdated(const QImage &);
+    /** @brief Send the YUV frame displayed by the monitor for analysis, without rendering it to RGB. */
+    void yuvFrameUpdated(const SharedFrame &);
     /** @brief This signal contains the audio of the current frame. */
     void audioSamplesSignal(const audioShortVector &, int, int, int);
     /** @brief Scopes are ready to receive a new frame. */
@@ -70,6 +70,7 @@ using namespace Mlt;
 GLWidget::GLWidget(int id, QWidget *parent)
     : QQuickWidget(parent)
     , sendFrameForAnalysis(false)
+    , sendYuvFrameForAnalysis(false)
     , m_glslManager(nullptr)
     , m_consumer(nullptr)
     , m_producer(nullptr)
@@ -97,6 +98,7 @@ GLWidget::GLWidget(int id, QWidget *parent)
     , m_colorSpace(601)
     , m_dar(1.78)
     , m_sendFrame(false)
+    , m_sendYuvFrame(false)
     , m_isZoneMode(false)
     , m_isLoopMode(false)
     , m_loopIn(0)
@@ -652,31 +654,37 @@ void GLWidget::paintGL()
     glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
     check_error(f);
 
-    if (m_sendFrame && m_analyseSem.tryAcquire(1)) {
-        // Render RGB frame for analysis
-        if (!qFuzzyCompare(m_zoom, 1.0f)) {
-            // Disable monitor zoom to render frame
-            modelView = QMatrix4x4();
-            m_shader->setUniformValue(m_modelViewLocation, modelView);
-        }
-        if ((m_fbo == nullptr) || m_fbo->size() != m_profileSize) {
-            delete m_fbo;
-            QOpenGLFramebufferObjectFormat fmt;
-            fmt.setSamples(1);
-            m_fbo = new QOpenGLFramebufferObject(m_profileSize.width(), m_profileSize.height(), fmt); // GL_TEXTURE_2D);
-        }
-        m_fbo->bind();
-        glViewport(0, 0, m_profileSize.width(), m_profileSize.height());
+    if ((m_sendFrame || m_sendYuvFrame) && m_analyseSem.tryAcquire(1)) {
+        if (!m_sendFrame && m_glslManager == nullptr) {
+            // The frame already holds its YUV image, no need to render it
+            Q_EMIT analyseYuvFrame(m_sharedFrame);
+        } else {
+            // Render RGB frame for analysis
+            if (!qFuzzyCompare(m_zoom, 1.0f)) {
+                // Disable monitor zoom to render frame
+                modelView = QMatrix4x4();
+                m_shader->setUniformValue(m_modelViewLocation, modelView);
+            }
+            if ((m_fbo == nullptr) || m_fbo->size() != m_profileSize) {
+                delete m_fbo;
+                QOpenGLFramebufferObjectFormat fmt;
+                fmt.setSamples(1);
+                m_fbo = new QOpenGLFramebufferObject(m_profileSize.width(), m_profileSize.height(), fmt); // GL_TEXTURE_2D);
+            }
+            m_fbo->bind();
+            glViewport(0, 0, m_profileSize.width(), m_profileSize.height());
 
-        QMatrix4x4 projection2;
-        projection2.scale(2.0f / width, 2.0f / height);
-        m_shader->setUniformValue(m_projectionLocation, projection2);
+            QMatrix4x4 projection2;
+            projection2.scale(2.0f / width, 2.0f / height);
+            m_shader->setUniformValue(m_projectionLocation, projection2);
 
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
-        check_error(f);
-        m_fbo->release();
-        Q_EMIT analyseFrame(m_fbo->toImage());
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
+            check_error(f);
+            m_fbo->release();
+            Q_EMIT analyseFrame(m_fbo->toImage());
+        }
         m_sendFrame = false;
+        m_sendYuvFrame = false;
     }
     // Cleanup
     m_shader->disableAttributeArray(m_vertexLocation);
@@ -1280,6 +1288,7 @@ void GLWidget::onFrameDisplayed(const SharedFrame &frame)
     m_contextSharedAccess.lock();
     m_sharedFrame = frame;
     m_sendFrame = sendFrameForAnalysis;
+    m_sendYuvFrame = sendYuvFrameForAnalysis;
     m_contextSharedAccess.unlock();
     quickWindow()->update();
 }
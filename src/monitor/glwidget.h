@@ -90,6 +90,9 @@ public:
     QRect displayRect() const;
     /** @brief set to true if we want to emit a QImage of the frame for analysis */
     bool sendFrameForAnalysis;
+    /** @brief set to true if we want to emit the YUV frame for analysis. A QImage is still emitted instead if sendFrameForAnalysis is set
+     *  or if the frame is only available as an OpenGL texture */
+    bool sendYuvFrameForAnalysis;
     /** @brief delete and rebuild consumer, for example when external display is switched */
     void resetConsumer(bool fullReset);
     void lockMonitor();
@@ -172,6 +175,7 @@ Q_SIGNALS:
     void mouseSeek(int eventDelta, uint modifiers);
     void startDrag();
     void analyseFrame(const QImage &);
+    void analyseYuvFrame(const SharedFrame &);
     void showContextMenu(const QPoint &);
     void lockMonitor(bool);
     void passKeyEvent(QKeyEvent *);
@@ -222,6 +226,7 @@ private:
     int m_colorSpace;
     double m_dar;
     bool m_sendFrame;
+    bool m_sendYuvFrame;
     bool m_isZoneMode;
     bool m_isLoopMode;
     int m_loopIn;
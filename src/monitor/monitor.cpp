@@ -401,6 +401,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
 
     connect(this, &Monitor::scopesClear, m_glMonitor, &GLWidget::releaseAnalyse, Qt::DirectConnection);
     connect(m_glMonitor, &GLWidget::analyseFrame, this, &Monitor::frameUpdated);
+    connect(m_glMonitor, &GLWidget::analyseYuvFrame, this, &Monitor::yuvFrameUpdated);
     m_timePos = new TimecodeDisplay(this);
 
     if (id == Kdenlive::ProjectMonitor) {
@@ -432,6 +433,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
         m_audioMeterWidget->setVisibility((KdenliveSettings::monitoraudio() & m_id) != 0);
         if (id == Kdenlive::ProjectMonitor) {
             connect(m_audioMeterWidget, &MonitorAudioLevel::audioLevelsAvailable, pCore.get(), &Core::audioLevelsAvailable);
+            connect(m_audioMeterWidget, &MonitorAudioLevel::audioLoudnessAvailable, pCore.get(), &Core::audioLoudnessAvailable);
         }
     }
 
@@ -1719,12 +1721,12 @@ void Monitor::slotOpenClip(const std::shared_ptr<ProjectClip> &controller, int i
         }
     } else if (controller == nullptr) {
         // Nothing to do
-        pCore->taskManager.displayedClip = -1;
+        pCore->taskManager.setDisplayedClip(-1);
         return;
     }
     disconnect(this, &Monitor::seekPosition, this, &Monitor::seekRemap);
     m_controller = controller;
-    pCore->taskManager.displayedClip = m_controller ? m_controller->clipId().toInt() : -1;
+    pCore->taskManager.setDisplayedClip(m_controller ? m_controller->clipId().toInt() : -1);
     m_glMonitor->getControllerProxy()->setAudioStream(QString());
     m_snaps.reset(new SnapModel());
     m_glMonitor->getControllerProxy()->resetZone();
@@ -2113,7 +2115,8 @@ void Monitor::slotSetVolume(int volume)
 
 void Monitor::sendFrameForAnalysis(bool analyse)
 {
-    m_glMonitor->sendFrameForAnalysis = analyse;
+    // The color scopes read the YUV frames, other requests for RGB images go through sendFrameForAnalysis
+    m_glMonitor->sendYuvFrameForAnalysis = analyse;
 }
 
 void Monitor::updateAudioForAnalysis()
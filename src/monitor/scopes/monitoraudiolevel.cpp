@@ -6,8 +6,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "monitoraudiolevel.h"
+#include "audiomixer/audiolevelwidget.hpp"
 #include "audiomixer/iecscale.h"
 #include "core.h"
+#include "lib/audio/audioMeter.h"
 #include "profiles/profilemodel.hpp"
 
 #include "mlt++/Mlt.h"
@@ -17,6 +19,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QFont>
 #include <QPaintEvent>
 #include <QPainter>
+#include <QToolTip>
 
 MonitorAudioLevel::MonitorAudioLevel(int height, QWidget *parent)
     : ScopeWidget(parent)
@@ -25,10 +28,12 @@ MonitorAudioLevel::MonitorAudioLevel(int height, QWidget *parent)
     , m_channelHeight(height / 2)
     , m_channelDistance(1)
     , m_channelFillHeight(m_channelHeight)
+    , m_lastPosition(-1)
+    , m_levels(16)
+    , m_publishPending(false)
 {
     setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Preferred);
     isValid = true;
-    connect(this, &MonitorAudioLevel::audioLevelsAvailable, this, &MonitorAudioLevel::setAudioValues);
 }
 
 MonitorAudioLevel::~MonitorAudioLevel() = default;
@@ -36,6 +41,7 @@ MonitorAudioLevel::~MonitorAudioLevel() = default;
 void MonitorAudioLevel::refreshScope(const QSize & /*size*/, bool /*full*/)
 {
     SharedFrame sFrame;
+    bool measured = false;
     while (m_queue.count() > 0) {
         sFrame = m_queue.pop();
         if (sFrame.is_valid()) {
@@ -43,28 +49,53 @@ void MonitorAudioLevel::refreshScope(const QSize & /*size*/, bool /*full*/)
             if (samples <= 0) {
                 continue;
             }
-            // TODO: the 200 value is aligned with the MLT audiolevel filter, but seems arbitrary.
-            samples = qMin(200, samples);
-            int channels = sFrame.get_audio_channels();
-            QVector<double> levels;
-            const int16_t *audio = sFrame.get_audio();
-            for (int c = 0; c < channels; c++) {
-                int16_t peak = 0;
-                const int16_t *p = audio + c;
-                for (int s = 0; s < samples; s++) {
-                    int16_t sample = abs(*p);
-                    if (sample > peak) peak = sample;
-                    p += channels;
-                }
-                if (peak == 0) {
-                    levels << -100;
-                } else {
-                    levels << 20 * log10((double)peak / (double)std::numeric_limits<int16_t>::max());
-                }
+            const int position = sFrame.get_position();
+            if (position == m_lastPosition) {
+                // Same frame displayed again, don't measure its audio twice
+                continue;
+            }
+            const int channels = sFrame.get_audio_channels();
+            const int frequency = sFrame.get_audio_frequency();
+            if (!m_meter || m_meter->channels() != channels || m_meter->frequency() != frequency) {
+                m_meter.reset(new AudioMeter(channels, frequency));
+            } else if (position < m_lastPosition || position - m_lastPosition > qMax(1, frequency / samples)) {
+                // Loudness is measured over continuous playback, restart after a seek. The scope queue drops frames when we are late,
+                // so only a backward move or a forward jump of more than a second of audio is a seek
+                m_meter->reset();
             }
-            Q_EMIT audioLevelsAvailable(levels);
+            m_lastPosition = position;
+            m_meter->process(sFrame.get_audio(), samples);
+            MeterLevels levels;
+            const std::vector<double> &peaks = m_meter->peaks();
+            levels.peaks = QVector<double>(peaks.begin(), peaks.end());
+            levels.momentary = m_meter->momentary();
+            levels.shortTerm = m_meter->shortTerm();
+            levels.integrated = m_meter->integrated();
+            levels.truePeak = m_meter->maxTruePeak();
+            m_levels.push(std::move(levels));
+            measured = true;
         }
     }
+    // Wake the GUI once for all the levels it did not read yet
+    if (measured && !m_publishPending.exchange(true)) {
+        QMetaObject::invokeMethod(this, &MonitorAudioLevel::publishLevels, Qt::QueuedConnection);
+    }
+}
+
+void MonitorAudioLevel::publishLevels()
+{
+    m_publishPending = false;
+    MeterLevels levels;
+    bool found = false;
+    while (m_levels.pop(levels)) {
+        setAudioValues(levels.peaks);
+        Q_EMIT audioLevelsAvailable(levels.peaks);
+        found = true;
+    }
+    if (found) {
+        m_loudness = levels;
+        Q_EMIT audioLoudnessAvailable(levels.momentary, levels.shortTerm, levels.integrated, levels.truePeak);
+    }
 }
 
 void MonitorAudioLevel::resizeEvent(QResizeEvent *event)
@@ -178,6 +209,20 @@ void MonitorAudioLevel::setAudioValues(const QVector<double> &values)
     update();
 }
 
+bool MonitorAudioLevel::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        if (m_loudness.peaks.isEmpty()) {
+            QToolTip::hideText();
+        } else {
+            QToolTip::showText(static_cast<QHelpEvent *>(event)->globalPos(),
+                               AudioLevelWidget::loudnessText(m_loudness.momentary, m_loudness.shortTerm, m_loudness.integrated, m_loudness.truePeak), this);
+        }
+        return true;
+    }
+    return ScopeWidget::event(event);
+}
+
 void MonitorAudioLevel::setVisibility(bool enable)
 {
     if (enable) {
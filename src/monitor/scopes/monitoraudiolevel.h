@@ -8,9 +8,13 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include "scopewidget.h"
+#include "utils/spscqueue.hpp"
 #include <QWidget>
+#include <atomic>
 #include <memory>
 
+class AudioMeter;
+
 class MonitorAudioLevel : public ScopeWidget
 {
     Q_OBJECT
@@ -23,6 +27,7 @@ public:
     void setVisibility(bool enable);
 
 protected:
+    bool event(QEvent *event) override;
     void paintEvent(QPaintEvent *) override;
     void resizeEvent(QResizeEvent *event) override;
 
@@ -35,12 +40,33 @@ private:
     int m_channelHeight;
     int m_channelDistance;
     int m_channelFillHeight;
+    /** @brief Measurement of a frame, passed from the refresh thread to the GUI */
+    struct MeterLevels
+    {
+        QVector<double> peaks;
+        double momentary;
+        double shortTerm;
+        double integrated;
+        double truePeak;
+    };
+    /** @brief Only used by the refresh thread */
+    std::unique_ptr<AudioMeter> m_meter;
+    int m_lastPosition;
+    SpscQueue<MeterLevels> m_levels;
+    /** @brief True when the GUI was asked to read the queued levels */
+    std::atomic<bool> m_publishPending;
+    /** @brief Last displayed measurement, for the tooltip */
+    MeterLevels m_loudness;
     void drawBackground(int channels = 2);
     void refreshScope(const QSize &size, bool full) override;
+    /** @brief Display the queued levels, called in the GUI thread */
+    void publishLevels();
 
 public Q_SLOTS:
     void setAudioValues(const QVector<double> &values);
 
 Q_SIGNALS:
     void audioLevelsAvailable(const QVector<double>& levels);
+    /** @brief EBU R128 loudness in LUFS of the played audio and its highest true peak in dBTP */
+    void audioLoudnessAvailable(double momentary, double shortTerm, double integrated, double truePeak);
 };
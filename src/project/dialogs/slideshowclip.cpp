@@ -9,6 +9,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "core.h"
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
+#include "utils/lumathumbnailcache.hpp"
 
 #include <KFileItem>
 #include <KLocalizedString>
@@ -143,19 +144,13 @@ SlideshowClip::SlideshowClip(const Timecode &tc, QString clipFolder, ProjectClip
     }
     for (int i = 0; i < values.count(); i++) {
         const QString &entry = values.at(i);
-        // Create thumbnails
-        if (!entry.isEmpty() && (entry.endsWith(QLatin1String(".png")) || entry.endsWith(QLatin1String(".pgm")))) {
-            if (MainWindow::m_lumacache.contains(entry)) {
-                m_view.luma_file->addItem(QPixmap::fromImage(MainWindow::m_lumacache.value(entry)), names.at(i), entry);
-            } else {
-                QImage pix(entry);
-                if (!pix.isNull()) {
-                    MainWindow::m_lumacache.insert(entry, pix.scaled(50, 30, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-                    m_view.luma_file->addItem(QPixmap::fromImage(MainWindow::m_lumacache.value(entry)), names.at(i), entry);
-                }
-            }
+        // The luma is passed to the slideshow producer as a file
+        if (LumaThumbnailCache::isLumaFile(entry) && QFileInfo(entry).isFile()) {
+            m_view.luma_file->addItem(names.at(i), entry);
         }
     }
+    // Create thumbnails
+    LumaThumbnailCache::get()->setComboIcons(m_view.luma_file);
 
     if (clip) {
         m_view.slide_loop->setChecked(clip->getProducerIntProperty(QStringLiteral("loop")) != 0);
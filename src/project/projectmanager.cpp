@@ -449,6 +449,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveACopy)
             // The file filename does not have to exist for KAutoSaveFile to be constructed (if it exists, it will not be touched).
             m_project->m_autosave = new KAutoSaveFile(autosaveUrl, m_project);
         } else {
+            m_project->waitForAutoSave();
             m_project->m_autosave->setManagedFile(autosaveUrl);
         }
 
@@ -540,6 +541,7 @@ bool ProjectManager::saveFile()
         return saveFileAs();
     }
     bool result = saveFileAs(m_project->url().toLocalFile());
+    m_project->waitForAutoSave();
     m_project->m_autosave->resize(0);
     return result;
 }
@@ -890,22 +892,13 @@ void ProjectManager::slotStartAutoSave()
 
 void ProjectManager::slotAutoSave()
 {
+    // MLT cannot copy a tractor with its producers, filters and transitions other than by serializing it, so the scene is built on the GUI thread
+    // from the live timeline: the xml consumer walks the bin and preview playlists and the filter properties, which the GUI thread edits without
+    // locking. The replacements and the file write are done by the document in a worker thread.
     prepareSave();
     QString saveFolder = m_project->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile();
-    QString scene = projectSceneList(saveFolder);
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
-    }
-    if (!scene.contains(QLatin1String("<track "))) {
-        // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
-        pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"), ErrorMessage);
-        return;
-    }
-    m_project->slotAutoSave(scene);
+    const QString scene = projectSceneList(saveFolder);
+    m_project->slotAutoSave(scene, m_replacementPattern);
     m_lastSave.start();
 }
 
@@ -31,31 +31,62 @@ RenderServer::~RenderServer() {}
 
 void RenderServer::jobConnected()
 {
-    QLocalSocket *socket = m_server.nextPendingConnection();
-    connect(socket, &QLocalSocket::readyRead, this, &RenderServer::jobSent);
+    while (m_server.hasPendingConnections()) {
+        QLocalSocket *socket = m_server.nextPendingConnection();
+        connect(socket, &QLocalSocket::readyRead, this, &RenderServer::jobSent);
+        connect(socket, &QLocalSocket::disconnected, this, &RenderServer::jobDisconnected);
+    }
 }
 
 void RenderServer::jobSent()
 {
-    QLocalSocket *socket = reinterpret_cast<QLocalSocket *>(sender());
-    QTextStream text(socket);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-    text.setCodec("UTF-8");
-#endif
-    QString block, line;
-    while (text.readLineInto(&line)) {
-        block.append(line);
-        if (line == QLatin1String("}")) { // end of json object
-            QJsonParseError error;
-            const QJsonObject json = QJsonDocument::fromJson(block.toUtf8(), &error).object();
-            if (error.error != QJsonParseError::NoError) {
-                pCore->displayMessage(i18n("Communication error with render job"), ErrorMessage);
-                qWarning() << "RenderServer recieve error: " << error.errorString() << block;
-            }
-            handleJson(json, socket);
-            block.clear();
+    auto *socket = qobject_cast<QLocalSocket *>(sender());
+    if (socket == nullptr) {
+        return;
+    }
+    readMessages(socket);
+}
+
+void RenderServer::readMessages(QLocalSocket *socket)
+{
+    // Messages of several jobs interleave and may arrive split, keep the incomplete line of each stream
+    QByteArray &pending = m_pending[socket];
+    pending.append(socket->readAll());
+    int end;
+    while ((end = pending.indexOf('\n')) >= 0) {
+        // Each message is a compact json object on its own line
+        const QByteArray line = pending.left(end);
+        pending.remove(0, end + 1);
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonObject json = QJsonDocument::fromJson(line, &error).object();
+        if (error.error != QJsonParseError::NoError) {
+            pCore->displayMessage(i18n("Communication error with render job"), ErrorMessage);
+            qWarning() << "RenderServer recieve error: " << error.errorString() << line;
+            continue;
         }
+        handleJson(json, socket);
+    }
+}
+
+void RenderServer::jobDisconnected()
+{
+    auto *socket = qobject_cast<QLocalSocket *>(sender());
+    if (socket == nullptr) {
+        return;
+    }
+    // The last messages of the job, like its end, may not have been read yet
+    readMessages(socket);
+    m_pending.remove(socket);
+    const QStringList urls = m_jobSocket.keys(socket);
+    for (const QString &url : urls) {
+        // The job exited without reporting its end
+        m_jobSocket.remove(url);
+        Q_EMIT setRenderingFinished(url, -2, i18n("Lost communication with render job"));
     }
+    socket->deleteLater();
 }
 
 void RenderServer::handleJson(const QJsonObject &json, QLocalSocket *socket)
@@ -80,9 +111,10 @@ void RenderServer::handleJson(const QJsonObject &json, QLocalSocket *socket)
 
 void RenderServer::abortJob(const QString &job)
 {
-    if (m_jobSocket.contains(job)) {
-        m_jobSocket[job]->write("abort");
-        m_jobSocket[job]->flush();
+    QLocalSocket *socket = m_jobSocket.value(job);
+    if (socket != nullptr && socket->state() == QLocalSocket::ConnectedState) {
+        socket->write("abort");
+        socket->flush();
     } else {
         pCore->displayMessage(i18n("Can't open communication with render job %1", job), ErrorMessage);
     }
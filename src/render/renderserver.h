@@ -29,8 +29,14 @@ private Q_SLOTS:
     void jobConnected();
     void handleJson(const QJsonObject &json, QLocalSocket *socket);
     void jobSent();
+    /** @brief A render job closed its connection, report the jobs that did not finish. */
+    void jobDisconnected();
 
 private:
+    /** @brief Parse the complete messages received from a job, one json object per line. */
+    void readMessages(QLocalSocket *socket);
     QLocalServer m_server;
     QHash<QString, QLocalSocket*> m_jobSocket;
+    /** @brief Data received from each job that does not form a complete message yet */
+    QHash<QLocalSocket *, QByteArray> m_pending;
 };
@@ -26,7 +26,7 @@ AbstractGfxScopeWidget::~AbstractGfxScopeWidget() = default;
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
     QMutexLocker lock(&m_mutex);
-    return renderGfxScope(accelerationFactor, m_scopeImage);
+    return renderGfxScope(accelerationFactor, m_scopeFrame);
 }
 
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -37,10 +37,10 @@ void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 
 ///// Slots /////
 
-void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const ScopeFrame &frame)
 {
     QMutexLocker lock(&m_mutex);
-    m_scopeImage = frame;
+    m_scopeFrame = frame;
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
@@ -4,7 +4,7 @@
  * See http://www.poynton.com/ColorFAQ.html for details.
  */
 enum class ITURec {
-    Rec_601, Rec_709
+    Rec_601, Rec_709, Rec_2020
 };
 
 // CIE 601 luminance factors
@@ -16,3 +16,8 @@ constexpr float REC_601_B = .114f;
 constexpr float REC_709_R = .2125f;
 constexpr float REC_709_G = .7154f;
 constexpr float REC_709_B = .0721f;
+
+// CIE 2020 luminance factors
+constexpr float REC_2020_R = .2627f;
+constexpr float REC_2020_G = .6780f;
+constexpr float REC_2020_B = .0593f;
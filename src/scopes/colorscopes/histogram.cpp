@@ -128,7 +128,7 @@ QImage Histogram::renderHUD(uint)
     Q_EMIT signalHUDRenderingFinished(0, 1);
     return QImage();
 }
-QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+QImage Histogram::renderGfxScope(uint accelFactor, const ScopeFrame &frame)
 {
     QElapsedTimer timer;
     timer.start();
@@ -139,7 +139,7 @@ QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
 
     ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
 
-    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), qimage, componentFlags, rec, m_aUnscaled->isChecked(),
+    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), frame, componentFlags, rec, m_aUnscaled->isChecked(),
                                                                 m_ui->rbLogarithmic->isChecked(), accelFactor);
 
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelFactor);
@@ -6,6 +6,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "histogramgenerator.h"
+#include "scopeframe.h"
+#include "scopekernels.h"
 
 #include "klocalizedstring.h"
 #include <QDebug>
@@ -13,13 +15,20 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QPainter>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 HistogramGenerator::HistogramGenerator() = default;
 
 QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, ITURec rec, bool unscaled, bool logScale,
                                               uint accelFactor) const
 {
-    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    return calculateHistogram(paradeSize, ScopeFrame(image), components, rec, unscaled, logScale, accelFactor);
+}
+
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const ScopeFrame &frame, const int &components, ITURec rec, bool unscaled,
+                                              bool logScale, uint accelFactor) const
+{
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || frame.width() <= 0 || frame.height() <= 0) {
         return QImage();
     }
 
@@ -41,32 +50,34 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     const int wh = paradeSize.height();
 
     // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == ITURec::Rec_601) {
-                    y[int(REC_601_R * qRed(col) + REC_601_G * qGreen(col) + REC_601_B * qBlue(col))]++;
-                } else {
-                    y[int(REC_709_R * qRed(col) + REC_709_G * qGreen(col) + REC_709_B * qBlue(col))]++;
-                }
-            }
+    const int step = int(qMax(1u, accelFactor));
+    const int count = ScopeKernels::sampleCount(0, frame.width(), step);
+    const bool drawRGB = drawR || drawG || drawB || drawSum;
+    std::vector<QRgb> pixels(drawRGB ? size_t(count) : 0);
+    std::vector<float> lumas(drawY ? size_t(count) : 0);
+    for (int Y = 0; Y < frame.height(); ++Y) {
+        if (drawRGB) {
+            // Skip the RGB values if only Y is enabled, YUV frames then do not need any conversion
+            frame.rgb(Y, 0, count, step, pixels.data());
+            ScopeKernels::histogramRGB(pixels.data(), count, 1, r, g, b);
+        }
 
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
+        if (drawY) {
+            // Skip the luma computation if Y disabled
+            frame.luma(Y, 0, count, step, rec, lumas.data());
+            for (float luma : lumas) {
+                y[int(luma)]++;
             }
         }
     }
 
+    if (drawSum) {
+        // Every sample adds its red, green and blue values to the sum
+        for (int i = 0; i < 256; ++i) {
+            s[i] = r[i] + g[i] + b[i];
+        }
+    }
+
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
         // Nothing to draw
@@ -79,8 +90,8 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     // Height of a single histogram box without text
     const int partH = (wh - nParts * d) / nParts;
 
-    // Total number of bytes of the image
-    const int byteCount = int(image.sizeInBytes());
+    // Total number of bytes of the image, as a 32 bits image
+    const int byteCount = 4 * frame.width() * frame.height();
 
     // Factor for scaling the measured value to the histogram.
     // This factor is used for linear scaling and does not depend
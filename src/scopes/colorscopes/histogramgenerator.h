@@ -15,6 +15,7 @@ class QImage;
 class QPainter;
 class QRect;
 class QSize;
+class ScopeFrame;
 
 class HistogramGenerator : public QObject
 {
@@ -36,6 +37,9 @@ public:
     QImage calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, const ITURec rec, bool unscaled,
                               bool logScale,
                               uint accelFactor = 1) const;
+    /** @brief Calculates a histogram display from a frame. The luma of YUV frames is read from their samples, ignoring @param rec */
+    QImage calculateHistogram(const QSize &paradeSize, const ScopeFrame &frame, const int &components, const ITURec rec, bool unscaled, bool logScale,
+                              uint accelFactor = 1) const;
 
     /**
      * Draws the histogram of a single component.
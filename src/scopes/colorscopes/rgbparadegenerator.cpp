@@ -7,9 +7,13 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "rgbparadegenerator.h"
 #include "klocalizedstring.h"
+#include "scopeframe.h"
+#include "scopekernels.h"
 #include <QColor>
 #include <QDebug>
 #include <QPainter>
+#include <algorithm>
+#include <vector>
 
 #define CHOP255(a) ((255) < (a) ? (255) : int(a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -21,21 +25,20 @@ const QColor RGBParadeGenerator::colSoft(150, 150, 150, 255);
 const uchar RGBParadeGenerator::distRight(40);
 const uchar RGBParadeGenerator::distBottom(40);
 
-struct StructRGB
-{
-    uint r;
-    uint g;
-    uint b;
-};
-
 RGBParadeGenerator::RGBParadeGenerator() = default;
 
 QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
                                               bool drawGradientRef, uint accelFactor)
+{
+    return calculateRGBParade(paradeSize, ScopeFrame(image), paintMode, drawAxis, drawGradientRef, accelFactor);
+}
+
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const ScopeFrame &frame, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
+                                              bool drawGradientRef, uint accelFactor)
 {
     Q_ASSERT(accelFactor >= 1);
 
-    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0) {
         return QImage();
     }
     QImage parade(paradeSize, QImage::Format_ARGB32);
@@ -50,8 +53,8 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const uint ww = uint(paradeSize.width());
     const uint wh = uint(paradeSize.height());
-    const uint iw = uint(image.width());
-    const uint ih = uint(image.height());
+    const uint iw = uint(frame.width());
+    const uint ih = uint(frame.height());
 
     const uchar offset = 10;
     const uint partW = (ww - 2 * offset - distRight) / 3;
@@ -71,63 +74,61 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const float wPrediv = float(partW - 1) / (iw - 1);
 
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const auto x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-        auto r = uchar(qRed(pixel));
-        auto g = uchar(qGreen(pixel));
-        auto b = uchar(qBlue(pixel));
-
-        double dx = x * double(wPrediv);
-
-        paradeVals[size_t(dx)][r].r++;
-        paradeVals[size_t(dx)][g].g++;
-        paradeVals[size_t(dx)][b].b++;
-
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
-        }
-        if (g > maxG) {
-            maxG = g;
-        }
-        if (b > maxB) {
-            maxB = b;
+    // Bins of the red, green and blue parts one after the other, each one value by value
+    const size_t partBins = size_t(partW) * 256;
+    std::vector<uint> paradeVals(3 * partBins, 0);
+    uint *redVals = paradeVals.data();
+    uint *greenVals = redVals + partBins;
+    uint *blueVals = greenVals + partBins;
+
+    // Every accelFactor-th pixel of the image is sampled, following the scanlines
+    const int step = int(accelFactor);
+    std::vector<QRgb> pixels(iw);
+    for (int y = 0; y < int(ih); ++y) {
+        const int start = ScopeKernels::firstSample(y, int(iw), step);
+        const int count = ScopeKernels::sampleCount(start, int(iw), step);
+        frame.rgb(y, start, count, step, pixels.data());
+        for (int k = 0; k < count; ++k) {
+            const QRgb pixel = pixels[size_t(k)];
+            const int x = start + k * step;
+            auto r = uchar(qRed(pixel));
+            auto g = uchar(qGreen(pixel));
+            auto b = uchar(qBlue(pixel));
+
+            const auto column = size_t(x * double(wPrediv));
+            redVals[r * partW + column]++;
+            greenVals[g * partW + column]++;
+            blueVals[b * partW + column]++;
+
+            minR = qMin(minR, r);
+            minG = qMin(minG, g);
+            minB = qMin(minB, b);
+            maxR = qMax(maxR, r);
+            maxG = qMax(maxG, g);
+            maxB = qMax(maxB, b);
         }
     }
 
     const int offset1 = int(partW + offset);
     const int offset2 = int(2 * partW + 2 * offset);
-    switch (paintMode) {
-    case PaintMode_RGB:
-        for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
-        }
-        break;
-    default:
-        for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
+    const uint maxCount = *std::max_element(paradeVals.cbegin(), paradeVals.cend());
+    const auto alpha = [gain](uint value) { return qRgba(0, 0, 0, CHOP255(gain * float(value))); };
+    const std::vector<QRgb> alphas = ScopeKernels::countColors(qMin(maxCount + 1, uint(partBins)), alpha);
+    const QRgb redColor = paintMode == PaintMode_RGB ? qRgb(255, 10, 10) : qRgb(255, 255, 255);
+    const QRgb greenColor = paintMode == PaintMode_RGB ? qRgb(10, 255, 10) : qRgb(255, 255, 255);
+    const QRgb blueColor = paintMode == PaintMode_RGB ? qRgb(10, 10, 255) : qRgb(255, 255, 255);
+    std::vector<QRgb> lineAlphas(partW);
+    auto paintPart = [&](const uint *vals, QRgb color, QRgb *out) {
+        ScopeKernels::renderCounts(vals, int(partW), alphas, alpha, lineAlphas.data());
+        for (uint i = 0; i < partW; ++i) {
+            out[i] = (color & 0xffffff) | (lineAlphas[i] & 0xff000000);
         }
-        break;
+    };
+    for (int j = 0; j < 256; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(unscaled.scanLine(j));
+        paintPart(redVals + size_t(j) * partW, redColor, line);
+        paintPart(greenVals + size_t(j) * partW, greenColor, line + offset1);
+        paintPart(blueVals + size_t(j) * partW, blueColor, line + offset2);
     }
 
     // Scale the image to the target height. Scaling is not accomplished before because
@@ -139,9 +140,10 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
         QRgb opx;
         for (int i = 0; i <= 10; ++i) {
             int dy = i * int(partH - 1) / 10;
+            auto *line = reinterpret_cast<QRgb *>(parade.scanLine(dy));
             for (int x = 0; x < int(ww - distRight); ++x) {
-                opx = parade.pixel(x, dy);
-                parade.setPixel(x, dy, qRgba(CHOP255(150 + qRed(opx)), 255, CHOP255(200 + qBlue(opx)), CHOP255(32 + qAlpha(opx))));
+                opx = line[x];
+                line[x] = qRgba(CHOP255(150 + qRed(opx)), 255, CHOP255(200 + qBlue(opx)), CHOP255(32 + qAlpha(opx)));
             }
         }
     }
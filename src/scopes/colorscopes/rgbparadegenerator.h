@@ -12,6 +12,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 class QColor;
 class QImage;
 class QSize;
+class ScopeFrame;
 class RGBParadeGenerator : public QObject
 {
     Q_OBJECT
@@ -21,6 +22,8 @@ public:
     RGBParadeGenerator();
     QImage calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef,
                               uint accelFactor = 1);
+    QImage calculateRGBParade(const QSize &paradeSize, const ScopeFrame &frame, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
+                              bool drawGradientRef, uint accelFactor = 1);
 
     static const QColor colHighlight;
     static const QColor colLight;
@@ -0,0 +1,190 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopeframe.h"
+#include "scopekernels.h"
+
+namespace {
+/** @brief Matrix converting y on [0,1] and pb, pr on [-0.5,0.5] to RGB on [0,255] */
+struct YuvMatrix
+{
+    double m[3][3];
+};
+
+YuvMatrix yuvToRgb(ITURec rec)
+{
+    double kr = .2126;
+    double kb = .0722;
+    if (rec == ITURec::Rec_601) {
+        kr = .299;
+        kb = .114;
+    } else if (rec == ITURec::Rec_2020) {
+        kr = .2627;
+        kb = .0593;
+    }
+    const double kg = 1. - kr - kb;
+    return {{{255., 0., 255. * 2 * (1 - kr)},
+             {255., -255. * 2 * kb * (1 - kb) / kg, -255. * 2 * kr * (1 - kr) / kg},
+             {255., 255. * 2 * (1 - kb), 0.}}};
+}
+
+int clampColor(double value)
+{
+    return int(qBound(0., value, 255.) + .5);
+}
+} // namespace
+
+ScopeFrame::ScopeFrame(const QImage &image)
+    : m_image(ScopeKernels::scanlineImage(image))
+{
+}
+
+ScopeFrame::ScopeFrame(const SharedFrame &frame)
+    : m_frame(frame)
+{
+    if (!frame.is_valid()) {
+        return;
+    }
+    // Use the image of the frame if it is already YUV, otherwise the planar image that the monitor uploads to its textures
+    m_planar = frame.get_image_format() != mlt_image_yuv422;
+    m_yuv = frame.get_image(m_planar ? mlt_image_yuv420p : mlt_image_yuv422);
+    if (m_yuv == nullptr) {
+        return;
+    }
+    m_width = frame.get_image_width();
+    m_height = frame.get_image_height();
+    switch (frame.get_int("colorspace")) {
+    case 2020:
+        m_colorspace = ITURec::Rec_2020;
+        break;
+    case 709:
+        m_colorspace = ITURec::Rec_709;
+        break;
+    case 0:
+        // Same default as MLT
+        m_colorspace = m_height < 720 ? ITURec::Rec_601 : ITURec::Rec_709;
+        break;
+    default:
+        m_colorspace = ITURec::Rec_601;
+        break;
+    }
+    m_fullRange = frame.get_int("full_range") != 0;
+}
+
+bool ScopeFrame::isNull() const
+{
+    return m_yuv == nullptr && m_image.isNull();
+}
+
+bool ScopeFrame::isYuv() const
+{
+    return m_yuv != nullptr;
+}
+
+int ScopeFrame::width() const
+{
+    return isYuv() ? m_width : m_image.width();
+}
+
+int ScopeFrame::height() const
+{
+    return isYuv() ? m_height : m_image.height();
+}
+
+ITURec ScopeFrame::colorspace() const
+{
+    return m_colorspace;
+}
+
+bool ScopeFrame::fullRange() const
+{
+    return m_fullRange;
+}
+
+void ScopeFrame::yuvSample(int row, int x, int &y, int &u, int &v) const
+{
+    if (m_planar) {
+        const qint64 lumaSize = qint64(m_width) * m_height;
+        const qint64 chromaOffset = qint64(row / 2) * (m_width / 2) + x / 2;
+        y = m_yuv[qint64(row) * m_width + x];
+        u = m_yuv[lumaSize + chromaOffset];
+        v = m_yuv[lumaSize + qint64(m_width / 2) * (m_height / 2) + chromaOffset];
+    } else {
+        // Y0 U Y1 V
+        const uint8_t *line = m_yuv + qint64(row) * m_width * 2;
+        y = line[2 * x];
+        u = line[4 * (x / 2) + 1];
+        v = line[4 * (x / 2) + 3];
+    }
+}
+
+void ScopeFrame::luma(int row, int start, int count, int step, ITURec rec, float *out) const
+{
+    if (!isYuv()) {
+        ScopeKernels::luma(reinterpret_cast<const QRgb *>(m_image.constScanLine(row)) + start, count, step, rec, out);
+        return;
+    }
+    // The Y samples already are the luma of the frame
+    const uint8_t *line = m_yuv + qint64(row) * m_width * (m_planar ? 1 : 2);
+    const int stride = m_planar ? step : 2 * step;
+    line += start * (m_planar ? 1 : 2);
+    const float offset = m_fullRange ? 0.f : 16.f;
+    const float scale = m_fullRange ? 1.f : 255.f / 219.f;
+    for (int k = 0; k < count; ++k) {
+        // Values outside of the video range are clipped, like for RGB frames
+        out[k] = qBound(0.f, (float(line[k * stride]) - offset) * scale, 255.f);
+    }
+}
+
+void ScopeFrame::chroma(int row, int start, int count, int step, const double coefficients[6], double *u, double *v) const
+{
+    if (!isYuv()) {
+        ScopeKernels::chroma(reinterpret_cast<const QRgb *>(m_image.constScanLine(row)) + start, count, step, coefficients, u, v);
+        return;
+    }
+    // Apply the coefficients to the YUV to RGB matrix, so that the chroma is computed from the samples without clipping them to RGB
+    const YuvMatrix matrix = yuvToRgb(m_colorspace);
+    double cu[3], cv[3];
+    for (int i = 0; i < 3; ++i) {
+        cu[i] = coefficients[0] * matrix.m[0][i] + coefficients[1] * matrix.m[1][i] + coefficients[2] * matrix.m[2][i];
+        cv[i] = coefficients[3] * matrix.m[0][i] + coefficients[4] * matrix.m[1][i] + coefficients[5] * matrix.m[2][i];
+    }
+    const double yOffset = m_fullRange ? 0. : 16.;
+    const double yRange = m_fullRange ? 255. : 219.;
+    const double cRange = m_fullRange ? 255. : 224.;
+    int sy, su, sv;
+    for (int k = 0; k < count; ++k) {
+        yuvSample(row, start + k * step, sy, su, sv);
+        const double y = (sy - yOffset) / yRange;
+        const double pb = (su - 128) / cRange;
+        const double pr = (sv - 128) / cRange;
+        u[k] = cu[0] * y + cu[1] * pb + cu[2] * pr;
+        v[k] = cv[0] * y + cv[1] * pb + cv[2] * pr;
+    }
+}
+
+void ScopeFrame::rgb(int row, int start, int count, int step, QRgb *out) const
+{
+    if (!isYuv()) {
+        const auto *line = reinterpret_cast<const QRgb *>(m_image.constScanLine(row)) + start;
+        for (int k = 0; k < count; ++k) {
+            out[k] = line[k * step];
+        }
+        return;
+    }
+    const YuvMatrix matrix = yuvToRgb(m_colorspace);
+    const double yOffset = m_fullRange ? 0. : 16.;
+    const double yRange = m_fullRange ? 255. : 219.;
+    const double cRange = m_fullRange ? 255. : 224.;
+    int sy, su, sv;
+    for (int k = 0; k < count; ++k) {
+        yuvSample(row, start + k * step, sy, su, sv);
+        const double y = (sy - yOffset) / yRange;
+        const double pb = (su - 128) / cRange;
+        const double pr = (sv - 128) / cRange;
+        out[k] = qRgb(clampColor(matrix.m[0][0] * y + matrix.m[0][2] * pr), clampColor(matrix.m[1][0] * y + matrix.m[1][1] * pb + matrix.m[1][2] * pr),
+                      clampColor(matrix.m[2][0] * y + matrix.m[2][1] * pb));
+    }
+}
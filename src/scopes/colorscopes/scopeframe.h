@@ -0,0 +1,61 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+#include "monitor/scopes/sharedframe.h"
+
+#include <QImage>
+#include <QRgb>
+
+/** @class ScopeFrame
+    @brief A frame analysed by the color scopes, either an RGB image or the YUV image of a monitor frame.
+    YUV frames are read in place from the SharedFrame displayed by the monitor, without rendering them to RGB first.
+    Luma and chroma come straight from the Y, U and V samples, and RGB values are only computed for the sampled pixels
+    of the scopes that need them, using the matrix (Rec. 601, 709 or 2020) and the range of the frame.
+ */
+class ScopeFrame
+{
+public:
+    ScopeFrame() = default;
+    explicit ScopeFrame(const QImage &image);
+    explicit ScopeFrame(const SharedFrame &frame);
+
+    bool isNull() const;
+    /** @brief True if the frame is read from YUV samples */
+    bool isYuv() const;
+    int width() const;
+    int height() const;
+    /** @brief The matrix used to encode the YUV samples */
+    ITURec colorspace() const;
+    /** @brief True if the YUV samples use the full [0,255] range instead of the video range */
+    bool fullRange() const;
+
+    /** @brief Compute the luma on [0,255] of @param count pixels of a row, from @param start and taking one pixel out of @param step
+        @param rec the luma coefficients for RGB images, YUV frames use their own luma
+     */
+    void luma(int row, int start, int count, int step, ITURec rec, float *out) const;
+    /** @brief Compute the chroma of @param count pixels of a row, as the @param coefficients would give from RGB values on [0,255]
+        @see ScopeKernels::chroma
+     */
+    void chroma(int row, int start, int count, int step, const double coefficients[6], double *u, double *v) const;
+    /** @brief Copy the RGB values of @param count pixels of a row to @param out */
+    void rgb(int row, int start, int count, int step, QRgb *out) const;
+
+private:
+    /** @brief Y, U and V samples of the pixel x of a row */
+    void yuvSample(int row, int x, int &y, int &u, int &v) const;
+
+    QImage m_image;
+    SharedFrame m_frame;
+    /** @brief The YUV image of m_frame, planar 4:2:0 or packed 4:2:2 */
+    const uint8_t *m_yuv{nullptr};
+    bool m_planar{false};
+    int m_width{0};
+    int m_height{0};
+    ITURec m_colorspace{ITURec::Rec_709};
+    bool m_fullRange{false};
+};
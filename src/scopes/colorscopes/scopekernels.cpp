@@ -0,0 +1,247 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopekernels.h"
+
+#include <atomic>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SCOPEKERNELS_DISPATCH
+#include <immintrin.h>
+// The scalar kernel bodies are inlined in the vector functions for the remaining pixels
+#define KERNEL_INLINE __attribute__((always_inline)) inline
+#else
+#define KERNEL_INLINE inline
+#endif
+
+namespace {
+
+KERNEL_INLINE void lumaKernel(const QRgb *pixels, int count, int step, float fr, float fg, float fb, float *out)
+{
+    for (int i = 0; i < count; ++i) {
+        const QRgb pixel = pixels[i * step];
+        out[i] = fr * float(qRed(pixel)) + fg * float(qGreen(pixel)) + fb * float(qBlue(pixel));
+    }
+}
+
+KERNEL_INLINE void chromaKernel(const QRgb *pixels, int count, int step, const double *c, double *u, double *v)
+{
+    for (int i = 0; i < count; ++i) {
+        const QRgb pixel = pixels[i * step];
+        const double r = qRed(pixel);
+        const double g = qGreen(pixel);
+        const double b = qBlue(pixel);
+        u[i] = c[0] * r + c[1] * g + c[2] * b;
+        v[i] = c[3] * r + c[4] * g + c[5] * b;
+    }
+}
+
+void lumaScalar(const QRgb *pixels, int count, int step, float fr, float fg, float fb, float *out)
+{
+    lumaKernel(pixels, count, step, fr, fg, fb, out);
+}
+
+void chromaScalar(const QRgb *pixels, int count, int step, const double *c, double *u, double *v)
+{
+    chromaKernel(pixels, count, step, c, u, v);
+}
+
+#ifdef SCOPEKERNELS_DISPATCH
+// The vector kernels read 4 (SSE4.1) or 8 (AVX2) contiguous pixels at once and run the operations of the scalar kernel lane by lane,
+// without fused multiply-add, so their results are bit-exact with it. Sampled rows are gathered on AVX2 and use the scalar kernel on SSE4.1.
+
+__attribute__((target("sse4.1"))) void lumaSse4(const QRgb *pixels, int count, int step, float fr, float fg, float fb, float *out)
+{
+    if (step != 1) {
+        lumaKernel(pixels, count, step, fr, fg, fb, out);
+        return;
+    }
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128 vr = _mm_set1_ps(fr);
+    const __m128 vg = _mm_set1_ps(fg);
+    const __m128 vb = _mm_set1_ps(fb);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128 r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), mask));
+        const __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8), mask));
+        const __m128 b = _mm_cvtepi32_ps(_mm_and_si128(px, mask));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, r), _mm_mul_ps(vg, g)), _mm_mul_ps(vb, b)));
+    }
+    lumaKernel(pixels + i, count - i, 1, fr, fg, fb, out + i);
+}
+
+__attribute__((target("avx2"))) void lumaAvx2(const QRgb *pixels, int count, int step, float fr, float fg, float fb, float *out)
+{
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step));
+    const __m256 vr = _mm256_set1_ps(fr);
+    const __m256 vg = _mm256_set1_ps(fg);
+    const __m256 vb = _mm256_set1_ps(fb);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i px = step == 1 ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pixels + i))
+                                     : _mm256_i32gather_epi32(reinterpret_cast<const int *>(pixels + i * step), offsets, 4);
+        const __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 16), mask));
+        const __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8), mask));
+        const __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(px, mask));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vr, r), _mm256_mul_ps(vg, g)), _mm256_mul_ps(vb, b)));
+    }
+    lumaKernel(pixels + i * step, count - i, step, fr, fg, fb, out + i);
+}
+
+__attribute__((target("sse4.1"))) void chromaSse4(const QRgb *pixels, int count, int step, const double *c, double *u, double *v)
+{
+    if (step != 1) {
+        chromaKernel(pixels, count, step, c, u, v);
+        return;
+    }
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128d c0 = _mm_set1_pd(c[0]), c1 = _mm_set1_pd(c[1]), c2 = _mm_set1_pd(c[2]);
+    const __m128d c3 = _mm_set1_pd(c[3]), c4 = _mm_set1_pd(c[4]), c5 = _mm_set1_pd(c[5]);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128i ri = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+        const __m128i gi = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+        const __m128i bi = _mm_and_si128(px, mask);
+        // Two pixels per double vector: the low half, then the high half of the channels
+        for (int half = 0; half < 2; ++half) {
+            const __m128d r = _mm_cvtepi32_pd(half == 0 ? ri : _mm_unpackhi_epi64(ri, ri));
+            const __m128d g = _mm_cvtepi32_pd(half == 0 ? gi : _mm_unpackhi_epi64(gi, gi));
+            const __m128d b = _mm_cvtepi32_pd(half == 0 ? bi : _mm_unpackhi_epi64(bi, bi));
+            _mm_storeu_pd(u + i + 2 * half, _mm_add_pd(_mm_add_pd(_mm_mul_pd(c0, r), _mm_mul_pd(c1, g)), _mm_mul_pd(c2, b)));
+            _mm_storeu_pd(v + i + 2 * half, _mm_add_pd(_mm_add_pd(_mm_mul_pd(c3, r), _mm_mul_pd(c4, g)), _mm_mul_pd(c5, b)));
+        }
+    }
+    chromaKernel(pixels + i, count - i, 1, c, u + i, v + i);
+}
+
+__attribute__((target("avx2"))) void chromaAvx2(const QRgb *pixels, int count, int step, const double *c, double *u, double *v)
+{
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(step));
+    const __m256d c0 = _mm256_set1_pd(c[0]), c1 = _mm256_set1_pd(c[1]), c2 = _mm256_set1_pd(c[2]);
+    const __m256d c3 = _mm256_set1_pd(c[3]), c4 = _mm256_set1_pd(c[4]), c5 = _mm256_set1_pd(c[5]);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i px = step == 1 ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i))
+                                     : _mm_i32gather_epi32(reinterpret_cast<const int *>(pixels + i * step), offsets, 4);
+        const __m256d r = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 16), mask));
+        const __m256d g = _mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 8), mask));
+        const __m256d b = _mm256_cvtepi32_pd(_mm_and_si128(px, mask));
+        _mm256_storeu_pd(u + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c0, r), _mm256_mul_pd(c1, g)), _mm256_mul_pd(c2, b)));
+        _mm256_storeu_pd(v + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c3, r), _mm256_mul_pd(c4, g)), _mm256_mul_pd(c5, b)));
+    }
+    chromaKernel(pixels + i * step, count - i, step, c, u + i, v + i);
+}
+#endif
+
+ScopeKernels::SimdLevel detectSimdLevel()
+{
+#ifdef SCOPEKERNELS_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ScopeKernels::SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return ScopeKernels::SimdLevel::SSE4;
+    }
+#endif
+    return ScopeKernels::SimdLevel::Scalar;
+}
+
+std::atomic<ScopeKernels::SimdLevel> &currentLevel()
+{
+    static std::atomic<ScopeKernels::SimdLevel> level(ScopeKernels::supportedSimdLevel());
+    return level;
+}
+} // namespace
+
+ScopeKernels::SimdLevel ScopeKernels::supportedSimdLevel()
+{
+    static const SimdLevel supported = detectSimdLevel();
+    return supported;
+}
+
+ScopeKernels::SimdLevel ScopeKernels::simdLevel()
+{
+    return currentLevel();
+}
+
+void ScopeKernels::setSimdLevel(SimdLevel level)
+{
+    currentLevel() = qMin(level, supportedSimdLevel());
+}
+
+QImage ScopeKernels::scanlineImage(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+    default:
+        // Same conversion as QImage::pixel
+        return image.convertToFormat(QImage::Format_ARGB32);
+    }
+}
+
+void ScopeKernels::luma(const QRgb *pixels, int count, int step, ITURec rec, float *out)
+{
+    float fr = REC_709_R, fg = REC_709_G, fb = REC_709_B;
+    if (rec == ITURec::Rec_601) {
+        fr = REC_601_R;
+        fg = REC_601_G;
+        fb = REC_601_B;
+    } else if (rec == ITURec::Rec_2020) {
+        fr = REC_2020_R;
+        fg = REC_2020_G;
+        fb = REC_2020_B;
+    }
+    switch (simdLevel()) {
+#ifdef SCOPEKERNELS_DISPATCH
+    case SimdLevel::AVX2:
+        lumaAvx2(pixels, count, step, fr, fg, fb, out);
+        break;
+    case SimdLevel::SSE4:
+        lumaSse4(pixels, count, step, fr, fg, fb, out);
+        break;
+#endif
+    default:
+        lumaScalar(pixels, count, step, fr, fg, fb, out);
+        break;
+    }
+}
+
+void ScopeKernels::chroma(const QRgb *pixels, int count, int step, const double coefficients[6], double *u, double *v)
+{
+    switch (simdLevel()) {
+#ifdef SCOPEKERNELS_DISPATCH
+    case SimdLevel::AVX2:
+        chromaAvx2(pixels, count, step, coefficients, u, v);
+        break;
+    case SimdLevel::SSE4:
+        chromaSse4(pixels, count, step, coefficients, u, v);
+        break;
+#endif
+    default:
+        chromaScalar(pixels, count, step, coefficients, u, v);
+        break;
+    }
+}
+
+void ScopeKernels::histogramRGB(const QRgb *pixels, int count, int step, int *red, int *green, int *blue)
+{
+    // Scattered increments cannot be vectorized, but reading the scanline directly is much faster than QImage::pixel
+    for (int i = 0; i < count; ++i) {
+        const QRgb pixel = pixels[i * step];
+        red[qRed(pixel)]++;
+        green[qGreen(pixel)]++;
+        blue[qBlue(pixel)]++;
+    }
+}
+
+#undef KERNEL_INLINE
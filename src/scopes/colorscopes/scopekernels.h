@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+
+#include <QImage>
+#include <QRgb>
+#include <vector>
+
+/**
+ * Pixel kernels shared by the color scope generators.
+ *
+ * The kernels work on whole scanlines instead of single QImage::pixel calls.
+ * On x86 with GCC or Clang, the luma and chroma kernels have SSE4.1 and AVX2 versions written with intrinsics, and the best version
+ * supported by the CPU is selected at runtime. The SSE4.1 versions only vectorize contiguous pixels (step 1), the AVX2 versions gather
+ * sampled pixels. All versions run the same floating point operations in the same order, so their results are bit-exact with the scalar version.
+ */
+namespace ScopeKernels {
+
+enum class SimdLevel { Scalar, SSE4, AVX2 };
+
+/** @brief The best instruction set supported by this CPU and build */
+SimdLevel supportedSimdLevel();
+/** @brief The instruction set currently used by the kernels */
+SimdLevel simdLevel();
+/** @brief Force the instruction set used by the kernels, for tests and benchmarks. Levels above the supported one are lowered */
+void setSimdLevel(SimdLevel level);
+
+/** @brief Returns the image itself if its scanlines can be read as QRgb, otherwise a converted copy */
+QImage scanlineImage(const QImage &image);
+
+/** @brief Index of the first pixel of a row sampled when taking one pixel out of @param step over the whole image */
+inline int firstSample(int row, int width, int step)
+{
+    const int offset = int((qint64(row) * width) % step);
+    return offset == 0 ? 0 : step - offset;
+}
+
+/** @brief Number of pixels of a row sampled from @param start, taking one pixel out of @param step */
+inline int sampleCount(int start, int width, int step)
+{
+    return start >= width ? 0 : (width - start + step - 1) / step;
+}
+
+/** @brief Compute the luma on [0,255] of @param count pixels, taking one pixel out of @param step */
+void luma(const QRgb *pixels, int count, int step, ITURec rec, float *out);
+
+/** @brief Compute the chroma of @param count pixels, taking one pixel out of @param step.
+    @param coefficients the r, g, b factors of u followed by those of v
+ */
+void chroma(const QRgb *pixels, int count, int step, const double coefficients[6], double *u, double *v);
+
+/** @brief Add the red, green and blue values of @param count pixels, taking one pixel out of @param step, to 256 bins histograms */
+void histogramRGB(const QRgb *pixels, int count, int step, int *red, int *green, int *blue);
+
+/** @brief Build the color of the bin counts below @param size, so that costly (logarithmic) color scales are computed once per distinct count.
+    The size should not exceed the number of bins to paint, since a single bin can hold a very large count.
+ */
+template <typename F> std::vector<QRgb> countColors(uint size, F color)
+{
+    std::vector<QRgb> table(size);
+    for (uint i = 0; i < size; ++i) {
+        table[i] = color(i);
+    }
+    return table;
+}
+
+/** @brief Paint @param count bins through a table built by countColors, computing the counts outside of the table with @param color */
+template <typename F> void renderCounts(const uint *counts, int count, const std::vector<QRgb> &table, F color, QRgb *out)
+{
+    const uint size = uint(table.size());
+    for (int i = 0; i < count; ++i) {
+        out[i] = counts[i] < size ? table[counts[i]] : color(counts[i]);
+    }
+}
+
+} // namespace ScopeKernels
@@ -61,7 +61,10 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopeframe.h"
+#include "scopekernels.h"
 #include <cmath>
+#include <vector>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
@@ -108,7 +111,14 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
                                                   const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
                                                   uint accelFactor) const
 {
-    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    return calculateVectorscope(vectorscopeSize, ScopeFrame(image), gain, paintMode, colorSpace, false, accelFactor);
+}
+
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const ScopeFrame &frame, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
+                                                  uint accelFactor) const
+{
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0) {
         // Invalid size
         return QImage();
     }
@@ -124,137 +134,141 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QPoint pt;
     QRgb px;
 
-    // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
-    // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
-    double avgPxPerPx = double(image.depth()) / 8 * (image.bytesPerLine() * image.height()) / scope.size().width() / scope.size().height() / accelFactor;
+    // Just an average for the number of image pixels per scope pixel, computed as for a 32 bits image
+    double avgPxPerPx = 4. * (4. * frame.width() * frame.height()) / scope.size().width() / scope.size().height() / accelFactor;
 
     // benchmarking code
     // const auto start = std::chrono::high_resolution_clock::now();
 
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const QRgb pixel = image.pixel(i % image.width(), i / image.width());
-        const int r = qRed(pixel);
-        const int g = qGreen(pixel);
-        const int b = qBlue(pixel);
-
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
-            v = 0.002411 * r - 0.002019 * g - 0.0003921 * b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
-            v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
-            break;
+    // Factors of the u and v components, y would be 0.001173 * r + 0.002302 * g + 0.0004471 * b
+    static const double yuvFactors[6] = {-0.0005781, -0.001135, 0.001713, 0.002411, -0.002019, -0.0003921};
+    static const double ypbprFactors[6] = {-0.0006671, -0.001299, 0.0019608, 0.001961, -0.001642, -0.0003189};
+    const double *factors = colorSpace == VectorscopeGenerator::ColorSpace_YUV ? yuvFactors : ypbprFactors;
+
+    // Every accelFactor-th pixel of the image is sampled, following the scanlines
+    const bool original = paintMode == PaintMode_Original;
+    const int step = int(accelFactor);
+    auto *scopeBits = reinterpret_cast<QRgb *>(scope.bits());
+    const int scopeStride = scope.bytesPerLine() / int(sizeof(QRgb));
+    std::vector<double> us(size_t(frame.width()));
+    std::vector<double> vs(size_t(frame.width()));
+    // The RGB values are only needed to paint the original colors
+    std::vector<QRgb> pixels(original ? size_t(frame.width()) : 0);
+    for (int row = 0; row < frame.height(); ++row) {
+        const int start = ScopeKernels::firstSample(row, frame.width(), step);
+        const int count = ScopeKernels::sampleCount(start, frame.width(), step);
+        frame.chroma(row, start, count, step, factors, us.data(), vs.data());
+        if (original) {
+            frame.rgb(row, start, count, step, pixels.data());
         }
+        for (int k = 0; k < count; ++k) {
+            u = us[size_t(k)];
+            v = vs[size_t(k)];
+
+            pt = mapToCircle(vectorscopeSize, QPointF(SCALING * double(gain) * u, SCALING * double(gain) * v));
+
+            if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
+                // Point lies outside (because of scaling), don't plot it
+
+            } else {
+                QRgb &target = scopeBits[pt.y() * scopeStride + pt.x()];
+
+                // Draw the pixel using the chosen draw mode.
+                switch (paintMode) {
+                case PaintMode_YUV:
+                    // see yuvColorWheel
+                    dy = 128; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+
+                    if (dr < 0) {
+                        dr = 0;
+                    }
+                    if (dg < 0) {
+                        dg = 0;
+                    }
+                    if (db < 0) {
+                        db = 0;
+                    }
+                    if (dr > 255) {
+                        dr = 255;
+                    }
+                    if (dg > 255) {
+                        dg = 255;
+                    }
+                    if (db > 255) {
+                        db = 255;
+                    }
+
+                    target = qRgba(int(dr), int(dg), int(db), 255);
+                    break;
 
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * double(gain) * u, SCALING * double(gain) * v));
-
-        if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
-            // Point lies outside (because of scaling), don't plot it
-
-        } else {
-
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
+                case PaintMode_Chroma:
+                    dy = 200; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+
+                    // Scale the RGB values back to max 255
+                    dmax = dr;
+                    if (dg > dmax) {
+                        dmax = dg;
+                    }
+                    if (db > dmax) {
+                        dmax = db;
+                    }
+                    dmax = 255 / dmax;
+
+                    dr *= dmax;
+                    dg *= dmax;
+                    db *= dmax;
+
+                    target = qRgba(int(dr), int(dg), int(db), 255);
                     break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
+                case PaintMode_Original:
+                    target = pixels[size_t(k)];
                     break;
-                }
-
-                if (dr < 0) {
-                    dr = 0;
-                }
-                if (dg < 0) {
-                    dg = 0;
-                }
-                if (db < 0) {
-                    db = 0;
-                }
-                if (dr > 255) {
-                    dr = 255;
-                }
-                if (dg > 255) {
-                    dg = 255;
-                }
-                if (db > 255) {
-                    db = 255;
-                }
-
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
-                break;
-
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
+                case PaintMode_Green:
+                    px = target;
+                    target = qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
+                                   qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx)));
+                    break;
+                case PaintMode_Green2:
+                    px = target;
+                    target = qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255,
+                                   qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))), qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx))));
                     break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
+                case PaintMode_Black:
                 default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
+                    px = target;
+                    target = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
                     break;
                 }
-
-                // Scale the RGB values back to max 255
-                dmax = dr;
-                if (dg > dmax) {
-                    dmax = dg;
-                }
-                if (db > dmax) {
-                    dmax = db;
-                }
-                dmax = 255 / dmax;
-
-                dr *= dmax;
-                dg *= dmax;
-                db *= dmax;
-
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, pixel);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
-                                         qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx))));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255,
-                                         qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))), qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx)))));
-                break;
-            case PaintMode_Black:
-            default:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
-                break;
             }
         }
     }
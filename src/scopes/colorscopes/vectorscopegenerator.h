@@ -14,6 +14,7 @@ class QImage;
 class QPoint;
 class QPointF;
 class QSize;
+class ScopeFrame;
 
 class VectorscopeGenerator : public QObject
 {
@@ -25,6 +26,9 @@ public:
 
     QImage calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain, const VectorscopeGenerator::PaintMode &paintMode,
                                 const VectorscopeGenerator::ColorSpace &colorSpace, bool, uint accelFactor = 1) const;
+    /** @brief Calculates the vectorscope of a frame. The chroma of YUV frames is read from their samples */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, const ScopeFrame &frame, const float &gain, const VectorscopeGenerator::PaintMode &paintMode,
+                                const VectorscopeGenerator::ColorSpace &colorSpace, bool, uint accelFactor = 1) const;
 
     QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
     static const double scaling;
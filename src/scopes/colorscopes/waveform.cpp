@@ -178,14 +178,14 @@ QImage Waveform::renderHUD(uint)
     return hud;
 }
 
-QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+QImage Waveform::renderGfxScope(uint accelFactor, const ScopeFrame &frame)
 {
     QElapsedTimer timer;
     timer.start();
 
     const int paintmode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
     ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
-    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0, m_paddingBottom), qimage,
+    QImage wave = m_waveformGenerator->calculateWaveform(scopeRect().size() - m_textWidth - QSize(0, m_paddingBottom), frame,
                                                          WaveformGenerator::PaintMode(paintmode), true, rec, accelFactor);
 
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), 1);
@@ -49,7 +49,7 @@ private:
     /// Implemented methods ///
     QRect scopeRect() override;
     QImage renderHUD(uint) override;
-    QImage renderGfxScope(uint, const QImage &) override;
+    QImage renderGfxScope(uint, const ScopeFrame &) override;
     QImage renderBackground(uint) override;
     bool isHUDDependingOnInput() const override;
     bool isScopeDependingOnInput() const override;
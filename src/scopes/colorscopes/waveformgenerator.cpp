@@ -6,8 +6,11 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "waveformgenerator.h"
+#include "scopeframe.h"
+#include "scopekernels.h"
 
 #include <cmath>
+#include <functional>
 
 #include <QDebug>
 #include <QElapsedTimer>
@@ -24,6 +27,12 @@ WaveformGenerator::~WaveformGenerator() = default;
 
 QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode, bool drawAxis, ITURec rec,
                                             uint accelFactor)
+{
+    return calculateWaveform(waveformSize, ScopeFrame(image), paintMode, drawAxis, rec, accelFactor);
+}
+
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const ScopeFrame &frame, WaveformGenerator::PaintMode paintMode, bool drawAxis,
+                                            ITURec rec, uint accelFactor)
 {
     Q_ASSERT(accelFactor >= 1);
 
@@ -32,7 +41,7 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
 
     QImage wave(waveformSize, QImage::Format_ARGB32);
 
-    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    if (waveformSize.width() <= 0 || waveformSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0) {
         return QImage();
     }
 
@@ -41,10 +50,11 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
 
     const uint ww = uint(waveformSize.width());
     const uint wh = uint(waveformSize.height());
-    const uint iw = uint(image.width());
-    const auto totalPixels = image.width() * image.height();
+    const uint iw = uint(frame.width());
+    const auto totalPixels = frame.width() * frame.height();
 
-    std::vector<std::vector<uint>> waveValues(size_t(waveformSize.width()), std::vector<uint>(size_t(waveformSize.height()), 0));
+    // Bins of the scope, row by row from the bottom
+    std::vector<uint> waveValues(size_t(ww) * wh, 0);
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
@@ -57,54 +67,44 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
     const float hPrediv = (wh - 1) / 255.f;
     const float wPrediv = (ww - 1) / float(iw - 1);
 
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const int x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-
-        float dY, dx, dy;
-
-        if (rec == ITURec::Rec_601) {
-            // CIE 601 Luminance
-            dY = REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel);
-        } else {
-            // CIE 709 Luminance
-            dY = REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
+    // Every accelFactor-th pixel of the image is sampled, following the scanlines
+    const int step = int(accelFactor);
+    std::vector<float> lumas(size_t(frame.width()));
+    uint maxCount = 0;
+    for (int y = 0; y < frame.height(); ++y) {
+        const int start = ScopeKernels::firstSample(y, frame.width(), step);
+        const int count = ScopeKernels::sampleCount(start, frame.width(), step);
+        // dY is on [0,255]
+        frame.luma(y, start, count, step, rec, lumas.data());
+        for (int k = 0; k < count; ++k) {
+            const float dy = lumas[size_t(k)] * hPrediv;
+            const float dx = (start + k * step) * wPrediv;
+            uint &bin = waveValues[size_t(dy) * ww + size_t(dx)];
+            bin++;
+            maxCount = qMax(maxCount, bin);
         }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = x * wPrediv;
-        waveValues[size_t(dx)][size_t(dy)]++;
     }
 
+    std::function<QRgb(uint)> color;
     switch (paintMode) {
     case PaintMode_Green:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                wave.setPixel(i, waveformSize.height() - j - 1,
-                              qRgba(CHOP255(52 * logf(0.1f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(.25f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(64 * logf(gain * float(waveValues[size_t(i)][size_t(j)])))));
-            }
-        }
+        // Logarithmic scale. Needs fine tuning by hand, but looks great.
+        color = [gain](uint value) {
+            return qRgba(CHOP255(52 * logf(0.1f * gain * float(value))), CHOP255(52 * logf(gain * float(value))), CHOP255(52 * logf(.25f * gain * float(value))),
+                         CHOP255(64 * logf(gain * float(value))));
+        };
         break;
     case PaintMode_Yellow:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * float(waveValues[size_t(i)][size_t(j)]))));
-            }
-        }
+        color = [gain](uint value) { return qRgba(255, 242, 0, CHOP255(gain * float(value))); };
         break;
     default:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2.f * gain * float(waveValues[size_t(i)][size_t(j)]))));
-            }
-        }
+        color = [gain](uint value) { return qRgba(255, 255, 255, CHOP255(2.f * gain * float(value))); };
         break;
     }
+    const std::vector<QRgb> colors = ScopeKernels::countColors(qMin(maxCount + 1, ww * wh), color);
+    for (uint j = 0; j < wh; ++j) {
+        ScopeKernels::renderCounts(waveValues.data() + size_t(j) * ww, int(ww), colors, color, reinterpret_cast<QRgb *>(wave.scanLine(int(wh - j - 1))));
+    }
 
     if (drawAxis) {
         QPainter davinci;
@@ -119,9 +119,10 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
         davinci.setCompositionMode(QPainter::CompositionMode_Overlay);
         for (int i = 0; i <= 10; ++i) {
             int dy = int(i / 10.f * (wh - 1));
+            auto *line = reinterpret_cast<QRgb *>(wave.scanLine(dy));
             for (int x = 0; x < int(ww); ++x) {
-                opx = wave.pixel(x, dy);
-                wave.setPixel(x, dy, qRgba(CHOP255(150 + qRed(opx)), 255, CHOP255(200 + qBlue(opx)), CHOP255(32 + qAlpha(opx))));
+                opx = line[x];
+                line[x] = qRgba(CHOP255(150 + qRed(opx)), 255, CHOP255(200 + qBlue(opx)), CHOP255(32 + qAlpha(opx)));
             }
         }
     }
@@ -12,6 +12,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 class QImage;
 class QSize;
+class ScopeFrame;
 
 class WaveformGenerator : public QObject
 {
@@ -25,4 +26,7 @@ public:
 
     QImage calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode, bool drawAxis,
                              const ITURec rec, uint accelFactor = 1);
+    /** @brief Calculates the waveform of a frame. The luma of YUV frames is read from their samples, ignoring @param rec */
+    QImage calculateWaveform(const QSize &waveformSize, const ScopeFrame &frame, WaveformGenerator::PaintMode paintMode, bool drawAxis, const ITURec rec,
+                             uint accelFactor = 1);
 };
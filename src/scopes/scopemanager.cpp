@@ -11,6 +11,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "audioscopes/spectrogram.h"
 #include "colorscopes/histogram.h"
 #include "colorscopes/rgbparade.h"
+#include "colorscopes/scopeframe.h"
 #include "colorscopes/vectorscope.h"
 #include "colorscopes/waveform.h"
 #include "core.h"
@@ -122,6 +123,16 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
     }
 }
 void ScopeManager::slotDistributeFrame(const QImage &image)
+{
+    distributeFrame(ScopeFrame(image));
+}
+
+void ScopeManager::slotDistributeYuvFrame(const SharedFrame &frame)
+{
+    distributeFrame(ScopeFrame(frame));
+}
+
+void ScopeManager::distributeFrame(const ScopeFrame &frame)
 {
 #ifdef DEBUG_SM
     qCDebug(KDENLIVE_LOG) << "ScopeManager: Starting to distribute frame.";
@@ -129,7 +140,7 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
     for (auto &m_colorScope : m_colorScopes) {
         if (!m_colorScope.scope->visibleRegion().isEmpty()) {
             if (m_colorScope.scope->autoRefreshEnabled()) {
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+                m_colorScope.scope->slotRenderZoneUpdated(frame);
 #ifdef DEBUG_SM
                 qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
 #endif
@@ -137,7 +148,7 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
                 // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
                 // Force the scope to update.
                 m_colorScope.singleFrameRequested = false;
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+                m_colorScope.scope->slotRenderZoneUpdated(frame);
                 m_colorScope.scope->forceUpdateScope();
 #ifdef DEBUG_SM
                 qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << m_colorScopes[i].scope->widgetName();
@@ -202,6 +213,7 @@ void ScopeManager::slotUpdateActiveRenderer()
     // Connect new renderer
     if (m_lastConnectedRenderer != nullptr) {
         connect(m_lastConnectedRenderer, &Monitor::frameUpdated, this, &ScopeManager::slotDistributeFrame, Qt::UniqueConnection);
+        connect(m_lastConnectedRenderer, &Monitor::yuvFrameUpdated, this, &ScopeManager::slotDistributeYuvFrame, Qt::UniqueConnection);
         connect(m_lastConnectedRenderer, &Monitor::audioSamplesSignal, this, &ScopeManager::slotDistributeAudio, Qt::UniqueConnection);
 
 #ifdef DEBUG_SM
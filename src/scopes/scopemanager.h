@@ -15,6 +15,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 class QDockWidget;
 class AbstractMonitor;
 class QSignalMapper;
+class ScopeFrame;
+class SharedFrame;
 
 /** @class ScopeManager
     @brief Manages communication between Scopes and Renderer.
@@ -96,6 +98,9 @@ private:
      */
     template <class T> void createScopeDock(T *scopeWidget, const QString &title, const QString &name);
 
+    /** @brief Send a frame to the visible color scopes */
+    void distributeFrame(const ScopeFrame &frame);
+
 public Q_SLOTS:
     void slotCheckActiveScopes();
 
@@ -125,6 +130,7 @@ private Q_SLOTS:
     void checkActiveColourScopes();
 
     void slotDistributeFrame(const QImage &image);
+    void slotDistributeYuvFrame(const SharedFrame &frame);
     void slotDistributeAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
     /**
       Allows a scope to explicitly request a new frame, even if the scope's autoRefresh is disabled.
@@ -612,7 +612,8 @@ void ClipModel::requestRemapResize(int inPoint, int outPoint, int oldIn, int old
                                   .arg(m_producer->frames_to_time(j.key() + offset, mlt_time_clock))
                                   .arg(GenTime(j.value(), pCore->getCurrentFps()).seconds());
                 }
-                Fun operation = [this, kfrData = result.join(QLatin1Char(';'))]() {
+                const QString kfrData = result.join(QLatin1Char(';'));
+                Fun operation = [this, kfrData]() {
                     setRemapValue("map", kfrData.toUtf8().constData());
                     if (auto ptr = m_parent.lock()) {
                         QModelIndex ix = ptr->makeClipIndexFromID(m_id);
@@ -629,6 +630,7 @@ void ClipModel::requestRemapResize(int inPoint, int outPoint, int oldIn, int old
                     return true;
                 };
                 operation();
+                addUndoPayload((kfrData.size() + oldKfrData.size()) * qint64(sizeof(QChar)));
                 PUSH_LAMBDA(operation, redo);
                 PUSH_FRONT_LAMBDA(reverse, undo);
             }
@@ -1298,6 +1300,12 @@ void ClipModel::setFakePosition(int fpos)
     m_fakePosition = fpos;
 }
 
+qint64 ClipModel::memoryCost() const
+{
+    // The producer is shared with the bin clip, only count our own data
+    return qint64(sizeof(ClipModel)) + m_effectStack->memoryCost();
+}
+
 QDomElement ClipModel::toXml(QDomDocument &document)
 {
     QDomElement container = document.createElement(QStringLiteral("clip"));
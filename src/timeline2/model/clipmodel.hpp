@@ -107,6 +107,8 @@ public:
 
     /** @brief Returns an XML representation of the clip with its effects */
     QDomElement toXml(QDomDocument &document);
+    /** @brief Estimated memory used by this clip and its effects, reported when an undo command keeps it alive */
+    qint64 memoryCost() const;
 
     /** @brief Retrieve a list of all snaps for this clip */
     void allSnaps(std::vector<int> &snaps, int offset = 0) const;
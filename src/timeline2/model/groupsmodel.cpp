@@ -56,6 +56,8 @@ Fun GroupsModel::groupItems_lambda(int gid, const std::unordered_set<int> &ids,
 {
     QWriteLocker locker(&m_lock);
     Q_ASSERT(ids.size() == 0 || type != GroupType::Leaf);
+    // The lambda keeps its own copy of the hash set, count a node and a bucket for each id
+    addUndoPayload(qint64(ids.size()) * qint64(sizeof(int) + 3 * sizeof(void *)));
     return [gid, ids, parent, type, this]() {
         createGroupItem(gid);
         if (parent != -1) {
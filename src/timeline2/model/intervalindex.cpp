@@ -0,0 +1,197 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "intervalindex.hpp"
+
+#include <algorithm>
+
+struct IntervalIndex::Node
+{
+    Node(int s, int e, int i, uint32_t p)
+        : start(s)
+        , end(e)
+        , id(i)
+        , priority(p)
+        , maxEnd(e)
+    {
+    }
+    int start;
+    int end;
+    int id;
+    uint32_t priority;
+    /** Maximum end of the intervals stored in this subtree */
+    int maxEnd;
+    NodePtr left;
+    NodePtr right;
+
+    std::pair<int, int> key() const { return {start, id}; }
+};
+
+IntervalIndex::IntervalIndex()
+    : m_seed(0x9E3779B9u)
+{
+}
+
+IntervalIndex::~IntervalIndex()
+{
+    clear();
+}
+
+uint32_t IntervalIndex::nextPriority()
+{
+    // xorshift32, we only need a cheap and reproducible balancing priority
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
+
+void IntervalIndex::pull(Node *node)
+{
+    node->maxEnd = node->end;
+    if (node->left) {
+        node->maxEnd = std::max(node->maxEnd, node->left->maxEnd);
+    }
+    if (node->right) {
+        node->maxEnd = std::max(node->maxEnd, node->right->maxEnd);
+    }
+}
+
+void IntervalIndex::split(NodePtr node, std::pair<int, int> key, NodePtr &left, NodePtr &right)
+{
+    if (!node) {
+        left.reset();
+        right.reset();
+        return;
+    }
+    if (node->key() < key) {
+        NodePtr subLeft;
+        split(std::move(node->right), key, subLeft, right);
+        node->right = std::move(subLeft);
+        pull(node.get());
+        left = std::move(node);
+    } else {
+        NodePtr subRight;
+        split(std::move(node->left), key, left, subRight);
+        node->left = std::move(subRight);
+        pull(node.get());
+        right = std::move(node);
+    }
+}
+
+IntervalIndex::NodePtr IntervalIndex::merge(NodePtr left, NodePtr right)
+{
+    if (!left) {
+        return right;
+    }
+    if (!right) {
+        return left;
+    }
+    if (left->priority > right->priority) {
+        left->right = merge(std::move(left->right), std::move(right));
+        pull(left.get());
+        return left;
+    }
+    right->left = merge(std::move(left), std::move(right->left));
+    pull(right.get());
+    return right;
+}
+
+void IntervalIndex::insert(int id, int start, int end)
+{
+    if (m_intervals.count(id) > 0) {
+        remove(id);
+    }
+    m_intervals[id] = {start, end};
+    NodePtr left, right;
+    split(std::move(m_root), {start, id}, left, right);
+    auto node = std::make_unique<Node>(start, end, id, nextPriority());
+    m_root = merge(merge(std::move(left), std::move(node)), std::move(right));
+}
+
+bool IntervalIndex::remove(int id)
+{
+    auto it = m_intervals.find(id);
+    if (it == m_intervals.end()) {
+        return false;
+    }
+    int start = it->second.first;
+    m_intervals.erase(it);
+    NodePtr left, middle, right;
+    split(std::move(m_root), {start, id}, left, right);
+    // middle will only contain the node with key {start, id}
+    split(std::move(right), {start, id + 1}, middle, right);
+    middle.reset();
+    m_root = merge(std::move(left), std::move(right));
+    return true;
+}
+
+bool IntervalIndex::contains(int id) const
+{
+    return m_intervals.count(id) > 0;
+}
+
+std::pair<int, int> IntervalIndex::interval(int id) const
+{
+    auto it = m_intervals.find(id);
+    if (it == m_intervals.end()) {
+        return {-1, -1};
+    }
+    return it->second;
+}
+
+size_t IntervalIndex::size() const
+{
+    return m_intervals.size();
+}
+
+void IntervalIndex::clear()
+{
+    // Dismantle the tree iteratively to avoid deep recursion in the node destructors
+    std::vector<NodePtr> pending;
+    if (m_root) {
+        pending.push_back(std::move(m_root));
+    }
+    while (!pending.empty()) {
+        NodePtr node = std::move(pending.back());
+        pending.pop_back();
+        if (node->left) {
+            pending.push_back(std::move(node->left));
+        }
+        if (node->right) {
+            pending.push_back(std::move(node->right));
+        }
+    }
+    m_intervals.clear();
+}
+
+void IntervalIndex::collect(const Node *node, int start, int end, std::vector<int> &result)
+{
+    if (node == nullptr || node->maxEnd < start) {
+        // Nothing in this subtree reaches the requested range
+        return;
+    }
+    collect(node->left.get(), start, end, result);
+    if (node->start > end) {
+        // This node and its right subtree start after the requested range
+        return;
+    }
+    if (node->end >= start) {
+        result.push_back(node->id);
+    }
+    collect(node->right.get(), start, end, result);
+}
+
+std::vector<int> IntervalIndex::overlapping(int start, int end) const
+{
+    std::vector<int> result;
+    collect(m_root.get(), start, end, result);
+    return result;
+}
+
+std::vector<int> IntervalIndex::stabbing(int position) const
+{
+    return overlapping(position, position);
+}
@@ -0,0 +1,66 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** @class IntervalIndex
+    @brief This class is an augmented binary search tree (treap) that stores closed integer intervals [start, end] associated with an item id.
+    It is used by the tracks to answer range and position queries in O(log n + k) instead of iterating over all the items of the track.
+    Each node stores the maximum end of its subtree, which allows to prune whole branches during a query.
+    Note that this class does no locking, it is the responsibility of the owner to protect concurrent access.
+ */
+class IntervalIndex
+{
+public:
+    IntervalIndex();
+    ~IntervalIndex();
+    IntervalIndex(const IntervalIndex &) = delete;
+    IntervalIndex &operator=(const IntervalIndex &) = delete;
+
+    /** @brief Inserts the item with given id, covering frames start to end (included). If the id already exists, it is updated */
+    void insert(int id, int start, int end);
+
+    /** @brief Removes the item with given id. Returns false if it was not found */
+    bool remove(int id);
+
+    /** @brief Returns true if the given id is stored in the index */
+    bool contains(int id) const;
+
+    /** @brief Returns the stored interval for the given id, or {-1, -1} if not found */
+    std::pair<int, int> interval(int id) const;
+
+    /** @brief Returns the number of stored items */
+    size_t size() const;
+
+    /** @brief Removes all items */
+    void clear();
+
+    /** @brief Returns the ids of the items intersecting the range [start, end], ordered by start position */
+    std::vector<int> overlapping(int start, int end) const;
+
+    /** @brief Returns the ids of the items covering the given position, ordered by start position */
+    std::vector<int> stabbing(int position) const;
+
+private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+    NodePtr m_root;
+    /** @brief Store the interval of each id, to be able to find the node when removing */
+    std::unordered_map<int, std::pair<int, int>> m_intervals;
+    uint32_t m_seed;
+
+    uint32_t nextPriority();
+    static void pull(Node *node);
+    /** @brief Split the tree in nodes strictly before key (left) and nodes after or equal to key (right) */
+    static void split(NodePtr node, std::pair<int, int> key, NodePtr &left, NodePtr &right);
+    static NodePtr merge(NodePtr left, NodePtr right);
+    static void collect(const Node *node, int start, int end, std::vector<int> &result);
+};
@@ -86,6 +86,10 @@ RTTR_REGISTRATION
             parameter_names("clipId", "groupId", "delta_track", "delta_pos", "updateView", "logUndo"))
         .method("suggestClipMove",
                 &TimelineModel::suggestClipMove)(parameter_names("clipId", "trackId", "position", "cursorPosition", "snapDistance", "moveMirrorTracks"))
+        .method("suggestClipDragMove",
+                &TimelineModel::suggestClipDragMove)(parameter_names("clipId", "trackId", "position", "cursorPosition", "snapDistance", "moveMirrorTracks"))
+        .method("endClipDrag", &TimelineModel::endClipDrag)(parameter_names("clipId", "moveMirrorTracks"))
+        .method("cancelClipDrag", &TimelineModel::cancelClipDrag)
         .method("suggestCompositionMove",
                 &TimelineModel::suggestCompositionMove)(parameter_names("compoId", "trackId", "position", "cursorPosition", "snapDistance"))
         // .method("addSnap", &TimelineModel::addSnap)(parameter_names("pos"))
@@ -130,6 +134,10 @@ TimelineModel::TimelineModel(const QUuid &uuid, Mlt::Profile *profile, std::weak
     , m_softDelete(false)
 {
     connect(m_guidesModel.get(), &MarkerListModel::categoriesChanged, this, &TimelineModel::saveGuideCategories);
+    if (auto ptr = m_undoStack.lock()) {
+        // Every operation requested on the model, and every undo or redo, can change the dragged items, their groups or their mixes
+        connect(ptr.get(), &QUndoStack::indexChanged, this, &TimelineModel::resetDragSession);
+    }
     m_guidesFilterModel.reset(new MarkerSortModel(this));
     m_guidesFilterModel->setSourceModel(m_guidesModel.get());
     m_guidesFilterModel->setSortRole(MarkerListModel::PosRole);
@@ -1200,6 +1208,9 @@ bool TimelineModel::requestClipMove(int clipId, int trackId, int position, bool
     QWriteLocker locker(&m_lock);
     TRACE(clipId, trackId, position, updateView, logUndo, invalidateTimeline);
     Q_ASSERT(m_allClips.count(clipId) > 0);
+    if (logUndo) {
+        resetDragSession();
+    }
     if (m_allClips[clipId]->getPosition() == position && getClipTrackId(clipId) == trackId) {
         TRACE_RES(true);
         return true;
@@ -1323,6 +1334,174 @@ QVariantList TimelineModel::suggestItemMove(int itemId, int trackId, int positio
     return QVariantList();
 }
 
+void TimelineModel::ensureDragSession(int itemId)
+{
+    int rootId = m_groups->getRootId(itemId);
+    if (m_dragSession && m_dragSession->rootId == rootId && m_dragSession->items.count(itemId) > 0) {
+        if (!m_dragSession->previewed) {
+            return;
+        }
+        // A previewed drag never moves the items, so a different position means the session is stale (for example after an undo)
+        if (m_dragSession->clipId == itemId && getItemTrackId(itemId) == m_dragSession->originTrackId &&
+            getItemPosition(itemId) == m_dragSession->originPosition) {
+            return;
+        }
+    }
+    resetDragSession();
+    m_dragSession = std::make_unique<DragSession>();
+    m_dragSession->rootId = rootId;
+    m_dragSession->clipId = itemId;
+    if (m_groups->isInGroup(itemId)) {
+        m_dragSession->items = m_groups->getLeaves(rootId);
+    } else {
+        m_dragSession->items = {itemId};
+    }
+    m_dragSession->ignored = m_dragSession->items;
+    m_dragSession->canPreview = true;
+    // Clips mixed with a dragged clip are handled by the mix checks of the real move, don't reject them here
+    for (int id : m_dragSession->items) {
+        if (!isClip(id)) {
+            if (m_dragSession->canPreview) {
+                qDebug() << "// Dragged group" << rootId << "contains compositions or subtitles, moving it without preview";
+            }
+            m_dragSession->canPreview = false;
+            continue;
+        }
+        int tid = getClipTrackId(id);
+        if (tid == -1 || !getTrackById_const(tid)->hasMix(id)) {
+            continue;
+        }
+        std::pair<MixInfo, MixInfo> mixData = getTrackById_const(tid)->getMixInfo(id);
+        m_dragSession->ignored.insert(mixData.first.firstClipId);
+        m_dragSession->ignored.insert(mixData.second.secondClipId);
+    }
+}
+
+bool TimelineModel::isDragMovePossible(int delta_pos) const
+{
+    return isDragMovePossible(0, delta_pos, true);
+}
+
+bool TimelineModel::isDragMovePossible(int delta_track, int delta_pos, bool moveMirrorTracks, std::unordered_map<int, int> *targetTracks) const
+{
+    if (!m_dragSession || m_editMode != TimelineMode::NormalEdit) {
+        return true;
+    }
+    // Same track deltas as requestGroupMove: the track move is cancelled if the group doesn't fit, and items of the other type than the
+    // dragged clip move in the opposite direction
+    if (delta_track != 0) {
+        int masterTrackId = isClip(m_dragSession->clipId) ? getClipTrackId(m_dragSession->clipId) : -1;
+        if (masterTrackId == -1) {
+            return false;
+        }
+        if (m_groups->isInGroup(m_dragSession->clipId)) {
+            delta_track = adjustGroupTrackDelta(m_dragSession->clipId, m_dragSession->items, delta_track, moveMirrorTracks);
+        }
+    }
+    int audio_delta = delta_track;
+    int video_delta = delta_track;
+    if (delta_track != 0) {
+        if (getTrackById_const(getClipTrackId(m_dragSession->clipId))->isAudioTrack()) {
+            video_delta = -delta_track;
+        } else {
+            audio_delta = -delta_track;
+        }
+    }
+    for (int id : m_dragSession->items) {
+        bool composition = isComposition(id);
+        if (!composition && !isClip(id)) {
+            continue;
+        }
+        int tid = composition ? getCompositionTrackId(id) : getClipTrackId(id);
+        if (tid == -1) {
+            continue;
+        }
+        int targetTid = tid;
+        if (delta_track != 0) {
+            bool audioTrack = getTrackById_const(tid)->isAudioTrack();
+            int d = audioTrack ? audio_delta : video_delta;
+            if (!moveMirrorTracks && !composition && id != m_dragSession->clipId) {
+                d = 0;
+            }
+            int target_track_position = getTrackPosition(tid) + d;
+            if (target_track_position < 0 || target_track_position >= getTracksCount()) {
+                return false;
+            }
+            targetTid = getTrackIndexFromPosition(target_track_position);
+            if (getTrackById_const(targetTid)->isAudioTrack() != audioTrack) {
+                return false;
+            }
+        }
+        if (composition) {
+            const auto &compo = m_allCompositions.at(id);
+            int in = compo->getPosition() + delta_pos;
+            if (getTrackById_const(targetTid)->hasCollision(in, in + compo->getPlaytime() - 1, m_dragSession->ignored, true)) {
+                return false;
+            }
+        } else {
+            const auto &clip = m_allClips.at(id);
+            int in = clip->getPosition() + delta_pos;
+            if (in < 0) {
+                return false;
+            }
+            if (getTrackById_const(targetTid)->hasCollision(in, in + clip->getPlaytime() - 1, m_dragSession->ignored)) {
+                return false;
+            }
+        }
+        if (targetTracks) {
+            (*targetTracks)[id] = targetTid;
+        }
+    }
+    return true;
+}
+
+bool TimelineModel::isMixMovePossible(int clipId, int trackId, int position) const
+{
+    std::pair<MixInfo, MixInfo> mixData = getTrackById_const(trackId)->getMixInfo(clipId);
+    int clipDuration = m_allClips.at(clipId)->getPlaytime();
+    // Moving into the mixed clip is allowed if it is in the same group
+    int groupId = m_groups->isInGroup(clipId) ? m_groups->getRootId(clipId) : -1;
+    if (mixData.first.firstClipId > -1) {
+        // Clip has start mix
+        bool allowMove = groupId > -1 && groupId == m_groups->getRootId(mixData.first.firstClipId);
+        if (!allowMove && position + clipDuration > mixData.first.firstClipInOut.first && position < mixData.first.firstClipInOut.second) {
+            return false;
+        }
+    }
+    if (mixData.second.firstClipId > -1) {
+        // Clip has end mix
+        bool allowMove = groupId > -1 && groupId == m_groups->getRootId(mixData.second.secondClipId);
+        if (!allowMove && position + clipDuration > mixData.second.secondClipInOut.first && position < mixData.second.secondClipInOut.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TimelineModel::resetDragSession()
+{
+    if (!m_dragSession) {
+        return;
+    }
+    std::unique_ptr<DragSession> session = std::move(m_dragSession);
+    if (!session->previewed) {
+        return;
+    }
+    // Bring the previewed clips back to their model position and track
+    QVector<int> roles{FakePositionRole, FakeTrackIdRole};
+    for (int id : session->items) {
+        if (!isClip(id)) {
+            continue;
+        }
+        m_allClips[id]->setFakeTrackId(-1);
+        m_allClips[id]->setFakePosition(m_allClips[id]->getPosition());
+        QModelIndex modelIndex = makeClipIndexFromID(id);
+        if (modelIndex.isValid()) {
+            notifyChange(modelIndex, modelIndex, roles);
+        }
+    }
+}
+
 int TimelineModel::adjustFrame(int frame, int trackId)
 {
     if (m_editMode == TimelineMode::InsertEdit && isTrack(trackId)) {
@@ -1388,6 +1567,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
         TRACE_RES(position);
         return {position, trackId};
     }
+    ensureDragSession(clipId);
     if (m_editMode == TimelineMode::InsertEdit) {
         int maxPos = getTrackById_const(trackId)->trackDuration();
         if (m_allClips[clipId]->getCurrentTrackId() == trackId) {
@@ -1399,12 +1579,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
     if (snapDistance > 0) {
         std::vector<int> ignored_pts;
         // For snapping, we must ignore all in/outs of the clips of the group being moved
-        std::unordered_set<int> all_items = {clipId};
-        if (m_groups->isInGroup(clipId)) {
-            int groupId = m_groups->getRootId(clipId);
-            all_items = m_groups->getLeaves(groupId);
-        }
-        for (int current_clipId : all_items) {
+        for (int current_clipId : m_dragSession->items) {
             if (isClip(current_clipId)) {
                 m_allClips[current_clipId]->allSnaps(ignored_pts, offset);
             } else if (isComposition(current_clipId) || isSubTitle(current_clipId)) {
@@ -1420,46 +1595,18 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
         }
     }
     bool isInGroup = m_groups->isInGroup(clipId);
-    if (sourceTrackId == trackId) {
-        // Same track move, check if there is a mix and limit move
-        std::pair<MixInfo, MixInfo> mixData = getTrackById_const(trackId)->getMixInfo(clipId);
-        if (mixData.first.firstClipId > -1) {
-            // Clip has start mix
-            int clipDuration = m_allClips[clipId]->getPlaytime();
-            // ensure we don't move into clip
-            bool allowMove = false;
-            if (isInGroup) {
-                // Check if in same group as clip mix
-                int groupId = m_groups->getRootId(clipId);
-                if (groupId == m_groups->getRootId(mixData.first.firstClipId)) {
-                    allowMove = true;
-                }
-            }
-            if (!allowMove && position + clipDuration > mixData.first.firstClipInOut.first && position < mixData.first.firstClipInOut.second) {
-                // Abort move
-                return {currentPos, sourceTrackId};
-            }
-        }
-        if (mixData.second.firstClipId > -1) {
-            // Clip has end mix
-            int clipDuration = m_allClips[clipId]->getPlaytime();
-            bool allowMove = false;
-            if (isInGroup) {
-                // Check if in same group as clip mix
-                int groupId = m_groups->getRootId(clipId);
-                if (groupId == m_groups->getRootId(mixData.second.secondClipId)) {
-                    allowMove = true;
-                }
-            }
-            if (!allowMove && position + clipDuration > mixData.second.secondClipInOut.first && position < mixData.second.secondClipInOut.second) {
-                // Abort move
-                return {currentPos, sourceTrackId};
-            }
-        }
+    if (sourceTrackId == trackId && !isMixMovePossible(clipId, trackId, position)) {
+        // Same track move into a clip we are mixed with, abort move
+        return {currentPos, sourceTrackId};
+    }
+    // we check if move is possible. Same track moves that would collide are rejected by the drag session without touching the playlists
+    bool possible = false;
+    if (m_editMode == TimelineMode::NormalEdit) {
+        possible = (sourceTrackId != trackId || isDragMovePossible(position - currentPos)) &&
+                   requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
+    } else {
+        possible = requestFakeClipMove(clipId, trackId, position, true, false, false);
     }
-    // we check if move is possible
-    bool possible = (m_editMode == TimelineMode::NormalEdit) ? requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false)
-                                                             : requestFakeClipMove(clipId, trackId, position, true, false, false);
 
     if (possible) {
         TRACE_RES(position);
@@ -1478,7 +1625,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
         // Try same track move
         if (trackId != sourceTrackId && sourceTrackId != -1) {
             trackId = sourceTrackId;
-            possible = requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
+            possible = isDragMovePossible(position - currentPos) && requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
             if (!possible) {
                 qWarning() << "can't move clip" << clipId << "on track" << trackId << "at" << position;
             } else {
@@ -1498,7 +1645,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
             TRACE_RES(currentPos);
             return {currentPos, sourceTrackId};
         }
-        possible = requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
+        possible = isDragMovePossible(position - currentPos) && requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
         TRACE_RES(possible ? position : currentPos);
         if (possible) {
             return {position, trackId};
@@ -1507,7 +1654,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
     }
     if (trackId != sourceTrackId) {
         // Try same track move
-        possible = requestClipMove(clipId, sourceTrackId, position, moveMirrorTracks, true, false, false);
+        possible = isDragMovePossible(position - currentPos) && requestClipMove(clipId, sourceTrackId, position, moveMirrorTracks, true, false, false);
         if (possible) {
             return {position, sourceTrackId};
         }
@@ -1579,7 +1726,7 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
     }
     if (blank_length != 0) {
         int updatedPos = currentPos + (after ? blank_length : -blank_length);
-        possible = requestClipMove(clipId, trackId, updatedPos, moveMirrorTracks, true, false, false);
+        possible = isDragMovePossible(updatedPos - currentPos) && requestClipMove(clipId, trackId, updatedPos, moveMirrorTracks, true, false, false);
         if (possible) {
             TRACE_RES(updatedPos);
             return {updatedPos, trackId};
@@ -1589,6 +1736,139 @@ QVariantList TimelineModel::suggestClipMove(int clipId, int trackId, int positio
     return {currentPos, sourceTrackId};
 }
 
+QVariantList TimelineModel::suggestClipDragMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance, bool moveMirrorTracks)
+{
+    QWriteLocker locker(&m_lock);
+    TRACE(clipId, trackId, position, cursorPosition, snapDistance, moveMirrorTracks);
+    Q_ASSERT(isClip(clipId));
+    Q_ASSERT(isTrack(trackId));
+    if (m_editMode != TimelineMode::NormalEdit || getClipTrackId(clipId) == -1) {
+        return suggestClipMove(clipId, trackId, position, cursorPosition, snapDistance, moveMirrorTracks);
+    }
+    ensureDragSession(clipId);
+    if (!m_dragSession->canPreview) {
+        // The view has no fake position for compositions and subtitles, groups containing them are not previewed and are moved for real
+        return suggestClipMove(clipId, trackId, position, cursorPosition, snapDistance, moveMirrorTracks);
+    }
+    if (!m_dragSession->previewed) {
+        m_dragSession->originTrackId = m_dragSession->ghostTrackId = getClipTrackId(clipId);
+        m_dragSession->originPosition = m_dragSession->ghostPosition = getClipPosition(clipId);
+    }
+    int sourceTrackId = m_dragSession->originTrackId;
+    int currentPos = m_dragSession->originPosition;
+    if (getTrackById_const(trackId)->isAudioTrack() != getTrackById_const(sourceTrackId)->isAudioTrack()) {
+        // Trying move on incompatible track type, stay on same track
+        trackId = m_dragSession->ghostTrackId;
+    }
+    if (snapDistance > 0) {
+        std::vector<int> ignored_pts;
+        // For snapping, we must ignore all in/outs of the clips being moved
+        for (int current_clipId : m_dragSession->items) {
+            m_allClips[current_clipId]->allSnaps(ignored_pts);
+        }
+        int snapped = getBestSnapPos(currentPos, position - currentPos, ignored_pts, cursorPosition, snapDistance);
+        if (snapped >= 0) {
+            position = snapped;
+        }
+    }
+    if (position == m_dragSession->ghostPosition && trackId == m_dragSession->ghostTrackId) {
+        TRACE_RES(position);
+        return {position, trackId};
+    }
+    // Candidate positions are only checked against the tracks interval indexes, the playlists are not modified until endClipDrag
+    std::unordered_map<int, int> targetTracks;
+    auto isPossible = [&](int tid, int pos) {
+        targetTracks.clear();
+        if (tid == sourceTrackId && !isMixMovePossible(clipId, tid, pos)) {
+            return false;
+        }
+        return isDragMovePossible(getTrackPosition(tid) - getTrackPosition(sourceTrackId), pos - currentPos, moveMirrorTracks, &targetTracks);
+    };
+    bool possible = isPossible(trackId, position);
+    if (!possible && trackId != m_dragSession->ghostTrackId) {
+        // Try to follow the mouse on the last valid track
+        trackId = m_dragSession->ghostTrackId;
+        possible = isPossible(trackId, position);
+    }
+    if (!possible) {
+        // Stick to the item blocking the move: bisect between the last valid position and the requested one
+        int validPos = m_dragSession->ghostPosition;
+        int invalidPos = position;
+        while (qAbs(invalidPos - validPos) > 1) {
+            int middle = validPos + (invalidPos - validPos) / 2;
+            if (isPossible(trackId, middle)) {
+                validPos = middle;
+            } else {
+                invalidPos = middle;
+            }
+        }
+        position = validPos;
+        possible = isPossible(trackId, position);
+    }
+    if (!possible) {
+        TRACE_RES(m_dragSession->ghostPosition);
+        return {m_dragSession->ghostPosition, m_dragSession->ghostTrackId};
+    }
+    // A group move may stay on its tracks if the group doesn't fit on the requested ones
+    if (targetTracks.count(clipId) > 0) {
+        trackId = targetTracks.at(clipId);
+    }
+    // Preview the move through the fake position and track of the dragged clips
+    int delta_pos = position - currentPos;
+    for (const auto &target : targetTracks) {
+        const auto &clip = m_allClips[target.first];
+        QVector<int> roles{FakePositionRole};
+        int fakeTrackId = target.second == clip->getCurrentTrackId() ? -1 : target.second;
+        if (fakeTrackId != clip->getFakeTrackId()) {
+            clip->setFakeTrackId(fakeTrackId);
+            roles << FakeTrackIdRole;
+        }
+        clip->setFakePosition(clip->getPosition() + delta_pos);
+        QModelIndex modelIndex = makeClipIndexFromID(target.first);
+        if (modelIndex.isValid()) {
+            notifyChange(modelIndex, modelIndex, roles);
+        }
+    }
+    m_dragSession->previewed = true;
+    m_dragSession->ghostTrackId = trackId;
+    m_dragSession->ghostPosition = position;
+    TRACE_RES(position);
+    return {position, trackId};
+}
+
+int TimelineModel::endClipDrag(int clipId, bool moveMirrorTracks)
+{
+    QWriteLocker locker(&m_lock);
+    TRACE(clipId, moveMirrorTracks);
+    if (!m_dragSession || !m_dragSession->previewed || m_dragSession->clipId != clipId) {
+        TRACE_RES(-1);
+        return -1;
+    }
+    int trackId = m_dragSession->ghostTrackId;
+    int position = m_dragSession->ghostPosition;
+    // Keep the session out of the way of the final move, the clips moved to another track must be inserted without fake track
+    std::unique_ptr<DragSession> session = std::move(m_dragSession);
+    for (int id : session->items) {
+        m_allClips[id]->setFakeTrackId(-1);
+    }
+    bool res = requestClipMove(clipId, trackId, position, moveMirrorTracks, true, true, true);
+    if (!res) {
+        qWarning() << "can't move clip" << clipId << "on track" << trackId << "at" << position;
+    }
+    // Align the previewed clips with their final position, or bring them back to their origin if the move failed
+    m_dragSession = std::move(session);
+    resetDragSession();
+    TRACE_RES(res ? 1 : 0);
+    return res ? 1 : 0;
+}
+
+void TimelineModel::cancelClipDrag()
+{
+    QWriteLocker locker(&m_lock);
+    TRACE();
+    resetDragSession();
+}
+
 QVariantList TimelineModel::suggestCompositionMove(int compoId, int trackId, int position, int cursorPosition, int snapDistance)
 {
     QWriteLocker locker(&m_lock);
@@ -2048,6 +2328,9 @@ bool TimelineModel::requestItemDeletion(int itemId, bool logUndo)
 
 bool TimelineModel::requestClipDeletion(int clipId, Fun &undo, Fun &redo, bool logUndo)
 {
+    if (m_dragSession && m_dragSession->items.count(clipId) > 0) {
+        resetDragSession();
+    }
     int trackId = getClipTrackId(clipId);
     if (trackId != -1) {
         bool res = true;
@@ -2079,6 +2362,7 @@ bool TimelineModel::requestClipDeletion(int clipId, Fun &undo, Fun &redo, bool l
     };
     if (operation()) {
         UPDATE_UNDO_REDO(operation, reverse, undo, redo);
+        addUndoPayload(clip->memoryCost());
         return true;
     }
     undo();
@@ -2103,6 +2387,9 @@ bool TimelineModel::requestSubtitleDeletion(int clipId, Fun &undo, Fun &redo, bo
 
 bool TimelineModel::requestCompositionDeletion(int compositionId, Fun &undo, Fun &redo)
 {
+    if (m_dragSession && m_dragSession->items.count(compositionId) > 0) {
+        resetDragSession();
+    }
     int trackId = getCompositionTrackId(compositionId);
     if (trackId != -1) {
         bool res = getTrackById(trackId)->requestCompositionDeletion(compositionId, true, true, undo, redo, true);
@@ -2139,6 +2426,7 @@ bool TimelineModel::requestCompositionDeletion(int compositionId, Fun &undo, Fun
         update_monitor();
         PUSH_LAMBDA(update_monitor, operation);
         UPDATE_UNDO_REDO(operation, reverse, undo, redo);
+        addUndoPayload(composition->memoryCost());
         return true;
     }
     undo();
@@ -2336,11 +2624,85 @@ bool TimelineModel::requestFakeGroupMove(int clipId, int groupId, int delta_trac
     return true;
 }
 
+int TimelineModel::adjustGroupTrackDelta(int itemId, const std::unordered_set<int> &items, int delta_track, bool moveMirrorTracks) const
+{
+    if (delta_track == 0) {
+        return 0;
+    }
+    int lowerTrack = -1;
+    int upperTrack = -1;
+    for (int affectedItemId : items) {
+        if (isSubTitle(affectedItemId)) {
+            continue;
+        }
+        // Check if an upper / lower move is possible
+        const int trackPos = getTrackPosition(getItemTrackId(affectedItemId));
+        if (lowerTrack == -1 || lowerTrack > trackPos) {
+            lowerTrack = trackPos;
+        }
+        if (upperTrack == -1 || upperTrack < trackPos) {
+            upperTrack = trackPos;
+        }
+    }
+    bool masterIsAudio = getTrackById_const(getItemTrackId(itemId))->isAudioTrack();
+    if (delta_track < 0) {
+        if (!masterIsAudio) {
+            // Case 1, dragging a video clip down
+            bool lowerTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(lowerTrack))->isAudioTrack();
+            int lowerPos = lowerTrackIsAudio ? lowerTrack - delta_track : lowerTrack + delta_track;
+            if (lowerPos < 0) {
+                // No space below
+                return 0;
+            } else if (!lowerTrackIsAudio) {
+                // Moving a group of video clips
+                if (getTrackById_const(getTrackIndexFromPosition(lowerPos))->isAudioTrack()) {
+                    // Moving to a non matching track (video on audio track)
+                    return 0;
+                }
+            }
+        } else if (lowerTrack + delta_track < 0) {
+            // Case 2, dragging an audio clip down
+            return 0;
+        }
+    } else {
+        if (!masterIsAudio) {
+            // Case 1, dragging a video clip up
+            int upperPos = upperTrack + delta_track;
+            if (upperPos >= getTracksCount()) {
+                // Moving above top track, not allowed
+                return 0;
+            } else if (getTrackById_const(getTrackIndexFromPosition(upperPos))->isAudioTrack()) {
+                // Trying to move to a non matching track (video clip on audio track)
+                return 0;
+            }
+        } else {
+            bool upperTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(upperTrack))->isAudioTrack();
+            if (!upperTrackIsAudio) {
+                // Dragging an audio clip up, check that upper video clip has an available video track
+                int targetPos = upperTrack - delta_track;
+                if (moveMirrorTracks && (targetPos < 0 || getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack())) {
+                    return 0;
+                }
+            } else {
+                int targetPos = upperTrack + delta_track;
+                if (targetPos >= getTracksCount() || !getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
+                    // Trying to drag audio above topmost track or on video track
+                    return 0;
+                }
+            }
+        }
+    }
+    return delta_track;
+}
+
 bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, int delta_pos, bool moveMirrorTracks, bool updateView, bool logUndo,
                                      bool revertMove)
 {
     QWriteLocker locker(&m_lock);
     TRACE(itemId, groupId, delta_track, delta_pos, updateView, logUndo);
+    if (logUndo) {
+        resetDragSession();
+    }
     std::function<bool(void)> undo = []() { return true; };
     std::function<bool(void)> redo = []() { return true; };
     bool res = requestGroupMove(itemId, groupId, delta_track, delta_pos, updateView, logUndo, undo, redo, revertMove, moveMirrorTracks);
@@ -2370,8 +2732,6 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
     std::vector<int> sorted_clips_ids;
     std::vector<std::pair<int, std::pair<int, int>>> sorted_compositions;
     std::vector<std::pair<int, GenTime>> sorted_subtitles;
-    int lowerTrack = -1;
-    int upperTrack = -1;
     QVector<int> tracksWithMix;
 
     // Separate clips from compositions to sort and check source tracks
@@ -2379,16 +2739,6 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
     // Mixes might be deleted while moving clips to another track, so store them before attempting a move
     QMap<int, std::pair<MixInfo, MixInfo>> mixDataArray;
     for (int affectedItemId : all_items) {
-        if (delta_track != 0 && !isSubTitle(affectedItemId)) {
-            // Check if an upper / lower move is possible
-            const int trackPos = getTrackPosition(getItemTrackId(affectedItemId));
-            if (lowerTrack == -1 || lowerTrack > trackPos) {
-                lowerTrack = trackPos;
-            }
-            if (upperTrack == -1 || upperTrack < trackPos) {
-                upperTrack = trackPos;
-            }
-        }
         if (isClip(affectedItemId)) {
             sorted_clips.emplace_back(affectedItemId, m_allClips[affectedItemId]->getPosition());
             sorted_clips_ids.push_back(affectedItemId);
@@ -2462,55 +2812,9 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
     // Check if there is a track move
     // Second step, reinsert clips at correct positions
     int audio_delta, video_delta;
+    delta_track = adjustGroupTrackDelta(itemId, all_items, delta_track, moveMirrorTracks);
     audio_delta = video_delta = delta_track;
     bool masterIsAudio = delta_track != 0 ? getTrackById_const(getItemTrackId(itemId))->isAudioTrack() : false;
-    if (delta_track < 0) {
-        if (!masterIsAudio) {
-            // Case 1, dragging a video clip down
-            bool lowerTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(lowerTrack))->isAudioTrack();
-            int lowerPos = lowerTrackIsAudio ? lowerTrack - delta_track : lowerTrack + delta_track;
-            if (lowerPos < 0) {
-                // No space below
-                delta_track = 0;
-            } else if (!lowerTrackIsAudio) {
-                // Moving a group of video clips
-                if (getTrackById_const(getTrackIndexFromPosition(lowerPos))->isAudioTrack()) {
-                    // Moving to a non matching track (video on audio track)
-                    delta_track = 0;
-                }
-            }
-        } else if (lowerTrack + delta_track < 0) {
-            // Case 2, dragging an audio clip down
-            delta_track = 0;
-        }
-    } else if (delta_track > 0) {
-        if (!masterIsAudio) {
-            // Case 1, dragging a video clip up
-            int upperPos = upperTrack + delta_track;
-            if (upperPos >= getTracksCount()) {
-                // Moving above top track, not allowed
-                delta_track = 0;
-            } else if (getTrackById_const(getTrackIndexFromPosition(upperPos))->isAudioTrack()) {
-                // Trying to move to a non matching track (video clip on audio track)
-                delta_track = 0;
-            }
-        } else {
-            bool upperTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(upperTrack))->isAudioTrack();
-            if (!upperTrackIsAudio) {
-                // Dragging an audio clip up, check that upper video clip has an available video track
-                int targetPos = upperTrack - delta_track;
-                if (moveMirrorTracks && (targetPos < 0 || getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack())) {
-                    delta_track = 0;
-                }
-            } else {
-                int targetPos = upperTrack + delta_track;
-                if (targetPos >= getTracksCount() || !getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
-                    // Trying to drag audio above topmost track or on video track
-                    delta_track = 0;
-                }
-            }
-        }
-    }
     bool updateSubtitles = updateView;
     if (delta_track == 0 && updateView) {
         updateView = false;
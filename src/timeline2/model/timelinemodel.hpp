@@ -429,6 +429,19 @@ public:
         */
     Q_INVOKABLE QVariantList suggestItemMove(int itemId, int trackId, int position, int cursorPosition, int snapDistance = -1);
     Q_INVOKABLE QVariantList suggestClipMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance = -1, bool moveMirrorTracks = true);
+    /** @brief Same as suggestClipMove, for a clip interactively dragged in the timeline.
+       In normal edit mode, the move is only previewed through the fake position and track of the dragged items, the playlists are updated by endClipDrag.
+       @returns  a list in the form {position, trackId}
+     */
+    Q_INVOKABLE QVariantList suggestClipDragMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance = -1, bool moveMirrorTracks = true);
+    /** @brief Apply the move previewed by suggestClipDragMove. This action is undoable.
+       Groups containing compositions or subtitles are never previewed, suggestClipDragMove moves them like suggestClipMove.
+       @returns 1 if the previewed move was applied, 0 if it could not be applied (the clips stay at their origin) and -1 if the clip was not
+       dragged through a preview, in which case the caller has to finalize the move itself.
+     */
+    Q_INVOKABLE int endClipDrag(int clipId, bool moveMirrorTracks);
+    /** @brief Discard the current drag, restoring the previewed items to their position */
+    Q_INVOKABLE void cancelClipDrag();
     Q_INVOKABLE int suggestSubtitleMove(int subId, int position, int cursorPosition, int snapDistance);
     Q_INVOKABLE QVariantList suggestCompositionMove(int compoId, int trackId, int position, int cursorPosition, int snapDistance = -1);
     /** @brief returns the frame pos adjusted to edit mode
@@ -933,6 +946,25 @@ protected:
     /** @brief Attempt to make a clip move without ever updating the view */
     bool requestClipMoveAttempt(int clipId, int trackId, int position);
 
+    /** @brief Prepare the drag session for the dragged item, or reuse the current one if it matches */
+    void ensureDragSession(int itemId);
+    /** @brief Returns false if moving the dragged items by delta_pos frames on their current tracks would collide with an item that is not part of the drag.
+     *  The check only uses the tracks interval indexes, so impossible positions are rejected without modifying the MLT playlists.
+     */
+    bool isDragMovePossible(int delta_pos) const;
+    /** @brief Same as above, also moving the dragged items by delta_track tracks the way requestGroupMove does.
+     *  If targetTracks is not null, it receives the target track of each dragged item.
+     */
+    bool isDragMovePossible(int delta_track, int delta_pos, bool moveMirrorTracks, std::unordered_map<int, int> *targetTracks = nullptr) const;
+    /** @brief Returns the track delta requestGroupMove applies when moving the items by delta_track tracks, 0 if the items don't fit on the target tracks.
+     *  itemId is the item driving the move.
+     */
+    int adjustGroupTrackDelta(int itemId, const std::unordered_set<int> &items, int delta_track, bool moveMirrorTracks) const;
+    /** @brief Returns false if the clip would be moved into a clip it is mixed with on its track */
+    bool isMixMovePossible(int clipId, int trackId, int position) const;
+    /** @brief Discard the drag session and its preview. Called when a move is finalized, when a dragged item is deleted and when the undo stack changes */
+    void resetDragSession();
+
     int getSubtitleIndex(int subId) const;
     std::pair<int, GenTime> getSubtitleIdFromIndex(int index) const;
 
@@ -1032,6 +1064,29 @@ protected:
     bool m_softDelete;
     std::shared_ptr<MarkerSortModel> m_guidesFilterModel;
 
+    /** @brief Data cached while an item is interactively dragged, to avoid rebuilding it on each suggestClipMove call */
+    struct DragSession
+    {
+        /// Root of the dragged group, or the dragged item itself if it is not grouped
+        int rootId = -1;
+        /// All the items moved by the drag
+        std::unordered_set<int> items;
+        /// Items ignored by the collision checks: the moving items and the clips mixed with them
+        std::unordered_set<int> ignored;
+        /// The clip driving the drag, and its track and position when the drag started
+        int clipId = -1;
+        int originTrackId = -1;
+        int originPosition = -1;
+        /// Last valid track and position previewed for the driving clip, the playlists are only updated when the drag ends
+        int ghostTrackId = -1;
+        int ghostPosition = -1;
+        /// False if the drag contains compositions or subtitles, which the view cannot preview at a fake position
+        bool canPreview = false;
+        /// True once the fake position of the dragged clips was changed
+        bool previewed = false;
+    };
+    std::unique_ptr<DragSession> m_dragSession;
+
     // what follows are some virtual function that corresponds to the QML. They are implemented in TimelineItemModel
 protected:
     /** @brief Rebuild track compositing */
@@ -19,6 +19,7 @@
 #include "timelinemodel.hpp"
 #include <QDebug>
 #include <QModelIndex>
+#include <limits>
 #include <memory>
 #include <mlt++/MltTransition.h>
 
@@ -176,6 +177,7 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
             }
             int new_in = clip->getPosition();
             int new_out = new_in + clip->getPlaytime();
+            m_clipIndex.insert(clipId, new_in, new_out - 1);
             ptr->m_snaps->addPoint(new_in);
             ptr->m_snaps->addPoint(new_out);
             if (updateView) {
@@ -413,6 +415,7 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
             m_allClips[clipId]->setCurrentTrackId(-1);
             // m_allClips[clipId]->setSubPlaylistIndex(-1);
             m_allClips.erase(clipId);
+            m_clipIndex.remove(clipId);
             delete prod;
             m_playlists[target_track].unlock();
             if (auto ptr = m_parent.lock()) {
@@ -687,6 +690,7 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
             m_playlists[target_track].consolidate_blanks();
             m_playlists[target_track].unlock();
             if (err == 0) {
+                m_clipIndex.insert(clipId, m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in);
                 update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
                 if (right && m_playlists[target_track].count() - 1 == target_clip_mutable) {
                     // deleted last clip in playlist
@@ -723,6 +727,7 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
                 }
                 int err = m_playlists[target_track].resize_clip(target_clip, in, out);
                 if (err == 0) {
+                    m_clipIndex.insert(clipId, m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in);
                     update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
                 }
                 m_playlists[target_track].consolidate_blanks();
@@ -776,6 +781,7 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
                     m_allClips[clipId]->setPosition(m_playlists[target_track].clip_start(target_clip_mutable));
                 }
                 if (err == 0) {
+                    m_clipIndex.insert(clipId, m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in);
                     update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
                 }
                 m_playlists[target_track].consolidate_blanks();
@@ -799,9 +805,9 @@ int TrackModel::getId() const
 int TrackModel::getClipByStartPosition(int position) const
 {
     READ_LOCK();
-    for (auto &clip : m_allClips) {
-        if (clip.second->getPosition() == position) {
-            return clip.second->getId();
+    for (int cid : m_clipIndex.stabbing(position)) {
+        if (m_clipIndex.interval(cid).first == position) {
+            return cid;
         }
     }
     return -1;
@@ -810,17 +816,27 @@ int TrackModel::getClipByStartPosition(int position) const
 int TrackModel::getClipByPosition(int position, int playlist)
 {
     READ_LOCK();
-    QSharedPointer<Mlt::Producer> prod(nullptr);
-    if ((playlist == 0 || playlist == -1) && m_playlists[0].count() > 0) {
-        prod = QSharedPointer<Mlt::Producer>(m_playlists[0].get_clip_at(position));
-    }
-    if (playlist != 0 && (!prod || prod->is_blank()) && m_playlists[1].count() > 0) {
-        prod = QSharedPointer<Mlt::Producer>(m_playlists[1].get_clip_at(position));
-    }
-    if (!prod || prod->is_blank()) {
+    const std::vector<int> candidates = m_clipIndex.stabbing(position);
+    if (candidates.empty()) {
         return -1;
     }
-    int cid = prod->get_int("_kdenlive_cid");
+    int cid = -1;
+    if (playlist == -1 && candidates.size() == 1) {
+        cid = candidates.front();
+    } else {
+        // Several clips overlap (mix zone) or we query a specific playlist, ask MLT which one is on top
+        QSharedPointer<Mlt::Producer> prod(nullptr);
+        if ((playlist == 0 || playlist == -1) && m_playlists[0].count() > 0) {
+            prod = QSharedPointer<Mlt::Producer>(m_playlists[0].get_clip_at(position));
+        }
+        if (playlist != 0 && (!prod || prod->is_blank()) && m_playlists[1].count() > 0) {
+            prod = QSharedPointer<Mlt::Producer>(m_playlists[1].get_clip_at(position));
+        }
+        if (!prod || prod->is_blank()) {
+            return -1;
+        }
+        cid = prod->get_int("_kdenlive_cid");
+    }
     if (playlist == -1) {
         if (hasStartMix(cid)) {
             if (position < m_allClips[cid]->getPosition() + m_allClips[cid]->getMixCutPosition()) {
@@ -854,16 +870,9 @@ QSharedPointer<Mlt::Producer> TrackModel::getClipProducer(int clipId)
 int TrackModel::getCompositionByPosition(int position)
 {
     READ_LOCK();
-    for (const auto &comp : m_compoPos) {
-        if (comp.first == position) {
-            return comp.second;
-        } else if (comp.first < position) {
-            if (comp.first + m_allCompositions[comp.second]->getPlaytime() >= position) {
-                return comp.second;
-            }
-        }
-    }
-    return -1;
+    // Compositions are also matched on the frame following their end
+    const std::vector<int> ids = m_compoIndex.overlapping(position - 1, position);
+    return ids.empty() ? -1 : ids.front();
 }
 
 int TrackModel::getClipByRow(int row) const
@@ -880,18 +889,8 @@ int TrackModel::getClipByRow(int row) const
 std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
 {
     READ_LOCK();
-    std::unordered_set<int> ids;
-    for (const auto &clp : m_allClips) {
-        int pos = clp.second->getPosition();
-        int length = clp.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
-            ids.insert(clp.first);
-        }
-    }
-    return ids;
+    const std::vector<int> found = m_clipIndex.overlapping(position, end > -1 ? end - 1 : std::numeric_limits<int>::max());
+    return std::unordered_set<int>(found.begin(), found.end());
 }
 
 int TrackModel::getRowfromClip(int clipId) const
@@ -905,19 +904,20 @@ std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end
 {
     READ_LOCK();
     // TODO: this function doesn't take into accounts the fact that there are two tracks
-    std::unordered_set<int> ids;
-    for (const auto &compo : m_allCompositions) {
-        int pos = compo.second->getPosition();
-        int length = compo.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
+    const std::vector<int> found = m_compoIndex.overlapping(position, end > -1 ? end - 1 : std::numeric_limits<int>::max());
+    return std::unordered_set<int>(found.begin(), found.end());
+}
 
-            ids.insert(compo.first);
+bool TrackModel::hasCollision(int position, int end, const std::unordered_set<int> &exceptions, bool compositions) const
+{
+    READ_LOCK();
+    const std::vector<int> found = compositions ? m_compoIndex.overlapping(position, end) : m_clipIndex.overlapping(position, end);
+    for (int id : found) {
+        if (exceptions.count(id) == 0) {
+            return true;
         }
     }
-    return ids;
+    return false;
 }
 
 int TrackModel::getRowfromComposition(int tid) const
@@ -1063,6 +1063,14 @@ bool TrackModel::checkConsistency()
         }
 
         last_out = clips[i].first + cur_clip->getPlaytime();
+        if (m_clipIndex.interval(clips[i].second) != std::pair<int, int>(clips[i].first, last_out - 1)) {
+            qDebug() << "ERROR: interval index is not in sync for clip " << clips[i].second;
+            return false;
+        }
+    }
+    if (m_clipIndex.size() != m_allClips.size()) {
+        qDebug() << "ERROR: the number of indexed clips doesn't match number of clips";
+        return false;
     }
     int playtime = std::max(m_playlists[0].get_playtime(), m_playlists[1].get_playtime());
     if (!clips.empty() && playtime != clips.back().first + m_allClips[clips.back().second]->getPlaytime()) {
@@ -1085,6 +1093,14 @@ bool TrackModel::checkConsistency()
             qDebug() << "Error: found composition" << m_compoPos[pos] << "instead of " << compo.first << "at position" << pos;
             return false;
         }
+        if (m_compoIndex.interval(compo.first) != std::pair<int, int>(pos, pos + compo.second->getPlaytime() - 1)) {
+            qDebug() << "Error: interval index is not in sync for composition " << compo.first;
+            return false;
+        }
+    }
+    if (m_compoIndex.size() != m_allCompositions.size()) {
+        qDebug() << "Error: the number of indexed compositions doesn't match number of compositions";
+        return false;
     }
     for (auto it = m_compoPos.begin(); it != m_compoPos.end(); ++it) {
         int compoId = it->second;
@@ -1360,6 +1376,7 @@ Fun TrackModel::requestCompositionResize_lambda(int compoId, int in, int out, bo
         m_allCompositions[compoId]->setInOut(in, out);
         update_snaps(in, out + 1);
         m_compoPos[m_allCompositions[compoId]->getPosition()] = compoId;
+        m_compoIndex.insert(compoId, in, out);
         return true;
     };
 }
@@ -1424,6 +1441,7 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
         m_allCompositions[compoId]->setCurrentTrackId(-1);
         m_allCompositions.erase(compoId);
         m_compoPos.erase(old_in);
+        m_compoIndex.remove(compoId);
         ptr->m_snaps->removePoint(old_in);
         ptr->m_snaps->removePoint(old_out);
         if (finalMove) {
@@ -1479,6 +1497,7 @@ Fun TrackModel::requestCompositionInsertion_lambda(int compoId, int position, bo
                 ptr->m_snaps->addPoint(new_in);
                 ptr->m_snaps->addPoint(new_out);
                 m_compoPos[new_in] = composition->getId();
+                m_compoIndex.insert(composition->getId(), new_in, new_out - 1);
                 if (finalMove) {
                     Q_EMIT ptr->invalidateZone(new_in, new_out);
                 }
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "definitions.h"
+#include "intervalindex.hpp"
 #include "undohelper.hpp"
 #include <QReadWriteLock>
 #include <QSharedPointer>
@@ -310,6 +311,11 @@ protected:
     std::unordered_set<int> getClipsInRange(int position, int end = -1);
     /** @brief Returns the list of the ids of the compositions that intersect the given range */
     std::unordered_set<int> getCompositionsInRange(int position, int end);
+    /** @brief Returns true if an item that is not listed in exceptions intersects the range [position, end] (end included).
+     *  This only reads the interval indexes, the MLT playlists are not queried.
+     *  @param compositions if true, check compositions instead of clips
+     */
+    bool hasCollision(int position, int end, const std::unordered_set<int> &exceptions, bool compositions = false) const;
 
     /** @brief Import effects from a service that contains some (another track) */
     bool importEffects(std::weak_ptr<Mlt::Service> service);
@@ -365,6 +371,12 @@ private:
      */
     std::map<int, int> m_compoPos;
 
+    /** @brief Interval indexes of the clips and compositions, used to answer range and position queries without iterating over all items.
+     *  They are kept in sync with m_allClips / m_allCompositions by the insertion, deletion and resize lambdas
+     */
+    IntervalIndex m_clipIndex;
+    IntervalIndex m_compoIndex;
+
     /// This is a lock that ensures safety in case of concurrent access
     mutable QReadWriteLock m_lock;
     void reverseCompositionXml(const QString &composition, QDomElement xml);
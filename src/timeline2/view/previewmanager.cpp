@@ -18,11 +18,217 @@
 
 #include <KLocalizedString>
 #include <KMessageBox>
-#include <QCollator>
 #include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMap>
 #include <QMutexLocker>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <algorithm>
+#include <mlt++/Mlt.h>
+#include <tuple>
+#include <vector>
+
+namespace {
+/** @brief Maximum number of unused chunk files kept in the store folder */
+const int maxStoredChunks = 200;
+
+/** @brief Rendered chunk files of each timeline by start frame, readable from the thumbnail threads */
+QMutex renderedFilesMutex;
+QHash<QUuid, QMap<int, QString>> renderedFiles;
+
+/** @brief Returns false for properties that don't change the rendered frames (runtime data, metadata, Kdenlive annotations).
+    Positions are also skipped, since they are hashed relative to the chunk */
+bool isRenderProperty(const char *name)
+{
+    if (name[0] == '_' || qstrncmp(name, "meta.", 5) == 0) {
+        return false;
+    }
+    if (qstrncmp(name, "kdenlive:", 9) == 0) {
+        return qstrcmp(name, "kdenlive:file_hash") == 0;
+    }
+    return qstrcmp(name, "id") != 0 && qstrcmp(name, "in") != 0 && qstrcmp(name, "out") != 0 && qstrcmp(name, "length") != 0;
+}
+
+/** @brief Hash the properties of a service. The external files it uses are added to @param files, their modification is checked later outside of the
+    timeline lock */
+void hashProperties(QCryptographicHash &hash, Mlt::Properties &properties, QStringList &files)
+{
+    // Sort the properties so that the hash does not depend on the order in which they were set
+    QVector<QPair<QByteArray, QByteArray>> values;
+    const int count = properties.count();
+    for (int i = 0; i < count; i++) {
+        const char *name = properties.get_name(i);
+        if (name == nullptr || !isRenderProperty(name)) {
+            continue;
+        }
+        const char *value = properties.get(i);
+        if (value != nullptr) {
+            values.append({QByteArray(name), QByteArray(value)});
+        }
+    }
+    std::sort(values.begin(), values.end());
+    for (const auto &value : qAsConst(values)) {
+        hash.addData(value.first + '=' + value.second + '\n');
+    }
+    // The content hash of a bin clip already identifies its media
+    const char *fileHash = properties.get("kdenlive:file_hash");
+    if (fileHash != nullptr && fileHash[0] != '\0') {
+        return;
+    }
+    // An external file (media, subtitles, lut...) may be modified without changing its path
+    for (const char *name : {"resource", "av.filename", "filename"}) {
+        const QString path = QString::fromUtf8(properties.get(name));
+        if (!path.isEmpty()) {
+            files << path;
+        }
+    }
+}
+
+/** @brief Hash the position of an item active between in and out, relative to the chunk [start, end] */
+void hashRange(QCryptographicHash &hash, int in, int out, int start, int end)
+{
+    hash.addData(QByteArray::number(in - start) + ':' + QByteArray::number(qMin(out, end) - start) + '\n');
+}
+
+void hashFilters(QCryptographicHash &hash, Mlt::Service &service, int start, int end, QStringList &files)
+{
+    const int count = service.filter_count();
+    for (int i = 0; i < count; i++) {
+        std::unique_ptr<Mlt::Filter> filter(service.filter(i));
+        if (!filter || !filter->is_valid() || filter->get_int("disable") == 1) {
+            continue;
+        }
+        const int in = filter->get_in();
+        const int out = filter->get_out();
+        if (in == 0 && out == 0) {
+            hash.addData(QByteArrayLiteral("filter\n"));
+        } else if (in <= end && out >= start) {
+            hash.addData(QByteArrayLiteral("filter:"));
+            hashRange(hash, in, out, start, end);
+        } else {
+            continue;
+        }
+        hashProperties(hash, *filter.get(), files);
+    }
+}
+
+void hashProducer(QCryptographicHash &hash, Mlt::Producer &producer, int start, int end, QStringList &files, int depth = 0);
+
+void hashTractor(QCryptographicHash &hash, Mlt::Tractor &tractor, int start, int end, QStringList &files, int depth)
+{
+    const int count = tractor.count();
+    for (int i = 0; i < count; i++) {
+        std::unique_ptr<Mlt::Producer> track(tractor.track(i));
+        if (!track || !track->is_valid()) {
+            continue;
+        }
+        const char *playlistId = track->get("kdenlive:playlistid");
+        if (qstrcmp(playlistId, "timeline_preview") == 0 || qstrcmp(playlistId, "timeline_overlay") == 0) {
+            continue;
+        }
+        // The audio of a track with hidden video is still rendered
+        const int hide = track->get_int("hide");
+        hash.addData(QByteArrayLiteral("track:") + QByteArray::number(hide) + '\n');
+        if (hide == 3) {
+            continue;
+        }
+        const mlt_service_type type = track->type();
+        if (type != mlt_service_tractor_type && type != mlt_service_playlist_type) {
+            // A producer used as a whole track, like the black background track, is a generator spanning the timeline.
+            // Don't hash the chunk position, or a chunk could never be reused after a move
+            hashFilters(hash, *track.get(), start, end, files);
+            hashProperties(hash, *track.get(), files);
+            hash.addData(QByteArrayLiteral("producer:") + QByteArray::number(end - start) + '\n');
+            continue;
+        }
+        hashProducer(hash, *track.get(), start, end, files, depth + 1);
+    }
+    QScopedPointer<Mlt::Service> service(tractor.producer());
+    while (service != nullptr && service->is_valid()) {
+        if (service->type() == mlt_service_transition_type) {
+            Mlt::Transition transition(mlt_transition(service->get_service()));
+            const int in = transition.get_in();
+            const int out = transition.get_out();
+            if (transition.get_int("always_active") == 1 || (in == 0 && out == 0)) {
+                hash.addData(QByteArrayLiteral("transition\n"));
+                hashProperties(hash, transition, files);
+            } else if (in <= end && out >= start) {
+                hash.addData(QByteArrayLiteral("transition:"));
+                hashRange(hash, in, out, start, end);
+                hashProperties(hash, transition, files);
+            }
+        }
+        service.reset(service->producer());
+    }
+}
+
+void hashPlaylist(QCryptographicHash &hash, Mlt::Playlist &playlist, int start, int end, QStringList &files, int depth)
+{
+    const int count = playlist.count();
+    for (int i = qMax(0, playlist.get_clip_index_at(start)); i < count; i++) {
+        std::unique_ptr<Mlt::ClipInfo> info(playlist.clip_info(i));
+        if (!info || info->start > end) {
+            break;
+        }
+        const int clipEnd = info->start + info->frame_count - 1;
+        if (clipEnd < start || playlist.is_blank(i) || info->cut == nullptr) {
+            continue;
+        }
+        // Only the part of the clip visible in the chunk matters, so a clip can move without changing the chunk content
+        const int overlapStart = qMax(start, info->start);
+        const int overlapEnd = qMin(end, clipEnd);
+        const int from = info->frame_in + overlapStart - info->start;
+        const int to = from + overlapEnd - overlapStart;
+        hash.addData(QByteArrayLiteral("clip:") + QByteArray::number(overlapStart - start) + ':' + QByteArray::number(from) + ':' +
+                     QByteArray::number(to) + '\n');
+        hashFilters(hash, *info->cut, from, to, files);
+        hashProperties(hash, *info->cut, files);
+        hashProducer(hash, info->cut->parent(), from, to, files, depth + 1);
+    }
+}
+
+/** @brief Hash everything that contributes to the frames between start and end of a producer */
+void hashProducer(QCryptographicHash &hash, Mlt::Producer &producer, int start, int end, QStringList &files, int depth)
+{
+    if (depth > 32) {
+        // Broken graph, don't recurse forever
+        return;
+    }
+    hashFilters(hash, producer, start, end, files);
+    switch (producer.type()) {
+    case mlt_service_tractor_type: {
+        Mlt::Tractor tractor(producer);
+        hashTractor(hash, tractor, start, end, files, depth);
+        break;
+    }
+    case mlt_service_playlist_type: {
+        Mlt::Playlist playlist(producer);
+        hashPlaylist(hash, playlist, start, end, files, depth);
+        break;
+    }
+    case mlt_service_chain_type: {
+        Mlt::Chain chain(producer);
+        hashProperties(hash, chain, files);
+        // The source frames used in this chunk
+        hash.addData(QByteArray::number(start) + ':' + QByteArray::number(end) + '\n');
+        for (int i = 0; i < chain.link_count(); i++) {
+            QScopedPointer<Mlt::Link> link(chain.link(i));
+            if (link && link->is_valid()) {
+                hashProperties(hash, *link.data(), files);
+            }
+        }
+        break;
+    }
+    default:
+        hashProperties(hash, producer, files);
+        // The source frames used in this chunk
+        hash.addData(QByteArray::number(start) + ':' + QByteArray::number(end) + '\n');
+        break;
+    }
+}
+} // namespace
 
 PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *parent)
     : QObject(parent)
@@ -34,10 +240,10 @@ PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *paren
     , m_warnOnCrash(true)
     , m_previewTrackIndex(-1)
     , m_initialized(false)
+    , m_renderFailed(false)
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
-    QObject::connect(&m_previewProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::processEnded);
 
     // Find path for Kdenlive renderer
 #ifdef Q_OS_WIN
@@ -52,16 +258,14 @@ PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *paren
                                i18n("Could not find the kdenlive_render application, something is wrong with your installation. Rendering will not work"));
         }
     }
-    connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
-    connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
 }
 
 PreviewManager::~PreviewManager()
 {
     if (m_initialized) {
         abortRendering();
-        if (m_undoDir.dirName() == QLatin1String("undo")) {
-            m_undoDir.removeRecursively();
+        if (m_storeDir.dirName() == QLatin1String("store")) {
+            m_storeDir.removeRecursively();
         }
         if ((pCore->currentDoc()->url().isEmpty() && m_cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).isEmpty()) ||
             m_cacheDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
@@ -70,6 +274,12 @@ PreviewManager::~PreviewManager()
             }
         }
     }
+    {
+        QMutexLocker lock(&renderedFilesMutex);
+        renderedFiles.remove(m_uuid);
+    }
+    // Render processes are stopped, delete them before the other members
+    m_workers.clear();
     delete m_overlayTrack;
     delete m_previewTrack;
 }
@@ -94,13 +304,13 @@ bool PreviewManager::initialize()
     }
     if (m_uuid == doc->uuid()) {
         if (m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir() ||
-            (!m_cacheDir.exists(QStringLiteral("undo")) && !m_cacheDir.mkdir(QStringLiteral("undo"))) || !m_cacheDir.absolutePath().contains(documentId)) {
+            (!m_cacheDir.exists(QStringLiteral("store")) && !m_cacheDir.mkdir(QStringLiteral("store"))) || !m_cacheDir.absolutePath().contains(documentId)) {
             pCore->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absolutePath()), ErrorMessage);
             return false;
         }
     } else {
         if (m_cacheDir.dirName().toLatin1() != QCryptographicHash::hash(m_uuid.toByteArray(), QCryptographicHash::Md5).toHex() || m_cacheDir == QDir() ||
-            (!m_cacheDir.exists(QStringLiteral("undo")) && !m_cacheDir.mkdir(QStringLiteral("undo"))) || !m_cacheDir.absolutePath().contains(documentId)) {
+            (!m_cacheDir.exists(QStringLiteral("store")) && !m_cacheDir.mkdir(QStringLiteral("store"))) || !m_cacheDir.absolutePath().contains(documentId)) {
             pCore->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absolutePath()), ErrorMessage);
             return false;
         }
@@ -109,16 +319,20 @@ bool PreviewManager::initialize()
         pCore->displayMessage(i18n("Invalid timeline preview parameters"), ErrorMessage);
         return false;
     }
-    m_undoDir = QDir(m_cacheDir.absoluteFilePath(QStringLiteral("undo")));
+    m_storeDir = QDir(m_cacheDir.absoluteFilePath(QStringLiteral("store")));
 
     // Make sure our cache dirs are inside the temporary folder
-    if (!m_cacheDir.makeAbsolute() || !m_undoDir.makeAbsolute() || !m_undoDir.mkpath(QStringLiteral("."))) {
+    if (!m_cacheDir.makeAbsolute() || !m_storeDir.makeAbsolute() || !m_storeDir.mkpath(QStringLiteral("."))) {
         pCore->displayMessage(i18n("Something is wrong with cache folders"), ErrorMessage);
         return false;
     }
+    // Remove the undo history of previous versions, chunks are now found by content
+    QDir legacyUndoDir(m_cacheDir.absoluteFilePath(QStringLiteral("undo")));
+    if (legacyUndoDir.exists()) {
+        legacyUndoDir.removeRecursively();
+    }
 
     connect(this, &PreviewManager::cleanupOldPreviews, this, &PreviewManager::doCleanupOldPreviews);
-    connect(doc, &KdenliveDoc::removeInvalidUndo, this, &PreviewManager::slotRemoveInvalidUndo, Qt::DirectConnection);
     m_previewTimer.setSingleShot(true);
     m_previewTimer.setInterval(3000);
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
@@ -166,9 +380,12 @@ void PreviewManager::loadChunks(QVariantList previewChunks, QVariantList dirtyCh
         }
         int position = playlist.clip_start(i);
         if (previewChunks.contains(QString::number(position))) {
-            if (existingChuncks.contains(QString("%1.%2").arg(position).arg(m_extension))) {
-                clip.reset(playlist.get_clip(i));
+            clip.reset(playlist.get_clip(i));
+            // Chunk files are named after their content hash, or after their position for projects created by older versions
+            const QString fileName = QFileInfo(QString::fromUtf8(clip->parent().get("resource"))).fileName();
+            if (existingChuncks.contains(fileName)) {
                 m_renderedChunks << position;
+                setChunkHash(position, QFileInfo(fileName).completeBaseName());
                 m_previewTrack->insert_at(position, clip.get(), 1);
             } else {
                 dirtyChunks << position;
@@ -200,6 +417,11 @@ void PreviewManager::deletePreviewTrack()
     m_previewTrack = nullptr;
     m_dirtyChunks.clear();
     m_renderedChunks.clear();
+    m_chunkHashes.clear();
+    {
+        QMutexLocker lock(&renderedFilesMutex);
+        renderedFiles.remove(m_uuid);
+    }
     Q_EMIT dirtyChunksChanged();
     Q_EMIT renderedChunksChanged();
     m_tractor->unlock();
@@ -320,104 +542,188 @@ void PreviewManager::invalidatePreviews()
         m_previewTimer.stop();
         timer = true;
     }
-    KdenliveDoc *doc = pCore->currentDoc();
-    int stackIx = doc->commandStack()->index();
-    int stackMax = doc->commandStack()->count();
-    if (stackIx == stackMax && !m_undoDir.exists(QString::number(stackIx - 1))) {
-        // We just added a new command in stack, archive existing chunks
-        int ix = stackIx - 1;
-        m_undoDir.mkdir(QString::number(ix));
-        bool foundPreviews = false;
-        for (const auto &i : m_dirtyChunks) {
-            QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(ix).arg(current))) {
-                foundPreviews = true;
+    // After an undo, or if a sequence was moved back, the new content of the invalidated chunks may already have been rendered
+    const QList<int> invalidated = m_invalidatedChunks.values();
+    m_invalidatedChunks.clear();
+    restoreChunks(invalidated);
+    Q_EMIT cleanupOldPreviews();
+    pCore->currentDoc()->setModified(true);
+    if (timer) {
+        m_previewTimer.start();
+    }
+}
+
+const QByteArray PreviewManager::chunkContent(int frame, QStringList &files) const
+{
+    const int chunkSize = KdenliveSettings::timelinechunks();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QStringLiteral("%1|%2|%3|%4|%5\n")
+                     .arg(m_consumerParams.join(QLatin1Char(' ')), m_extension, pCore->getCurrentProfilePath())
+                     .arg(chunkSize)
+                     .arg(!KdenliveSettings::proxypreview() && pCore->currentDoc()->useProxy() ? 1 : 0)
+                     .toUtf8());
+    hashProducer(hash, *m_tractor, frame, frame + chunkSize - 1, files);
+    return hash.result();
+}
+
+const QString PreviewManager::chunkHash(const QByteArray &content, const QStringList &files)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(content);
+    for (const QString &path : files) {
+        auto stamp = m_fileStamps.constFind(path);
+        if (stamp == m_fileStamps.constEnd()) {
+            QByteArray value;
+            const QFileInfo info(path);
+            if (info.isFile()) {
+                value = QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + ':' + QByteArray::number(info.size());
             }
+            stamp = m_fileStamps.insert(path, value);
         }
-        if (!foundPreviews) {
-            // No preview files found, remove undo folder
-            m_undoDir.rmdir(QString::number(ix));
-        } else {
-            // new chunks archived, cleanup old ones
-            Q_EMIT cleanupOldPreviews();
+        hash.addData(stamp.value() + '\n');
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+const QString PreviewManager::chunkFileName(const QString &hash) const
+{
+    return QStringLiteral("%1.%2").arg(hash, m_extension);
+}
+
+void PreviewManager::setChunkHash(int frame, const QString &hash)
+{
+    m_chunkHashes.insert(frame, hash);
+    QMutexLocker lock(&renderedFilesMutex);
+    renderedFiles[m_uuid].insert(frame, m_cacheDir.absoluteFilePath(chunkFileName(hash)));
+}
+
+QString PreviewManager::renderedChunkFile(const QUuid &uuid, int frame, int *offset)
+{
+    QMutexLocker lock(&renderedFilesMutex);
+    auto files = renderedFiles.constFind(uuid);
+    if (files == renderedFiles.constEnd() || files->isEmpty()) {
+        return QString();
+    }
+    // Find the last chunk starting before frame
+    auto it = files->upperBound(frame);
+    if (it == files->constBegin()) {
+        return QString();
+    }
+    --it;
+    if (frame - it.key() >= KdenliveSettings::timelinechunks()) {
+        return QString();
+    }
+    if (offset) {
+        *offset = frame - it.key();
+    }
+    return it.value();
+}
+
+QVariantList PreviewManager::restoreChunks(const QList<int> &chunks, QHash<int, QString> *missingHashes)
+{
+    QVariantList foundChunks;
+    if (m_previewTrack == nullptr || chunks.isEmpty()) {
+        return foundChunks;
+    }
+    // Only walk the timeline while it is locked, the files it uses are checked afterwards
+    std::vector<std::tuple<int, QByteArray, QStringList>> contents;
+    m_tractor->lock();
+    for (int frame : chunks) {
+        if (m_chunkHashes.contains(frame)) {
+            continue;
         }
-    } else {
-        // Restore existing chunks, delete others
-        // Check if we just undo the last stack action, then backup, otherwise delete
-        bool lastUndo = false;
-        if (stackIx + 1 == stackMax) {
-            if (!m_undoDir.exists(QString::number(stackMax))) {
-                lastUndo = true;
-                bool foundPreviews = false;
-                m_undoDir.mkdir(QString::number(stackMax));
-                for (const auto &i : m_dirtyChunks) {
-                    QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-                    if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(stackMax).arg(current))) {
-                        foundPreviews = true;
-                    }
-                }
-                if (!foundPreviews) {
-                    m_undoDir.rmdir(QString::number(stackMax));
-                }
+        QStringList files;
+        const QByteArray content = chunkContent(frame, files);
+        contents.emplace_back(frame, content, files);
+    }
+    m_tractor->unlock();
+    // Each file is checked once for all the chunks using it
+    m_fileStamps.clear();
+    for (const auto &chunk : contents) {
+        const int frame = std::get<0>(chunk);
+        const QString hash = chunkHash(std::get<1>(chunk), std::get<2>(chunk));
+        const QString fileName = chunkFileName(hash);
+        if (!m_cacheDir.exists(fileName) && !m_cacheDir.rename(QStringLiteral("store/%1").arg(fileName), fileName)) {
+            if (missingHashes) {
+                missingHashes->insert(frame, hash);
             }
+            continue;
         }
-        bool moveFile = true;
-        QDir tmpDir = m_undoDir;
-        if (!tmpDir.cd(QString::number(stackIx))) {
-            moveFile = false;
-        }
-        QVariantList foundChunks;
-        for (const auto &i : m_dirtyChunks) {
-            QString cacheFileName = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
-            }
-            if (moveFile) {
-                if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
-                    foundChunks << i;
-                } else {
-                    qDebug() << "// ERROR PROCESSE CHUNK: " << i << ", " << cacheFileName;
-                }
-            }
+        setChunkHash(frame, hash);
+        foundChunks << frame;
+    }
+    m_fileStamps.clear();
+    if (!foundChunks.isEmpty()) {
+        std::sort(foundChunks.begin(), foundChunks.end(), chunkSort);
+        m_dirtyMutex.lock();
+        for (auto &ck : foundChunks) {
+            m_dirtyChunks.removeAll(ck);
+            auto position = std::lower_bound(m_renderedChunks.begin(), m_renderedChunks.end(), ck, chunkSort);
+            m_renderedChunks.insert(position, ck);
         }
-        if (!foundChunks.isEmpty()) {
-            std::sort(foundChunks.begin(), foundChunks.end(), chunkSort);
-            m_dirtyMutex.lock();
-            for (auto &ck : foundChunks) {
-                m_dirtyChunks.removeAll(ck);
-                m_renderedChunks << ck;
-            }
-            m_dirtyMutex.unlock();
-            Q_EMIT dirtyChunksChanged();
-            Q_EMIT renderedChunksChanged();
-            reloadChunks(foundChunks);
+        m_dirtyMutex.unlock();
+        Q_EMIT dirtyChunksChanged();
+        Q_EMIT renderedChunksChanged();
+        reloadChunks(foundChunks);
+    }
+    return foundChunks;
+}
+
+const QString PreviewManager::storeRenderedChunk(int frame)
+{
+    const QString renderedFile = QStringLiteral("%1.%2").arg(frame).arg(m_extension);
+    const QString hash = m_pendingHashes.value(frame);
+    if (hash.isEmpty()) {
+        return renderedFile;
+    }
+    const QString fileName = chunkFileName(hash);
+    if (m_cacheDir.exists(fileName) || m_cacheDir.rename(QStringLiteral("store/%1").arg(fileName), fileName)) {
+        // The same content was already rendered for another chunk
+        m_cacheDir.remove(renderedFile);
+    } else if (!m_cacheDir.rename(renderedFile, fileName)) {
+        return renderedFile;
+    }
+    return fileName;
+}
+
+void PreviewManager::releaseChunk(int frame, bool discard)
+{
+    const QString hash = m_chunkHashes.take(frame);
+    {
+        QMutexLocker lock(&renderedFilesMutex);
+        auto it = renderedFiles.find(m_uuid);
+        if (it != renderedFiles.end()) {
+            it->remove(frame);
         }
     }
-    doc->setModified(true);
-    if (timer) {
-        m_previewTimer.start();
+    if (hash.isEmpty() || m_chunkHashes.key(hash, -1) > -1) {
+        // The file is still used by another chunk
+        return;
+    }
+    const QString fileName = chunkFileName(hash);
+    if (discard || !m_storeDir.exists()) {
+        m_cacheDir.remove(fileName);
+        return;
+    }
+    m_storeDir.remove(fileName);
+    if (m_cacheDir.rename(fileName, QStringLiteral("store/%1").arg(fileName))) {
+        // The store is cleaned by release date
+        QFile storedFile(m_storeDir.absoluteFilePath(fileName));
+        if (storedFile.open(QIODevice::ReadWrite)) {
+            storedFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
     }
 }
 
 void PreviewManager::doCleanupOldPreviews()
 {
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
+    if (m_storeDir.dirName() != QLatin1String("store")) {
         return;
     }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-
-    // Use QCollator to do a natural sorting so that 10 is after 2
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(dirs.begin(), dirs.end(), [&collator](const QString &file1, const QString &file2) { return collator.compare(file1, file2) < 0; });
-    bool ok;
-    while (dirs.count() > 5) {
-        QDir tmp = m_undoDir;
-        QString dirName = dirs.takeFirst();
-        dirName.toInt(&ok);
-        if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
-        }
+    // Oldest released chunks first
+    QFileInfoList files = m_storeDir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    while (files.count() > maxStoredChunks) {
+        m_storeDir.remove(files.takeFirst().fileName());
     }
 }
 
@@ -429,7 +735,7 @@ void PreviewManager::clearPreviewRange(bool resetZones)
     bool hasPreview = m_previewTrack != nullptr;
     QMutexLocker lock(&m_dirtyMutex);
     for (const auto &ix : qAsConst(m_renderedChunks)) {
-        m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+        releaseChunk(ix.toInt(), true);
         if (!m_dirtyChunks.contains(ix)) {
             m_dirtyChunks << ix;
         }
@@ -480,18 +786,18 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     }
     if (add) {
         Q_EMIT dirtyChunksChanged();
-        if (m_previewProcess.state() == QProcess::NotRunning && KdenliveSettings::autopreview()) {
+        if (!workersRunning() && KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     } else {
         // Remove processed chunks
-        bool isRendering = m_previewProcess.state() != QProcess::NotRunning;
+        bool isRendering = workersRunning();
         m_previewGatherTimer.stop();
         abortRendering();
         m_tractor->lock();
         bool hasPreview = m_previewTrack != nullptr;
         for (int ix : qAsConst(toRemove)) {
-            m_cacheDir.remove(QStringLiteral("%1.%2").arg(ix).arg(m_extension));
+            releaseChunk(ix, false);
             if (!hasPreview) {
                 continue;
             }
@@ -515,16 +821,18 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
 
 void PreviewManager::abortRendering()
 {
-    if (m_previewProcess.state() == QProcess::NotRunning) {
+    if (!workersRunning()) {
         return;
     }
     // Don't display error message on voluntary abort
     m_warnOnCrash = false;
     Q_EMIT abortPreview();
-    m_previewProcess.waitForFinished();
-    if (m_previewProcess.state() != QProcess::NotRunning) {
-        m_previewProcess.kill();
-        m_previewProcess.waitForFinished();
+    for (auto &worker : m_workers) {
+        worker->process.waitForFinished();
+        if (worker->process.state() != QProcess::NotRunning) {
+            worker->process.kill();
+            worker->process.waitForFinished();
+        }
     }
     // Re-init time estimation
     Q_EMIT previewRender(-1, QString(), 1000);
@@ -544,6 +852,26 @@ void PreviewManager::startPreviewRender()
         m_waitingThumbs.clear();
         // clear log
         m_errorLog.clear();
+        // Reuse the chunks whose content was already rendered
+        QList<int> dirtyChunks;
+        m_dirtyMutex.lock();
+        for (const auto &ck : qAsConst(m_dirtyChunks)) {
+            dirtyChunks << ck.toInt();
+        }
+        m_dirtyMutex.unlock();
+        m_pendingHashes.clear();
+        restoreChunks(dirtyChunks, &m_pendingHashes);
+        if (m_dirtyChunks.isEmpty()) {
+            pCore->currentDoc()->previewProgress(1000);
+            return;
+        }
+        for (auto it = m_pendingHashes.constBegin(); it != m_pendingHashes.constEnd(); ++it) {
+            // The renderer skips existing files, remove leftovers of an aborted render
+            const QString renderedFile = QStringLiteral("%1.%2").arg(it.key()).arg(m_extension);
+            if (m_chunkHashes.key(QString::number(it.key()), -1) == -1 && m_cacheDir.exists(renderedFile)) {
+                m_cacheDir.remove(renderedFile);
+            }
+        }
         const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
         if (!KdenliveSettings::proxypreview() && pCore->currentDoc()->useProxy()) {
             const QString playlist =
@@ -570,26 +898,59 @@ void PreviewManager::startPreviewRender()
     }
 }
 
-void PreviewManager::receivedStderr()
+void PreviewManager::receivedStderr(PreviewWorker *worker)
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    QStringList resultList = QString::fromLocal8Bit(worker->process.readAllStandardError()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
     for (auto &result : resultList) {
         if (result.startsWith(QLatin1String("START:"))) {
-            if (m_previewProcess.state() == QProcess::Running) {
-                workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
-                Q_EMIT workingPreviewChanged();
+            if (worker->process.state() == QProcess::Running) {
+                worker->workingChunk = result.section(QLatin1String("START:"), 1).simplified().toInt();
+                updateWorkingPreview();
             }
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            worker->processedChunks++;
             m_processedChunks++;
-            QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
-            Q_EMIT previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
+            const QString fileName = storeRenderedChunk(chunk);
+            Q_EMIT previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / qMax(1, m_chunksToRender));
         } else {
-            m_errorLog.append(result);
+            worker->errorLog.append(result);
         }
     }
 }
 
+int PreviewManager::workerCount()
+{
+    if (KdenliveSettings::previewworkers() > 0) {
+        return KdenliveSettings::previewworkers();
+    }
+    return pCore->taskManager.concurrency();
+}
+
+bool PreviewManager::workersRunning() const
+{
+    for (const auto &worker : m_workers) {
+        if (worker->process.state() != QProcess::NotRunning) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PreviewManager::updateWorkingPreview()
+{
+    int working = -1;
+    for (const auto &worker : m_workers) {
+        if (worker->workingChunk >= 0 && (working < 0 || worker->workingChunk < working)) {
+            working = worker->workingChunk;
+        }
+    }
+    if (working != workingPreview) {
+        workingPreview = working;
+        Q_EMIT workingPreviewChanged();
+    }
+}
+
 void PreviewManager::doPreviewRender(const QString &scene)
 {
     // initialize progress bar
@@ -597,40 +958,106 @@ void PreviewManager::doPreviewRender(const QString &scene)
         return;
     }
     QMutexLocker lock(&m_dirtyMutex);
-    Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
+    Q_ASSERT(!workersRunning());
     std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
-    const QStringList dirtyChunks = getCompressedList(m_dirtyChunks);
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
+    m_renderFailed = false;
+    m_workers.clear();
+    const int workers = qMin(workerCount(), m_chunksToRender);
+    for (int i = 0; i < workers; i++) {
+        m_workers.push_back(std::make_unique<PreviewWorker>());
+        PreviewWorker *worker = m_workers.back().get();
+        connect(&worker->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, worker](int exitCode, QProcess::ExitStatus status) { processEnded(worker, exitCode, status); });
+        connect(&worker->process, &QProcess::readyReadStandardError, this, [this, worker]() { receivedStderr(worker); });
+        connect(&worker->process, &QProcess::started, this,
+                [worker]() { qCDebug(KDENLIVE_LOG) << "Preview rendering process" << worker->process.processId() << "started"; });
+        // Queued, since start() can report the failure before the other workers are started
+        connect(
+            &worker->process, &QProcess::errorOccurred, this,
+            [this, worker](QProcess::ProcessError error) {
+                if (error != QProcess::FailedToStart ||
+                    std::none_of(m_workers.cbegin(), m_workers.cend(), [worker](const std::unique_ptr<PreviewWorker> &w) { return w.get() == worker; })) {
+                    return;
+                }
+                // No finished signal follows, handle it as a failed render so that its chunks stay dirty
+                worker->errorLog.append(worker->process.errorString());
+                processEnded(worker, -1, QProcess::CrashExit);
+            },
+            Qt::QueuedConnection);
+        connect(this, &PreviewManager::abortPreview, &worker->process, &QProcess::kill, Qt::DirectConnection);
+    }
+    // Hand out groups of consecutive chunks to the workers in turn, so that the zone is rendered from its start
+    // while each process still gets a short list of ranges to render
+    const int groupSize = qMax(1, m_chunksToRender / (workers * 8));
+    for (int i = 0; i < m_chunksToRender; i++) {
+        m_workers.at(size_t((i / groupSize) % workers))->chunks << m_dirtyChunks.at(i).toInt();
+    }
+    lock.unlock();
+    pCore->currentDoc()->previewProgress(0);
+    for (auto &worker : m_workers) {
+        startWorker(worker.get(), scene);
+    }
+}
+
+void PreviewManager::startWorker(PreviewWorker *worker, const QString &scene)
+{
+    QVariantList chunks;
+    for (int chunk : qAsConst(worker->chunks)) {
+        chunks << chunk;
+    }
     int chunkSize = KdenliveSettings::timelinechunks();
     QStringList args{QStringLiteral("preview-chunks"),
                      scene,
                      m_cacheDir.absolutePath(),
-                     dirtyChunks.join(QLatin1Char(',')),
+                     getCompressedList(chunks).join(QLatin1Char(',')),
                      QString::number(chunkSize - 1),
                      pCore->getCurrentProfilePath(),
                      m_extension,
                      m_consumerParams.join(QLatin1Char(' '))};
-    pCore->currentDoc()->previewProgress(0);
-    m_previewProcess.start(m_renderer, args);
-    if (m_previewProcess.waitForStarted()) {
-        qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
-    }
+    worker->processedChunks = 0;
+    worker->workingChunk = -1;
+    worker->errorLog.clear();
+    worker->process.start(m_renderer, args);
 }
 
-void PreviewManager::processEnded(int exitCode, QProcess::ExitStatus status)
+void PreviewManager::processEnded(PreviewWorker *worker, int exitCode, QProcess::ExitStatus status)
 {
-    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-    QFile::remove(sceneList);
-    if (status == QProcess::QProcess::CrashExit || exitCode != 0) {
+    const int failedChunk = worker->workingChunk;
+    worker->workingChunk = -1;
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        m_renderFailed = true;
+        m_errorLog.append(worker->errorLog);
         Q_EMIT previewRender(0, m_errorLog, -1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+        if (failedChunk >= 0) {
+            const QString fileName = QStringLiteral("%1.%2").arg(failedChunk).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
         }
-    } else {
+        if (m_warnOnCrash && failedChunk >= 0) {
+            // Only give up on the chunk that crashed, the worker resumes with its other chunks.
+            // The failed chunk stays in the dirty list so that it will be retried on next render
+            QList<int> remaining = worker->chunks.mid(worker->processedChunks);
+            remaining.removeAll(failedChunk);
+            m_chunksToRender--;
+            if (!remaining.isEmpty()) {
+                worker->chunks = remaining;
+                startWorker(worker, m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt")));
+                updateWorkingPreview();
+                return;
+            }
+        }
+    }
+    updateWorkingPreview();
+    if (workersRunning()) {
+        return;
+    }
+    // All render processes are finished
+    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
+    QFile::remove(sceneList);
+    if (!m_renderFailed) {
         // Normal exit and exit code 0: everything okay
         pCore->currentDoc()->previewProgress(1000);
     }
@@ -650,25 +1077,6 @@ void PreviewManager::slotProcessDirtyChunks()
     }
 }
 
-void PreviewManager::slotRemoveInvalidUndo(int ix)
-{
-    QMutexLocker lock(&m_previewMutex);
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
-        // Make sure we delete correct folder
-        return;
-    }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    bool ok;
-    for (const QString &dir : qAsConst(dirs)) {
-        if (dir.toInt(&ok) >= ix && ok) {
-            QDir tmp = m_undoDir;
-            if (tmp.cd(dir)) {
-                tmp.removeRecursively();
-            }
-        }
-    }
-}
-
 void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
     if (m_previewTrack == nullptr) {
@@ -679,7 +1087,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
     int end = endFrame - endFrame % chunkSize;
 
     m_previewGatherTimer.stop();
-    bool previewWasRunning = m_previewProcess.state() == QProcess::Running;
+    bool previewWasRunning = workersRunning();
     bool alreadyRendered = false;
     bool wasInDirtyZone = false;
     if (!m_renderedChunks.isEmpty()) {
@@ -714,6 +1122,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
                 delete prod;
                 QVariant val(i);
                 m_renderedChunks.removeAll(val);
+                releaseChunk(i, false);
                 if (!m_dirtyChunks.contains(val)) {
                     QMutexLocker lock(&m_dirtyMutex);
                     m_dirtyChunks << val;
@@ -736,6 +1145,15 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
         // Invalidated zone outside our rendered zones
         return;
     }
+    // Remember the invalidated chunks, their new content may match an existing chunk file
+    m_dirtyMutex.lock();
+    for (const auto &ck : qAsConst(m_dirtyChunks)) {
+        const int frame = ck.toInt();
+        if (frame >= start && frame <= end) {
+            m_invalidatedChunks.insert(frame);
+        }
+    }
+    m_dirtyMutex.unlock();
     m_previewGatherTimer.start();
 }
 
@@ -746,8 +1164,8 @@ void PreviewManager::reloadChunks(const QVariantList &chunks)
     }
     m_tractor->lock();
     for (const auto &ix : chunks) {
-        if (m_previewTrack->is_blank_at(ix.toInt())) {
-            QString fileName = m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+        if (m_previewTrack->is_blank_at(ix.toInt()) && m_chunkHashes.contains(ix.toInt())) {
+            QString fileName = m_cacheDir.absoluteFilePath(chunkFileName(m_chunkHashes.value(ix.toInt())));
             fileName.prepend(QStringLiteral("avformat:"));
             Mlt::Producer prod(*pCore->getProjectProfile(), fileName.toUtf8().constData());
             if (prod.is_valid()) {
@@ -791,7 +1209,10 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
             m_dirtyMutex.lock();
             m_dirtyChunks.removeAll(QVariant(frame));
             m_dirtyMutex.unlock();
-            m_renderedChunks << frame;
+            // Chunks are rendered out of order by the workers, keep the list sorted
+            auto position = std::lower_bound(m_renderedChunks.begin(), m_renderedChunks.end(), QVariant(frame), chunkSort);
+            m_renderedChunks.insert(position, frame);
+            setChunkHash(frame, QFileInfo(file).completeBaseName());
             Q_EMIT renderedChunksChanged();
             prod.set("mlt_service", "avformat-novalidate");
             prod.set("mute_on_pause", 1);
@@ -812,14 +1233,12 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
 
 void PreviewManager::corruptedChunk(int frame, const QString &fileName)
 {
-    Q_EMIT abortPreview();
-    m_previewProcess.waitForFinished();
-    if (workingPreview >= 0) {
-        workingPreview = -1;
-        Q_EMIT workingPreviewChanged();
-    }
+    // Don't abort the other chunks, only this one will have to be rendered again
+    m_renderFailed = true;
     Q_EMIT previewRender(0, m_errorLog, -1);
-    m_cacheDir.remove(fileName);
+    if (m_chunkHashes.key(QFileInfo(fileName).completeBaseName(), -1) == -1) {
+        m_cacheDir.remove(fileName);
+    }
     if (!m_dirtyChunks.contains(frame)) {
         QMutexLocker lock(&m_dirtyMutex);
         m_dirtyChunks << frame;
@@ -914,5 +1333,5 @@ int PreviewManager::addedTracks() const
 
 bool PreviewManager::isRunning() const
 {
-    return workingPreview >= 0 || m_previewProcess.state() != QProcess::NotRunning;
+    return workingPreview >= 0 || workersRunning();
 }
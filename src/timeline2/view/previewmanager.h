@@ -10,10 +10,14 @@
 
 #include <QDir>
 #include <QFuture>
+#include <QHash>
 #include <QMutex>
 #include <QProcess>
+#include <QSet>
 #include <QTimer>
 #include <QUuid>
+#include <memory>
+#include <vector>
 
 class TimelineController;
 
@@ -30,6 +34,10 @@ class Producer;
     This allow us to get a preview with a smooth playback of our project.
     Only the preview zone is rendered. Once defined, a preview zone shows as a red line below
     the timeline ruler. As chunks are rendered, the zone turns to green.
+    Chunk files are named after a hash of the timeline content used to render them, so that a
+    chunk can be reused as soon as the same content appears again at any position, for example
+    after an undo or when a sequence is moved back. Chunks that are not used anymore are kept in
+    a store folder until the cache limit is reached.
  */
 class PreviewManager : public QObject
 {
@@ -79,8 +87,28 @@ public:
     bool hasDefinedRange() const;
     /** @brief Returns true if the render process is still running */
     bool isRunning() const;
+    /** @brief Returns the number of concurrent render processes used to render the dirty chunks */
+    static int workerCount();
+    /** @brief Returns the rendered preview file containing @param frame of the timeline @param uuid, or an empty string if this part
+     *  of the timeline is not rendered. Can be called from any thread.
+     *  @param offset if not null, receives the position of the frame in the file
+     */
+    static QString renderedChunkFile(const QUuid &uuid, int frame, int *offset = nullptr);
 
 private:
+    /** @brief A kdenlive_render process, rendering its share of the dirty chunks */
+    struct PreviewWorker
+    {
+        QProcess process;
+        /** @brief The chunks assigned to this process, in rendering order */
+        QList<int> chunks;
+        /** @brief The number of chunks from the list already processed */
+        int processedChunks = 0;
+        /** @brief The chunk currently processed, -1 if none */
+        int workingChunk = -1;
+        /** @brief The process output, useful in case of failure */
+        QString errorLog;
+    };
     Mlt::Tractor *m_tractor;
     QUuid m_uuid;
     Mlt::Playlist *m_previewTrack;
@@ -89,12 +117,20 @@ private:
     int m_previewTrackIndex;
     /** @brief: The kdenlive renderer app. */
     QString m_renderer;
-    /** @brief: The kdenlive timeline preview process. */
-    QProcess m_previewProcess;
+    /** @brief: The kdenlive timeline preview processes. */
+    std::vector<std::unique_ptr<PreviewWorker>> m_workers;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
-    /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
-    QDir m_undoDir;
+    /** @brief: The directory keeping the chunks not used anymore in the timeline, in case they can be reused (child of m_cacheDir). */
+    QDir m_storeDir;
+    /** @brief: The content hash of each rendered chunk, which is also the name of its file. */
+    QHash<int, QString> m_chunkHashes;
+    /** @brief: The content hash of the chunks processed by the current render. */
+    QHash<int, QString> m_pendingHashes;
+    /** @brief: The chunks invalidated since the last invalidatePreviews call, that may match an existing chunk file. */
+    QSet<int> m_invalidatedChunks;
+    /** @brief: The modification time and size of the external files used by the chunks being restored, so that each file is only checked once. */
+    QHash<QString, QByteArray> m_fileStamps;
     QMutex m_previewMutex;
     QStringList m_consumerParams;
     QString m_extension;
@@ -109,12 +145,43 @@ private:
     int m_chunksToRender;
     /** @brief: The count of already processed chunks - to calculate job progress */
     int m_processedChunks;
-    /** @brief: The render process output, useful in case of failure */
+    /** @brief: The render processes output, useful in case of failure */
     QString m_errorLog;
-    /** @brief: After an undo/redo, if we have preview history, use it. */
+    /** @brief: True if a chunk failed in the current rendering */
+    bool m_renderFailed;
+    /** @brief: Insert the files of these rendered chunks in the preview track. */
     void reloadChunks(const QVariantList &chunks);
-    /** @brief: A chunk failed to render, abort. */
+    /** @brief: Returns a hash of the timeline content and render parameters used to render the chunk starting at frame. Must be called with the tractor
+     *  locked.
+     *  @param files receives the external files used by the chunk, whose modification is not part of the returned hash
+     */
+    const QByteArray chunkContent(int frame, QStringList &files) const;
+    /** @brief: Returns the hash naming a chunk, from its content and the current version of the files it uses. */
+    const QString chunkHash(const QByteArray &content, const QStringList &files);
+    /** @brief: Returns the name of the file storing the chunk with this content hash. */
+    const QString chunkFileName(const QString &hash) const;
+    /** @brief: A chunk was rendered with this content hash, make its file available to renderedChunkFile. */
+    void setChunkHash(int frame, const QString &hash);
+    /** @brief: Reuse the existing chunk files matching the current content of these chunks. Returns the restored chunks.
+     *  @param missingHashes if not null, receives the content hash of the chunks that were not found
+     */
+    QVariantList restoreChunks(const QList<int> &chunks, QHash<int, QString> *missingHashes = nullptr);
+    /** @brief: Give the rendered file of a chunk its content hash name, returns the chunk file name. */
+    const QString storeRenderedChunk(int frame);
+    /** @brief: A chunk is not rendered anymore. Move its file to the store (or delete it if @param discard is true), unless another chunk uses it. */
+    void releaseChunk(int frame, bool discard);
+    /** @brief: A chunk failed to render, put it back in the dirty list. */
     void corruptedChunk(int workingPreview, const QString &fileName);
+    /** @brief: Start a render process for the chunks assigned to this worker. */
+    void startWorker(PreviewWorker *worker, const QString &scene);
+    /** @brief: Returns true if one of the render processes is running. */
+    bool workersRunning() const;
+    /** @brief: Update the working preview to the first chunk currently processed. */
+    void updateWorkingPreview();
+    /** @brief: Process preview rendering output. */
+    void receivedStderr(PreviewWorker *worker);
+    /** @brief: A render process exited, restart it on its remaining chunks if it crashed. */
+    void processEnded(PreviewWorker *worker, int exitCode, QProcess::ExitStatus status);
     /** @brief: Get a compressed list of chunks, like: "0-500,525,575". */
     const QStringList getCompressedList(const QVariantList items) const;
 
@@ -124,17 +191,12 @@ private:
     static bool chunkSort(const QVariant &c1, const QVariant &c2) { return c1.toInt() < c2.toInt(); };
 
 private Q_SLOTS:
-    /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
+    /** @brief: To avoid filling the hard drive, remove the chunks that were released first when the store is full. */
     void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
     void doPreviewRender(const QString &scene); // std::shared_ptr<Mlt::Producer> sourceProd);
-    /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
-    void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
-    /** @brief: Process preview rendering output. */
-    void receivedStderr();
-    void processEnded(int exitCode, QProcess::ExitStatus status);
 
 public Q_SLOTS:
     /** @brief: Prepare and start rendering. */
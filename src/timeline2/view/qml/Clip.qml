@@ -55,6 +55,7 @@ Rectangle {
     property int trackId: -1 // Id of the parent track in the model
     property int fakeTid: -1
     property int fakePosition: 0
+    property var trackParent
     property int originalTrackId: -1
     property int originalX: x
     property int originalDuration: clipDuration
@@ -164,6 +165,7 @@ Rectangle {
         if (clipRoot.fakeTid > -1 && parentTrack) {
             if (clipRoot.parent != dragContainer) {
                 var pos = clipRoot.mapToGlobal(clipRoot.x, clipRoot.y);
+                clipRoot.trackParent = clipRoot.parent
                 clipRoot.parent = dragContainer
                 pos = clipRoot.mapFromGlobal(pos.x, pos.y)
                 clipRoot.x = pos.x
@@ -172,6 +174,12 @@ Rectangle {
             clipRoot.y = Logic.getTrackById(clipRoot.fakeTid).y
             clipRoot.height = Logic.getTrackById(clipRoot.fakeTid).height
         } else {
+            if (clipRoot.trackParent && clipRoot.parent == dragContainer) {
+                // The drag ended without moving the clip to another track
+                clipRoot.parent = clipRoot.trackParent
+                clipRoot.y = 0
+                clipRoot.x = modelStart * timeScale
+            }
             clipRoot.height = Qt.binding(function () {
                 return parentTrack.height
             })
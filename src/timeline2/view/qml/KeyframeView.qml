@@ -109,6 +109,7 @@ Rectangle
                 property int tmpVal : keyframeVal.y + root.baseUnit / 2
                 property int tmpPos : x + keyframeVal.x + root.baseUnit / 2
                 property int dragPos : -1
+                property bool moving: kfMouseArea.pressed || kf1MouseArea.pressed
                 anchors.bottom: parent.bottom
                 onFrameTypeChanged: {
                     keyframecanvas.requestPaint()
@@ -116,6 +117,9 @@ Rectangle
                 onValueChanged: {
                     keyframecanvas.requestPaint()
                 }
+                onMovingChanged: {
+                    keyframecanvas.requestPaint()
+                }
                 onRealValueChanged: {
                     kf1MouseArea.movingVal = kfrModel.realValue(model.normalizedValue)
                 }
@@ -300,31 +304,20 @@ Rectangle
         width: kfrCount > 0 ? Math.min(parent.width, scrollView.width) : 0
         height: kfrCount > 0 ? parent.height : 0
         opacity: keyframeContainer.selected ? 1 : 0.5
-        Component {
-            id: comp
-            PathCurve { }
-        }
-        Component {
-            id: compline
-            PathLine { }
-        }
-        property var paths : []
-        Path {
-            id: myPath
-            startX: 0
-            startY: parent.height
-        }
-
         onPaint: {
             if (kfrCount < 1) {
                 return
             }
+            // Draw directly on the context, creating path elements on each repaint would fill the canvas with objects
             var ctx = getContext("2d");
+            ctx.clearRect(0,0, width, height);
             ctx.beginPath()
             ctx.fillStyle = Qt.rgba(0,0,0.8, 0.5);
-            paths = []
+            ctx.moveTo(0, height)
             var xpos
             var ypos
+            var previousX = 0
+            var previousY
             for(var i = 0; i < keyframes.count; i++)
             {
                 if (i + 1 < keyframes.count) {
@@ -334,27 +327,42 @@ Rectangle
                 }
                 xpos = keyframes.itemAt(i).tmpPos - offset
                 var type = i > 0 ? keyframes.itemAt(i-1).frameType : keyframes.itemAt(i).frameType
-                if (type === 0) {
+                if (type === 0 && ypos !== undefined) {
                     // discrete
-                    paths.push(compline.createObject(keyframecanvas, {"x": xpos, "y": ypos} ))
+                    ctx.lineTo(xpos, ypos)
                 }
+                previousY = ypos
                 ypos = keyframes.itemAt(i).tmpVal
                 if (type < 2) {
                     // linear
-                    paths.push(compline.createObject(keyframecanvas, {"x": xpos, "y": ypos} ))
+                    ctx.lineTo(xpos, ypos)
                 } else if (type === 2) {
                     // curve
-                    paths.push(comp.createObject(keyframecanvas, {"x": xpos, "y": ypos} ))
+                    if (i > 0 && !keyframes.itemAt(i - 1).moving && !keyframes.itemAt(i).moving) {
+                        // Draw the interpolated values of the model, sampling about one value per pixel in the visible part
+                        var frameStep = Math.max(1, Math.floor(1 / timeScale))
+                        var firstFrame = Math.max(keyframes.itemAt(i - 1).frame, Math.floor(offset / timeScale) + keyframeContainer.inPoint)
+                        var lastFrame = Math.min(keyframes.itemAt(i).frame, Math.ceil((offset + width) / timeScale) + keyframeContainer.inPoint)
+                        var values = kfrModel.getNormalizedRange(firstFrame, lastFrame, frameStep)
+                        for (var j = 0; j < values.length; j++) {
+                            ctx.lineTo((firstFrame + j * frameStep - keyframeContainer.inPoint) * timeScale - offset, height - height * values[j])
+                        }
+                        ctx.lineTo(xpos, ypos)
+                    } else if (previousY === undefined) {
+                        ctx.lineTo(xpos, ypos)
+                    } else {
+                        // A keyframe of the segment is dragged, the model does not have its values yet
+                        var middle = (previousX + xpos) / 2
+                        ctx.bezierCurveTo(middle, previousY, middle, ypos, xpos, ypos)
+                    }
                 }
+                previousX = xpos
                 if (xpos > scrollView.width) {
                     break;
                 }
             }
-            paths.push(compline.createObject(keyframecanvas, {"x": keyframecanvas.width, "y": ypos} ))
-            paths.push(compline.createObject(keyframecanvas, {"x": keyframecanvas.width, "y": keyframecanvas.height} ))
-            myPath.pathElements = paths
-            ctx.clearRect(0,0, width, height);
-            ctx.path = myPath;
+            ctx.lineTo(width, ypos)
+            ctx.lineTo(width, height)
             ctx.closePath()
             ctx.fill()
         }
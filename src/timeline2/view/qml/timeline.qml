@@ -339,6 +339,7 @@ Rectangle {
     }
 
     function endDrag() {
+        controller.cancelClipDrag()
         dragProxy.draggedItem = -1
         dragProxy.x = 0
         dragProxy.y = 0
@@ -507,6 +508,9 @@ Rectangle {
     property bool scrollVertically: timeline.scrollVertically
     property int spacerMinPos: 0
 
+    onScrollMinChanged: timeline.setVisibleRange(scrollMin, scrollMax)
+    onScrollMaxChanged: timeline.setVisibleRange(scrollMin, scrollMax)
+
     onSeekingFinishedChanged : {
         playhead.opacity = seekingFinished ? 1 : 0.5
     }
@@ -1824,7 +1828,8 @@ Rectangle {
                                             var posx = Math.round((parent.x)/ root.timeScale)
                                             var posy = Math.min(Math.max(0, dragProxyArea.mouseY + parent.y - dragProxy.verticalOffset), tracksContainerArea.height)
                                             var tId = Logic.getTrackIdFromPos(posy)
-                                            if (dragProxy.masterObject && tId === dragProxy.masterObject.trackId) {
+                                            if (dragProxy.masterObject && tId === timeline.activeTrack) {
+                                                // In normal edit, the active track follows the clip or its preview
                                                 if (posx == dragFrame && controller.normalEdit()) {
                                                     return
                                                 }
@@ -1841,7 +1846,7 @@ Rectangle {
                                                     dragProxy.masterObject.x = pos.x
                                                     dragProxy.masterObject.y = pos.y
                                                 }
-                                                var moveData = controller.suggestClipMove(dragProxy.draggedItem, tId, posx, root.consumerPosition, dragProxyArea.snapping, moveMirrorTracks)
+                                                var moveData = controller.suggestClipDragMove(dragProxy.draggedItem, tId, posx, root.consumerPosition, dragProxyArea.snapping, moveMirrorTracks)
                                                 dragFrame = moveData[0]
                                                 timeline.activeTrack = moveData[1]
                                                 //timeline.getItemMovingTrack(dragProxy.draggedItem)
@@ -1868,10 +1873,16 @@ Rectangle {
                                                 controller.requestCompositionMove(dragProxy.draggedItem, tId, dragFrame , true, true, true)
                                             } else {
                                                 if (controller.normalEdit()) {
-                                                    // Move clip back to original position
-                                                    controller.requestClipMove(dragProxy.draggedItem, dragProxy.sourceTrack, dragProxy.sourceFrame, moveMirrorTracks, true, false, false, true)
-                                                    // Move clip to final pos
-                                                    controller.requestClipMove(dragProxy.draggedItem, tId, dragFrame , moveMirrorTracks, true, true, true)
+                                                    // Apply the previewed move, or finalize the move if the clip was moved for real during the drag
+                                                    var dropResult = controller.endClipDrag(dragProxy.draggedItem, moveMirrorTracks)
+                                                    if (dropResult < 1) {
+                                                        // Move clip back to original position
+                                                        controller.requestClipMove(dragProxy.draggedItem, dragProxy.sourceTrack, dragProxy.sourceFrame, moveMirrorTracks, true, false, false, true)
+                                                    }
+                                                    if (dropResult < 0) {
+                                                        // No preview, move clip to final pos
+                                                        controller.requestClipMove(dragProxy.draggedItem, tId, dragFrame , moveMirrorTracks, true, true, true)
+                                                    }
                                                 } else {
                                                     // Fake move, only process final move
                                                     timeline.endFakeMove(dragProxy.draggedItem, dragFrame, true, true, true)
@@ -7,6 +7,7 @@
 
 #include "bin/projectitemmodel.h"
 #include "capture/mediacapture.h"
+#include "lib/audio/audioLevelsPyramid.h"
 #include "core.h"
 #include "kdenlivesettings.h"
 #include <QElapsedTimer>
@@ -105,11 +106,11 @@ public:
         // setTextureSize(QSize(1, 1));
         connect(this, &TimelineWaveform::levelsChanged, [&]() {
             if (!m_binId.isEmpty()) {
-                if (m_audioLevels.isEmpty() && m_stream >= 0) {
+                if (m_peaks == nullptr && m_stream >= 0) {
                     update();
                 } else {
                     // Clip changed, reset levels
-                    m_audioLevels.clear();
+                    m_peaks.reset();
                 }
             }
         });
@@ -125,9 +126,9 @@ public:
         if (m_binId.isEmpty()) {
             return;
         }
-        if (m_audioLevels.isEmpty() && m_stream >= 0) {
-            m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId, m_stream);
-            if (m_audioLevels.isEmpty()) {
+        if (m_peaks == nullptr && m_stream >= 0) {
+            m_peaks = pCore->projectItemModel()->getAudioPeaksByBinID(m_binId, m_stream);
+            if (m_peaks == nullptr) {
                 return;
             }
             m_audioMax = KdenliveSettings::normalizechannels() ? pCore->projectItemModel()->getAudioMaxLevel(m_binId, m_stream) : 0;
@@ -143,6 +144,9 @@ public:
         QPen pen(painter->pen());
         double increment = qMax(1., m_scale / m_channels);           // qMax(1., 1. / qAbs(indicesPrPixel));
         qreal indicesPrPixel = m_channels / m_scale * qAbs(m_speed); // qreal(m_outPoint - m_inPoint) / width() * m_precisionFactor;
+        // Number of frames covered by a drawing step, the pyramid gives us the peak of this range in constant time
+        const double framesPrPixel = qAbs(m_speed) / m_scale;
+        const double stepFrames = increment * framesPrPixel;
         int h = int(height());
         double offset = 0;
         bool pathDraw = increment > 1.2;
@@ -164,16 +168,25 @@ public:
             scaleFactor = m_audioMax;
         }
         bool reverse = m_speed < 0;
-        int maxLength = m_audioLevels.length();
+        const int frameCount = m_peaks->frameCount();
+        int maxLength = frameCount * m_channels;
         if (reverse) {
             m_inPoint = qMin(m_inPoint, maxLength - m_channels);
         }
         int startPos = int(m_inPoint / indicesPrPixel);
+        // Returns the frame range drawn at position i
+        auto stepRange = [&](double i) {
+            if (reverse) {
+                double frame = (startPos - i) * framesPrPixel;
+                return qMakePair(frame - stepFrames, frame);
+            }
+            double frame = (startPos + i) * framesPrPixel;
+            return qMakePair(frame, frame + stepFrames);
+        };
         if (!KdenliveSettings::displayallchannels()) {
             // Draw merged channels
             double i = 0;
             int j = 0;
-            int idx = 0;
             QPainterPath path;
             if (pathDraw) {
                 path.moveTo(j - 1, height());
@@ -181,21 +194,12 @@ public:
             for (; i <= width(); j++) {
                 double level;
                 i = j * increment;
-                if (reverse) {
-                    idx = qCeil((startPos - i) * indicesPrPixel);
-                    idx -= idx % m_channels;
-                } else {
-                    idx = qCeil((startPos + i) * indicesPrPixel);
-                    idx += idx % m_channels;
-                }
+                const QPair<double, double> range = stepRange(i);
                 i -= offset;
-                if (idx + m_channels >= maxLength || idx < 0) {
+                if (range.first >= frameCount || range.second < 0) {
                     break;
                 }
-                level = m_audioLevels.at(idx) / scaleFactor;
-                for (int k = 1; k < m_channels; k++) {
-                    level = qMax(level, m_audioLevels.at(idx + k) / scaleFactor);
-                }
+                level = m_peaks->peakInRange(range.first, range.second).level() / scaleFactor;
                 if (pathDraw) {
                     double val = height() - level * height();
                     path.lineTo(i, val);
@@ -216,11 +220,13 @@ public:
             bgRect.setHeight(channelHeight);
             // Path for vector drawing
             for (int channel = 0; channel < m_channels; channel++) {
-                double level;
                 // y is channel median pos
                 double y = (channel * channelHeight) + channelHeight / 2;
+                // Positive peaks are drawn above the median line, negative ones below
                 QPainterPath path;
+                QPainterPath lowPath;
                 path.moveTo(-1, y);
+                lowPath.moveTo(-1, y);
                 if (channel % 2 == 0) {
                     // Add dark background on odd channels
                     painter->setOpacity(0.2);
@@ -239,32 +245,28 @@ public:
                 painter->setOpacity(1);
                 double i = 0;
                 int j = 0;
-                int idx = 0;
                 for (; i <= width(); j++) {
                     i = j * increment;
-                    if (reverse) {
-                        idx = qCeil((startPos - i) * indicesPrPixel);
-                        idx -= idx % m_channels;
-                    } else {
-                        idx = qCeil((startPos + i) * indicesPrPixel);
-                        idx += idx % m_channels;
-                    }
+                    const QPair<double, double> range = stepRange(i);
                     i -= offset;
-                    idx += channel;
-                    if (idx >= maxLength || idx < 0) break;
+                    if (range.first >= frameCount || range.second < 0) {
+                        break;
+                    }
+                    const AudioLevelsPyramid::Peak peak = m_peaks->peakInRange(range.first, range.second, channel);
+                    double high = peak.high * scaleFactor;
+                    double low = peak.low * scaleFactor;
                     if (pathDraw) {
-                        level = m_audioLevels.at(idx) * scaleFactor;
-                        path.lineTo(i, y - level);
+                        path.lineTo(i, y - high);
+                        lowPath.lineTo(i, y + low);
                     } else {
-                        level = m_audioLevels.at(idx) * scaleFactor; // divide height by 510 (2*255) to get height
-                        painter->drawLine(int(i), int(y - level), int(i), int(y + level));
+                        painter->drawLine(int(i), int(y - high), int(i), int(y + low));
                     }
                 }
                 if (pathDraw) {
                     path.lineTo(i, y);
+                    lowPath.lineTo(i, y);
                     painter->drawPath(path);
-                    QTransform tr(1, 0, 0, -1, 0, 2 * y);
-                    painter->drawPath(tr.map(path));
+                    painter->drawPath(lowPath);
                 }
                 if (m_firstChunk && m_channels > 1 && m_channels < 7) {
                     const QStringList chanelNames{"L", "R", "C", "LFE", "BL", "BR"};
@@ -282,7 +284,7 @@ Q_SIGNALS:
     void audioChannelsChanged();
 
 private:
-    QVector<uint8_t> m_audioLevels;
+    std::shared_ptr<const AudioLevelsPyramid> m_peaks;
     int m_inPoint;
     int m_outPoint;
     QString m_binId;
@@ -9,7 +9,6 @@
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
-#include "doc/kthumb.h"
 #include "utils/thumbnailcache.hpp"
 
 #include <QCryptographicHash>
@@ -26,6 +25,7 @@ ThumbnailProvider::~ThumbnailProvider() = default;
 
 QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
+    Q_UNUSED(requestedSize)
     QImage result;
     // id is binID/#frameNumber
     QString binId = id.section('/', 0, 0);
@@ -44,9 +44,9 @@ QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSi
                 *size = result.size();
                 return result;
             }
-            std::shared_ptr<Mlt::Producer> prod = binClip->thumbProducer();
-            if (prod && prod->is_valid()) {
-                result = makeThumbnail(prod, frameNumber, requestedSize);
+            // Concurrent requests on the same clip are spread over the clip's thumbnail producers
+            result = binClip->fetchThumbnail(frameNumber);
+            if (!result.isNull()) {
                 ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
             }
         }
@@ -72,18 +72,3 @@ QString ThumbnailProvider::cacheKey(Mlt::Properties &properties, const QString &
     }
     return key;
 }
-
-QImage ThumbnailProvider::makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize)
-{
-    Q_UNUSED(requestedSize)
-    producer->seek(frameNumber);
-    QScopedPointer<Mlt::Frame> frame(producer->get_frame());
-    if (frame == nullptr || !frame->is_valid()) {
-        return QImage();
-    }
-    // TODO: cache these values ?
-    int imageHeight = pCore->thumbProfile()->height();
-    int imageWidth = pCore->thumbProfile()->width();
-    int fullWidth = qRound(imageHeight * pCore->getCurrentDar());
-    return KThumb::getFrame(frame.data(), imageWidth, imageHeight, fullWidth);
-}
@@ -76,6 +76,11 @@ TimelineController::TimelineController(QObject *parent)
     connect(pCore.get(), &Core::autoScrollChanged, this, &TimelineController::autoScrollChanged);
     connect(pCore.get(), &Core::recordAudio, this, &TimelineController::switchRecording);
     connect(pCore.get(), &Core::refreshActiveGuides, this, [this]() { m_activeSnaps.clear(); });
+    // Scrolling emits a range change on each step, reprioritize tasks at most once per interval while it goes on
+    m_visibleRangeTimer.setSingleShot(true);
+    m_visibleRangeTimer.setInterval(150);
+    connect(&m_visibleRangeTimer, &QTimer::timeout, this, &TimelineController::updateVisibleClips);
+    connect(this, &TimelineController::scaleFactorChanged, this, &TimelineController::scheduleVisibleClipsUpdate);
 }
 
 TimelineController::~TimelineController() {}
@@ -124,6 +129,15 @@ void TimelineController::setModel(std::shared_ptr<TimelineItemModel> model)
     connect(this, &TimelineController::videoTargetChanged, this, &TimelineController::updateVideoTarget);
     connect(this, &TimelineController::audioTargetChanged, this, &TimelineController::updateAudioTarget);
     connect(m_model.get(), &TimelineItemModel::requestMonitorRefresh, [&]() { pCore->refreshProjectMonitorOnce(); });
+    // Inserted, deleted and moved clips change the clips in the visible range
+    connect(m_model.get(), &TimelineItemModel::rowsInserted, this, &TimelineController::scheduleVisibleClipsUpdate);
+    connect(m_model.get(), &TimelineItemModel::rowsRemoved, this, &TimelineController::scheduleVisibleClipsUpdate);
+    connect(m_model.get(), &TimelineItemModel::modelReset, this, &TimelineController::scheduleVisibleClipsUpdate);
+    connect(m_model.get(), &TimelineItemModel::dataChanged, this, [this](const QModelIndex &, const QModelIndex &, const QVector<int> &roles) {
+        if (roles.contains(TimelineModel::StartRole) || roles.contains(TimelineModel::DurationRole)) {
+            scheduleVisibleClipsUpdate();
+        }
+    });
     connect(m_model.get(), &TimelineModel::durationUpdated, this, &TimelineController::checkDuration);
     connect(m_model.get(), &TimelineModel::selectionChanged, this, &TimelineController::selectionChanged);
     connect(m_model.get(), &TimelineModel::selectedMixChanged, this, &TimelineController::showMixModel);
@@ -404,6 +418,34 @@ void TimelineController::selectItems(const QList<int> &ids)
     m_model->requestSetSelection(ids_s);
 }
 
+void TimelineController::setVisibleRange(int start, int end)
+{
+    m_visibleRange = QPoint(start, end);
+    scheduleVisibleClipsUpdate();
+}
+
+void TimelineController::scheduleVisibleClipsUpdate()
+{
+    if (!m_visibleRangeTimer.isActive()) {
+        m_visibleRangeTimer.start();
+    }
+}
+
+void TimelineController::updateVisibleClips()
+{
+    if (!m_model) {
+        return;
+    }
+    std::unordered_set<int> binIds;
+    for (const auto &track : m_model->m_allTracks) {
+        const std::unordered_set<int> clips = track->getClipsInRange(m_visibleRange.x(), m_visibleRange.y());
+        for (int clipId : clips) {
+            binIds.insert(m_model->getClipBinId(clipId).toInt());
+        }
+    }
+    pCore->taskManager.setVisibleClips(binIds);
+}
+
 void TimelineController::setScrollPos(int pos)
 {
     if (pos > 0 && m_root) {
@@ -3287,92 +3329,127 @@ void TimelineController::setAudioRef(int clipId)
         }
     }
     m_audioRef = clipId;
-    std::unique_ptr<AudioEnvelope> envelope(new AudioEnvelope(getClipBinId(clipId), clipId));
-    m_audioCorrelator.reset(new AudioCorrelation(std::move(envelope)));
-    connect(m_audioCorrelator.get(), &AudioCorrelation::gotAudioAlignData, this, [&](int cid, int shift) {
-        // Ensure the clip was not deleted while processing calculations
-        if (m_model->isClip(cid)) {
-            int pos = m_model->getClipPosition(m_audioRef) + shift - m_model->getClipIn(m_audioRef);
-            bool result = m_model->requestClipMove(cid, m_model->getClipTrackId(cid), pos, true, true, true);
-            if (!result) {
-                pCore->displayMessage(i18n("Cannot move clip to frame %1.", (pos + shift)), ErrorMessage, 500);
-            }
-        } else {
-            // Clip was deleted, discard audio reference
-            m_audioRef = -1;
-        }
-    });
-    connect(m_audioCorrelator.get(), &AudioCorrelation::displayMessage, pCore.get(), &Core::displayMessage);
+    // Start computing the reference envelope while the clips to align are selected
+    m_audioAlignment.reset(new AudioAlignment(getClipBinId(clipId), clipId));
 }
 
 void TimelineController::alignAudio(int clipId)
 {
-    // find other clip
+    std::unordered_set<int> clipsToAnalyse;
     if (clipId == -1) {
-        clipId = getMainSelectedClip();
-        if (clipId == -1) {
-            pCore->displayMessage(i18n("No clip selected"), ErrorMessage, 500);
-            return;
-        }
+        // Align the whole selection
+        clipsToAnalyse = m_model->getCurrentSelection();
+    } else if (m_model->m_groups->isInGroup(clipId)) {
+        clipsToAnalyse = m_model->getGroupElements(clipId);
+    } else {
+        clipsToAnalyse.insert(clipId);
     }
-    if (m_audioRef == -1 || m_audioRef == clipId || !m_model->isClip(m_audioRef)) {
+    clipsToAnalyse.erase(m_audioRef);
+    if (clipsToAnalyse.empty()) {
+        pCore->displayMessage(i18n("No clip selected"), ErrorMessage, 500);
+        return;
+    }
+    if (m_audioRef == -1 || !m_model->isClip(m_audioRef)) {
         pCore->displayMessage(i18n("Set audio reference before attempting to align"), InformationMessage, 500);
         return;
     }
+    // Clips are moved with their real group, not with the selection
+    m_model->requestClearSelection();
     const QString masterBinClipId = getClipBinId(m_audioRef);
-    std::unordered_set<int> clipsToAnalyse;
-    if (m_model->m_groups->isInGroup(clipId)) {
-        clipsToAnalyse = m_model->getGroupElements(clipId);
-        m_model->requestClearSelection();
-    } else {
-        clipsToAnalyse.insert(clipId);
+    if (!m_audioAlignment || m_audioAlignment->hasStarted() || m_audioAlignment->referenceId() != m_audioRef) {
+        // Envelopes already computed for the same clip zones are reused from the cache
+        m_audioAlignment.reset(new AudioAlignment(masterBinClipId, m_audioRef));
     }
     QList<int> processedGroups;
-    int processed = 0;
+    QList<int> sameSource;
     for (int cid : clipsToAnalyse) {
-        if (!m_model->isClip(cid) || cid == m_audioRef) {
+        if (!m_model->isClip(cid)) {
             continue;
         }
         const QString otherBinId = getClipBinId(cid);
+        if (!pCore->bin()->getBinClip(otherBinId)->hasAudio()) {
+            // Cannot process non audio clips
+            continue;
+        }
         if (m_model->m_groups->isInGroup(cid)) {
+            // Only process one clip from each group
             int parentGroup = m_model->m_groups->getRootId(cid);
             if (processedGroups.contains(parentGroup)) {
                 continue;
             }
-            // Only process one clip from the group
-            std::shared_ptr<ProjectClip> clip = pCore->bin()->getBinClip(otherBinId);
-            if (clip->hasAudio()) {
-                processedGroups << parentGroup;
-            } else {
-                continue;
-            }
-        }
-        if (!pCore->bin()->getBinClip(otherBinId)->hasAudio()) {
-            // Cannot process non audi clips
-            continue;
+            processedGroups << parentGroup;
         }
         if (otherBinId == masterBinClipId) {
             // easy, same clip.
-            int newPos = m_model->getClipPosition(m_audioRef) - m_model->getClipIn(m_audioRef) + m_model->getClipIn(cid);
-            if (newPos) {
-                bool result = m_model->requestClipMove(cid, m_model->getClipTrackId(cid), newPos, true, true, true);
-                processed++;
-                if (!result) {
-                    pCore->displayMessage(i18n("Cannot move clip to frame %1.", newPos), ErrorMessage, 500);
-                }
-                continue;
-            }
+            sameSource << cid;
+            continue;
         }
-        processed++;
         // Perform audio calculation
-        auto *envelope =
-            new AudioEnvelope(otherBinId, cid, size_t(m_model->getClipIn(cid)), size_t(m_model->getClipPlaytime(cid)), size_t(m_model->getClipPosition(cid)));
-        m_audioCorrelator->addChild(envelope);
+        m_audioAlignment->addChild(otherBinId, cid, size_t(m_model->getClipIn(cid)), size_t(m_model->getClipPlaytime(cid)),
+                                   size_t(m_model->getClipPosition(cid)));
     }
-    if (processed == 0) {
-        // TODO: improve feedback message after freeze
-        pCore->displayMessage(i18n("Select a clip to apply an effect"), ErrorMessage, 500);
+    if (sameSource.isEmpty() && m_audioAlignment->childCount() == 0) {
+        pCore->displayMessage(i18n("No audio clip to align"), ErrorMessage, 500);
+        return;
     }
+    AudioAlignment *alignment = m_audioAlignment.get();
+    connect(alignment, &AudioAlignment::displayMessage, pCore.get(), &Core::displayMessage);
+    connect(alignment, &AudioAlignment::finished, this, [this, alignment, sameSource]() {
+        // Ensure the reference was not deleted while processing calculations
+        if (!m_model->isClip(m_audioRef) || alignment->referenceId() != m_audioRef) {
+            m_audioRef = -1;
+            pCore->displayMessage(i18n("Audio reference was removed"), ErrorMessage, 500);
+            return;
+        }
+        const int origin = m_model->getClipPosition(m_audioRef) - m_model->getClipIn(m_audioRef);
+        QMap<int, int> positions;
+        for (int cid : sameSource) {
+            positions.insert(cid, origin + m_model->getClipIn(cid));
+        }
+        int lowConfidence = 0;
+        for (const AudioAlignment::Result &result : alignment->results()) {
+            if (!result.valid) {
+                continue;
+            }
+            if (result.confidence < AudioAlignment::LowConfidence) {
+                lowConfidence++;
+            }
+            positions.insert(result.clipId, origin + result.shift);
+        }
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        int moved = 0;
+        for (auto it = positions.cbegin(); it != positions.cend(); ++it) {
+            const int cid = it.key();
+            // Clip was deleted while processing
+            if (!m_model->isClip(cid)) {
+                continue;
+            }
+            const int delta = it.value() - m_model->getClipPosition(cid);
+            bool result = true;
+            if (delta == 0) {
+                continue;
+            } else if (m_model->m_groups->isInGroup(cid)) {
+                result = m_model->requestGroupMove(cid, m_model->m_groups->getRootId(cid), 0, delta, true, true, undo, redo);
+            } else {
+                result = m_model->requestClipMove(cid, m_model->getClipTrackId(cid), it.value(), true, true, true, true, undo, redo);
+            }
+            if (result) {
+                moved++;
+            } else {
+                pCore->displayMessage(i18n("Cannot move clip to frame %1.", it.value()), ErrorMessage, 500);
+            }
+        }
+        if (moved > 0) {
+            pCore->pushUndo(undo, redo, i18np("Align clip", "Align %1 clips", moved));
+        }
+        if (lowConfidence > 0) {
+            pCore->displayMessage(i18np("Alignment of %1 clip is uncertain", "Alignment of %1 clips is uncertain", lowConfidence), ErrorMessage, 1000);
+        } else {
+            pCore->displayMessage(i18np("Aligned %1 clip", "Aligned %1 clips", positions.size()), OperationCompletedMessage, 500);
+        }
+    });
+    m_audioAlignment->start();
 }
 
 void TimelineController::switchTrackActive(int trackId)
@@ -6,12 +6,13 @@
 #pragma once
 
 #include "definitions.h"
-#include "lib/audio/audioCorrelation.h"
+#include "lib/audio/audioAlignment.h"
 #include "timeline2/model/timelineitemmodel.hpp"
 
 #include <KActionCollection>
 #include <QApplication>
 #include <QDir>
+#include <QTimer>
 
 class QAction;
 class QQuickItem;
@@ -129,6 +130,9 @@ public:
     /** @brief Returns true is item is selected as well as other items */
     Q_INVOKABLE bool isInSelection(int itemId);
 
+    /** @brief The timeline view was scrolled or zoomed, the jobs of the clips visible between start and end frames get a higher priority */
+    Q_INVOKABLE void setVisibleRange(int start, int end);
+
     /** @brief Show/hide audio record controls on a track
      */
     Q_INVOKABLE void switchRecording(int trackId, bool record);
@@ -456,7 +460,9 @@ public:
 
     Q_INVOKABLE void splitAudio(int clipId);
     Q_INVOKABLE void splitVideo(int clipId);
+    /** @brief Set the clip on which other clips are aligned, and start analysing its audio */
     Q_INVOKABLE void setAudioRef(int clipId = -1);
+    /** @brief Align the audio of a clip (with its group), or of all selected clips if @param clipId is -1, on the audio reference */
     Q_INVOKABLE void alignAudio(int clipId = -1);
     Q_INVOKABLE void urlDropped(QStringList droppedFile, int frame, int tid);
 
@@ -727,6 +733,13 @@ public:
 private:
     int m_duration;
     QQuickItem *m_root;
+    /** @brief The visible timeline range, sent to the task manager at most once per interval of m_visibleRangeTimer */
+    QPoint m_visibleRange;
+    QTimer m_visibleRangeTimer;
+    /** @brief Send the clips in the visible range to the task manager */
+    void updateVisibleClips();
+    /** @brief Start m_visibleRangeTimer if it is not running, the visible range or the clips it contains changed */
+    void scheduleVisibleClipsUpdate();
     KActionCollection *m_actionCollection;
     std::shared_ptr<TimelineItemModel> m_model;
     bool m_usePreview;
@@ -746,7 +759,7 @@ private:
     int m_activeTrack;
     double m_scale;
     QAction *m_disablePreview;
-    std::shared_ptr<AudioCorrelation> m_audioCorrelator;
+    std::unique_ptr<AudioAlignment> m_audioAlignment;
     QMutex m_metaMutex;
     bool m_ready;
     std::vector<int> m_activeSnaps;
@@ -57,6 +57,8 @@ protected:
     /** @brief Returns the path to the effects' preferred list*/
     QString assetPreferredListPath() const override;
 
+    QString assetCacheName() const override;
+
     void parseType(QScopedPointer<Mlt::Properties> &metadata, Info &res) override;
 
     /** @brief Returns the metadata associated with the given asset*/
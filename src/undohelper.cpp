@@ -7,8 +7,35 @@
 #ifdef CRASH_AUTO_TEST
 #include "logger.hpp"
 #endif
+#include <QAbstractEventDispatcher>
 #include <QDebug>
+#include <QTimer>
 #include <utility>
+
+namespace {
+/** @brief Data captured by the lambdas built in this thread since the last command was created */
+thread_local qint64 pendingPayload = 0;
+thread_local bool payloadResetQueued = false;
+} // namespace
+
+void addUndoPayload(qint64 bytes)
+{
+    // Commands are pushed in the same call as their lambdas are built. Lambdas built without logging undo, or dropped after a failed
+    // operation, never become a command: forget their payload once we are back to the event loop so it is not charged to the next command.
+    // Threads without an event loop (like the thread pool) never get back to it, so their payload is not recorded at all
+    if (QAbstractEventDispatcher::instance() == nullptr) {
+        return;
+    }
+    pendingPayload += bytes;
+    if (!payloadResetQueued) {
+        payloadResetQueued = true;
+        QTimer::singleShot(0, []() {
+            pendingPayload = 0;
+            payloadResetQueued = false;
+        });
+    }
+}
+
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
@@ -16,6 +43,21 @@ FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &
     , m_undone(false)
 {
     setText(text);
+    // The captures of the lambdas cannot be measured, use the size reported while building them
+    m_memoryCost = qint64(sizeof(FunctionalUndoCommand)) + 2 * UndoLambdaCost + text.size() * qint64(sizeof(QChar)) + pendingPayload;
+    pendingPayload = 0;
+}
+
+qint64 FunctionalUndoCommand::memoryCost() const
+{
+    return m_memoryCost;
+}
+
+void FunctionalUndoCommand::releaseLambdas()
+{
+    m_undo = nullptr;
+    m_redo = nullptr;
+    m_memoryCost = qint64(sizeof(FunctionalUndoCommand)) + text().size() * qint64(sizeof(QChar));
 }
 
 void FunctionalUndoCommand::undo()
@@ -25,13 +67,17 @@ void FunctionalUndoCommand::undo()
     Logger::log_undo(true);
 #endif
     m_undone = true;
+    if (!m_undo) {
+        // Released command
+        return;
+    }
     bool res = m_undo();
     Q_ASSERT(res);
 }
 
 void FunctionalUndoCommand::redo()
 {
-    if (m_undone) {
+    if (m_undone && m_redo) {
         // qDebug() << "REDOING " <<text();
 #ifdef CRASH_AUTO_TEST
         Logger::log_undo(false);
@@ -5,17 +5,28 @@
 
 #pragma once
 
+#include <QtGlobal>
 #include <functional>
 
 using Fun = std::function<bool(void)>;
 
+/** @brief Estimated size of the closure created when chaining two lambdas */
+constexpr qint64 UndoLambdaCost = 2 * qint64(sizeof(Fun)) + 16;
+
+/** @brief Account for @param bytes of data captured by the undo/redo lambdas being built in this thread.
+    They are added to the memory cost of the next FunctionalUndoCommand created in this thread before it returns to its event loop.
+    Nothing is recorded in threads without an event loop.
+ */
+void addUndoPayload(qint64 bytes);
+
 /** @brief this macro executes an operation after a given lambda
  */
 #define PUSH_LAMBDA(operation, lambda)                                                                                                                         \
     lambda = [lambda, operation]() {                                                                                                                           \
         bool v = lambda();                                                                                                                                     \
         return v && operation();                                                                                                                               \
-    };
+    };                                                                                                                                                         \
+    addUndoPayload(UndoLambdaCost);
 
 /** @brief this macro executes an operation before a given lambda
  */
@@ -23,7 +34,8 @@ using Fun = std::function<bool(void)>;
     lambda = [lambda, operation]() {                                                                                                                           \
         bool v = operation();                                                                                                                                  \
         return v && lambda();                                                                                                                                  \
-    };
+    };                                                                                                                                                         \
+    addUndoPayload(UndoLambdaCost);
 
 #include <QUndoCommand>
 
@@ -38,8 +50,15 @@ public:
     FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
+    /** @brief Estimated memory used by this command and the data captured by its lambdas */
+    qint64 memoryCost() const;
+    /** @brief Free the lambdas of this command, it does nothing anymore when undone or redone.
+        Used to drop the oldest history when it uses too much memory.
+     */
+    void releaseLambdas();
 
 private:
     Fun m_undo, m_redo;
     bool m_undone;
+    qint64 m_memoryCost;
 };
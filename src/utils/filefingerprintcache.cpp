@@ -0,0 +1,235 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "filefingerprintcache.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+std::unique_ptr<FileFingerprintCache> FileFingerprintCache::instance;
+std::once_flag FileFingerprintCache::m_onceFlag;
+
+namespace {
+const quint32 cacheMagic = 0x4b444650; // KDFP
+const quint32 cacheVersion = 1;
+// Entries not used for this number of days are dropped when saving
+const qint64 maxUnusedDays = 180;
+
+qint64 today()
+{
+    return QDateTime::currentSecsSinceEpoch() / 86400;
+}
+
+quint64 mix(quint64 value)
+{
+    // splitmix64 finalizer
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+} // namespace
+
+size_t FileFingerprintCache::FileKeyHash::operator()(const FileKey &key) const
+{
+    quint64 h = mix(key.device);
+    h = mix(h ^ key.inode);
+    h = mix(h ^ quint64(key.size));
+    h = mix(h ^ quint64(key.modified));
+    return size_t(h);
+}
+
+FileFingerprintCache::FileFingerprintCache(const QString &path)
+    : m_path(path)
+    , m_loaded(false)
+    , m_dirty(false)
+{
+}
+
+FileFingerprintCache::~FileFingerprintCache()
+{
+    save();
+}
+
+std::unique_ptr<FileFingerprintCache> &FileFingerprintCache::get()
+{
+    std::call_once(m_onceFlag, [] {
+        const QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        instance.reset(new FileFingerprintCache(cacheDir.absoluteFilePath(QStringLiteral("fingerprints.cache"))));
+    });
+    return instance;
+}
+
+bool FileFingerprintCache::fileKey(const QString &path, FileKey &key)
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return false;
+    }
+    key.size = info.size();
+    key.modified = info.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return false;
+    }
+    key.device = quint64(st.st_dev);
+    key.inode = quint64(st.st_ino);
+#else
+    // No inode, identify the file by its path
+    const QByteArray canonical = info.absoluteFilePath().toUtf8();
+    key.inode = qFromUnaligned<quint64>(QCryptographicHash::hash(canonical, QCryptographicHash::Md5).constData());
+#endif
+    return true;
+}
+
+FileFingerprintCache::Fingerprint FileFingerprintCache::computeHash(const QString &path)
+{
+    QFile file(path);
+    QByteArray fileHash;
+    qint64 fSize = 0;
+    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
+        /*
+         * 1 MB = 1 second per 450 files (or faster)
+         * 10 MB = 9 seconds per 450 files (or faster)
+         */
+        QByteArray fileData;
+        fSize = file.size();
+        if (fSize > 2000000) {
+            fileData = file.read(1000000);
+            if (file.seek(file.size() - 1000000)) {
+                fileData.append(file.readAll());
+            }
+        } else {
+            fileData = file.readAll();
+        }
+        file.close();
+        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+    }
+    return {fileHash, fSize};
+}
+
+FileFingerprintCache::Fingerprint FileFingerprintCache::fileHash(const QString &path)
+{
+    FileKey key;
+    if (!fileKey(path, key)) {
+        return computeHash(path);
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        load();
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            const qint64 day = today();
+            if (it->second.lastUse != day) {
+                it->second.lastUse = day;
+                m_dirty = true;
+            }
+            return {it->second.hash, key.size};
+        }
+    }
+    const Fingerprint result = computeHash(path);
+    FileKey after;
+    // Don't cache a file that was modified while we read it
+    if (!result.first.isEmpty() && fileKey(path, after) && after == key) {
+        QMutexLocker lock(&m_mutex);
+        m_entries[key] = {result.first, today()};
+        m_dirty = true;
+    }
+    return result;
+}
+
+void FileFingerprintCache::prefetch(const QStringList &paths)
+{
+    QStringList files = paths;
+    files.removeDuplicates();
+    QtConcurrent::blockingMap(files, [this](const QString &path) { fileHash(path); });
+}
+
+int FileFingerprintCache::count()
+{
+    QMutexLocker lock(&m_mutex);
+    load();
+    return int(m_entries.size());
+}
+
+void FileFingerprintCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 entries = 0;
+    stream >> magic >> version >> entries;
+    if (magic != cacheMagic || version != cacheVersion) {
+        qWarning() << "Discarding invalid fingerprint cache" << m_path;
+        return;
+    }
+    m_entries.reserve(entries);
+    for (quint32 i = 0; i < entries && stream.status() == QDataStream::Ok; ++i) {
+        FileKey key;
+        Entry entry;
+        stream >> key.device >> key.inode >> key.size >> key.modified >> entry.lastUse >> entry.hash;
+        if (stream.status() == QDataStream::Ok) {
+            m_entries[key] = entry;
+        }
+    }
+}
+
+bool FileFingerprintCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty) {
+        return true;
+    }
+    const qint64 oldest = today() - maxUnusedDays;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.lastUse < oldest) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write fingerprint cache" << m_path;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << cacheMagic << cacheVersion << quint32(m_entries.size());
+    for (const auto &entry : m_entries) {
+        stream << entry.first.device << entry.first.inode << entry.first.size << entry.first.modified << entry.second.lastUse << entry.second.hash;
+    }
+    if (!file.commit()) {
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/** @class FileFingerprintCache
+    @brief Persistent cache of the content hashes of media files.
+    Kdenlive identifies media files by the MD5 of their first and last megabyte. Reading these on every project opening is slow
+    on network storage, so the hashes are stored in a cache file, keyed by the device, inode, size and modification time of
+    the file: the content is only read again when one of them changes. The key is looked up through a cheap 64 bit mix of
+    these values instead of hashing the path.
+    The cache is shared by clip loading, the document checker and the missing file searches. It is thread safe, and files
+    are hashed outside of the lock so that several threads can hash concurrently.
+ */
+class FileFingerprintCache
+{
+public:
+    /** @brief The content hash of a file and its size */
+    using Fingerprint = QPair<QByteArray, qint64>;
+
+    /** @brief Create a cache stored in @param path, which is loaded on first use */
+    explicit FileFingerprintCache(const QString &path);
+    /** @brief Saves the cache if it changed */
+    ~FileFingerprintCache();
+
+    // Returns the instance of the Singleton
+    static std::unique_ptr<FileFingerprintCache> &get();
+
+    /** @brief Returns the fingerprint of a file, only reading it if it is not in the cache.
+        The hash is empty if the file cannot be read.
+     */
+    Fingerprint fileHash(const QString &path);
+    /** @brief Compute the fingerprints of several files in parallel on the global thread pool */
+    void prefetch(const QStringList &paths);
+    /** @brief Write the cache file, dropping entries unused for a long time */
+    bool save();
+    /** @brief Number of cached files */
+    int count();
+
+    /** @brief Read a file to compute its fingerprint, without using the cache */
+    static Fingerprint computeHash(const QString &path);
+
+private:
+    struct FileKey
+    {
+        quint64 device{0};
+        quint64 inode{0};
+        qint64 size{0};
+        qint64 modified{0};
+        bool operator==(const FileKey &other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && modified == other.modified;
+        }
+    };
+    struct FileKeyHash
+    {
+        size_t operator()(const FileKey &key) const;
+    };
+    struct Entry
+    {
+        QByteArray hash;
+        /** @brief Day of the last use, since epoch */
+        qint64 lastUse;
+    };
+    /** @brief Identify the current version of a file, returns false if it does not exist */
+    static bool fileKey(const QString &path, FileKey &key);
+    /** @brief Read the cache file, must be called with m_mutex locked */
+    void load();
+
+    static std::unique_ptr<FileFingerprintCache> instance;
+    static std::once_flag m_onceFlag;
+    const QString m_path;
+    QMutex m_mutex;
+    std::unordered_map<FileKey, Entry, FileKeyHash> m_entries;
+    bool m_loaded;
+    bool m_dirty;
+};
@@ -0,0 +1,180 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "lumathumbnailcache.hpp"
+
+#include <QAbstractItemView>
+#include <QComboBox>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QEvent>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPixmap>
+#include <QSaveFile>
+#include <QScrollBar>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+std::unique_ptr<LumaThumbnailCache> LumaThumbnailCache::instance;
+std::once_flag LumaThumbnailCache::m_onceFlag;
+const QSize LumaThumbnailCache::ThumbnailSize(50, 30);
+
+LumaThumbnailCache::LumaThumbnailCache(const QString &cacheDir)
+    : QObject()
+    , m_cacheDir(cacheDir)
+{
+}
+
+std::unique_ptr<LumaThumbnailCache> &LumaThumbnailCache::get()
+{
+    std::call_once(m_onceFlag, [] {
+        const QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        instance.reset(new LumaThumbnailCache(cacheDir.absoluteFilePath(QStringLiteral("lumas"))));
+    });
+    return instance;
+}
+
+bool LumaThumbnailCache::isLumaFile(const QString &path)
+{
+    return path.endsWith(QLatin1String(".png"), Qt::CaseInsensitive) || path.endsWith(QLatin1String(".pgm"), Qt::CaseInsensitive);
+}
+
+QString LumaThumbnailCache::cacheFile(const QString &path) const
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return QString();
+    }
+    // A modified luma gets a new thumbnail
+    const QByteArray key = info.absoluteFilePath().toUtf8() + '#' + QByteArray::number(info.size()) + '#' +
+                           QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    return QDir(m_cacheDir).absoluteFilePath(QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Md5).toHex()) + QStringLiteral(".png"));
+}
+
+QImage LumaThumbnailCache::loadThumbnail(const QString &path) const
+{
+    const QString cached = cacheFile(path);
+    if (cached.isEmpty()) {
+        return QImage();
+    }
+    QImage thumb(cached);
+    if (!thumb.isNull()) {
+        return thumb;
+    }
+    QImageReader reader(path);
+    const QImage full = reader.read();
+    if (full.isNull()) {
+        return QImage();
+    }
+    thumb = full.scaled(ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QDir().mkpath(m_cacheDir);
+    QSaveFile file(cached);
+    if (file.open(QIODevice::WriteOnly) && thumb.save(&file, "PNG")) {
+        file.commit();
+    }
+    return thumb;
+}
+
+QImage LumaThumbnailCache::thumbnail(const QString &path)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_thumbnails.constFind(path);
+    if (it != m_thumbnails.constEnd()) {
+        return it.value();
+    }
+    if (m_pending.contains(path)) {
+        return QImage();
+    }
+    m_pending.insert(path);
+    QThreadPool::globalInstance()->start([this, path]() {
+        const QImage thumb = loadThumbnail(path);
+        {
+            QMutexLocker lk(&m_mutex);
+            m_pending.remove(path);
+            // Also remember failures, so that invalid files are not read again
+            m_thumbnails.insert(path, thumb);
+        }
+        if (!thumb.isNull()) {
+            QMetaObject::invokeMethod(this, [this, path, thumb]() { Q_EMIT thumbnailReady(path, thumb); }, Qt::QueuedConnection);
+        }
+    });
+    return QImage();
+}
+
+void LumaThumbnailCache::setComboIcons(QComboBox *combo)
+{
+    if (!combo->property("_lumathumbnails").toBool()) {
+        // Only connect each combo box once, it is refilled on each refresh
+        combo->setProperty("_lumathumbnails", true);
+        connect(this, &LumaThumbnailCache::thumbnailReady, combo, [combo](const QString &path, const QImage &image) {
+            int ix = combo->findData(path);
+            if (ix > -1) {
+                combo->setItemIcon(ix, QPixmap::fromImage(image));
+            }
+        });
+        connect(combo, QOverload<int>::of(&QComboBox::currentIndexChanged), combo, [this, combo](int ix) {
+            if (ix > -1) {
+                setItemIcon(combo, ix, true);
+            }
+        });
+        combo->view()->installEventFilter(this);
+        connect(combo->view()->verticalScrollBar(), &QScrollBar::valueChanged, combo, [this, combo]() {
+            if (combo->view()->isVisible()) {
+                setVisibleIcons(combo);
+            }
+        });
+    }
+    for (int i = 0; i < combo->count(); ++i) {
+        setItemIcon(combo, i, i == combo->currentIndex());
+    }
+}
+
+void LumaThumbnailCache::setItemIcon(QComboBox *combo, int row, bool load)
+{
+    const QString path = combo->itemData(row).toString();
+    if (!isLumaFile(path)) {
+        return;
+    }
+    QImage thumb;
+    if (load) {
+        thumb = thumbnail(path);
+    } else {
+        QMutexLocker lock(&m_mutex);
+        thumb = m_thumbnails.value(path);
+    }
+    if (!thumb.isNull()) {
+        combo->setItemIcon(row, QPixmap::fromImage(thumb));
+    }
+}
+
+void LumaThumbnailCache::setVisibleIcons(QComboBox *combo)
+{
+    QAbstractItemView *view = combo->view();
+    const QRect area = view->viewport()->rect();
+    const int first = qMax(0, view->indexAt(area.topLeft()).row());
+    const QModelIndex last = view->indexAt(area.bottomLeft());
+    // Before the popup is laid out, assume it shows as many rows as it can
+    const int lastRow = last.isValid() ? last.row() : qMin(combo->count() - 1, first + combo->maxVisibleItems() - 1);
+    for (int i = first; i <= lastRow; ++i) {
+        setItemIcon(combo, i, true);
+    }
+}
+
+bool LumaThumbnailCache::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Show) {
+        // The view of a combo box is a child of its popup container
+        QObject *parent = watched->parent();
+        while (parent != nullptr && qobject_cast<QComboBox *>(parent) == nullptr) {
+            parent = parent->parent();
+        }
+        if (parent != nullptr) {
+            setVisibleIcons(static_cast<QComboBox *>(parent));
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,77 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <memory>
+#include <mutex>
+
+class QComboBox;
+
+/** @class LumaThumbnailCache
+    @brief On demand thumbnails of the luma files used by transitions and slideshows.
+    Thumbnails are only created when a widget displays them. The luma image is decoded and scaled on the global thread pool, and
+    the scaled thumbnail is stored in a persistent cache folder, keyed by the path, size and modification time of the luma file,
+    so that the full size image is only decoded once. Loaded thumbnails are kept in memory and thumbnailReady() is emitted on the
+    GUI thread when a requested thumbnail becomes available.
+ */
+class LumaThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** @brief Create a cache storing its thumbnails in @param cacheDir */
+    explicit LumaThumbnailCache(const QString &cacheDir);
+
+    // Returns the instance of the Singleton
+    static std::unique_ptr<LumaThumbnailCache> &get();
+
+    /** @brief Size of the thumbnails, the aspect ratio of the luma is kept */
+    static const QSize ThumbnailSize;
+
+    /** @brief Returns true if @param path is a luma file that can have a thumbnail */
+    static bool isLumaFile(const QString &path);
+    /** @brief Returns the thumbnail of a luma file if it is already loaded. Else returns a null image and loads it in the background,
+        thumbnailReady() is emitted once it is available.
+     */
+    QImage thumbnail(const QString &path);
+    /** @brief Set the thumbnails as icons of the items of @param combo whose data is a luma file.
+        Thumbnails already in memory are set right away. Missing ones are only loaded for the current item, and for the rows shown
+        when the popup is opened or scrolled, so that a luma pack is not decoded as a whole. Icons are set when they are ready.
+     */
+    void setComboIcons(QComboBox *combo);
+
+    /** @brief Path of the cached thumbnail of a luma file, or an empty string if the file does not exist */
+    QString cacheFile(const QString &path) const;
+    /** @brief Returns the thumbnail of a luma file, reading it from the cache folder or creating it. Can be called from any thread */
+    QImage loadThumbnail(const QString &path) const;
+
+Q_SIGNALS:
+    void thumbnailReady(const QString &path, const QImage &image);
+
+protected:
+    /** @brief Load the thumbnails of the visible rows when the popup of a combo box is shown */
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    static std::unique_ptr<LumaThumbnailCache> instance;
+    static std::once_flag m_onceFlag;
+    const QString m_cacheDir;
+    QMutex m_mutex;
+    QHash<QString, QImage> m_thumbnails;
+    /** @brief Luma files being loaded */
+    QSet<QString> m_pending;
+    /** @brief Set the icon of the item @param row of @param combo, loading its thumbnail if @param load is true */
+    void setItemIcon(QComboBox *combo, int row, bool load);
+    /** @brief Load the thumbnails of the rows shown in the popup of @param combo */
+    void setVisibleIcons(QComboBox *combo);
+};
@@ -0,0 +1,87 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/** @class SpscQueue
+    @brief Lock free ring buffer passing values from one producer thread to one consumer thread.
+    Unlike DataQueue, neither side ever blocks: push() fails when the queue is full and pop() when it is empty. This makes
+    it suitable for the MLT consumer thread, which must not wait for the GUI. Only the producer may call push() and only
+    the consumer may call pop(), front() and clear().
+ */
+template <class T> class SpscQueue
+{
+public:
+    /** @brief Create a queue holding at least @param capacity values */
+    explicit SpscQueue(size_t capacity)
+        : m_buffer(roundCapacity(capacity))
+        , m_mask(m_buffer.size() - 1)
+    {
+    }
+
+    /** @brief Append a value, returns false and drops it if the queue is full */
+    bool push(T value)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_buffer.size()) {
+            return false;
+        }
+        m_buffer[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Take the oldest value, returns false if the queue is empty */
+    bool pop(T &value)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_buffer[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Returns the oldest value without removing it, or nullptr if the queue is empty */
+    const T *front() const
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_buffer[head & m_mask];
+    }
+
+    /** @brief Drop all the queued values */
+    void clear()
+    {
+        m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t capacity() const { return m_buffer.size(); }
+
+private:
+    static size_t roundCapacity(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> m_buffer;
+    const size_t m_mask;
+    // Keep the indexes on separate cache lines, each one is only written by one thread
+    std::atomic<size_t> m_head{0};
+    char m_padding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail{0};
+};
@@ -9,10 +9,25 @@
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "project/projectmanager.h"
+#include "thumbnailstore.hpp"
 #include <QDir>
+#include <QFileInfo>
 #include <QMutexLocker>
+#include <QtConcurrent>
+#include <algorithm>
 #include <list>
 
+namespace {
+// Maximum number of thumbnail stores keeping their file open
+const int maxOpenStores = 64;
+
+/** @brief The legacy file of a thumbnail, next to the store of its clip */
+QString legacyFile(const std::shared_ptr<ThumbnailStore> &store, const QString &key)
+{
+    return QFileInfo(store->path()).absoluteDir().absoluteFilePath(key);
+}
+} // namespace
+
 std::unique_ptr<ThumbnailCache> ThumbnailCache::instance;
 std::once_flag ThumbnailCache::m_onceFlag;
 
@@ -115,16 +130,33 @@ bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOn
 {
     QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = pos < 0 ? getAudioKey(binId, &ok).constFirst() : getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
+    if (pos < 0) {
+        auto key = getAudioKey(binId, &ok).constFirst();
+        if (ok && m_volatileCache->contains(key)) {
+            return true;
+        }
+        if (!ok || volatileOnly) {
+            return false;
+        }
+        locker.unlock();
+        QDir thumbFolder = getDir(true, &ok);
+        return ok && thumbFolder.exists(key);
+    }
+    const QString hash = getHash(binId, &ok);
+    if (ok && m_volatileCache->contains(thumbKey(hash, pos))) {
         return true;
     }
     if (!ok || volatileOnly) {
         return false;
     }
+    bool migrating = false;
+    std::shared_ptr<ThumbnailStore> store = getStore(hash, &migrating);
     locker.unlock();
-    QDir thumbFolder = getDir(pos < 0, &ok);
-    return ok && thumbFolder.exists(key);
+    if (!store) {
+        return false;
+    }
+    // A legacy file is only deleted once its thumbnail was added to the store, check it first
+    return (migrating && QFile::exists(legacyFile(store, thumbKey(hash, pos)))) || store->contains(pos);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
@@ -138,12 +170,9 @@ QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly
     if (!ok || volatileOnly) {
         return QImage();
     }
+    locker.unlock();
     QDir thumbFolder = getDir(true, &ok);
     if (ok && thumbFolder.exists(key)) {
-        if (std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), -1) != m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(-1);
-        }
-        locker.unlock();
         return QImage(thumbFolder.absoluteFilePath(key));
     }
     return QImage();
@@ -167,62 +196,54 @@ const QList<QUrl> ThumbnailCache::getAudioThumbPath(const QString &binId) const
 
 QImage ThumbnailCache::getThumbnail(QString hash, const QString &binId, int pos, bool volatileOnly) const
 {
+    Q_UNUSED(binId)
     if (hash.isEmpty()) {
         return QImage();
     }
-    hash.append(QString("#%1.jpg").arg(pos));
+    const QString key = thumbKey(hash, pos);
     QMutexLocker locker(&m_mutex);
-    if (m_volatileCache->contains(hash)) {
-        return m_volatileCache->get(hash);
+    if (m_volatileCache->contains(key)) {
+        return m_volatileCache->get(key);
     }
     if (volatileOnly) {
         return QImage();
     }
-    bool ok = false;
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(hash)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(hash));
-    }
+    bool migrating = false;
+    std::shared_ptr<ThumbnailStore> store = getStore(hash, &migrating);
     locker.unlock();
-    return QImage();
+    return persistentThumbnail(store, key, pos, migrating);
 }
 
 QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
     QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
+    const QString hash = getHash(binId, &ok);
+    if (!ok) {
+        return QImage();
+    }
+    const QString key = thumbKey(hash, pos);
+    if (m_volatileCache->contains(key)) {
         return m_volatileCache->get(key);
     }
-    if (!ok || volatileOnly) {
+    if (volatileOnly) {
         return QImage();
     }
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(key));
-    }
-    return QImage();
+    bool migrating = false;
+    std::shared_ptr<ThumbnailStore> store = getStore(hash, &migrating);
+    locker.unlock();
+    return persistentThumbnail(store, key, pos, migrating);
 }
 
 void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent)
 {
     QMutexLocker locker(&m_mutex);
     bool ok = false;
-    const QString key = getKey(binId, pos, &ok);
+    const QString hash = getHash(binId, &ok);
     if (!ok) {
         return;
     }
+    const QString key = thumbKey(hash, pos);
     // if volatile cache also contains this entry, update it
     if (m_volatileCache->contains(key)) {
         m_volatileCache->remove(key);
@@ -231,18 +252,27 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     }
     m_volatileCache->insert(key, img, (int)img.sizeInBytes());
     if (persistent) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-                m_storedOnDisk[binId].push_back(pos);
-            }
-            locker.unlock();
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << thumbFolder.absoluteFilePath(key);
-            }
+        std::shared_ptr<ThumbnailStore> store = getStore(hash);
+        locker.unlock();
+        if (store) {
+            store->store(pos, img);
+        }
+    }
+}
+
+QImage ThumbnailCache::persistentThumbnail(const std::shared_ptr<ThumbnailStore> &store, const QString &key, int pos, bool migrating)
+{
+    if (!store) {
+        return QImage();
+    }
+    if (migrating) {
+        // A legacy file is only deleted once its thumbnail was added to the store, read it first
+        QImage img(legacyFile(store, key));
+        if (!img.isNull()) {
+            return img;
         }
     }
+    return store->image(pos);
 }
 
 bool ThumbnailCache::checkIntegrity() const
@@ -252,32 +282,35 @@ bool ThumbnailCache::checkIntegrity() const
 
 void ThumbnailCache::saveCachedThumbs(const std::unordered_map<QString, std::vector<int>> &keys)
 {
-    bool ok;
-    QDir thumbFolder = getDir(false, &ok);
-    if (!ok) {
-        return;
-    }
     QMutexLocker locker(&m_mutex);
+    std::vector<std::pair<std::shared_ptr<ThumbnailStore>, std::vector<std::pair<int, QImage>>>> pending;
     for (auto &key : keys) {
-        bool ok;
+        bool ok = false;
+        const QString hash = getHash(key.first, &ok);
+        if (!ok) {
+            continue;
+        }
+        std::shared_ptr<ThumbnailStore> store = getStore(hash);
+        if (!store) {
+            continue;
+        }
+        std::vector<std::pair<int, QImage>> images;
         for (const auto &pos : key.second) {
-            if (m_storedOnDisk.find(key.first) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[key.first].begin(), m_storedOnDisk[key.first].end(), pos) == m_storedOnDisk[key.first].end()) {
-                const QString thumbKey = getKey(key.first, pos, &ok);
-                if (!ok) {
-                    continue;
-                }
-                if (!thumbFolder.exists(thumbKey) && m_volatileCache->contains(thumbKey)) {
-                    QImage img = m_volatileCache->get(thumbKey);
-                    if (!img.save(thumbFolder.absoluteFilePath(thumbKey))) {
-                        qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                        break;
-                    } else {
-                        m_storedOnDisk[key.first].push_back(pos);
-                    }
-                }
+            const QString thumbnailKey = thumbKey(hash, pos);
+            if (m_volatileCache->contains(thumbnailKey) && !store->contains(pos)) {
+                images.emplace_back(pos, m_volatileCache->get(thumbnailKey));
             }
         }
+        if (!images.empty()) {
+            pending.emplace_back(store, std::move(images));
+        }
+    }
+    // Encode and write outside of the lock, one write per clip
+    locker.unlock();
+    for (const auto &clip : pending) {
+        if (!clip.first->storeImages(clip.second)) {
+            qDebug() << "// Error writing thumbnails to " << clip.first->path();
+        }
     }
 }
 
@@ -296,29 +329,29 @@ void ThumbnailCache::invalidateThumbsForClip(const QString &binId)
     }
     bool ok = false;
     // Video thumbs
-    QStringList files;
-    if (m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
-        // Remove persistent cache
-        for (const auto &pos : m_storedOnDisk.at(binId)) {
-            if (pos >= 0) {
-                auto key = getKey(binId, pos, &ok);
-                if (ok) {
-                    files << key;
-                }
-            }
-        }
-        m_storedOnDisk.erase(binId);
+    const QString hash = getHash(binId, &ok);
+    if (!ok) {
+        return;
     }
-    // Release mutex before deleting files
-    locker.unlock();
-    if (!files.isEmpty()) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            while (!files.isEmpty()) {
-                thumbFolder.remove(files.takeFirst());
-            }
+    bool migrating = false;
+    std::shared_ptr<ThumbnailStore> store = getStore(hash, &migrating);
+    if (!store) {
+        return;
+    }
+    if (migrating) {
+        // Delete the legacy files before the store, so that the migration cannot bring back the outdated thumbnails
+        locker.unlock();
+        QDir thumbFolder = QFileInfo(store->path()).absoluteDir();
+        const QStringList files = thumbFolder.entryList({hash + QStringLiteral("#*.jpg")}, QDir::Files);
+        for (const QString &file : files) {
+            thumbFolder.remove(file);
         }
+        locker.relock();
     }
+    m_stores.erase(store->path());
+    m_recentStores.remove(store);
+    // Delete the file before releasing the mutex, a store created again for this hash would otherwise lose its new thumbnails
+    store->remove();
 }
 
 void ThumbnailCache::clearCache()
@@ -326,11 +359,66 @@ void ThumbnailCache::clearCache()
     QMutexLocker locker(&m_mutex);
     m_volatileCache->clear();
     m_storedVolatile.clear();
-    m_storedOnDisk.clear();
+    m_stores.clear();
+    m_recentStores.clear();
+    m_migratedDirs.clear();
+}
+
+std::shared_ptr<ThumbnailStore> ThumbnailCache::getStore(const QString &hash, bool *migrating) const
+{
+    if (hash.isEmpty()) {
+        return nullptr;
+    }
+    bool ok = false;
+    QDir thumbFolder = getDir(false, &ok);
+    if (!ok) {
+        return nullptr;
+    }
+    const QString folder = thumbFolder.absolutePath();
+    if (!m_migratedDirs.contains(folder) && !m_migratingDirs.contains(folder)) {
+        m_migratedDirs.insert(folder);
+        // A folder can hold hundreds of thousands of legacy files, don't block the thumbnails while they are listed and packed
+        m_migratingDirs.insert(folder);
+        QtConcurrent::run([this, thumbFolder, folder]() {
+            ThumbnailStore::migrateLegacyFiles(thumbFolder, [this](const QString &path) {
+                QMutexLocker lock(&m_mutex);
+                return storeForPath(path);
+            });
+            QMutexLocker lock(&m_mutex);
+            m_migratingDirs.remove(folder);
+        });
+    }
+    if (migrating) {
+        *migrating = m_migratingDirs.contains(folder);
+    }
+    return storeForPath(thumbFolder.absoluteFilePath(ThumbnailStore::fileName(hash)));
+}
+
+std::shared_ptr<ThumbnailStore> ThumbnailCache::storeForPath(const QString &path) const
+{
+    std::shared_ptr<ThumbnailStore> store;
+    auto it = m_stores.find(path);
+    if (it != m_stores.end()) {
+        store = it->second;
+        auto recent = std::find(m_recentStores.begin(), m_recentStores.end(), store);
+        if (recent != m_recentStores.end()) {
+            m_recentStores.erase(recent);
+        }
+    } else {
+        store = std::make_shared<ThumbnailStore>(path);
+        m_stores[path] = store;
+    }
+    m_recentStores.push_front(store);
+    // Projects can have thousands of clips, only keep the files of the recently used stores open
+    if (int(m_recentStores.size()) > maxOpenStores) {
+        m_recentStores.back()->close();
+        m_recentStores.pop_back();
+    }
+    return store;
 }
 
 // static
-QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+QString ThumbnailCache::getHash(const QString &binId, bool *ok)
 {
     if (binId.isEmpty()) {
         *ok = false;
@@ -341,7 +429,23 @@ QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
     if (!*ok) {
         return QString();
     }
-    return binClip->hashForThumbs() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+    return binClip->hashForThumbs();
+}
+
+// static
+QString ThumbnailCache::thumbKey(const QString &hash, int pos)
+{
+    return hash + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+}
+
+// static
+QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+{
+    const QString hash = getHash(binId, ok);
+    if (!*ok) {
+        return QString();
+    }
+    return thumbKey(hash, pos);
 }
 
 // static
@@ -9,15 +9,21 @@
 #include <QDir>
 #include <QImage>
 #include <QMutex>
+#include <QSet>
 #include <QUrl>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
 
+class ThumbnailStore;
+
 /** @class ThumbnailCache
     @brief This class class is an interface to the caches that store thumbnails.
     In Kdenlive, we use two such caches, a persistent that is stored on disk to allow thumbnails to be reused when reopening.
+    The persistent video thumbnails of a clip are packed in a single file, see ThumbnailStore. Thumbnail folders using the legacy
+    one file per frame layout are migrated in a background task on first access, the legacy files are used until they are migrated.
     The other one is a volatile LRU cache that lives in memory.
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
@@ -73,6 +79,9 @@ protected:
 
     // Return the key associated to a thumbnail
     static QString getKey(const QString &binId, int pos, bool *ok);
+    static QString thumbKey(const QString &hash, int pos);
+    // Return the hash used to name the thumbnails of a clip
+    static QString getHash(const QString &binId, bool *ok);
     static QStringList getAudioKey(const QString &binId, bool *ok);
 
     // Return the dir where the persistent cache lives
@@ -85,8 +94,25 @@ protected:
     std::unique_ptr<Cache_t> m_volatileCache;
     mutable QMutex m_mutex;
 
+    /** @brief Returns the persistent store of a clip hash in the current thumbnail folder, must be called with m_mutex locked.
+        Starts the migration of the legacy files of the folder on first access.
+        @param migrating if not null, set to true if the legacy files of the folder are still being migrated
+    */
+    std::shared_ptr<ThumbnailStore> getStore(const QString &hash, bool *migrating = nullptr) const;
+    /** @brief Returns the store of a file, creating it if needed. Must be called with m_mutex locked */
+    std::shared_ptr<ThumbnailStore> storeForPath(const QString &path) const;
+    /** @brief Read a thumbnail from a store, or from its legacy file while the folder is migrated */
+    static QImage persistentThumbnail(const std::shared_ptr<ThumbnailStore> &store, const QString &key, int pos, bool migrating);
+
     // the following maps keeps track of the positions that we store for each clip in volatile caches.
     // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
     std::unordered_map<QString, std::vector<int>> m_storedVolatile;
-    mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+    /** @brief The persistent stores, by file path */
+    mutable std::unordered_map<QString, std::shared_ptr<ThumbnailStore>> m_stores;
+    /** @brief The most recently used stores, first is the most recent. The files of the other stores are closed */
+    mutable std::list<std::shared_ptr<ThumbnailStore>> m_recentStores;
+    /** @brief Thumbnail folders already checked for legacy thumbnail files */
+    mutable QSet<QString> m_migratedDirs;
+    /** @brief Thumbnail folders whose legacy files are being migrated */
+    mutable QSet<QString> m_migratingDirs;
 };
@@ -0,0 +1,243 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "thumbnailproducerpool.hpp"
+
+#include <QThread>
+#include <mlt++/MltProducer.h>
+
+namespace {
+// Maximum number of requests from other threads served before our own, so that a request cannot starve while new ones keep arriving ahead
+const int maxBatch = 16;
+} // namespace
+
+ThumbnailProducerPool::ThumbnailProducerPool(Factory factory, Renderer renderer, int maxProducers)
+    : m_factory(std::move(factory))
+    , m_renderer(std::move(renderer))
+    , m_maxProducers(qMax(1, maxProducers))
+    , m_creating(0)
+    , m_generation(0)
+    , m_coalesced(0)
+{
+    m_clock.start();
+}
+
+ThumbnailProducerPool::~ThumbnailProducerPool() = default;
+
+int ThumbnailProducerPool::defaultSize()
+{
+    return qBound(1, QThread::idealThreadCount() / 2, 4);
+}
+
+QImage ThumbnailProducerPool::requestFrame(int frame)
+{
+    m_mutex.lock();
+    std::shared_ptr<Request> &pending = m_requests[frame];
+    if (!pending) {
+        pending = std::make_shared<Request>();
+    } else {
+        m_coalesced++;
+    }
+    // Keep our own reference, the map entry is removed once the frame is decoded
+    const std::shared_ptr<Request> request = pending;
+    while (!request->done) {
+        if (request->taken) {
+            // Another thread is decoding this frame
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+        bool failed = false;
+        Instance *instance = acquireInstance(frame, request, &failed);
+        if (failed) {
+            finishRequest(frame, request, QImage());
+            break;
+        }
+        if (instance == nullptr) {
+            // All producers are busy, wait until one is released or our frame was decoded by another thread
+            if (!request->done && !request->taken) {
+                m_condition.wait(&m_mutex);
+            }
+            continue;
+        }
+        request->taken = true;
+        int served = 0;
+        while (true) {
+            auto next = nextRequest(instance->position, request, frame, served);
+            const int target = next->first;
+            const std::shared_ptr<Request> current = next->second;
+            current->taken = true;
+            m_mutex.unlock();
+            const QImage image = m_renderer(*instance->producer.get(), target);
+            m_mutex.lock();
+            instance->position = target;
+            finishRequest(target, current, image);
+            if (current == request) {
+                break;
+            }
+            served++;
+        }
+        releaseInstance(instance);
+    }
+    const QImage result = request->image;
+    m_mutex.unlock();
+    return result;
+}
+
+ThumbnailProducerPool::Instance *ThumbnailProducerPool::acquireInstance(int frame, const std::shared_ptr<Request> &request, bool *failed)
+{
+    Instance *best = nullptr;
+    for (const auto &instance : m_instances) {
+        if (instance->busy) {
+            continue;
+        }
+        if (best == nullptr) {
+            best = instance.get();
+            continue;
+        }
+        // Prefer the closest instance before the frame, otherwise the one needing the shortest backward seek
+        bool before = instance->position <= frame;
+        bool bestBefore = best->position <= frame;
+        if (before != bestBefore) {
+            if (before) {
+                best = instance.get();
+            }
+        } else if (before ? instance->position > best->position : instance->position < best->position) {
+            best = instance.get();
+        }
+    }
+    if (best) {
+        best->busy = true;
+        return best;
+    }
+    if (int(m_instances.size()) + m_creating >= m_maxProducers) {
+        return nullptr;
+    }
+    // Opening a clip can be slow, don't block the other requests meanwhile
+    m_creating++;
+    const int generation = m_generation;
+    m_mutex.unlock();
+    std::shared_ptr<Mlt::Producer> producer = m_factory();
+    m_mutex.lock();
+    m_creating--;
+    // Another instance may have served or taken our frame meanwhile
+    const bool served = request->done || request->taken;
+    if (producer == nullptr || !producer->is_valid()) {
+        *failed = !served;
+        m_condition.wakeAll();
+        return nullptr;
+    }
+    if (generation != m_generation) {
+        // The pool was cleared while we were creating the producer, it may use an outdated source. Nobody may be left to wake us up
+        // if we waited for an instance, so try again with the new source
+        m_condition.wakeAll();
+        return served ? nullptr : acquireInstance(frame, request, failed);
+    }
+    m_instances.push_back(std::make_unique<Instance>());
+    Instance *instance = m_instances.back().get();
+    instance->producer = std::move(producer);
+    instance->generation = generation;
+    if (served) {
+        // Keep the producer for the next requests
+        instance->lastUsed = m_clock.elapsed();
+        m_condition.wakeAll();
+        return nullptr;
+    }
+    instance->busy = true;
+    return instance;
+}
+
+void ThumbnailProducerPool::releaseInstance(Instance *instance)
+{
+    instance->busy = false;
+    instance->lastUsed = m_clock.elapsed();
+    if (instance->generation != m_generation) {
+        for (auto it = m_instances.begin(); it != m_instances.end(); ++it) {
+            if (it->get() == instance) {
+                m_instances.erase(it);
+                break;
+            }
+        }
+    }
+    m_condition.wakeAll();
+}
+
+std::map<int, std::shared_ptr<ThumbnailProducerPool::Request>>::iterator
+ThumbnailProducerPool::nextRequest(int position, const std::shared_ptr<Request> &own, int ownFrame, int served)
+{
+    if (served >= maxBatch) {
+        return m_requests.find(ownFrame);
+    }
+    auto eligible = [&own](const std::pair<const int, std::shared_ptr<Request>> &entry) { return entry.second == own || !entry.second->taken; };
+    const auto start = m_requests.lower_bound(position);
+    for (auto it = start; it != m_requests.end(); ++it) {
+        if (eligible(*it)) {
+            return it;
+        }
+    }
+    // Nothing left ahead of the instance, restart from the lowest pending frame
+    for (auto it = m_requests.begin(); it != start; ++it) {
+        if (eligible(*it)) {
+            return it;
+        }
+    }
+    return m_requests.find(ownFrame);
+}
+
+void ThumbnailProducerPool::finishRequest(int frame, const std::shared_ptr<Request> &request, const QImage &image)
+{
+    request->image = image;
+    request->done = true;
+    auto it = m_requests.find(frame);
+    if (it != m_requests.end() && it->second == request) {
+        m_requests.erase(it);
+    }
+    m_condition.wakeAll();
+}
+
+void ThumbnailProducerPool::clear(int maxProducers)
+{
+    QMutexLocker lock(&m_mutex);
+    if (maxProducers > 0) {
+        m_maxProducers = maxProducers;
+    }
+    m_generation++;
+    for (auto it = m_instances.begin(); it != m_instances.end();) {
+        if ((*it)->busy) {
+            ++it;
+        } else {
+            it = m_instances.erase(it);
+        }
+    }
+    // The limit may have changed
+    m_condition.wakeAll();
+}
+
+int ThumbnailProducerPool::releaseIdle(qint64 idleMs)
+{
+    QMutexLocker lock(&m_mutex);
+    const qint64 limit = m_clock.elapsed() - idleMs;
+    int released = 0;
+    for (auto it = m_instances.begin(); it != m_instances.end();) {
+        if (!(*it)->busy && (*it)->lastUsed <= limit) {
+            it = m_instances.erase(it);
+            released++;
+        } else {
+            ++it;
+        }
+    }
+    return released;
+}
+
+int ThumbnailProducerPool::producerCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return int(m_instances.size());
+}
+
+int ThumbnailProducerPool::maxProducers() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_maxProducers;
+}
@@ -0,0 +1,104 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Mlt {
+class Producer;
+}
+
+/** @class ThumbnailProducerPool
+    @brief A bounded set of producers extracting the thumbnails of one clip from several threads.
+    A producer can only be seeked by one thread at a time, so sharing a single thumbnail producer serializes all thumbnail requests of a clip.
+    This pool creates up to maxProducers instances on demand, and checks out one instance for each request:
+    - concurrent requests for the same frame are coalesced: only one of them decodes the frame, the others receive the same image
+    - the idle instance whose last position is the closest before the requested frame is preferred, so that decoding seeks forward
+    - the thread holding an instance also serves the other pending requests in ascending order from the instance position, so that a
+      batch of requests (like the thumbnails of a timeline clip) is decoded in a single forward pass
+ */
+class ThumbnailProducerPool
+{
+public:
+    using Factory = std::function<std::shared_ptr<Mlt::Producer>()>;
+    using Renderer = std::function<QImage(Mlt::Producer &producer, int frame)>;
+
+    ThumbnailProducerPool(Factory factory, Renderer renderer, int maxProducers = defaultSize());
+    ~ThumbnailProducerPool();
+
+    /** @brief Returns the image of a frame, blocking until it is decoded. Returns a null image if no producer could be created */
+    QImage requestFrame(int frame);
+    /** @brief Drop all producers, for example after the clip was reloaded. Producers currently in use are dropped when released
+        @param maxProducers the new limit, or -1 to keep the current one
+    */
+    void clear(int maxProducers = -1);
+    /** @brief Drop the producers that were not used during the last idleMs milliseconds
+        @returns the number of dropped producers
+    */
+    int releaseIdle(qint64 idleMs);
+    /** @brief Number of producers currently created */
+    int producerCount() const;
+    int maxProducers() const;
+    /** @brief Default limit on the number of producers of a clip, based on the number of cores */
+    static int defaultSize();
+
+private:
+    struct Instance
+    {
+        std::shared_ptr<Mlt::Producer> producer;
+        /** @brief Last decoded frame, -1 if none */
+        int position = -1;
+        bool busy = false;
+        int generation = 0;
+        /** @brief Time of the last release, from m_clock */
+        qint64 lastUsed = 0;
+    };
+    struct Request
+    {
+        QImage image;
+        /** @brief True once a thread is responsible for decoding this frame */
+        bool taken = false;
+        bool done = false;
+    };
+    /** @brief Check out the best idle instance for a frame, creating one if allowed. Must be called with m_mutex locked, which is released
+        while creating a producer
+        @param request the request of the frame, if another thread took it while the producer was created no instance is returned
+        @param failed set to true if a producer could not be created
+    */
+    Instance *acquireInstance(int frame, const std::shared_ptr<Request> &request, bool *failed);
+    /** @brief Return an instance to the pool, must be called with m_mutex locked */
+    void releaseInstance(Instance *instance);
+    /** @brief Pick the next request to decode on an instance: the first pending one at or after its position, wrapping to the lowest one
+        @param own the request of the calling thread, always eligible
+        @param served the number of other requests already served, own request is returned when reaching the batch limit
+    */
+    std::map<int, std::shared_ptr<Request>>::iterator nextRequest(int position, const std::shared_ptr<Request> &own, int ownFrame, int served);
+    /** @brief Publish the image of a request and wake up waiting threads, must be called with m_mutex locked */
+    void finishRequest(int frame, const std::shared_ptr<Request> &request, const QImage &image);
+
+    Factory m_factory;
+    Renderer m_renderer;
+    mutable QMutex m_mutex;
+    QWaitCondition m_condition;
+    std::vector<std::unique_ptr<Instance>> m_instances;
+    /** @brief Requests not yet fulfilled, by frame */
+    std::map<int, std::shared_ptr<Request>> m_requests;
+    int m_maxProducers;
+    /** @brief Number of producers being created outside of the lock */
+    int m_creating;
+    /** @brief Incremented on clear, instances from a previous generation are discarded */
+    int m_generation;
+    /** @brief Number of requests that joined a pending request for the same frame */
+    int m_coalesced;
+    QElapsedTimer m_clock;
+};
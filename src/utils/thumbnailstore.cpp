@@ -0,0 +1,410 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "thumbnailstore.hpp"
+#include "kdenlive_debug.h"
+
+#include <QBuffer>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace {
+const char storeMagic[4] = {'K', 'D', 'T', 'H'};
+const quint32 storeVersion = 1;
+// magic, version, reserved
+const int headerSize = 16;
+// position, data size
+const int recordHeaderSize = 8;
+const int jpegQuality = 80;
+// Appended records are read from the file until the unmapped part reaches this size or the mapped size
+const qint64 remapThreshold = 1 << 20;
+
+QByteArray storeHeader()
+{
+    QByteArray header(headerSize, '\0');
+    auto *data = reinterpret_cast<uchar *>(header.data());
+    memcpy(data, storeMagic, 4);
+    qToLittleEndian<quint32>(storeVersion, data + 4);
+    return header;
+}
+} // namespace
+
+ThumbnailStore::ThumbnailStore(const QString &path)
+    : m_path(path)
+    , m_file(path)
+    , m_data(nullptr)
+    , m_mappedSize(0)
+    , m_end(0)
+    , m_removed(false)
+    , m_indexed(false)
+{
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+// static
+QString ThumbnailStore::fileName(const QString &hash)
+{
+    return hash + QStringLiteral(".thumbs");
+}
+
+const QString &ThumbnailStore::path() const
+{
+    return m_path;
+}
+
+bool ThumbnailStore::openFile() const
+{
+    if (m_file.isOpen()) {
+        return true;
+    }
+    if (m_removed) {
+        return false;
+    }
+    if (!QFile::exists(m_path)) {
+        // The file may have been deleted since it was indexed, for example by the cache cleanup
+        resetIndex();
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    remap();
+    if (!m_indexed) {
+        m_indexed = true;
+        if (!readIndex()) {
+            qWarning() << "Discarding invalid thumbnail store" << m_path;
+            m_index.clear();
+            m_end = 0;
+        }
+    }
+    return true;
+}
+
+void ThumbnailStore::checkIndex() const
+{
+    if (!m_indexed) {
+        openFile();
+    } else if (!m_file.isOpen() && !QFile::exists(m_path)) {
+        resetIndex();
+    }
+}
+
+void ThumbnailStore::resetIndex() const
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_mappedSize = 0;
+    m_file.close();
+    m_index.clear();
+    m_end = 0;
+    m_indexed = false;
+}
+
+void ThumbnailStore::close()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_mappedSize = 0;
+    m_file.close();
+}
+
+bool ThumbnailStore::isOpen() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_file.isOpen();
+}
+
+void ThumbnailStore::remap() const
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_mappedSize = m_file.size();
+    if (m_mappedSize > 0) {
+        // If mapping is not supported, entries are read from the file
+        m_data = m_file.map(0, m_mappedSize);
+    }
+}
+
+bool ThumbnailStore::readIndex() const
+{
+    QByteArray buffer;
+    const uchar *data = m_data;
+    if (data == nullptr) {
+        m_file.seek(0);
+        buffer = m_file.readAll();
+        data = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+    const qint64 size = m_data ? m_mappedSize : buffer.size();
+    if (size < headerSize || memcmp(data, storeMagic, 4) != 0 || qFromLittleEndian<quint32>(data + 4) != storeVersion) {
+        return false;
+    }
+    // Later records override earlier ones for the same position
+    std::map<int, Entry> entries;
+    qint64 offset = headerSize;
+    while (offset + recordHeaderSize <= size) {
+        const int pos = qFromLittleEndian<qint32>(data + offset);
+        const quint32 length = qFromLittleEndian<quint32>(data + offset + 4);
+        if (offset + recordHeaderSize + length > size) {
+            // Truncated record
+            break;
+        }
+        entries[pos] = {pos, offset + recordHeaderSize, length};
+        offset += recordHeaderSize + length;
+    }
+    m_end = offset;
+    m_index.clear();
+    m_index.reserve(entries.size());
+    for (const auto &entry : entries) {
+        m_index.push_back(entry.second);
+    }
+    return true;
+}
+
+const ThumbnailStore::Entry *ThumbnailStore::findEntry(int pos) const
+{
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), pos, [](const Entry &entry, int value) { return entry.pos < value; });
+    if (it == m_index.end() || it->pos != pos) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+QByteArray ThumbnailStore::readEntry(const Entry &entry) const
+{
+    if (m_data && entry.offset + entry.size <= m_mappedSize) {
+        return QByteArray(reinterpret_cast<const char *>(m_data + entry.offset), int(entry.size));
+    }
+    if (!m_file.seek(entry.offset)) {
+        return QByteArray();
+    }
+    return m_file.read(entry.size);
+}
+
+bool ThumbnailStore::contains(int pos) const
+{
+    QMutexLocker lock(&m_mutex);
+    checkIndex();
+    return findEntry(pos) != nullptr;
+}
+
+int ThumbnailStore::count() const
+{
+    QMutexLocker lock(&m_mutex);
+    checkIndex();
+    return int(m_index.size());
+}
+
+std::vector<int> ThumbnailStore::positions() const
+{
+    QMutexLocker lock(&m_mutex);
+    checkIndex();
+    std::vector<int> result;
+    result.reserve(m_index.size());
+    for (const Entry &entry : m_index) {
+        result.push_back(entry.pos);
+    }
+    return result;
+}
+
+QByteArray ThumbnailStore::data(int pos) const
+{
+    QMutexLocker lock(&m_mutex);
+    checkIndex();
+    const Entry *entry = findEntry(pos);
+    if (entry == nullptr || !openFile()) {
+        return QByteArray();
+    }
+    return readEntry(*entry);
+}
+
+QImage ThumbnailStore::image(int pos) const
+{
+    // Decode outside of the lock, so that several thumbnails of a clip can be decoded in parallel
+    const QByteArray jpeg = data(pos);
+    if (jpeg.isEmpty()) {
+        return QImage();
+    }
+    return QImage::fromData(jpeg, "JPG");
+}
+
+bool ThumbnailStore::store(int pos, const QImage &img)
+{
+    return storeImages({{pos, img}});
+}
+
+bool ThumbnailStore::storeImages(const std::vector<std::pair<int, QImage>> &images)
+{
+    std::vector<std::pair<int, QByteArray>> records;
+    records.reserve(images.size());
+    for (const auto &image : images) {
+        QByteArray jpeg;
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (image.second.isNull() || !image.second.save(&buffer, "JPG", jpegQuality)) {
+            qCWarning(KDENLIVE_LOG) << "Cannot encode thumbnail" << image.first << "for" << m_path;
+            continue;
+        }
+        records.emplace_back(image.first, jpeg);
+    }
+    if (records.empty()) {
+        return false;
+    }
+    QMutexLocker lock(&m_mutex);
+    return appendRecords(records);
+}
+
+bool ThumbnailStore::appendRecords(const std::vector<std::pair<int, QByteArray>> &records)
+{
+    if (m_removed) {
+        return false;
+    }
+    if (m_file.isOpen() && !QFile::exists(m_path)) {
+        // Don't append to a deleted file, start a new one
+        resetIndex();
+    }
+    if (!openFile()) {
+        // New store
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            qCWarning(KDENLIVE_LOG) << "Cannot open thumbnail store" << m_path;
+            return false;
+        }
+        m_indexed = true;
+    }
+    QByteArray output;
+    if (m_end == 0) {
+        // New or invalid file
+        output = storeHeader();
+    }
+    const qint64 start = m_end;
+    std::vector<Entry> entries;
+    qint64 offset = start + output.size();
+    for (const auto &record : records) {
+        uchar recordHeader[recordHeaderSize];
+        qToLittleEndian<qint32>(record.first, recordHeader);
+        qToLittleEndian<quint32>(quint32(record.second.size()), recordHeader + 4);
+        output.append(reinterpret_cast<const char *>(recordHeader), recordHeaderSize);
+        output.append(record.second);
+        entries.push_back({record.first, offset + recordHeaderSize, quint32(record.second.size())});
+        offset += recordHeaderSize + record.second.size();
+    }
+    if (m_file.size() != start && m_data) {
+        // Drop a truncated record left by an interrupted write, the file cannot shrink while mapped
+        m_file.unmap(m_data);
+        m_data = nullptr;
+        m_mappedSize = 0;
+    }
+    bool ok = (m_file.size() == start || m_file.resize(start)) && m_file.seek(start) && m_file.write(output) == output.size() && m_file.flush();
+    if (!ok) {
+        qCWarning(KDENLIVE_LOG) << "Cannot write thumbnails to" << m_path;
+        m_file.resize(start);
+        remap();
+        return false;
+    }
+    m_end = offset;
+    for (const Entry &entry : entries) {
+        auto it = std::lower_bound(m_index.begin(), m_index.end(), entry.pos, [](const Entry &current, int value) { return current.pos < value; });
+        if (it != m_index.end() && it->pos == entry.pos) {
+            *it = entry;
+        } else {
+            m_index.insert(it, entry);
+        }
+    }
+    // The new records are read from the file, only map it again once the unmapped part is large
+    if (m_data == nullptr || m_end - m_mappedSize > qMax(remapThreshold, m_mappedSize)) {
+        remap();
+    }
+    return true;
+}
+
+void ThumbnailStore::remove()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+    QFile::remove(m_path);
+    m_index.clear();
+    m_mappedSize = 0;
+    m_end = 0;
+    m_removed = true;
+}
+
+// static
+int ThumbnailStore::migrateLegacyFiles(const QDir &dir, const std::function<std::shared_ptr<ThumbnailStore>(const QString &)> &storeForPath)
+{
+    const QStringList files = dir.entryList({QStringLiteral("*#*.jpg")}, QDir::Files);
+    if (files.isEmpty()) {
+        return 0;
+    }
+    // Group the files by clip hash, sorted by position
+    std::map<QString, std::map<int, QString>> legacy;
+    for (const QString &file : files) {
+        bool ok = false;
+        QString position = file.section(QLatin1Char('#'), -1);
+        position.chop(4);
+        const int pos = position.toInt(&ok);
+        if (ok) {
+            legacy[file.section(QLatin1Char('#'), 0, -2)][pos] = file;
+        }
+    }
+    int migrated = 0;
+    for (const auto &clip : legacy) {
+        const QString path = dir.absoluteFilePath(fileName(clip.first));
+        std::shared_ptr<ThumbnailStore> store = storeForPath ? storeForPath(path) : std::make_shared<ThumbnailStore>(path);
+        if (!store) {
+            continue;
+        }
+        std::vector<std::pair<int, QByteArray>> records;
+        QStringList done;
+        for (const auto &thumb : clip.second) {
+            if (store->contains(thumb.first)) {
+                done << thumb.second;
+                continue;
+            }
+            // The legacy files are already JPEG encoded, store them as is
+            QFile file(dir.absoluteFilePath(thumb.second));
+            if (file.open(QIODevice::ReadOnly)) {
+                records.emplace_back(thumb.first, file.readAll());
+                done << thumb.second;
+            }
+        }
+        QMutexLocker lock(&store->m_mutex);
+        // The store may be used while it is migrated, thumbnails stored in the meantime are newer than the legacy files
+        store->checkIndex();
+        records.erase(std::remove_if(records.begin(), records.end(),
+                                     [&store](const std::pair<int, QByteArray> &record) { return store->findEntry(record.first) != nullptr; }),
+                      records.end());
+        // The legacy files of a removed store are outdated, only delete them
+        if (!records.empty() && !store->appendRecords(records) && !store->m_removed) {
+            continue;
+        }
+        const bool removed = store->m_removed;
+        lock.unlock();
+        if (!removed) {
+            migrated += int(records.size());
+        }
+        for (const QString &file : qAsConst(done)) {
+            dir.remove(file);
+        }
+    }
+    return migrated;
+}
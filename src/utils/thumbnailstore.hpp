@@ -0,0 +1,107 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/** @class ThumbnailStore
+    @brief Packed persistent storage for the video thumbnails of one clip.
+    All the thumbnails of a clip are stored as JPEG records in a single <hash>.thumbs file of the thumbnail cache folder, instead of one
+    <hash>#<pos>.jpg file per frame. The file starts with a header followed by records (position, size, JPEG data) that are only ever
+    appended: storing a position again appends a new record overriding the previous one.
+    The file is opened on first access and memory mapped for reading. The sorted position index is built on first open by walking the record
+    headers, so that lookups are a binary search. A truncated last record (for example after a crash) is ignored, and overwritten by the
+    next append. Appended records are read from the file until the unmapped part grows enough to map the file again.
+    close() releases the file and its mapping but keeps the index, the file is opened again on the next access.
+ */
+class ThumbnailStore
+{
+public:
+    /** @brief Create the store of a file, which is only opened on first access and created on first write */
+    explicit ThumbnailStore(const QString &path);
+    ~ThumbnailStore();
+
+    /** @brief The store file name for a clip hash */
+    static QString fileName(const QString &hash);
+    /** @brief Pack the legacy <hash>#<pos>.jpg files of a thumbnail folder in stores, and delete them.
+        @param storeForPath returns the store of a file. It allows migrating to stores that are used at the same time, by default a new store is
+        created for each file
+        @returns the number of migrated thumbnails
+    */
+    static int migrateLegacyFiles(const QDir &dir, const std::function<std::shared_ptr<ThumbnailStore>(const QString &)> &storeForPath = {});
+
+    const QString &path() const;
+    bool contains(int pos) const;
+    /** @brief Returns the number of stored positions */
+    int count() const;
+    /** @brief Returns the stored positions in ascending order */
+    std::vector<int> positions() const;
+    /** @brief Returns the decoded thumbnail for a position, or a null image */
+    QImage image(int pos) const;
+    /** @brief Returns the JPEG data for a position, or an empty array */
+    QByteArray data(int pos) const;
+
+    /** @brief Encode and append a thumbnail */
+    bool store(int pos, const QImage &img);
+    /** @brief Encode and append several thumbnails in one write */
+    bool storeImages(const std::vector<std::pair<int, QImage>> &images);
+    /** @brief Delete the store file. Later writes to this store are ignored */
+    void remove();
+    /** @brief Close the file, it is opened again on the next access */
+    void close();
+    /** @brief Returns true if the file is currently open */
+    bool isOpen() const;
+
+private:
+    struct Entry
+    {
+        int pos;
+        qint64 offset;
+        quint32 size;
+    };
+    /** @brief Append encoded records to the file and index them, must be called with m_mutex locked */
+    bool appendRecords(const std::vector<std::pair<int, QByteArray>> &records);
+    /** @brief Open and map the file if needed, building the index on first open. Must be called with m_mutex locked.
+        Returns false if the file does not exist or cannot be opened
+    */
+    bool openFile() const;
+    /** @brief Build the index if needed, or forget it if the file of a closed store was deleted. Must be called with m_mutex locked */
+    void checkIndex() const;
+    /** @brief Close the file and forget its records, the next write starts a new file. Must be called with m_mutex locked */
+    void resetIndex() const;
+    /** @brief Map the file again after it changed, must be called with m_mutex locked */
+    void remap() const;
+    /** @brief Walk the records of the mapped file to build the index. Returns false if the file is not a valid store */
+    bool readIndex() const;
+    /** @brief Returns the entry for a position, or nullptr. Must be called with m_mutex locked */
+    const Entry *findEntry(int pos) const;
+    /** @brief Read the data of an entry, must be called with m_mutex locked */
+    QByteArray readEntry(const Entry &entry) const;
+
+    const QString m_path;
+    mutable QMutex m_mutex;
+    // The file is opened lazily, also from the const accessors
+    mutable QFile m_file;
+    /** @brief The mapped file, or nullptr if it is not mapped */
+    mutable uchar *m_data;
+    mutable qint64 m_mappedSize;
+    /** @brief Offset after the last complete record */
+    mutable qint64 m_end;
+    bool m_removed;
+    /** @brief True once the index was read from the file, it is kept when the file is closed */
+    mutable bool m_indexed;
+    /** @brief Entries sorted by position */
+    mutable std::vector<Entry> m_index;
+};
@@ -0,0 +1,115 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "assets/assetcatalogcache.hpp"
+
+#include <QDateTime>
+#include <QTemporaryDir>
+
+namespace {
+void writeFile(const QString &path, const QByteArray &data, const QDateTime &modified)
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    REQUIRE(file.write(data) == data.size());
+    REQUIRE(file.flush());
+    REQUIRE(file.setFileTime(modified, QFileDevice::FileModificationTime));
+}
+} // namespace
+
+TEST_CASE("Asset catalog cache", "[AssetCatalogCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString cachePath = dir.filePath(QStringLiteral("effects.catalog"));
+    const QString assetDir = dir.filePath(QStringLiteral("effects"));
+    REQUIRE(QDir().mkpath(assetDir));
+    const QDateTime modified = QDateTime::currentDateTime().addDays(-1);
+    writeFile(QDir(assetDir).filePath(QStringLiteral("blur.xml")), QByteArrayLiteral("<effect tag=\"boxblur\"/>"), modified);
+    const QStringList services = {QStringLiteral("boxblur"), QStringLiteral("volume")};
+    const QByteArray key = AssetCatalogCache::catalogKey(services, {assetDir});
+
+    QDomDocument doc;
+    REQUIRE(doc.setContent(QStringLiteral("<effect tag=\"boxblur\" id=\"blur\"><parameter name=\"hori\" type=\"constant\"><name>Width</name>"
+                                          "</parameter></effect>")));
+    QVector<AssetCatalogCache::Entry> entries;
+    entries.append({QStringLiteral("blur"), QStringLiteral("boxblur"), QStringLiteral("Blur"), QStringLiteral("Box blur (boxblur)"), QStringLiteral("Author"),
+                    QStringLiteral("1.0"), 100, 3, doc.documentElement()});
+    // Assets with empty metadata have no XML description
+    entries.append({QStringLiteral("volume"), QStringLiteral("volume"), QString(), QString(), QString(), QString(), 0, 1, QDomElement()});
+    REQUIRE(AssetCatalogCache::write(cachePath, AssetCatalogCache::serialize(key, entries)));
+
+    SECTION("Round trip")
+    {
+        QVector<AssetCatalogCache::Entry> loaded;
+        REQUIRE(AssetCatalogCache::load(cachePath, key, loaded));
+        REQUIRE(loaded.size() == 2);
+        REQUIRE(loaded.at(0).id == QLatin1String("blur"));
+        REQUIRE(loaded.at(0).mltId == QLatin1String("boxblur"));
+        REQUIRE(loaded.at(0).name == QLatin1String("Blur"));
+        REQUIRE(loaded.at(0).description == QLatin1String("Box blur (boxblur)"));
+        REQUIRE(loaded.at(0).author == QLatin1String("Author"));
+        REQUIRE(loaded.at(0).versionStr == QLatin1String("1.0"));
+        REQUIRE(loaded.at(0).version == 100);
+        REQUIRE(loaded.at(0).type == 3);
+        const QDomElement xml = loaded.at(0).xml;
+        REQUIRE(xml.tagName() == QLatin1String("effect"));
+        REQUIRE(xml.attribute(QStringLiteral("id")) == QLatin1String("blur"));
+        REQUIRE(xml.firstChildElement(QStringLiteral("parameter")).firstChildElement(QStringLiteral("name")).text() == QLatin1String("Width"));
+        REQUIRE(loaded.at(1).id == QLatin1String("volume"));
+        REQUIRE(loaded.at(1).type == 1);
+        REQUIRE(loaded.at(1).xml.isNull());
+    }
+
+    SECTION("Stale or invalid catalogs are rejected")
+    {
+        QVector<AssetCatalogCache::Entry> loaded;
+        // Same inputs, same key
+        REQUIRE(AssetCatalogCache::catalogKey(services, {assetDir}) == key);
+        // MLT services changed
+        REQUIRE(AssetCatalogCache::catalogKey({QStringLiteral("boxblur")}, {assetDir}) != key);
+        REQUIRE_FALSE(AssetCatalogCache::load(cachePath, AssetCatalogCache::catalogKey({QStringLiteral("boxblur")}, {assetDir}), loaded));
+        // An asset file was edited
+        writeFile(QDir(assetDir).filePath(QStringLiteral("blur.xml")), QByteArrayLiteral("<effect tag=\"boxblur\"/>"), modified.addSecs(10));
+        REQUIRE(AssetCatalogCache::catalogKey(services, {assetDir}) != key);
+        // An asset file was added
+        const QByteArray editedKey = AssetCatalogCache::catalogKey(services, {assetDir});
+        writeFile(QDir(assetDir).filePath(QStringLiteral("sharpen.xml")), QByteArrayLiteral("<effect tag=\"sharpen\"/>"), modified);
+        REQUIRE(AssetCatalogCache::catalogKey(services, {assetDir}) != editedKey);
+        REQUIRE(loaded.isEmpty());
+        // Truncated file
+        QFile file(cachePath);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.resize(file.size() - 4));
+        file.close();
+        REQUIRE_FALSE(AssetCatalogCache::load(cachePath, key, loaded));
+        REQUIRE_FALSE(AssetCatalogCache::load(dir.filePath(QStringLiteral("missing.catalog")), key, loaded));
+    }
+
+    SECTION("Updated plugins invalidate the catalog")
+    {
+        const bool hadFrei0r = qEnvironmentVariableIsSet("FREI0R_PATH");
+        const bool hadLadspa = qEnvironmentVariableIsSet("LADSPA_PATH");
+        const QByteArray previousFrei0r = qgetenv("FREI0R_PATH");
+        const QByteArray previousLadspa = qgetenv("LADSPA_PATH");
+        const QString frei0rDir = dir.filePath(QStringLiteral("frei0r"));
+        const QString ladspaDir = dir.filePath(QStringLiteral("ladspa"));
+        REQUIRE(QDir().mkpath(frei0rDir));
+        REQUIRE(QDir().mkpath(ladspaDir));
+        qputenv("FREI0R_PATH", frei0rDir.toLocal8Bit());
+        qputenv("LADSPA_PATH", ladspaDir.toLocal8Bit());
+        const QByteArray pluginKey = AssetCatalogCache::catalogKey(services, {assetDir});
+        REQUIRE(AssetCatalogCache::catalogKey(services, {assetDir}) == pluginKey);
+        // The frei0r plugins were uninstalled, without changing the list of services
+        REQUIRE(QDir(frei0rDir).removeRecursively());
+        const QByteArray frei0rKey = AssetCatalogCache::catalogKey(services, {assetDir});
+        REQUIRE(frei0rKey != pluginKey);
+        // Another LADSPA plugin folder is used
+        qputenv("LADSPA_PATH", assetDir.toLocal8Bit());
+        REQUIRE(AssetCatalogCache::catalogKey(services, {assetDir}) != frei0rKey);
+        hadFrei0r ? qputenv("FREI0R_PATH", previousFrei0r) : qunsetenv("FREI0R_PATH");
+        hadLadspa ? qputenv("LADSPA_PATH", previousLadspa) : qunsetenv("LADSPA_PATH");
+    }
+}
@@ -0,0 +1,98 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "lib/audio/audioAlignment.h"
+
+#include <numeric>
+#include <random>
+
+namespace {
+// White noise with a louder burst, like speech over a background
+std::vector<float> noiseSignal(size_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-.5f, .5f);
+    std::vector<float> samples(size);
+    for (size_t i = 0; i < size; ++i) {
+        samples[i] = dist(gen) * (i > size / 3 && i < size / 2 ? 1.f : .2f);
+    }
+    return samples;
+}
+
+// One envelope value per frame of frameSize samples, normalized like AudioEnvelope
+std::vector<qint64> envelopeOf(const std::vector<float> &samples, size_t first, size_t frames, size_t frameSize)
+{
+    std::vector<qint64> envelope(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        for (size_t k = 0; k < frameSize; ++k) {
+            envelope[i] += qint64(std::abs(samples[first + i * frameSize + k]) * 32768);
+        }
+    }
+    const qint64 mean = std::accumulate(envelope.begin(), envelope.end(), 0LL) / qint64(frames);
+    for (qint64 &value : envelope) {
+        value -= mean;
+    }
+    return envelope;
+}
+} // namespace
+
+TEST_CASE("Audio alignment", "[AudioAlignment]")
+{
+    const size_t frameSize = 160;
+    const std::vector<float> reference = noiseSignal(600 * frameSize, 3);
+
+    SECTION("Coarse shift of envelopes")
+    {
+        const std::vector<qint64> main = envelopeOf(reference, 0, 600, frameSize);
+        const std::vector<qint64> sub = envelopeOf(reference, 137 * frameSize, 300, frameSize);
+        REQUIRE(AudioAlignment::coarseShift(main, sub) == 137);
+        // The clip starts before the reference
+        const std::vector<qint64> late = envelopeOf(reference, 150 * frameSize, 400, frameSize);
+        const std::vector<qint64> early = envelopeOf(reference, 100 * frameSize, 400, frameSize);
+        REQUIRE(AudioAlignment::coarseShift(late, early) == -50);
+        REQUIRE(AudioAlignment::coarseShift(main, {}) == 0);
+    }
+
+    SECTION("Sample accurate lag")
+    {
+        // An excerpt that does not start on a frame boundary
+        const size_t start = 41 * frameSize + 57;
+        const std::vector<float> sub(reference.begin() + qint64(start), reference.begin() + qint64(start + 20 * frameSize));
+        double confidence = 0.;
+        REQUIRE(AudioAlignment::bestLag(reference, sub, &confidence) == qint64(start));
+        REQUIRE(confidence == Approx(1.).margin(1e-4));
+
+        // Noisy copy, still found with a good confidence
+        std::vector<float> noisy = sub;
+        const std::vector<float> noise = noiseSignal(noisy.size(), 8);
+        for (size_t i = 0; i < noisy.size(); ++i) {
+            noisy[i] += noise[i] * .2f;
+        }
+        REQUIRE(AudioAlignment::bestLag(reference, noisy, &confidence) == qint64(start));
+        REQUIRE(confidence > AudioAlignment::LowConfidence);
+    }
+
+    SECTION("Unrelated audio has a low confidence")
+    {
+        const std::vector<float> other = noiseSignal(20 * frameSize, 21);
+        double confidence = 1.;
+        AudioAlignment::bestLag(reference, other, &confidence);
+        REQUIRE(confidence < AudioAlignment::LowConfidence);
+        // An excerpt longer than the reference cannot be placed
+        REQUIRE(AudioAlignment::bestLag(other, reference, &confidence) == 0);
+        REQUIRE(confidence == 0.);
+    }
+
+    SECTION("Normalized correlation")
+    {
+        const std::vector<double> a{1., 2., 3., 4.};
+        const std::vector<double> b{2., 4., 6., 8.};
+        const std::vector<double> c{4., 3., 2., 1.};
+        const std::vector<double> flat{1., 1., 1., 1.};
+        REQUIRE(AudioAlignment::normalizedCorrelation(a.data(), b.data(), a.size()) == Approx(1.));
+        REQUIRE(AudioAlignment::normalizedCorrelation(a.data(), c.data(), a.size()) == Approx(-1.));
+        REQUIRE(AudioAlignment::normalizedCorrelation(a.data(), flat.data(), a.size()) == 0.);
+    }
+}
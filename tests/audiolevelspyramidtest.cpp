@@ -0,0 +1,156 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "lib/audio/audioLevelsPyramid.h"
+
+#include <QTemporaryDir>
+#include <random>
+#include <vector>
+
+namespace {
+// Reference peak computed by scanning the finest level
+AudioLevelsPyramid::Peak linearPeak(const QByteArray &peaks, int channels, int firstBin, int lastBin, int channel)
+{
+    AudioLevelsPyramid::Peak result;
+    const int bins = peaks.size() / (2 * channels);
+    for (int bin = qMax(0, firstBin); bin <= lastBin && bin < bins; ++bin) {
+        for (int c = 0; c < channels; ++c) {
+            if (channel >= 0 && c != channel) {
+                continue;
+            }
+            result.merge({uint8_t(peaks.at(2 * (bin * channels + c))), uint8_t(peaks.at(2 * (bin * channels + c) + 1))});
+        }
+    }
+    return result;
+}
+} // namespace
+
+TEST_CASE("Audio levels pyramid", "[AudioLevelsPyramid]")
+{
+    const int channels = 2;
+    const int binsPerFrame = 4;
+    const int frames = 1001;
+    std::mt19937 gen(12);
+    QByteArray peaks(frames * binsPerFrame * channels * 2, Qt::Uninitialized);
+    for (char &value : peaks) {
+        value = char(gen() % 200);
+    }
+    // Put the loudest peak in the middle of the stream, on the negative side of the second channel
+    peaks[2 * (2000 * channels + 1) + 1] = char(250);
+    std::shared_ptr<const AudioLevelsPyramid> pyramid = AudioLevelsPyramid::fromPeaks(peaks, channels, binsPerFrame, frames);
+    REQUIRE(pyramid != nullptr);
+
+    SECTION("Structure")
+    {
+        REQUIRE(pyramid->channels() == channels);
+        REQUIRE(pyramid->frameCount() == frames);
+        REQUIRE(pyramid->binCount(0) == frames * binsPerFrame);
+        REQUIRE(pyramid->binCount(pyramid->levelCount() - 1) == 1);
+        REQUIRE(pyramid->maxLevel() == 250);
+        // Coarser levels must contain the maximum of their children
+        for (int level = 1; level < pyramid->levelCount(); ++level) {
+            for (int bin = 0; bin < pyramid->binCount(level); ++bin) {
+                for (int c = 0; c < channels; ++c) {
+                    AudioLevelsPyramid::Peak expected = pyramid->peak(level - 1, 2 * bin, c);
+                    expected.merge(pyramid->peak(level - 1, 2 * bin + 1, c));
+                    AudioLevelsPyramid::Peak current = pyramid->peak(level, bin, c);
+                    REQUIRE(current.high == expected.high);
+                    REQUIRE(current.low == expected.low);
+                }
+            }
+        }
+        const QVector<uint8_t> levels = pyramid->frameLevels();
+        REQUIRE(levels.size() == frames * channels);
+        REQUIRE(levels.at(500 * channels + 1) == 250);
+    }
+
+    SECTION("Range queries never miss a peak")
+    {
+        for (int i = 0; i < 2000; ++i) {
+            double start = (gen() % (frames * 100)) / 100.;
+            double length = (gen() % 20000) / 100.;
+            int channel = int(gen() % 3) - 1;
+            AudioLevelsPyramid::Peak fast = pyramid->peakInRange(start, start + length, channel);
+            int firstBin = int(std::floor(start * binsPerFrame));
+            int lastBin = qMax(firstBin, int(std::ceil((start + length) * binsPerFrame)) - 1);
+            AudioLevelsPyramid::Peak exact = linearPeak(peaks, channels, firstBin, lastBin, channel);
+            // Coarser bins may cover a little more than the requested range, but never less
+            REQUIRE(fast.high >= exact.high);
+            REQUIRE(fast.low >= exact.low);
+            if (firstBin == lastBin) {
+                // A single bin is read at the finest level
+                REQUIRE(fast.high == exact.high);
+                REQUIRE(fast.low == exact.low);
+            }
+        }
+        REQUIRE(pyramid->peakInRange(frames + 10, frames + 20).level() == 0);
+    }
+
+    SECTION("Cache file round trip")
+    {
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+        const QString path = dir.filePath(QStringLiteral("test.peaks"));
+        REQUIRE(pyramid->save(path));
+        std::shared_ptr<const AudioLevelsPyramid> loaded = AudioLevelsPyramid::load(path);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->channels() == channels);
+        REQUIRE(loaded->binsPerFrame() == binsPerFrame);
+        REQUIRE(loaded->frameCount() == frames);
+        REQUIRE(loaded->maxLevel() == 250);
+        REQUIRE(loaded->frameLevels() == pyramid->frameLevels());
+        for (int level = 0; level < pyramid->levelCount(); level += 3) {
+            REQUIRE(loaded->peak(level, 0, 1).low == pyramid->peak(level, 0, 1).low);
+        }
+
+        // Truncated files are rejected
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.resize(file.size() - 1));
+        file.close();
+        REQUIRE(AudioLevelsPyramid::load(path) == nullptr);
+        // The loaded pyramid does not depend on its file anymore
+        REQUIRE(QFile::remove(path));
+        REQUIRE(loaded->frameLevels() == pyramid->frameLevels());
+        REQUIRE(AudioLevelsPyramid::load(dir.filePath(QStringLiteral("missing.peaks"))) == nullptr);
+    }
+
+    SECTION("Legacy per frame levels")
+    {
+        QVector<uint8_t> levels{10, 20, 30, 40, 50, 60};
+        std::shared_ptr<const AudioLevelsPyramid> legacy = AudioLevelsPyramid::fromFrameLevels(levels, 2);
+        REQUIRE(legacy != nullptr);
+        REQUIRE(legacy->binsPerFrame() == 1);
+        REQUIRE(legacy->frameCount() == 3);
+        REQUIRE(legacy->frameLevels() == levels);
+        REQUIRE(legacy->peakInRange(0, 3, 1).level() == 60);
+        REQUIRE(AudioLevelsPyramid::scaledLevel(0.) == 0);
+        REQUIRE(AudioLevelsPyramid::scaledLevel(1.) == 230);
+    }
+
+    SECTION("Frame peaks from interleaved samples")
+    {
+        // 8 stereo samples: one positive peak on the left channel in the first bin, one negative on the right channel in the last bin
+        std::vector<int16_t> samples(16, 0);
+        samples[2] = 16384;
+        samples[15] = -32768;
+        QByteArray framePeaks;
+        AudioLevelsPyramid::appendFramePeaks(framePeaks, samples.data(), 8, 2, 2, binsPerFrame);
+        REQUIRE(framePeaks.size() == binsPerFrame * 2 * 2);
+        REQUIRE(uint8_t(framePeaks.at(0)) == AudioLevelsPyramid::scaledLevel(0.5));
+        REQUIRE(uint8_t(framePeaks.at(1)) == 0);
+        REQUIRE(uint8_t(framePeaks.at(framePeaks.size() - 1)) == AudioLevelsPyramid::scaledLevel(1.));
+        REQUIRE(uint8_t(framePeaks.at(framePeaks.size() - 2)) == 0);
+        // A missing frame, or one with another channel count, repeats the previous one
+        AudioLevelsPyramid::appendFramePeaks(framePeaks, nullptr, 0, 2, 2, binsPerFrame);
+        AudioLevelsPyramid::appendFramePeaks(framePeaks, samples.data(), 16, 1, 2, binsPerFrame);
+        REQUIRE(framePeaks.size() == 3 * binsPerFrame * 2 * 2);
+        REQUIRE(framePeaks.mid(16, 16) == framePeaks.left(16));
+        REQUIRE(framePeaks.right(16) == framePeaks.left(16));
+        QByteArray silence;
+        AudioLevelsPyramid::appendFramePeaks(silence, nullptr, 0, 2, 2, binsPerFrame);
+        REQUIRE(silence == QByteArray(binsPerFrame * 2 * 2, '\0'));
+    }
+}
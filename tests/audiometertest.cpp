@@ -0,0 +1,174 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "lib/audio/audioMeter.h"
+#include "utils/spscqueue.hpp"
+
+#include <random>
+#include <thread>
+
+namespace {
+// Interleaved sine on all channels, with a peak amplitude in dBFS
+std::vector<int16_t> sine(int channels, int frequency, double hz, double db, double seconds, double phase = 0.)
+{
+    const int count = int(frequency * seconds);
+    const double amplitude = std::pow(10., db / 20.) * 32767.;
+    std::vector<int16_t> samples(size_t(count * channels));
+    for (int i = 0; i < count; ++i) {
+        const auto value = int16_t(std::lround(amplitude * std::sin(2. * M_PI * hz * i / frequency + phase)));
+        for (int c = 0; c < channels; ++c) {
+            samples[size_t(i * channels + c)] = value;
+        }
+    }
+    return samples;
+}
+
+// Feed the samples one video frame at a time, like the monitor
+void play(AudioMeter &meter, const std::vector<int16_t> &samples)
+{
+    const int frameSize = meter.frequency() / 25;
+    const int count = int(samples.size()) / meter.channels();
+    for (int offset = 0; offset < count; offset += frameSize) {
+        meter.process(samples.data() + offset * meter.channels(), qMin(frameSize, count - offset));
+    }
+}
+} // namespace
+
+TEST_CASE("Audio meter", "[AudioMeter]")
+{
+    SECTION("EBU R128 loudness of a stereo sine")
+    {
+        // EBU Tech 3341 test 1: a -23 dBFS 1kHz sine on both channels reads -23 LUFS
+        for (int frequency : {44100, 48000}) {
+            AudioMeter meter(2, frequency);
+            play(meter, sine(2, frequency, 1000., -23., 20.));
+            REQUIRE(meter.momentary() == Approx(-23.).margin(0.1));
+            REQUIRE(meter.shortTerm() == Approx(-23.).margin(0.1));
+            REQUIRE(meter.integrated() == Approx(-23.).margin(0.1));
+            REQUIRE(meter.peaks().at(0) == Approx(-23.).margin(0.05));
+        }
+    }
+
+    SECTION("Integrated loudness is gated")
+    {
+        // EBU Tech 3341 test 5: quieter passages below the relative gate are ignored
+        AudioMeter meter(2, 48000);
+        play(meter, sine(2, 48000, 1000., -72., 10.));
+        play(meter, sine(2, 48000, 1000., -26., 20.));
+        play(meter, sine(2, 48000, 1000., -20., 20.1));
+        play(meter, sine(2, 48000, 1000., -26., 20.));
+        play(meter, sine(2, 48000, 1000., -72., 10.));
+        REQUIRE(meter.integrated() == Approx(-23.).margin(0.1));
+        // The last 3 seconds are below the absolute gate
+        REQUIRE(meter.shortTerm() < -70.);
+        meter.reset();
+        REQUIRE(meter.integrated() == AudioMeter::Silence);
+    }
+
+    SECTION("True peak between samples")
+    {
+        // Samples of a quarter sample rate sine shifted by 45° never reach its peak
+        AudioMeter meter(1, 48000);
+        play(meter, sine(1, 48000, 12000., -0.1, 1., M_PI / 4.));
+        REQUIRE(meter.peaks().at(0) == Approx(-3.1).margin(0.1));
+        REQUIRE(meter.truePeaks().at(0) == Approx(-0.1).margin(0.2));
+        REQUIRE(meter.maxTruePeak() == Approx(-0.1).margin(0.2));
+    }
+
+    SECTION("Silence and channel weights")
+    {
+        AudioMeter meter(6, 48000);
+        std::vector<int16_t> silence(size_t(6 * 4800));
+        meter.process(silence.data(), 4800);
+        REQUIRE(meter.momentary() == AudioMeter::Silence);
+        REQUIRE(meter.peaks().at(0) == AudioMeter::Silence);
+        // The LFE channel is not part of the loudness
+        std::vector<int16_t> lfe = sine(6, 48000, 1000., -10., 1.);
+        for (size_t i = 0; i < lfe.size(); ++i) {
+            if (i % 6 != 3) {
+                lfe[i] = 0;
+            }
+        }
+        play(meter, lfe);
+        REQUIRE(meter.momentary() == AudioMeter::Silence);
+        REQUIRE(meter.peaks().at(3) == Approx(-10.).margin(0.05));
+    }
+
+    SECTION("Kernels")
+    {
+        const std::vector<float> samples{0.1f, -0.7f, 0.3f, 0.5f, -0.2f};
+        REQUIRE(AudioMeter::peak(samples.data(), int(samples.size())) == Approx(0.7));
+        const std::vector<double> values{1., 2., 3., 4., 5.};
+        REQUIRE(AudioMeter::sumOfSquares(values.data(), int(values.size())) == Approx(55.));
+        REQUIRE(AudioMeter::toDb(1.) == Approx(0.));
+        REQUIRE(AudioMeter::toDb(0.) == AudioMeter::Silence);
+    }
+
+    SECTION("Vector kernels are bit-exact with the scalar path")
+    {
+        // Odd lengths, so that the vector kernels also run their scalar tail
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+        for (int count : {3, 17, 1001}) {
+            std::vector<float> samples(size_t(count + AudioMeter::TruePeakTaps - 1));
+            std::generate(samples.begin(), samples.end(), [&]() { return distribution(generator); });
+            std::vector<double> weighted(samples.begin(), samples.end());
+            std::vector<float> work(size_t(count));
+            AudioMeter::setSimdLevel(AudioMeter::SimdLevel::Scalar);
+            REQUIRE(AudioMeter::simdLevel() == AudioMeter::SimdLevel::Scalar);
+            const float peak = AudioMeter::peak(samples.data(), count);
+            const float truePeak = AudioMeter::truePeak(samples.data(), count, work.data());
+            const double power = AudioMeter::sumOfSquares(weighted.data(), count);
+            for (auto level : {AudioMeter::SimdLevel::SSE2, AudioMeter::SimdLevel::AVX2}) {
+                if (level > AudioMeter::supportedSimdLevel()) {
+                    continue;
+                }
+                AudioMeter::setSimdLevel(level);
+                CHECK(AudioMeter::peak(samples.data(), count) == peak);
+                CHECK(AudioMeter::truePeak(samples.data(), count, work.data()) == truePeak);
+                CHECK(AudioMeter::sumOfSquares(weighted.data(), count) == power);
+            }
+        }
+        AudioMeter::setSimdLevel(AudioMeter::supportedSimdLevel());
+    }
+}
+
+TEST_CASE("Single producer single consumer queue", "[AudioMeter]")
+{
+    SpscQueue<int> queue(5);
+    REQUIRE(queue.capacity() == 8);
+    int value = 0;
+    REQUIRE_FALSE(queue.pop(value));
+    for (int i = 0; i < 8; ++i) {
+        REQUIRE(queue.push(i));
+    }
+    // Full, the newest value is dropped
+    REQUIRE_FALSE(queue.push(8));
+    REQUIRE(*queue.front() == 0);
+    REQUIRE(queue.pop(value));
+    REQUIRE(value == 0);
+    queue.clear();
+    REQUIRE(queue.front() == nullptr);
+
+    // Values cross threads in order
+    const int count = 100000;
+    std::thread producer([&queue]() {
+        for (int i = 0; i < count;) {
+            if (queue.push(i)) {
+                ++i;
+            }
+        }
+    });
+    int expected = 0;
+    bool ordered = true;
+    while (expected < count) {
+        if (queue.pop(value)) {
+            ordered = ordered && value == expected;
+            ++expected;
+        }
+    }
+    producer.join();
+    REQUIRE(ordered);
+}
@@ -8,7 +8,11 @@
 #include "doc/kdenlivedoc.h"
 #include "test_utils.hpp"
 
+#include <QElapsedTimer>
+#include <QMutexLocker>
 #include <QString>
+#include <QTemporaryDir>
+#include <QThread>
 #include <cmath>
 #include <iostream>
 #include <tuple>
@@ -19,6 +23,16 @@
 #define protected public
 #include "core.h"
 #include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailstore.hpp"
+
+namespace {
+QImage thumbImage(int pos)
+{
+    QImage img(64, 36, QImage::Format_RGB32);
+    img.fill(QColor::fromHsv(pos % 360, 255, 255));
+    return img;
+}
+} // namespace
 
 TEST_CASE("Cache insert-remove", "[Cache]")
 {
@@ -111,3 +125,284 @@ TEST_CASE("getAudioKey() should dereference `ok` param", "ThumbnailCache") {
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
+
+TEST_CASE("Packed thumbnail store", "[Cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(ThumbnailStore::fileName(QStringLiteral("abcdef")));
+
+    SECTION("Store and reopen")
+    {
+        {
+            ThumbnailStore store(path);
+            REQUIRE(store.count() == 0);
+            REQUIRE(store.image(10).isNull());
+            REQUIRE_FALSE(QFile::exists(path));
+            REQUIRE(store.store(50, thumbImage(50)));
+            REQUIRE(store.storeImages({{10, thumbImage(10)}, {30, thumbImage(30)}}));
+            REQUIRE(store.positions() == std::vector<int>({10, 30, 50}));
+            REQUIRE(store.image(30).size() == QSize(64, 36));
+            // Storing a position again overrides it
+            REQUIRE(store.store(30, thumbImage(200)));
+            REQUIRE(store.count() == 3);
+        }
+        ThumbnailStore store(path);
+        REQUIRE(store.positions() == std::vector<int>({10, 30, 50}));
+        REQUIRE_FALSE(store.contains(20));
+        const QImage img = store.image(30);
+        REQUIRE(img.size() == QSize(64, 36));
+        // Jpeg is lossy, but the hue must match the overriding image
+        REQUIRE(qAbs(img.pixelColor(32, 18).hue() - 200) < 10);
+
+        REQUIRE_FALSE(store.data(50).isEmpty());
+
+        // Removed stores delete their file and ignore later writes
+        store.remove();
+        REQUIRE_FALSE(QFile::exists(path));
+        REQUIRE_FALSE(store.store(10, thumbImage(10)));
+    }
+
+    SECTION("Closed stores reopen on access")
+    {
+        ThumbnailStore store(path);
+        REQUIRE(store.storeImages({{10, thumbImage(10)}, {20, thumbImage(20)}}));
+        REQUIRE(store.isOpen());
+        store.close();
+        REQUIRE_FALSE(store.isOpen());
+        // The index is kept, the file is opened again to read the data
+        REQUIRE(store.contains(20));
+        REQUIRE_FALSE(store.isOpen());
+        REQUIRE(store.image(20).size() == QSize(64, 36));
+        REQUIRE(store.isOpen());
+        store.close();
+        // Appending after close keeps the existing records
+        REQUIRE(store.store(30, thumbImage(30)));
+        REQUIRE(store.positions() == std::vector<int>({10, 20, 30}));
+        // Records appended after the file was mapped are read from the file
+        for (int pos = 40; pos < 100; pos += 10) {
+            REQUIRE(store.store(pos, thumbImage(pos)));
+        }
+        for (int pos = 10; pos < 100; pos += 10) {
+            REQUIRE_FALSE(store.image(pos).isNull());
+        }
+        ThumbnailStore unopened(path);
+        REQUIRE_FALSE(unopened.isOpen());
+        REQUIRE(unopened.count() == 9);
+    }
+
+    SECTION("Truncated file")
+    {
+        {
+            ThumbnailStore store(path);
+            REQUIRE(store.storeImages({{1, thumbImage(1)}, {2, thumbImage(2)}}));
+        }
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.resize(file.size() - 10));
+        file.close();
+        ThumbnailStore store(path);
+        REQUIRE(store.positions() == std::vector<int>{1});
+        REQUIRE(store.store(3, thumbImage(3)));
+        ThumbnailStore reopened(path);
+        REQUIRE(reopened.positions() == std::vector<int>({1, 3}));
+        REQUIRE_FALSE(reopened.image(3).isNull());
+    }
+
+    SECTION("Deleted file")
+    {
+        ThumbnailStore store(path);
+        REQUIRE(store.storeImages({{10, thumbImage(10)}, {20, thumbImage(20)}}));
+        store.close();
+        // The records of a file deleted behind the store are forgotten, the next write starts a new file
+        REQUIRE(QFile::remove(path));
+        REQUIRE_FALSE(store.contains(10));
+        REQUIRE(store.store(30, thumbImage(30)));
+        REQUIRE(store.positions() == std::vector<int>{30});
+        {
+            ThumbnailStore reopened(path);
+            REQUIRE(reopened.positions() == std::vector<int>{30});
+        }
+        // Same if the file is deleted while it is open
+        REQUIRE(store.isOpen());
+        REQUIRE(QFile::remove(path));
+        REQUIRE(store.store(40, thumbImage(40)));
+        REQUIRE(store.positions() == std::vector<int>{40});
+        ThumbnailStore reopened(path);
+        REQUIRE(reopened.positions() == std::vector<int>{40});
+        REQUIRE_FALSE(reopened.image(40).isNull());
+    }
+
+    SECTION("Migration from one file per thumbnail")
+    {
+        QDir folder(dir.path());
+        for (int pos = 0; pos < 100; pos += 10) {
+            REQUIRE(thumbImage(pos).save(folder.absoluteFilePath(QStringLiteral("abcdef#%1.jpg").arg(pos))));
+            REQUIRE(thumbImage(pos).save(folder.absoluteFilePath(QStringLiteral("123456#%1.jpg").arg(pos))));
+        }
+        // Unrelated files are kept
+        REQUIRE(thumbImage(0).save(folder.absoluteFilePath(QStringLiteral("marker.jpg"))));
+        REQUIRE(ThumbnailStore::migrateLegacyFiles(folder) == 20);
+        REQUIRE(folder.entryList({QStringLiteral("*.jpg")}, QDir::Files) == QStringList{QStringLiteral("marker.jpg")});
+        ThumbnailStore store(path);
+        REQUIRE(store.count() == 10);
+        REQUIRE(store.image(90).size() == QSize(64, 36));
+        ThumbnailStore other(folder.absoluteFilePath(ThumbnailStore::fileName(QStringLiteral("123456"))));
+        REQUIRE(other.count() == 10);
+        REQUIRE(ThumbnailStore::migrateLegacyFiles(folder) == 0);
+    }
+}
+
+TEST_CASE("Persistent thumbnail cache", "[Cache]")
+{
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    Mock<KdenliveDoc> docMock(document);
+    KdenliveDoc &mockedDoc = docMock.get();
+
+    // The persistent cache lives in a temporary folder
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDir folder(dir.path());
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysDo([&folder](bool, bool *ok) {
+        *ok = true;
+        return folder;
+    });
+    When(Method(pmMock, current)).AlwaysReturn(&mockedDoc);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    mocked.m_project = &mockedDoc;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    mocked.updateTimeline(0, false, QString(), QString(), documentDate, 0);
+    auto timeline = mockedDoc.getTimeline(mockedDoc.uuid());
+    mocked.m_activeTimelineModel = timeline;
+    mocked.testSetActiveDocument(&mockedDoc, timeline);
+
+    QString binId = createProducer(*timeline->getProfile(), "red", binModel, 20, false);
+    bool ok = false;
+    const QString hash = ThumbnailCache::getHash(binId, &ok);
+    REQUIRE(ok);
+    REQUIRE_FALSE(hash.isEmpty());
+    auto &cache = ThumbnailCache::get();
+    // Forget the folders seen by the previous tests
+    cache->clearCache();
+    auto migrating = [&cache]() {
+        QMutexLocker lock(&cache->m_mutex);
+        return !cache->m_migratingDirs.isEmpty();
+    };
+
+    SECTION("Store and get")
+    {
+        cache->storeThumbnail(binId, 10, thumbImage(10), true);
+        cache->storeThumbnail(binId, 20, thumbImage(20), false);
+        while (migrating()) {
+            QThread::msleep(10);
+        }
+        REQUIRE(QFile::exists(folder.absoluteFilePath(ThumbnailStore::fileName(hash))));
+        REQUIRE(cache->hasThumbnail(binId, 10));
+        REQUIRE(cache->hasThumbnail(binId, 20, true));
+        // Only the persistent thumbnail is found once the memory cache is cleared
+        cache->clearCache();
+        REQUIRE(cache->hasThumbnail(binId, 10));
+        REQUIRE_FALSE(cache->hasThumbnail(binId, 10, true));
+        REQUIRE_FALSE(cache->hasThumbnail(binId, 20));
+        const QImage img = cache->getThumbnail(binId, 10);
+        REQUIRE(img.size() == QSize(64, 36));
+        REQUIRE(qAbs(img.pixelColor(32, 18).hue() - 10) < 10);
+        REQUIRE(cache->getThumbnail(hash, binId, 10).size() == QSize(64, 36));
+        cache->invalidateThumbsForClip(binId);
+        REQUIRE_FALSE(cache->hasThumbnail(binId, 10));
+        REQUIRE_FALSE(QFile::exists(folder.absoluteFilePath(ThumbnailStore::fileName(hash))));
+    }
+
+    SECTION("Migration of the legacy files")
+    {
+        for (int pos = 0; pos < 100; pos += 10) {
+            REQUIRE(thumbImage(pos).save(folder.absoluteFilePath(ThumbnailCache::thumbKey(hash, pos))));
+            REQUIRE(thumbImage(pos).save(folder.absoluteFilePath(QStringLiteral("123456#%1.jpg").arg(pos))));
+        }
+        // The first access starts the migration, the thumbnails are available while it runs
+        REQUIRE(cache->hasThumbnail(binId, 90));
+        REQUIRE(qAbs(cache->getThumbnail(binId, 50).pixelColor(32, 18).hue() - 50) < 10);
+        // A thumbnail stored during the migration is newer than the legacy file
+        cache->storeThumbnail(binId, 30, thumbImage(200), true);
+        cache->storeThumbnail(binId, 5, thumbImage(5), true);
+        while (migrating()) {
+            QThread::msleep(10);
+        }
+        REQUIRE(folder.entryList({QStringLiteral("*.jpg")}, QDir::Files).isEmpty());
+        {
+            QMutexLocker lock(&cache->m_mutex);
+            REQUIRE(cache->getStore(hash)->count() == 11);
+        }
+        ThumbnailStore other(folder.absoluteFilePath(ThumbnailStore::fileName(QStringLiteral("123456"))));
+        REQUIRE(other.count() == 10);
+        cache->clearCache();
+        REQUIRE(qAbs(cache->getThumbnail(binId, 90).pixelColor(32, 18).hue() - 90) < 10);
+        REQUIRE(qAbs(cache->getThumbnail(binId, 30).pixelColor(32, 18).hue() - 200) < 10);
+        REQUIRE_FALSE(cache->getThumbnail(binId, 5).isNull());
+        cache->invalidateThumbsForClip(binId);
+        REQUIRE_FALSE(cache->hasThumbnail(binId, 90));
+    }
+    while (migrating()) {
+        QThread::msleep(10);
+    }
+    cache->clearCache();
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Packed thumbnail store benchmark", "[Cache][.benchmark]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const int clips = 100;
+    const int thumbs = 30;
+    QDir legacy(dir.path());
+    legacy.mkdir(QStringLiteral("legacy"));
+    legacy.cd(QStringLiteral("legacy"));
+    QDir packed(dir.path());
+    packed.mkdir(QStringLiteral("packed"));
+    packed.cd(QStringLiteral("packed"));
+    for (int clip = 0; clip < clips; ++clip) {
+        std::vector<std::pair<int, QImage>> images;
+        for (int i = 0; i < thumbs; ++i) {
+            const QImage img = thumbImage(clip + i);
+            img.save(legacy.absoluteFilePath(QStringLiteral("clip%1#%2.jpg").arg(clip).arg(i * 25)));
+            images.emplace_back(i * 25, img);
+        }
+        ThumbnailStore store(packed.absoluteFilePath(ThumbnailStore::fileName(QStringLiteral("clip%1").arg(clip))));
+        REQUIRE(store.storeImages(images));
+    }
+    // Project open: check and load all thumbnails, like the timeline does.
+    // The files were just written and are likely in the page cache, this compares the cost of the file accesses rather than of the disk
+    QElapsedTimer timer;
+    timer.start();
+    int loaded = 0;
+    for (int clip = 0; clip < clips; ++clip) {
+        QDir folder(legacy.absolutePath());
+        for (int i = 0; i < thumbs; ++i) {
+            const QString key = QStringLiteral("clip%1#%2.jpg").arg(clip).arg(i * 25);
+            if (folder.exists(key) && !QImage(folder.absoluteFilePath(key)).isNull()) {
+                loaded++;
+            }
+        }
+    }
+    const qint64 legacyTime = timer.elapsed();
+    timer.restart();
+    for (int clip = 0; clip < clips; ++clip) {
+        ThumbnailStore store(packed.absoluteFilePath(ThumbnailStore::fileName(QStringLiteral("clip%1").arg(clip))));
+        for (int i = 0; i < thumbs; ++i) {
+            if (store.contains(i * 25) && !store.image(i * 25).isNull()) {
+                loaded++;
+            }
+        }
+    }
+    const qint64 packedTime = timer.elapsed();
+    REQUIRE(loaded == 2 * clips * thumbs);
+    REQUIRE(packed.entryList(QDir::Files).size() == clips);
+    qDebug() << "Loading" << clips * thumbs << "thumbnails, one file per thumbnail:" << legacyTime << "ms, packed stores:" << packedTime << "ms";
+}
@@ -9,6 +9,108 @@
 #include "scopes/colorscopes/waveformgenerator.h"
 #include "scopes/colorscopes/rgbparadegenerator.h"
 #include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/scopeframe.h"
+#include "scopes/colorscopes/scopekernels.h"
+
+#include <QElapsedTimer>
+#include <cstring>
+
+namespace {
+// A frame with pseudo random pixels, and some flat areas as in real footage
+QImage noiseImage(int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    quint32 seed = 42;
+    for (int y = 0; y < height; ++y) {
+        auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            if (x < width / 4) {
+                line[x] = qRgb(200, 30, 30);
+                continue;
+            }
+            seed = seed * 1664525u + 1013904223u;
+            line[x] = 0xff000000 | (seed >> 8);
+        }
+    }
+    return image;
+}
+
+QList<ScopeKernels::SimdLevel> vectorLevels()
+{
+    QList<ScopeKernels::SimdLevel> levels;
+    for (auto level : {ScopeKernels::SimdLevel::SSE4, ScopeKernels::SimdLevel::AVX2}) {
+        if (level <= ScopeKernels::supportedSimdLevel()) {
+            levels << level;
+        }
+    }
+    return levels;
+}
+
+QList<QImage> allScopes(const QImage &image, uint accelFactor)
+{
+    QList<QImage> scopes;
+    const QSize scopeSize(512, 256);
+    const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentR |
+                                HistogramGenerator::Components::ComponentG | HistogramGenerator::Components::ComponentB |
+                                HistogramGenerator::Components::ComponentSum;
+    for (auto mode : {WaveformGenerator::PaintMode_Green, WaveformGenerator::PaintMode_White}) {
+        scopes << WaveformGenerator().calculateWaveform(scopeSize, image, mode, true, ITURec::Rec_601, accelFactor);
+    }
+    scopes << RGBParadeGenerator().calculateRGBParade(scopeSize, image, RGBParadeGenerator::PaintMode_RGB, true, false, accelFactor);
+    scopes << HistogramGenerator().calculateHistogram(scopeSize, image, ALL_COMPONENTS, ITURec::Rec_709, false, true, accelFactor);
+    for (auto mode : {VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::PaintMode_Chroma}) {
+        scopes << VectorscopeGenerator().calculateVectorscope(scopeSize, image, 1, mode, VectorscopeGenerator::ColorSpace_YPbPr, false, accelFactor);
+    }
+    return scopes;
+}
+
+// A frame filled with one color, as the monitor would receive it from MLT
+SharedFrame yuvFrame(mlt_image_format format, int width, int height, int colorspace, int y, int u, int v, bool fullRange = false)
+{
+    const int size = mlt_image_format_size(format, width, height, nullptr);
+    auto *data = static_cast<uint8_t *>(mlt_pool_alloc(size));
+    if (format == mlt_image_yuv422) {
+        for (int i = 0; i < width * height / 2; ++i) {
+            data[4 * i] = uint8_t(y);
+            data[4 * i + 1] = uint8_t(u);
+            data[4 * i + 2] = uint8_t(y);
+            data[4 * i + 3] = uint8_t(v);
+        }
+    } else {
+        const int lumaSize = width * height;
+        const int chromaSize = (width / 2) * (height / 2);
+        memset(data, y, size_t(lumaSize));
+        memset(data + lumaSize, u, size_t(chromaSize));
+        memset(data + lumaSize + chromaSize, v, size_t(chromaSize));
+    }
+    mlt_frame frame = mlt_frame_init(nullptr);
+    mlt_frame_set_image(frame, data, size, mlt_pool_release);
+    Mlt::Frame mltFrame(frame);
+    mlt_frame_close(frame);
+    mltFrame.set("format", format);
+    mltFrame.set("width", width);
+    mltFrame.set("height", height);
+    mltFrame.set("colorspace", colorspace);
+    mltFrame.set("full_range", fullRange ? 1 : 0);
+    return SharedFrame(mltFrame);
+}
+
+// Rows of an image having non transparent pixels
+QList<int> paintedRows(const QImage &image)
+{
+    QList<int> rows;
+    for (int y = 0; y < image.height(); ++y) {
+        const auto *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x]) > 0) {
+                rows << y;
+                break;
+            }
+        }
+    }
+    return rows;
+}
+} // namespace
 
 // test for a bug where pixels were assumed to be RGB which was not true on
 // Windows, resulting in red and blue switched. BUG: 453149
@@ -80,3 +182,161 @@ TEST_CASE("Colorscope RGB/BGR handling")
         CHECK(rgbScope == bgrScope);
     }
 }
+
+TEST_CASE("Colorscope kernels", "[Scopes]")
+{
+    const QImage image = noiseImage(640, 360);
+    const int width = image.width();
+
+    SECTION("Sampling follows the pixel order of the image")
+    {
+        for (int step : {1, 3, 7}) {
+            int expected = 0;
+            int sampled = 0;
+            for (int y = 0; y < image.height(); ++y) {
+                const int start = ScopeKernels::firstSample(y, width, step);
+                const int count = ScopeKernels::sampleCount(start, width, step);
+                for (int k = 0; k < count; ++k) {
+                    // Same pixel as the k-th one when taking one pixel out of step over the whole image
+                    REQUIRE(y * width + start + k * step == expected);
+                    expected += step;
+                    sampled++;
+                }
+            }
+            REQUIRE(sampled == (image.width() * image.height() + step - 1) / step);
+        }
+    }
+
+    SECTION("RGB histogram matches QImage::pixel")
+    {
+        int r[256] = {0}, g[256] = {0}, b[256] = {0};
+        int refR[256] = {0}, refG[256] = {0}, refB[256] = {0};
+        for (int y = 0; y < image.height(); ++y) {
+            ScopeKernels::histogramRGB(reinterpret_cast<const QRgb *>(image.constScanLine(y)), ScopeKernels::sampleCount(0, width, 2), 2, r, g, b);
+            for (int x = 0; x < width; x += 2) {
+                const QRgb pixel = image.pixel(x, y);
+                refR[qRed(pixel)]++;
+                refG[qGreen(pixel)]++;
+                refB[qBlue(pixel)]++;
+            }
+        }
+        REQUIRE(memcmp(r, refR, sizeof(r)) == 0);
+        REQUIRE(memcmp(g, refG, sizeof(g)) == 0);
+        REQUIRE(memcmp(b, refB, sizeof(b)) == 0);
+    }
+
+    SECTION("Vector kernels are bit-exact with the scalar path")
+    {
+        const auto *line = reinterpret_cast<const QRgb *>(image.constScanLine(100));
+        const double factors[6] = {-0.0005781, -0.001135, 0.001713, 0.002411, -0.002019, -0.0003921};
+        for (int step : {1, 3}) {
+            const int count = ScopeKernels::sampleCount(0, width, step);
+            std::vector<float> scalarLuma(size_t(count)), luma(size_t(count));
+            std::vector<double> scalarU(size_t(count)), scalarV(size_t(count)), u(size_t(count)), v(size_t(count));
+            ScopeKernels::setSimdLevel(ScopeKernels::SimdLevel::Scalar);
+            REQUIRE(ScopeKernels::simdLevel() == ScopeKernels::SimdLevel::Scalar);
+            ScopeKernels::luma(line, count, step, ITURec::Rec_709, scalarLuma.data());
+            ScopeKernels::chroma(line, count, step, factors, scalarU.data(), scalarV.data());
+            const QList<QImage> scalarScopes = allScopes(image, uint(step));
+            for (auto level : vectorLevels()) {
+                ScopeKernels::setSimdLevel(level);
+                ScopeKernels::luma(line, count, step, ITURec::Rec_709, luma.data());
+                ScopeKernels::chroma(line, count, step, factors, u.data(), v.data());
+                CHECK(memcmp(luma.data(), scalarLuma.data(), luma.size() * sizeof(float)) == 0);
+                CHECK(memcmp(u.data(), scalarU.data(), u.size() * sizeof(double)) == 0);
+                CHECK(memcmp(v.data(), scalarV.data(), v.size() * sizeof(double)) == 0);
+                CHECK(allScopes(image, uint(step)) == scalarScopes);
+            }
+        }
+        ScopeKernels::setSimdLevel(ScopeKernels::supportedSimdLevel());
+    }
+}
+
+TEST_CASE("Colorscope kernels benchmark", "[Scopes][.benchmark]")
+{
+    for (const QSize &size : {QSize(1920, 1080), QSize(3840, 2160)}) {
+        const QImage frame = noiseImage(size.width(), size.height());
+        QList<ScopeKernels::SimdLevel> levels = vectorLevels();
+        levels.prepend(ScopeKernels::SimdLevel::Scalar);
+        for (auto level : levels) {
+            ScopeKernels::setSimdLevel(level);
+            QElapsedTimer timer;
+            timer.start();
+            const int runs = 3;
+            for (int i = 0; i < runs; ++i) {
+                REQUIRE(allScopes(frame, 1).size() == 6);
+            }
+            qDebug() << "Scopes at" << size << "with SIMD level" << int(level) << ":" << timer.elapsed() / runs << "ms per frame for all scopes";
+        }
+    }
+    ScopeKernels::setSimdLevel(ScopeKernels::supportedSimdLevel());
+}
+
+TEST_CASE("Colorscopes read YUV frames", "[Scopes]")
+{
+    const int width = 64;
+    const int height = 32;
+    QImage red(width, height, QImage::Format_RGB32);
+    red.fill(Qt::red);
+    const QSize scopeSize(256, 256);
+
+    // Red in Rec. 709 and Rec. 601 video range
+    const ScopeFrame frame709(yuvFrame(mlt_image_yuv422, width, height, 709, 63, 102, 240));
+    const ScopeFrame frame601(yuvFrame(mlt_image_yuv420p, width, height, 601, 81, 90, 240));
+
+    for (const ScopeFrame &frame : {frame709, frame601}) {
+        REQUIRE(frame.isYuv());
+        REQUIRE(frame.width() == width);
+        REQUIRE(frame.height() == height);
+        REQUIRE_FALSE(frame.fullRange());
+
+        QRgb pixels[width / 2];
+        float lumas[width / 2];
+        frame.rgb(height - 1, 1, width / 2, 2, pixels);
+        for (QRgb pixel : pixels) {
+            CHECK(qRed(pixel) >= 253);
+            CHECK(qGreen(pixel) <= 2);
+            CHECK(qBlue(pixel) <= 2);
+        }
+        const ITURec rec = frame.colorspace();
+        frame.luma(0, 0, width / 2, 2, rec, lumas);
+        const float expectedLuma = rec == ITURec::Rec_709 ? 255.f * REC_709_R : 255.f * REC_601_R;
+        for (float luma : lumas) {
+            CHECK(luma == Approx(expectedLuma).margin(1.));
+        }
+
+        // The chroma read from the samples matches the one computed from the RGB image
+        const double factors[6] = {-0.0006671, -0.001299, 0.0019608, 0.001961, -0.001642, -0.0003189};
+        double u[width], v[width], rgbU[width], rgbV[width];
+        frame.chroma(3, 0, width, 1, factors, u, v);
+        ScopeFrame(red).chroma(3, 0, width, 1, factors, rgbU, rgbV);
+        for (int i = 0; i < width; ++i) {
+            CHECK(u[i] == Approx(rgbU[i]).margin(0.01));
+            CHECK(v[i] == Approx(rgbV[i]).margin(0.01));
+        }
+
+        // The waveform shows the same level as for the RGB image, up to the rounding of the 8 bits samples
+        const QList<int> rows = paintedRows(WaveformGenerator().calculateWaveform(scopeSize, frame, WaveformGenerator::PaintMode_White, false, rec, 1));
+        const QList<int> rgbRows = paintedRows(WaveformGenerator().calculateWaveform(scopeSize, red, WaveformGenerator::PaintMode_White, false, rec, 1));
+        REQUIRE(rows.size() == 1);
+        REQUIRE(rgbRows.size() == 1);
+        CHECK(qAbs(rows.first() - rgbRows.first()) <= 1);
+        CHECK_FALSE(HistogramGenerator().calculateHistogram(scopeSize, frame, HistogramGenerator::ComponentY, rec, false, false, 1).isNull());
+        CHECK_FALSE(RGBParadeGenerator().calculateRGBParade(scopeSize, frame, RGBParadeGenerator::PaintMode_RGB, false, false, 1).isNull());
+        CHECK_FALSE(VectorscopeGenerator()
+                        .calculateVectorscope(scopeSize, frame, 1, VectorscopeGenerator::PaintMode_Original, VectorscopeGenerator::ColorSpace_YPbPr, false, 1)
+                        .isNull());
+    }
+
+    SECTION("Full range frames")
+    {
+        const ScopeFrame frame(yuvFrame(mlt_image_yuv422, width, height, 709, 255, 128, 128, true));
+        REQUIRE(frame.fullRange());
+        QRgb pixel;
+        float luma;
+        frame.rgb(0, 0, 1, 1, &pixel);
+        frame.luma(0, 0, 1, 1, ITURec::Rec_709, &luma);
+        CHECK(pixel == qRgb(255, 255, 255));
+        CHECK(luma == Approx(255.f));
+    }
+}
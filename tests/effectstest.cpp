@@ -7,8 +7,11 @@
 #include "doc/kdenlivedoc.h"
 #include "test_utils.hpp"
 
+#include <QElapsedTimer>
 #include <QString>
+#include <QThread>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <tuple>
 #include <unordered_set>
@@ -117,6 +120,100 @@ TEST_CASE("Effects stack", "[Effects]")
         REQUIRE(clipModel->rowCount() == 0);
         REQUIRE(splitModel->rowCount() == 1);
     }
+
+    // Process the events until @param done returns true, at most 2 seconds
+    auto waitFor = [](const std::function<bool()> &done) {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done() && timer.elapsed() < 2000) {
+            QThread::msleep(5);
+            qApp->processEvents();
+        }
+        return done();
+    };
+
+    SECTION("Parameter changes within a tick are notified once")
+    {
+        auto clipModel = timeline->getClipPtr(cid1)->m_effectStack;
+        REQUIRE(clipModel->appendEffect(anEffect));
+        REQUIRE(clipModel->appendEffect(anEffect));
+        auto first = std::static_pointer_cast<EffectItemModel>(clipModel->getEffectStackRow(0));
+        auto second = std::static_pointer_cast<EffectItemModel>(clipModel->getEffectStackRow(1));
+        AssetParameterModel::PendingUpdates &pending = AssetParameterModel::pendingUpdates();
+        // Flush the notifications of the effect creation
+        REQUIRE(waitFor([&pending]() { return pending.timer == nullptr || !pending.timer->isActive(); }));
+        int firstChanges = 0;
+        int secondChanges = 0;
+        QObject::connect(first.get(), &QAbstractItemModel::dataChanged, [&firstChanges]() { ++firstChanges; });
+        QObject::connect(second.get(), &QAbstractItemModel::dataChanged, [&secondChanges]() { ++secondChanges; });
+
+        for (int i = 0; i < 5; ++i) {
+            first->setParameter(QStringLiteral("u"), 60 + i);
+        }
+        second->setParameter(QStringLiteral("v"), 100);
+        REQUIRE(first->getParam(QStringLiteral("u")).toInt() == 64);
+        // Nothing is sent before the tick
+        REQUIRE(firstChanges == 0);
+        REQUIRE(secondChanges == 0);
+        REQUIRE(pending.timer->isActive());
+        REQUIRE(pending.models.size() == 2);
+        // Both effects belong to the same clip: it is refreshed and invalidated once
+        const ObjectId owner(ObjectType::TimelineClip, cid1);
+        REQUIRE(pending.renders == QVector<ObjectId>{owner});
+        REQUIRE(pending.items == QVector<QPair<ObjectId, QString>>{qMakePair(owner, anEffect)});
+
+        REQUIRE(waitFor([&pending]() { return !pending.timer->isActive(); }));
+        REQUIRE(firstChanges == 1);
+        REQUIRE(secondChanges == 1);
+        REQUIRE(pending.models.isEmpty());
+        REQUIRE(pending.renders.isEmpty());
+        REQUIRE(pending.items.isEmpty());
+
+        // A change after the tick starts a new one
+        first->setParameter(QStringLiteral("u"), 70);
+        REQUIRE(pending.renders == QVector<ObjectId>{owner});
+        REQUIRE(waitFor([&firstChanges]() { return firstChanges == 2; }));
+        REQUIRE(secondChanges == 1);
+    }
+
+    SECTION("Rebuilt effects are replugged once the values settle")
+    {
+        QDomDocument xml;
+        REQUIRE(xml.setContent(QStringLiteral("<effect tag=\"sox\" id=\"sox_gain\" type=\"audio\"><parameter type=\"constant\" name=\"gain\" default=\"0\" "
+                                              "min=\"-10\" max=\"10\"><name>Gain</name></parameter></effect>")));
+        auto sox = std::make_shared<AssetParameterModel>(std::make_unique<Mlt::Properties>(), xml.documentElement(), QStringLiteral("sox_gain"),
+                                                         ObjectId(ObjectType::TimelineClip, cid1));
+        int replugs = 0;
+        QObject::connect(sox.get(), &AssetParameterModel::replugEffect, [&replugs](const std::shared_ptr<AssetParameterModel> &) { ++replugs; });
+        // A slider drag, each step within the rebuild delay
+        for (int i = 1; i <= 5; ++i) {
+            sox->setParameter(QStringLiteral("gain"), i);
+            QThread::msleep(20);
+            qApp->processEvents();
+        }
+        REQUIRE(replugs == 0);
+        REQUIRE(QString(sox->getAsset()->get("effect")) == QLatin1String("gain 5"));
+        REQUIRE(waitFor([&replugs]() { return replugs > 0; }));
+        // No other rebuild once the values are stable
+        QThread::msleep(300);
+        qApp->processEvents();
+        REQUIRE(replugs == 1);
+    }
+
+    SECTION("Delayed replug of a removed effect")
+    {
+        auto clipModel = timeline->getClipPtr(cid1)->m_effectStack;
+        REQUIRE(clipModel->appendEffect(anEffect));
+        REQUIRE(clipModel->appendEffect(anEffect));
+        auto effect = std::static_pointer_cast<EffectItemModel>(clipModel->getEffectStackRow(0));
+        clipModel->removeEffect(effect);
+        REQUIRE(clipModel->rowCount() == 1);
+        REQUIRE(effect->row() < 0);
+        // The rebuild requested before the removal is ignored
+        clipModel->replugEffect(effect);
+        REQUIRE(clipModel->rowCount() == 1);
+        REQUIRE(clipModel->checkConsistency());
+    }
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
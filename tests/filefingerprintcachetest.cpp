@@ -0,0 +1,93 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "utils/filefingerprintcache.hpp"
+
+#include <QDateTime>
+#include <QTemporaryDir>
+
+namespace {
+void writeFile(const QString &path, const QByteArray &data, const QDateTime &modified = QDateTime())
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    REQUIRE(file.write(data) == data.size());
+    if (modified.isValid()) {
+        // Data written later would change the date again
+        REQUIRE(file.flush());
+        REQUIRE(file.setFileTime(modified, QFileDevice::FileModificationTime));
+    }
+}
+} // namespace
+
+TEST_CASE("File fingerprint cache", "[FileFingerprintCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString cachePath = dir.filePath(QStringLiteral("fingerprints.cache"));
+    const QString media = dir.filePath(QStringLiteral("clip.mp4"));
+    const QDateTime modified = QDateTime::currentDateTime().addDays(-1);
+    // Large enough to only hash the first and last megabyte
+    QByteArray content(3000000, 'a');
+    content[2500000] = 'b';
+    writeFile(media, content, modified);
+    const FileFingerprintCache::Fingerprint expected = FileFingerprintCache::computeHash(media);
+    REQUIRE(expected.first.size() == 16);
+    REQUIRE(expected.second == 3000000);
+
+    SECTION("Hashes are cached until the file changes")
+    {
+        FileFingerprintCache cache(cachePath);
+        REQUIRE(cache.fileHash(media) == expected);
+        REQUIRE(cache.count() == 1);
+        // Same size and date: the cached hash is used without reading the file
+        content[2500000] = 'c';
+        writeFile(media, content, modified);
+        REQUIRE(cache.fileHash(media) == expected);
+        // New date, the file is hashed again
+        writeFile(media, content, modified.addSecs(10));
+        const FileFingerprintCache::Fingerprint changed = cache.fileHash(media);
+        REQUIRE(changed.first != expected.first);
+        REQUIRE(changed == FileFingerprintCache::computeHash(media));
+        REQUIRE(cache.count() == 2);
+        // Missing files are not cached
+        REQUIRE(cache.fileHash(dir.filePath(QStringLiteral("missing.mp4"))).first.isEmpty());
+        REQUIRE(cache.count() == 2);
+    }
+
+    SECTION("Cache is persistent")
+    {
+        {
+            FileFingerprintCache cache(cachePath);
+            cache.prefetch({media, media});
+            REQUIRE(cache.count() == 1);
+            REQUIRE(cache.save());
+        }
+        content[2500000] = 'c';
+        writeFile(media, content, modified);
+        FileFingerprintCache cache(cachePath);
+        REQUIRE(cache.count() == 1);
+        REQUIRE(cache.fileHash(media) == expected);
+    }
+
+    SECTION("Parallel hashing")
+    {
+        QStringList files;
+        for (int i = 0; i < 20; ++i) {
+            files << dir.filePath(QStringLiteral("file%1.wav").arg(i));
+            writeFile(files.last(), QByteArray(1000 + i, char(i)));
+        }
+        FileFingerprintCache cache(cachePath);
+        cache.prefetch(files);
+        REQUIRE(cache.count() == 20);
+        for (const QString &file : qAsConst(files)) {
+            REQUIRE(cache.fileHash(file) == FileFingerprintCache::computeHash(file));
+        }
+        // An invalid cache file is ignored
+        writeFile(cachePath, QByteArray("garbage"));
+        FileFingerprintCache invalid(cachePath);
+        REQUIRE(invalid.count() == 0);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "doc/fileindex.h"
+#include "utils/filefingerprintcache.hpp"
+
+#include <QTemporaryDir>
+
+namespace {
+void writeFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    REQUIRE(file.write(data) == data.size());
+}
+} // namespace
+
+TEST_CASE("File index", "[FileIndex]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QDir root(dir.path());
+    // Three files of the same size, only the content tells them apart
+    writeFile(root.absoluteFilePath(QStringLiteral("a/clip.mp4")), QByteArray(1000, 'a'));
+    writeFile(root.absoluteFilePath(QStringLiteral("a/b/other.mp4")), QByteArray(1000, 'b'));
+    writeFile(root.absoluteFilePath(QStringLiteral("c/d/e/Clip.MP4")), QByteArray(1000, 'c'));
+    writeFile(root.absoluteFilePath(QStringLiteral("c/images/img_0001.png")), QByteArray(10, 'i'));
+    writeFile(root.absoluteFilePath(QStringLiteral("c/images/img_0002.png")), QByteArray(10, 'j'));
+    writeFile(root.absoluteFilePath(QStringLiteral("sound.wav")), QByteArray(500, 's'));
+
+    FileIndex index;
+    REQUIRE(index.build(dir.path()));
+    REQUIRE(index.fileCount() == 6);
+    REQUIRE(index.folders().size() == 7);
+    REQUIRE(index.folders().constFirst() == root.absolutePath());
+    REQUIRE(index.scannedFolders() == 7);
+
+    SECTION("Find by size and hash")
+    {
+        const QString target = root.absoluteFilePath(QStringLiteral("a/b/other.mp4"));
+        const QString hash = QString::fromLatin1(FileFingerprintCache::computeHash(target).first.toHex());
+        index.prefetchHashes({1000, 500});
+        REQUIRE(index.findFile(1000, hash) == target);
+        REQUIRE(index.findFile(999, hash).isEmpty());
+        REQUIRE(index.findFile(500, hash).isEmpty());
+    }
+
+    SECTION("Find by name, closest to the root first")
+    {
+        REQUIRE(index.findByName(QStringLiteral("clip.mp4")) == root.absoluteFilePath(QStringLiteral("a/clip.mp4")));
+        REQUIRE(index.findByName(QStringLiteral("SOUND.wav")) == root.absoluteFilePath(QStringLiteral("sound.wav")));
+        REQUIRE(index.findByName(QStringLiteral("missing.mp4")).isEmpty());
+    }
+
+    SECTION("Find slideshow images and folders")
+    {
+        REQUIRE(index.findByPattern(QStringLiteral("img_*")) == root.absoluteFilePath(QStringLiteral("c/images/img_0001.png")));
+        REQUIRE(index.findByPattern(QStringLiteral("none_*")).isEmpty());
+        REQUIRE(index.findFolder(QStringLiteral("images")) == root.absoluteFilePath(QStringLiteral("c/images")));
+        REQUIRE(index.findFolder(QStringLiteral("f")).isEmpty());
+    }
+
+    SECTION("Aborted walk")
+    {
+        const std::atomic<bool> abort{true};
+        FileIndex partial;
+        REQUIRE_FALSE(partial.build(dir.path(), &abort));
+        REQUIRE(partial.fileCount() == 0);
+    }
+
+    SECTION("Symbolic link loops are not followed")
+    {
+#ifdef Q_OS_UNIX
+        REQUIRE(QFile::link(root.absolutePath(), root.absoluteFilePath(QStringLiteral("a/loop"))));
+        FileIndex linked;
+        REQUIRE(linked.build(dir.path()));
+        REQUIRE(linked.fileCount() == 6);
+#endif
+    }
+}
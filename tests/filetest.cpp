@@ -12,6 +12,7 @@
 #include "timeline2/model/builders/meltBuilder.hpp"
 #include "xml/xml.hpp"
 
+#include <QElapsedTimer>
 #include <QTemporaryFile>
 #include <QUndoGroup>
 
@@ -404,3 +405,92 @@ TEST_CASE("Opening Mix", "[OPENMIX]")
     }
     undoStack->clear();
 }
+
+TEST_CASE("Autosave", "[AUTOSAVE]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    QTemporaryFile project(QDir::temp().absoluteFilePath(QStringLiteral("autosave-XXXXXX.kdenlive")));
+    REQUIRE(project.open());
+    document.m_autosave = new KAutoSaveFile(QUrl::fromLocalFile(project.fileName()), &document);
+
+    auto autosaved = [&document]() {
+        document.waitForAutoSave();
+        QFile file(document.m_autosave->fileName());
+        REQUIRE(file.open(QIODevice::ReadOnly));
+        return QString::fromUtf8(file.readAll());
+    };
+
+    SECTION("Scenes are written in the background with the replacements")
+    {
+        QMap<QString, QString> replacements;
+        replacements.insert(QStringLiteral("$CURRENTPATH"), QStringLiteral("/home/user/project"));
+        document.slotAutoSave(QStringLiteral("<mlt><track producer=\"$CURRENTPATH/clip.mp4\"/></mlt>"), replacements);
+        REQUIRE(autosaved() == QStringLiteral("<mlt><track producer=\"/home/user/project/clip.mp4\"/></mlt>"));
+        // Scenes queued while one is written replace each other, the last one ends in the file
+        for (int i = 0; i < 10; ++i) {
+            document.slotAutoSave(QStringLiteral("<mlt><track id=\"%1\"/></mlt>").arg(i));
+        }
+        REQUIRE(autosaved() == QStringLiteral("<mlt><track id=\"9\"/></mlt>"));
+    }
+
+    SECTION("Corrupted scenes do not overwrite the backup")
+    {
+        document.slotAutoSave(QStringLiteral("<mlt><track id=\"0\"/></mlt>"));
+        REQUIRE(autosaved() == QStringLiteral("<mlt><track id=\"0\"/></mlt>"));
+        document.slotAutoSave(QStringLiteral("<mlt></mlt>"));
+        REQUIRE(autosaved() == QStringLiteral("<mlt><track id=\"0\"/></mlt>"));
+    }
+}
+
+TEST_CASE("Autosave scene cost", "[AUTOSAVE][.benchmark]")
+{
+    // The autosave scene is built by the MLT xml consumer on the GUI thread, measure it on a large timeline
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    Mock<KdenliveDoc> docMock(document);
+    KdenliveDoc &mockedDoc = docMock.get();
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+    When(Method(pmMock, current)).AlwaysReturn(&mockedDoc);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    mocked.m_project = &mockedDoc;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    mocked.updateTimeline(0, false, QString(), QString(), documentDate, 0);
+    auto timeline = mockedDoc.getTimeline(mockedDoc.uuid());
+    mocked.m_activeTimelineModel = timeline;
+    mocked.testSetActiveDocument(&mockedDoc, timeline);
+
+    QString binId = createProducer(*timeline->getProfile(), "red", binModel, 20, false);
+    int tid1 = timeline->getTrackIndexFromPosition(2);
+    int tid2 = timeline->getTrackIndexFromPosition(3);
+    for (int clips : {500, 2000}) {
+        while (timeline->getTrackClipsCount(tid1) + timeline->getTrackClipsCount(tid2) < clips) {
+            int count = timeline->getTrackClipsCount(tid1) + timeline->getTrackClipsCount(tid2);
+            int cid = -1;
+            REQUIRE(timeline->requestClipInsertion(binId, count % 2 == 0 ? tid1 : tid2, 20 * (count / 2), cid, true, true, false));
+            if (count % 10 == 0) {
+                REQUIRE(timeline->addClipEffect(cid, QStringLiteral("sepia")));
+            }
+        }
+        qint64 best = -1;
+        for (int i = 0; i < 5; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            const QString scene = binModel->sceneList(QDir::temp().absolutePath(), QString(), QString(), timeline->tractor(), timeline->duration());
+            const qint64 elapsed = timer.elapsed();
+            REQUIRE(scene.contains(QLatin1String("<track ")));
+            best = best < 0 ? elapsed : qMin(best, elapsed);
+        }
+        qDebug() << "Autosave scene of" << clips << "clips built in" << best << "ms";
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
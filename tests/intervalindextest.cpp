@@ -0,0 +1,142 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "timeline2/model/intervalindex.hpp"
+
+#include <QElapsedTimer>
+#include <limits>
+#include <map>
+#include <random>
+#include <unordered_set>
+
+namespace {
+// Reproduces the linear scan previously used by TrackModel::getClipsInRange
+std::unordered_set<int> linearRange(const std::map<int, std::pair<int, int>> &items, int position, int end)
+{
+    std::unordered_set<int> ids;
+    for (const auto &it : items) {
+        int pos = it.second.first;
+        int length = it.second.second - it.second.first + 1;
+        if (end > -1 && pos >= end) {
+            continue;
+        }
+        if (pos >= position || pos + length - 1 >= position) {
+            ids.insert(it.first);
+        }
+    }
+    return ids;
+}
+
+std::unordered_set<int> indexRange(const IntervalIndex &index, int position, int end)
+{
+    const std::vector<int> found = index.overlapping(position, end > -1 ? end - 1 : std::numeric_limits<int>::max());
+    return std::unordered_set<int>(found.begin(), found.end());
+}
+} // namespace
+
+TEST_CASE("Interval index", "[IntervalIndex]")
+{
+    IntervalIndex index;
+
+    SECTION("Basic queries")
+    {
+        REQUIRE(index.overlapping(0, 100).empty());
+        index.insert(1, 0, 9);
+        index.insert(2, 10, 19);
+        index.insert(3, 15, 40);
+        REQUIRE(index.size() == 3);
+        REQUIRE(index.stabbing(5) == std::vector<int>{1});
+        REQUIRE(index.stabbing(10) == std::vector<int>{2});
+        REQUIRE(index.stabbing(16) == std::vector<int>({2, 3}));
+        REQUIRE(index.stabbing(41).empty());
+        REQUIRE(index.overlapping(9, 10) == std::vector<int>({1, 2}));
+        REQUIRE(index.interval(3) == std::pair<int, int>(15, 40));
+
+        // Updating an existing id moves it
+        index.insert(1, 50, 60);
+        REQUIRE(index.size() == 3);
+        REQUIRE(index.stabbing(5).empty());
+        REQUIRE(index.stabbing(55) == std::vector<int>{1});
+
+        REQUIRE(index.remove(2));
+        REQUIRE_FALSE(index.remove(2));
+        REQUIRE_FALSE(index.contains(2));
+        REQUIRE(index.stabbing(16) == std::vector<int>{3});
+        REQUIRE(index.interval(2) == std::pair<int, int>(-1, -1));
+        index.clear();
+        REQUIRE(index.size() == 0);
+        REQUIRE(index.overlapping(0, 100).empty());
+    }
+
+    SECTION("Randomized comparison with linear scan")
+    {
+        std::mt19937 gen(42);
+        std::map<int, std::pair<int, int>> reference;
+        for (int i = 0; i < 5000; ++i) {
+            int id = int(gen() % 500);
+            switch (gen() % 3) {
+            case 0:
+            case 1: {
+                int start = int(gen() % 20000);
+                int end = start + int(gen() % 300);
+                index.insert(id, start, end);
+                reference[id] = {start, end};
+                break;
+            }
+            default:
+                REQUIRE(index.remove(id) == (reference.erase(id) > 0));
+                break;
+            }
+            int position = int(gen() % 20000);
+            int end = (gen() % 4 == 0) ? -1 : position + int(gen() % 1000);
+            REQUIRE(indexRange(index, position, end) == linearRange(reference, position, end));
+        }
+    }
+}
+
+TEST_CASE("Interval index benchmark on a 10k clips track", "[IntervalIndex][.benchmark]")
+{
+    IntervalIndex index;
+    // Build a synthetic track with 10000 adjacent clips of varying duration
+    std::mt19937 gen(7);
+    std::map<int, std::pair<int, int>> reference;
+    int position = 0;
+    for (int id = 0; id < 10000; ++id) {
+        int duration = 25 + int(gen() % 250);
+        index.insert(id, position, position + duration - 1);
+        reference[id] = {position, position + duration - 1};
+        position += duration;
+    }
+    const int trackLength = position;
+    const int queries = 2000;
+    std::vector<int> starts;
+    for (int i = 0; i < queries; ++i) {
+        starts.push_back(int(gen() % uint(trackLength)));
+    }
+    QElapsedTimer timer;
+    size_t linearCount = 0;
+    timer.start();
+    for (int start : starts) {
+        linearCount += linearRange(reference, start, start + 500).size();
+    }
+    qint64 linearTime = timer.nsecsElapsed();
+    size_t indexCount = 0;
+    timer.restart();
+    for (int start : starts) {
+        indexCount += indexRange(index, start, start + 500).size();
+    }
+    qint64 indexTime = timer.nsecsElapsed();
+    REQUIRE(linearCount == indexCount);
+    qDebug() << "Range queries on 10k clips, linear scan:" << linearTime / queries << "ns/query, interval index:" << indexTime / queries << "ns/query";
+
+    timer.restart();
+    size_t stabbed = 0;
+    for (int start : starts) {
+        stabbed += index.stabbing(start).size();
+    }
+    qint64 stabTime = timer.nsecsElapsed();
+    REQUIRE(stabbed == size_t(queries));
+    qDebug() << "Position queries on 10k clips, interval index:" << stabTime / queries << "ns/query";
+}
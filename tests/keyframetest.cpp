@@ -261,5 +261,156 @@ TEST_CASE("Keyframe model", "[KeyframeModel]")
         undoStack->undo();
         state1(6.1);
     }
+
+    SECTION("Compiled curve matches MLT interpolation")
+    {
+        double fps = pCore->getCurrentFps();
+        auto check_curve = [&]() {
+            for (int frame = 0; frame <= 120; ++frame) {
+                GenTime pos(frame, fps);
+                REQUIRE(model->getInterpolatedValue(pos).toDouble() == Approx(model->getMltInterpolatedValue(pos).toDouble()).margin(1e-6));
+            }
+        };
+        REQUIRE(model->addKeyframe(GenTime(10, fps), KeyframeType::Linear, 20));
+        REQUIRE(model->addKeyframe(GenTime(30, fps), KeyframeType::Curve, -40));
+        REQUIRE(model->addKeyframe(GenTime(50, fps), KeyframeType::Curve, 60));
+        REQUIRE(model->addKeyframe(GenTime(70, fps), KeyframeType::Discrete, 10));
+        REQUIRE(model->addKeyframe(GenTime(90, fps), KeyframeType::Linear, 80));
+        auto curve = model->compiledCurve();
+        REQUIRE(curve->isSupported());
+        REQUIRE(curve->keyframeCount() == 6);
+        check_curve();
+        // The curve is only compiled once
+        REQUIRE(model->compiledCurve() == curve);
+
+        // The range matches the values frame by frame
+        QVector<double> range = model->getInterpolatedRange(0, 120);
+        REQUIRE(range.size() == 121);
+        for (int frame = 0; frame <= 120; ++frame) {
+            REQUIRE(range.at(frame) == Approx(model->getInterpolatedValue(frame).toDouble()).margin(1e-6));
+        }
+        // The sampled range drawn by the timeline uses the normalized scale of the keyframe view
+        QVariantList normalized = model->getNormalizedRange(10, 50, 4);
+        REQUIRE(normalized.size() == 11);
+        REQUIRE(normalized.first().toDouble() == Approx(model->data(model->index(1), KeyframeModel::NormalizedValueRole).toDouble()));
+        REQUIRE(normalized.last().toDouble() == Approx(model->data(model->index(3), KeyframeModel::NormalizedValueRole).toDouble()));
+
+        // Editing a keyframe invalidates the curve, and so does undo
+        REQUIRE(model->updateKeyframe(GenTime(50, fps), 0.));
+        REQUIRE(model->compiledCurve() != curve);
+        check_curve();
+        undoStack->undo();
+        check_curve();
+        REQUIRE(model->removeKeyframe(GenTime(30, fps)));
+        REQUIRE(model->compiledCurve()->keyframeCount() == 5);
+        check_curve();
+    }
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Compiled curve of rects, colors and splines", "[KeyframeModel]")
+{
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    Mlt::Profile pr;
+    std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(pr, "color", "red");
+    auto effectstack = EffectStackModel::construct(producer, {ObjectType::TimelineClip, 0}, undoStack);
+    double fps = pCore->getCurrentFps();
+
+    // Build the keyframe model of the first parameter of an effect with the given type
+    auto keyframeModel = [&](const QString &effectId, ParamType type) {
+        effectstack->appendEffect(effectId);
+        auto effect = std::dynamic_pointer_cast<EffectItemModel>(effectstack->getEffectStackRow(effectstack->rowCount() - 1));
+        REQUIRE(effect != nullptr);
+        effect->prepareKeyframes();
+        for (int row = 0; row < effect->rowCount(); ++row) {
+            QModelIndex index = effect->index(row, 0);
+            if (effect->data(index, AssetParameterModel::TypeRole).value<ParamType>() == type) {
+                return std::make_shared<KeyframeModel>(effect, index, undoStack);
+            }
+        }
+        return std::shared_ptr<KeyframeModel>();
+    };
+
+    SECTION("Rect")
+    {
+        auto model = keyframeModel(QStringLiteral("pan_zoom"), ParamType::AnimatedRect);
+        REQUIRE(model != nullptr);
+        REQUIRE(model->addKeyframe(GenTime(0, fps), KeyframeType::Linear, QStringLiteral("0 0 1920 1080")));
+        REQUIRE(model->addKeyframe(GenTime(20, fps), KeyframeType::Curve, QStringLiteral("100 -50 960 540")));
+        REQUIRE(model->addKeyframe(GenTime(45, fps), KeyframeType::Curve, QStringLiteral("-300 200 1280 720")));
+        REQUIRE(model->addKeyframe(GenTime(60, fps), KeyframeType::Discrete, QStringLiteral("10 10 640 360")));
+        REQUIRE(model->addKeyframe(GenTime(80, fps), KeyframeType::Linear, QStringLiteral("0 0 1920 1080")));
+        REQUIRE(model->compiledCurve()->isSupported());
+        for (int frame = 0; frame <= 100; ++frame) {
+            GenTime pos(frame, fps);
+            const QStringList value = model->getInterpolatedValue(pos).toString().split(QLatin1Char(' '));
+            const QStringList mltValue = model->getMltInterpolatedValue(pos).toString().split(QLatin1Char(' '));
+            REQUIRE(value.size() == mltValue.size());
+            for (int i = 0; i < value.size(); ++i) {
+                // Both sides truncate to an integer, a rounding difference can move the result by one
+                REQUIRE(value.at(i).toDouble() == Approx(mltValue.at(i).toDouble()).margin(1.));
+            }
+        }
+    }
+
+    SECTION("Color")
+    {
+        auto model = keyframeModel(QStringLiteral("pan_zoom"), ParamType::Color);
+        REQUIRE(model != nullptr);
+        REQUIRE(model->addKeyframe(GenTime(0, fps), KeyframeType::Linear, QStringLiteral("0x000000ff")));
+        REQUIRE(model->addKeyframe(GenTime(25, fps), KeyframeType::Curve, QStringLiteral("0xff800080")));
+        REQUIRE(model->addKeyframe(GenTime(50, fps), KeyframeType::Discrete, QStringLiteral("0x20c0ffff")));
+        REQUIRE(model->addKeyframe(GenTime(75, fps), KeyframeType::Linear, QStringLiteral("0xffffff00")));
+        REQUIRE(model->compiledCurve()->isSupported());
+        for (int frame = 0; frame <= 100; ++frame) {
+            GenTime pos(frame, fps);
+            REQUIRE(model->getInterpolatedValue(pos).toString() == model->getMltInterpolatedValue(pos).toString());
+        }
+    }
+
+    SECTION("Rotoscoping")
+    {
+        auto model = keyframeModel(QStringLiteral("rotoscoping"), ParamType::Roto_spline);
+        REQUIRE(model != nullptr);
+        // A spline of 3 points, each point being made of its center and two handles in relative coordinates
+        auto spline = [](double offset) {
+            QList<QVariant> points;
+            for (int i = 0; i < 3; ++i) {
+                QList<QVariant> point;
+                for (int j = 0; j < 3; ++j) {
+                    point << QVariant(QList<QVariant>() << QVariant(0.2 * i + 0.05 * j + offset) << QVariant(0.3 + 0.1 * i - offset));
+                }
+                points << QVariant(point);
+            }
+            return QVariant(points);
+        };
+        REQUIRE(model->addKeyframe(GenTime(10, fps), KeyframeType::Linear, spline(0.)));
+        REQUIRE(model->addKeyframe(GenTime(40, fps), KeyframeType::Linear, spline(0.25)));
+        REQUIRE(model->addKeyframe(GenTime(70, fps), KeyframeType::Linear, spline(-0.1)));
+        REQUIRE(model->compiledCurve()->isSupported());
+        for (int frame = 0; frame <= 100; ++frame) {
+            GenTime pos(frame, fps);
+            const QList<QVariant> points = model->getInterpolatedValue(pos).toList();
+            const QList<QVariant> mltPoints = model->getMltInterpolatedValue(pos).toList();
+            REQUIRE(points.size() == 3);
+            REQUIRE(points.size() == mltPoints.size());
+            for (int i = 0; i < points.size(); ++i) {
+                const QList<QVariant> point = points.at(i).toList();
+                const QList<QVariant> mltPoint = mltPoints.at(i).toList();
+                REQUIRE(point.size() == mltPoint.size());
+                for (int j = 0; j < point.size(); ++j) {
+                    REQUIRE(point.at(j).toList().at(0).toDouble() == Approx(mltPoint.at(j).toList().at(0).toDouble()).margin(1e-6));
+                    REQUIRE(point.at(j).toList().at(1).toDouble() == Approx(mltPoint.at(j).toList().at(1).toDouble()).margin(1e-6));
+                }
+            }
+        }
+    }
     pCore->m_projectManager = nullptr;
 }
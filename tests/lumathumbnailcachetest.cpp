@@ -0,0 +1,77 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "utils/lumathumbnailcache.hpp"
+
+#include <QComboBox>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+
+TEST_CASE("Luma thumbnail cache", "[LumaThumbnailCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString luma = dir.filePath(QStringLiteral("wipe.png"));
+    QImage image(400, 200, QImage::Format_Grayscale8);
+    for (int y = 0; y < image.height(); ++y) {
+        memset(image.scanLine(y), y, size_t(image.width()));
+    }
+    REQUIRE(image.save(luma));
+    LumaThumbnailCache cache(dir.filePath(QStringLiteral("cache")));
+
+    SECTION("Thumbnails are scaled and stored on disk")
+    {
+        REQUIRE(LumaThumbnailCache::isLumaFile(luma));
+        REQUIRE(LumaThumbnailCache::isLumaFile(QStringLiteral("luma01.PGM")));
+        REQUIRE_FALSE(LumaThumbnailCache::isLumaFile(QStringLiteral("effect.xml")));
+        const QString cached = cache.cacheFile(luma);
+        REQUIRE_FALSE(cached.isEmpty());
+        REQUIRE_FALSE(QFile::exists(cached));
+        const QImage thumb = cache.loadThumbnail(luma);
+        // The aspect ratio is kept
+        REQUIRE(thumb.size() == QSize(50, 25));
+        REQUIRE(QFile::exists(cached));
+        REQUIRE(QImage(cached).size() == thumb.size());
+        // Changing the luma file invalidates its thumbnail
+        QFile file(luma);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.setFileTime(QDateTime::currentDateTime().addDays(-1), QFileDevice::FileModificationTime));
+        file.close();
+        REQUIRE(cache.cacheFile(luma) != cached);
+        // Missing files and MLT builtin lumas have no thumbnail
+        REQUIRE(cache.cacheFile(QStringLiteral("luma01.pgm")).isEmpty());
+        REQUIRE(cache.loadThumbnail(dir.filePath(QStringLiteral("missing.png"))).isNull());
+    }
+
+    SECTION("Combo box icons are set when loaded")
+    {
+        const QString otherLuma = dir.filePath(QStringLiteral("other.png"));
+        REQUIRE(image.save(otherLuma));
+        QComboBox combo;
+        combo.addItem(QStringLiteral("None"));
+        combo.addItem(QStringLiteral("Wipe"), luma);
+        combo.addItem(QStringLiteral("Other"), otherLuma);
+        combo.setCurrentIndex(1);
+        cache.setComboIcons(&combo);
+        QElapsedTimer timer;
+        timer.start();
+        while (combo.itemIcon(1).isNull() && timer.elapsed() < 5000) {
+            QThread::msleep(10);
+            qApp->processEvents();
+        }
+        REQUIRE_FALSE(combo.itemIcon(1).isNull());
+        REQUIRE(combo.itemIcon(0).isNull());
+        // Now in memory
+        REQUIRE(cache.thumbnail(luma).size() == QSize(50, 25));
+        // Only the current item is loaded while the popup is closed
+        QThreadPool::globalInstance()->waitForDone();
+        REQUIRE(combo.itemIcon(2).isNull());
+        REQUIRE_FALSE(QFile::exists(cache.cacheFile(otherLuma)));
+    }
+}
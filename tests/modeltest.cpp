@@ -7,6 +7,8 @@
 #include "test_utils.hpp"
 #include "doc/kdenlivedoc.h"
 
+#include <QElapsedTimer>
+#include <QTemporaryDir>
 #include <QUndoGroup>
 
 using namespace fakeit;
@@ -2296,3 +2298,234 @@ TEST_CASE("New KdenliveDoc activeTrack", "KdenliveDoc")
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
+
+TEST_CASE("Bin item lookups", "[BinModel]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    Mlt::Profile profile;
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    const QString rootId = binModel->getRootFolder()->clipId();
+    QString folderA;
+    QString folderB;
+    QString folderC;
+    REQUIRE(binModel->requestAddFolder(folderA, QStringLiteral("A"), rootId, undo, redo));
+    REQUIRE(binModel->requestAddFolder(folderB, QStringLiteral("B"), folderA, undo, redo));
+    REQUIRE(binModel->requestAddFolder(folderC, QStringLiteral("C"), rootId, undo, redo));
+
+    // A clip of an existing file, with a known hash
+    auto addFileClip = [&](const QString &fileName, const QString &hash, const QString &parentId) {
+        const QString path = dir.filePath(fileName);
+        QFile file(path);
+        if (!file.exists()) {
+            REQUIRE(file.open(QIODevice::WriteOnly));
+            file.close();
+        }
+        std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(profile, "color", "red");
+        REQUIRE(producer->is_valid());
+        producer->set("resource", path.toUtf8().constData());
+        producer->set("kdenlive:file_hash", hash.toUtf8().constData());
+        const QString binId = QString::number(binModel->getFreeClipId());
+        auto binClip = ProjectClip::construct(binId, QIcon(), binModel, producer);
+        Fun undo2 = []() { return true; };
+        Fun redo2 = []() { return true; };
+        REQUIRE(binModel->addItem(binClip, parentId, undo2, redo2));
+        return binId;
+    };
+    const QString clipA = addFileClip(QStringLiteral("a.mkv"), QStringLiteral("hash-a"), folderA);
+    const QString clipB = addFileClip(QStringLiteral("b.mkv"), QStringLiteral("hash-b"), folderB);
+    const QString colorId = createProducer(profile, "red", binModel, 20, false);
+    const QFileInfo fileA(dir.filePath(QStringLiteral("a.mkv")));
+    const QFileInfo fileB(dir.filePath(QStringLiteral("b.mkv")));
+
+    SECTION("Indexed lookups")
+    {
+        for (const QString &id : {folderA, folderB, folderC}) {
+            auto item = binModel->getItemByBinId(id);
+            REQUIRE(item);
+            REQUIRE(item->clipId() == id);
+            REQUIRE(binModel->getFolderByBinId(id));
+            REQUIRE_FALSE(binModel->getClipByBinID(id));
+            REQUIRE_FALSE(binModel->isIdFree(id));
+        }
+        for (const QString &id : {clipA, clipB, colorId}) {
+            auto clip = binModel->getClipByBinID(id);
+            REQUIRE(clip);
+            REQUIRE(clip->clipId() == id);
+            // Timeline ids carry a suffix
+            REQUIRE(binModel->getClipByBinID(id + QStringLiteral("_2")) == clip);
+            REQUIRE_FALSE(binModel->getFolderByBinId(id));
+        }
+        REQUIRE_FALSE(binModel->getItemByBinId(QStringLiteral("999999")));
+    }
+
+    SECTION("Clips found by url and hash")
+    {
+        REQUIRE(binModel->getClipByUrl(fileA) == QStringList{clipA});
+        REQUIRE(binModel->getClipByUrl(fileB) == QStringList{clipB});
+        REQUIRE(binModel->getClipByUrl(QFileInfo(dir.filePath(QStringLiteral("missing.mkv")))).isEmpty());
+        // A second clip of the same file
+        const QString clipA2 = addFileClip(QStringLiteral("a.mkv"), QStringLiteral("hash-a"), folderC);
+        QStringList clips = binModel->getClipByUrl(fileA);
+        clips.sort();
+        QStringList expected = {clipA, clipA2};
+        expected.sort();
+        REQUIRE(clips == expected);
+
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-a")) == clipA);
+        REQUIRE(binModel->validateClipInFolder(folderC, QStringLiteral("hash-a")) == clipA2);
+        // Clips of subfolders are found
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-b")) == clipB);
+        REQUIRE(binModel->validateClipInFolder(folderB, QStringLiteral("hash-a")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderC, QStringLiteral("hash-b")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(QStringLiteral("999999"), QStringLiteral("hash-a")).isEmpty());
+    }
+
+    SECTION("Renamed files and folders")
+    {
+        Fun undo2 = []() { return true; };
+        Fun redo2 = []() { return true; };
+        REQUIRE(binModel->requestRenameFolder(binModel->getFolderByBinId(folderA), QStringLiteral("Renamed"), undo2, redo2));
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-a")) == clipA);
+
+        // The file of clip A is renamed and the clip relocated, like ProjectClip::setProducer does when the clip is reloaded
+        const QString renamed = dir.filePath(QStringLiteral("renamed.mkv"));
+        REQUIRE(QFile::rename(fileA.absoluteFilePath(), renamed));
+        auto clip = binModel->getClipByBinID(clipA);
+        std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(profile, "color", "red");
+        producer->set("resource", renamed.toUtf8().constData());
+        clip->m_clipType = ClipType::Unknown;
+        clip->updateProducer(producer);
+        clip->setProducerProperty(QStringLiteral("kdenlive:file_hash"), QStringLiteral("hash-renamed"));
+        binModel->updateWatcher(clip);
+        REQUIRE(clip->clipUrl() == renamed);
+
+        REQUIRE(binModel->getClipByUrl(fileA).isEmpty());
+        REQUIRE(binModel->getClipByUrl(QFileInfo(renamed)) == QStringList{clipA});
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-a")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-renamed")) == clipA);
+        // The other clip is not affected
+        REQUIRE(binModel->getClipByUrl(fileB) == QStringList{clipB});
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-b")) == clipB);
+    }
+
+    SECTION("Moved clips")
+    {
+        // Moved like Bin::doMoveClip does
+        auto clip = binModel->getClipByBinID(clipB);
+        REQUIRE(clip->changeParent(binModel->getFolderByBinId(folderC)));
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-b")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderB, QStringLiteral("hash-b")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderC, QStringLiteral("hash-b")) == clipB);
+        REQUIRE(binModel->validateClipInFolder(rootId, QStringLiteral("hash-b")) == clipB);
+        REQUIRE(binModel->getClipByUrl(fileB) == QStringList{clipB});
+        // And back
+        REQUIRE(clip->changeParent(binModel->getFolderByBinId(folderB)));
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-b")) == clipB);
+        REQUIRE(binModel->validateClipInFolder(folderC, QStringLiteral("hash-b")).isEmpty());
+    }
+
+    SECTION("Deleted items are removed from the index")
+    {
+        Fun undo2 = []() { return true; };
+        Fun redo2 = []() { return true; };
+        REQUIRE(binModel->requestBinClipDeletion(binModel->getItemByBinId(folderC), undo2, redo2));
+        REQUIRE(binModel->requestBinClipDeletion(binModel->getItemByBinId(clipA), undo2, redo2));
+        REQUIRE_FALSE(binModel->getItemByBinId(folderC));
+        REQUIRE_FALSE(binModel->getClipByBinID(clipA));
+        REQUIRE(binModel->isIdFree(clipA));
+        REQUIRE(binModel->getClipByUrl(fileA).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-a")).isEmpty());
+        REQUIRE(binModel->validateClipInFolder(folderC, QStringLiteral("hash-b")).isEmpty());
+        REQUIRE(binModel->getClipByUrl(fileB) == QStringList{clipB});
+        REQUIRE(undo2());
+        REQUIRE(binModel->getFolderByBinId(folderC));
+        REQUIRE(binModel->getClipByBinID(clipA));
+        REQUIRE(binModel->getClipByUrl(fileA) == QStringList{clipA});
+        REQUIRE(binModel->validateClipInFolder(folderA, QStringLiteral("hash-a")) == clipA);
+    }
+    binModel->clean();
+    REQUIRE(binModel->m_binIdIndex.size() == binModel->m_allItems.size());
+    REQUIRE(binModel->m_clipFileKeys.empty());
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Bin item lookups benchmark", "[BinModel][.benchmark]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    Mlt::Profile profile;
+
+    // Build a bin with 20k items: nested folders and a few clips
+    const int itemCount = 20000;
+    const int clipCount = 20;
+    QStringList folderIds;
+    QStringList clipIds;
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    QElapsedTimer timer;
+    timer.start();
+    QString parentId = binModel->getRootFolder()->clipId();
+    for (int i = 0; i < itemCount - clipCount; ++i) {
+        QString id;
+        REQUIRE(binModel->requestAddFolder(id, QStringLiteral("Folder %1").arg(i), parentId, undo, redo));
+        folderIds << id;
+        if (i % 100 == 0) {
+            parentId = id;
+        }
+    }
+    for (int i = 0; i < clipCount; ++i) {
+        clipIds << createProducer(profile, "red", binModel, 20, false);
+    }
+    qDebug() << "Built a bin of" << itemCount << "items in" << timer.elapsed() << "ms";
+
+    timer.start();
+    for (const QString &id : qAsConst(folderIds)) {
+        REQUIRE(binModel->getItemByBinId(id));
+        REQUIRE(binModel->getFolderByBinId(id));
+        REQUIRE_FALSE(binModel->getClipByBinID(id));
+        REQUIRE_FALSE(binModel->isIdFree(id));
+    }
+    for (const QString &id : qAsConst(clipIds)) {
+        REQUIRE(binModel->getClipByBinID(id));
+        REQUIRE(binModel->getClipByBinID(id + QStringLiteral("_2")));
+        REQUIRE_FALSE(binModel->getFolderByBinId(id));
+    }
+    qint64 indexed = timer.nsecsElapsed();
+
+    // Same lookups as the linear scan previously used, on a subset of the items
+    const int scanned = 200;
+    timer.start();
+    for (int i = 0; i < scanned; ++i) {
+        const QString &id = folderIds.at(i * folderIds.size() / scanned);
+        std::shared_ptr<AbstractProjectItem> found;
+        for (const auto &item : binModel->m_allItems) {
+            auto c = std::static_pointer_cast<AbstractProjectItem>(item.second.lock());
+            if (c->clipId() == id) {
+                found = c;
+                break;
+            }
+        }
+        REQUIRE(found);
+    }
+    qint64 linear = timer.nsecsElapsed();
+    qDebug() << "Bin lookup, indexed:" << indexed / (folderIds.size() * 4 + clipIds.size() * 3) << "ns, linear scan:" << linear / scanned << "ns";
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
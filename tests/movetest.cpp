@@ -99,6 +99,134 @@ TEST_CASE("Cut undo/redo", "[MoveClips]")
         REQUIRE(prod1.same_clip(prod3));
         REQUIRE(prod2.same_clip(prod4));
     }
+
+    SECTION("Drag session rejects colliding moves without touching the playlists")
+    {
+        REQUIRE(timeline->requestClipInsertion(binId, tid2, 300, cid3));
+        cid4 = timeline->getClipSplitPartner(cid3);
+        REQUIRE(timeline->getItemTrackId(cid4) == tid3);
+
+        timeline->ensureDragSession(cid3);
+        REQUIRE(timeline->m_dragSession->items.size() == 2);
+        REQUIRE(timeline->m_dragSession->items.count(cid4) == 1);
+        // Moving over the first clip would collide, moving right after it is fine
+        REQUIRE_FALSE(timeline->isDragMovePossible(-150));
+        REQUIRE(timeline->isDragMovePossible(-100));
+        REQUIRE(timeline->isDragMovePossible(500));
+        REQUIRE_FALSE(timeline->isDragMovePossible(-400));
+
+        // The suggested move is adjusted to the end of the first clip
+        QVariantList result = timeline->suggestClipMove(cid3, tid2, 150, -1, -1);
+        REQUIRE(result.at(0).toInt() == 200);
+        REQUIRE(timeline->getClipPosition(cid3) == 200);
+        REQUIRE(timeline->getClipPosition(cid4) == 200);
+        REQUIRE(timeline->checkConsistency());
+
+        // Finalizing the move ends the drag session
+        REQUIRE(timeline->requestClipMove(cid3, tid2, 250, true, true, true, true));
+        REQUIRE(timeline->m_dragSession == nullptr);
+        REQUIRE(timeline->checkConsistency());
+    }
+
+    SECTION("Drag session uses the track delta of requestGroupMove")
+    {
+        int tid1 = timeline->getTrackIndexFromPosition(3);
+        REQUIRE(timeline->requestClipInsertion(binId, tid2, 300, cid3));
+        int cid5 = -1;
+        REQUIRE(timeline->requestClipInsertion(binId, tid1, 600, cid5));
+        REQUIRE(timeline->requestClipsGroup({cid3, cid5}) > 0);
+
+        // The group cannot go above the top track, requestGroupMove keeps it on its tracks
+        timeline->ensureDragSession(cid3);
+        std::unordered_map<int, int> targetTracks;
+        REQUIRE(timeline->isDragMovePossible(1, 0, true, &targetTracks));
+        REQUIRE(targetTracks.at(cid3) == tid2);
+        REQUIRE(targetTracks.at(cid5) == tid1);
+
+        // The drag preview follows the same rule
+        QVariantList result = timeline->suggestClipDragMove(cid3, tid1, 400, -1, -1);
+        REQUIRE(result.at(0).toInt() == 400);
+        REQUIRE(result.at(1).toInt() == tid2);
+        REQUIRE(timeline->m_allClips[cid3]->getFakeTrackId() == -1);
+        REQUIRE(timeline->endClipDrag(cid3, true) == 1);
+        REQUIRE(timeline->getClipTrackId(cid3) == tid2);
+        REQUIRE(timeline->getClipPosition(cid3) == 400);
+        REQUIRE(timeline->getClipTrackId(cid5) == tid1);
+        REQUIRE(timeline->checkConsistency());
+    }
+
+    SECTION("Drag preview only updates the playlists on drop")
+    {
+        int tid1 = timeline->getTrackIndexFromPosition(3);
+        int tid4 = timeline->getTrackIndexFromPosition(0);
+        REQUIRE(timeline->requestClipInsertion(binId, tid2, 300, cid3));
+        cid4 = timeline->getClipSplitPartner(cid3);
+        Mlt::Playlist &playlist = timeline->getTrackById(tid2)->m_playlists[0];
+
+        // A colliding position sticks the preview to the end of the first clip
+        QVariantList result = timeline->suggestClipDragMove(cid3, tid2, 150, -1, -1);
+        REQUIRE(result.at(0).toInt() == 200);
+        REQUIRE(timeline->m_allClips[cid3]->getFakePosition() == 200);
+        REQUIRE(timeline->m_allClips[cid4]->getFakePosition() == 200);
+        REQUIRE(timeline->getClipPosition(cid3) == 300);
+        REQUIRE(playlist.is_blank_at(250));
+        REQUIRE_FALSE(playlist.is_blank_at(300));
+
+        // Changing the groups discards the session and its preview
+        REQUIRE(timeline->requestClipUngroup(cid3));
+        REQUIRE(timeline->m_dragSession == nullptr);
+        REQUIRE(timeline->m_allClips[cid3]->getFakePosition() == 300);
+        undoStack->undo();
+        REQUIRE(timeline->m_groups->isInGroup(cid3));
+
+        // Moving to another track is previewed through the fake track of both clips
+        result = timeline->suggestClipDragMove(cid3, tid1, 400, -1, -1);
+        REQUIRE(result.at(0).toInt() == 400);
+        REQUIRE(result.at(1).toInt() == tid1);
+        REQUIRE(timeline->m_allClips[cid3]->getFakeTrackId() == tid1);
+        REQUIRE(timeline->m_allClips[cid4]->getFakeTrackId() == tid4);
+        REQUIRE(timeline->getClipTrackId(cid3) == tid2);
+        REQUIRE(timeline->getClipTrackId(cid4) == tid3);
+        REQUIRE(timeline->getClipPosition(cid3) == 300);
+        REQUIRE_FALSE(playlist.is_blank_at(300));
+
+        // Dropping applies the previewed move as a single undoable operation
+        REQUIRE(timeline->endClipDrag(cid3, true) == 1);
+        REQUIRE(timeline->m_dragSession == nullptr);
+        REQUIRE(timeline->getClipTrackId(cid3) == tid1);
+        REQUIRE(timeline->getClipTrackId(cid4) == tid4);
+        REQUIRE(timeline->getClipPosition(cid3) == 400);
+        REQUIRE(timeline->getClipPosition(cid4) == 400);
+        REQUIRE(timeline->m_allClips[cid3]->getFakeTrackId() == -1);
+        REQUIRE(playlist.is_blank_at(300));
+        REQUIRE(timeline->checkConsistency());
+        undoStack->undo();
+        REQUIRE(timeline->getClipTrackId(cid3) == tid2);
+        REQUIRE(timeline->getClipPosition(cid3) == 300);
+        REQUIRE(timeline->checkConsistency());
+
+        // A drop that cannot be applied anymore is reported, the preview goes back to the clips position
+        result = timeline->suggestClipDragMove(cid3, tid2, 500, -1, -1);
+        REQUIRE(result.at(0).toInt() == 500);
+        int cid5 = -1;
+        REQUIRE(timeline->requestClipInsertion(binId, tid2, 500, cid5, false));
+        REQUIRE(timeline->m_dragSession != nullptr);
+        REQUIRE(timeline->endClipDrag(cid3, true) == 0);
+        REQUIRE(timeline->m_dragSession == nullptr);
+        REQUIRE(timeline->getClipPosition(cid3) == 300);
+        REQUIRE(timeline->m_allClips[cid3]->getFakePosition() == 300);
+        REQUIRE(timeline->checkConsistency());
+        REQUIRE(timeline->requestItemDeletion(cid5, false));
+
+        // Cancelling restores the preview without moving the clips
+        result = timeline->suggestClipDragMove(cid3, tid2, 500, -1, -1);
+        REQUIRE(timeline->m_allClips[cid3]->getFakePosition() == 500);
+        timeline->cancelClipDrag();
+        REQUIRE(timeline->m_dragSession == nullptr);
+        REQUIRE(timeline->m_allClips[cid3]->getFakePosition() == 300);
+        REQUIRE(timeline->getClipPosition(cid3) == 300);
+        REQUIRE(timeline->endClipDrag(cid3, true) == -1);
+    }
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
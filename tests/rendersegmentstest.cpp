@@ -0,0 +1,385 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "catch.hpp"
+
+#include "lib/renderSegments.h"
+
+#include <QFile>
+#include <QProcess>
+#include <QRgb>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <memory>
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+namespace {
+/** @brief The color of the @param frame in the test playlists, neighbour frames differ by at least 13 on each channel */
+QRgb frameColor(int frame)
+{
+    return qRgb(frame * 37 % 256, frame * 91 % 256, frame * 13 % 256);
+}
+
+/** @brief A playlist with a different color on each frame, so that a missing or repeated frame changes the hashes */
+QDomDocument colorPlaylist(int frames, const QString &target)
+{
+    QDomDocument doc;
+    QDomElement mlt = doc.createElement(QStringLiteral("mlt"));
+    doc.appendChild(mlt);
+    QDomElement playlist = doc.createElement(QStringLiteral("playlist"));
+    playlist.setAttribute(QStringLiteral("id"), QStringLiteral("main"));
+    for (int i = 0; i < frames; ++i) {
+        QDomElement producer = doc.createElement(QStringLiteral("producer"));
+        producer.setAttribute(QStringLiteral("id"), QStringLiteral("color%1").arg(i));
+        QDomElement service = doc.createElement(QStringLiteral("property"));
+        service.setAttribute(QStringLiteral("name"), QStringLiteral("mlt_service"));
+        service.appendChild(doc.createTextNode(QStringLiteral("color")));
+        producer.appendChild(service);
+        QDomElement resource = doc.createElement(QStringLiteral("property"));
+        resource.setAttribute(QStringLiteral("name"), QStringLiteral("resource"));
+        const QRgb rgb = frameColor(i);
+        const QString color = QStringLiteral("0x%1%2%3ff")
+                                  .arg(qRed(rgb), 2, 16, QLatin1Char('0'))
+                                  .arg(qGreen(rgb), 2, 16, QLatin1Char('0'))
+                                  .arg(qBlue(rgb), 2, 16, QLatin1Char('0'));
+        resource.appendChild(doc.createTextNode(color));
+        producer.appendChild(resource);
+        mlt.appendChild(producer);
+        QDomElement entry = doc.createElement(QStringLiteral("entry"));
+        entry.setAttribute(QStringLiteral("producer"), QStringLiteral("color%1").arg(i));
+        entry.setAttribute(QStringLiteral("in"), 0);
+        entry.setAttribute(QStringLiteral("out"), 0);
+        playlist.appendChild(entry);
+    }
+    mlt.appendChild(playlist);
+    QDomElement consumer = doc.createElement(QStringLiteral("consumer"));
+    consumer.setAttribute(QStringLiteral("mlt_service"), QStringLiteral("avformat"));
+    consumer.setAttribute(QStringLiteral("in"), 0);
+    consumer.setAttribute(QStringLiteral("out"), frames - 1);
+    consumer.setAttribute(QStringLiteral("target"), target);
+    consumer.setAttribute(QStringLiteral("f"), QStringLiteral("matroska"));
+    consumer.setAttribute(QStringLiteral("vcodec"), QStringLiteral("ffv1"));
+    consumer.setAttribute(QStringLiteral("an"), 1);
+    mlt.appendChild(consumer);
+    return doc;
+}
+
+/** @brief A copy of the @param playlist mixing a tone with the colors, encoded with B-frames and a GOP of @param gopSize frames */
+QDomDocument interFramePlaylist(const QDomDocument &playlist, int gopSize)
+{
+    QDomDocument doc = playlist.cloneNode(true).toDocument();
+    QDomElement mlt = doc.documentElement();
+    QDomElement consumer = mlt.firstChildElement(QStringLiteral("consumer"));
+    const int frames = consumer.attribute(QStringLiteral("out")).toInt() + 1;
+    auto property = [&doc](QDomElement &element, const QString &name, const QString &value) {
+        QDomElement prop = doc.createElement(QStringLiteral("property"));
+        prop.setAttribute(QStringLiteral("name"), name);
+        prop.appendChild(doc.createTextNode(value));
+        element.appendChild(prop);
+    };
+    QDomElement tone = doc.createElement(QStringLiteral("producer"));
+    tone.setAttribute(QStringLiteral("id"), QStringLiteral("tone"));
+    tone.setAttribute(QStringLiteral("in"), 0);
+    tone.setAttribute(QStringLiteral("out"), frames - 1);
+    property(tone, QStringLiteral("mlt_service"), QStringLiteral("tone"));
+    property(tone, QStringLiteral("frequency"), QStringLiteral("440"));
+    property(tone, QStringLiteral("length"), QString::number(frames));
+    mlt.insertBefore(tone, consumer);
+    QDomElement tractor = doc.createElement(QStringLiteral("tractor"));
+    tractor.setAttribute(QStringLiteral("id"), QStringLiteral("tractor"));
+    tractor.setAttribute(QStringLiteral("in"), 0);
+    tractor.setAttribute(QStringLiteral("out"), frames - 1);
+    QDomElement colors = doc.createElement(QStringLiteral("track"));
+    colors.setAttribute(QStringLiteral("producer"), QStringLiteral("main"));
+    tractor.appendChild(colors);
+    QDomElement audio = doc.createElement(QStringLiteral("track"));
+    audio.setAttribute(QStringLiteral("producer"), QStringLiteral("tone"));
+    audio.setAttribute(QStringLiteral("hide"), QStringLiteral("video"));
+    tractor.appendChild(audio);
+    QDomElement mix = doc.createElement(QStringLiteral("transition"));
+    property(mix, QStringLiteral("mlt_service"), QStringLiteral("mix"));
+    property(mix, QStringLiteral("a_track"), QStringLiteral("0"));
+    property(mix, QStringLiteral("b_track"), QStringLiteral("1"));
+    property(mix, QStringLiteral("always_active"), QStringLiteral("1"));
+    property(mix, QStringLiteral("sum"), QStringLiteral("1"));
+    tractor.appendChild(mix);
+    mlt.insertBefore(tractor, consumer);
+
+    consumer.removeAttribute(QStringLiteral("an"));
+    consumer.setAttribute(QStringLiteral("vcodec"), QStringLiteral("libx264"));
+    consumer.setAttribute(QStringLiteral("crf"), 12);
+    consumer.setAttribute(QStringLiteral("g"), gopSize);
+    consumer.setAttribute(QStringLiteral("bf"), 2);
+    // Every frame has a new color: without this, x264 would encode them all as scene cuts
+    consumer.setAttribute(QStringLiteral("x264-params"), QStringLiteral("scenecut=0:b-adapt=0"));
+    consumer.setAttribute(QStringLiteral("acodec"), QStringLiteral("aac"));
+    consumer.setAttribute(QStringLiteral("ar"), 48000);
+    consumer.setAttribute(QStringLiteral("ac"), 2);
+    return doc;
+}
+
+/** @brief Render the @param playlist with kdenlive_render in @param segments processes, returns the rendered file */
+QString renderDelivery(const QString &melt, const QDomDocument &playlist, const QString &target, int segments, const QString &split)
+{
+    QDomDocument doc = playlist.cloneNode(true).toDocument();
+    doc.documentElement().firstChildElement(QStringLiteral("consumer")).setAttribute(QStringLiteral("target"), target);
+    QFile file(target + QStringLiteral(".mlt"));
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write(doc.toString().toUtf8());
+    file.close();
+    QProcess render;
+    render.setProcessChannelMode(QProcess::ForwardedChannels);
+    render.start(QString::fromUtf8(KDENLIVE_RENDER_PATH), {QStringLiteral("delivery"), melt, file.fileName(), QStringLiteral("--segments"),
+                                                         QString::number(segments), QStringLiteral("--split"), split});
+    REQUIRE(render.waitForFinished(-1));
+    REQUIRE(render.exitStatus() == QProcess::NormalExit);
+    // kdenlive_render reports failures to Kdenlive, not in its exit code, and keeps a log of failed jobs
+    CHECK_FALSE(QFile::exists(target + QStringLiteral(".log")));
+    REQUIRE(QFile::exists(target));
+    return target;
+}
+
+/** @brief The color of the center of each frame, and the peak level of its audio */
+void decode(Mlt::Profile &profile, const QString &file, QVector<QRgb> &colors, QVector<int> &peaks)
+{
+    Mlt::Producer producer(profile, "avformat", file.toUtf8().constData());
+    REQUIRE(producer.is_valid());
+    REQUIRE(producer.get_int("audio_index") >= 0);
+    for (int i = 0; i < producer.get_length(); ++i) {
+        producer.seek(i);
+        std::unique_ptr<Mlt::Frame> frame(producer.get_frame());
+        mlt_image_format format = mlt_image_rgb;
+        int width = profile.width();
+        int height = profile.height();
+        const uchar *image = frame->get_image(format, width, height);
+        REQUIRE(image != nullptr);
+        const uchar *pixel = image + 3 * (width * (height / 2) + width / 2);
+        colors << qRgb(pixel[0], pixel[1], pixel[2]);
+        mlt_audio_format audioFormat = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = mlt_audio_calculate_frame_samples(float(profile.fps()), frequency, i);
+        const auto *audio = static_cast<const int16_t *>(frame->get_audio(audioFormat, frequency, channels, samples));
+        int peak = 0;
+        for (int j = 0; audio != nullptr && j < samples * channels; ++j) {
+            peak = qMax(peak, qAbs(int(audio[j])));
+        }
+        peaks << peak;
+    }
+}
+
+/** @brief The picture types of the video frames in presentation order, or an empty list if ffprobe is not available */
+QString pictureTypes(const QString &file)
+{
+    const QString ffprobe = QStandardPaths::findExecutable(QStringLiteral("ffprobe"));
+    if (ffprobe.isEmpty()) {
+        return QString();
+    }
+    QProcess probe;
+    probe.start(ffprobe, {QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-select_streams"), QStringLiteral("v:0"),
+                          QStringLiteral("-show_entries"), QStringLiteral("frame=pict_type"), QStringLiteral("-of"), QStringLiteral("csv=p=0"), file});
+    REQUIRE(probe.waitForFinished(-1));
+    QString types;
+    const QStringList lines = QString::fromUtf8(probe.readAllStandardOutput()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+        types.append(line.trimmed().left(1));
+    }
+    return types;
+}
+
+bool closeColors(QRgb a, QRgb b)
+{
+    const int tolerance = 6;
+    return qAbs(qRed(a) - qRed(b)) <= tolerance && qAbs(qGreen(a) - qGreen(b)) <= tolerance && qAbs(qBlue(a) - qBlue(b)) <= tolerance;
+}
+} // namespace
+
+TEST_CASE("Split a render range in segments", "[RenderSegments]")
+{
+    using Segments = QVector<RenderSegments::Segment>;
+    auto checkContiguous = [](const Segments &segments, int in, int out) {
+        REQUIRE_FALSE(segments.isEmpty());
+        CHECK(segments.first().in == in);
+        CHECK(segments.last().out == out);
+        for (int i = 1; i < segments.size(); ++i) {
+            CHECK(segments.at(i).in == segments.at(i - 1).out + 1);
+        }
+    };
+
+    SECTION("Fixed length segments start on a GOP")
+    {
+        const Segments segments = RenderSegments::split(100, 100 + 3000 - 1, 4, 12);
+        checkContiguous(segments, 100, 3099);
+        REQUIRE(segments.size() == 4);
+        for (const auto &segment : segments) {
+            CHECK((segment.in - 100) % 12 == 0);
+            CHECK(qAbs(segment.length() - 750) <= 12);
+        }
+    }
+
+    SECTION("Guides close to the ideal boundaries are preferred")
+    {
+        const Segments segments = RenderSegments::split(0, 2999, 3, 12, {5, 1013, 1400, 2950});
+        checkContiguous(segments, 0, 2999);
+        REQUIRE(segments.size() == 3);
+        // Only the guide at 1013 is close enough to an ideal boundary, the second boundary stays on a GOP
+        CHECK(segments.at(1).in == 1013);
+        CHECK(segments.at(2).in == 2004);
+    }
+
+    SECTION("Short ranges are not split")
+    {
+        Segments segments = RenderSegments::split(0, 299, 8, 12);
+        checkContiguous(segments, 0, 299);
+        CHECK(segments.size() == 1);
+        segments = RenderSegments::split(0, 999, 8, 0);
+        checkContiguous(segments, 0, 999);
+        CHECK(segments.size() == 4);
+        segments = RenderSegments::split(0, 999, 1, 0);
+        CHECK(segments.size() == 1);
+        CHECK(RenderSegments::split(10, 5, 4, 0).isEmpty());
+    }
+}
+
+TEST_CASE("Segmented render eligibility", "[RenderSegments]")
+{
+    const QDomDocument doc = colorPlaylist(1, QStringLiteral("/tmp/out.mkv"));
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer")).cloneNode().toElement();
+    consumer.setAttribute(QStringLiteral("out"), 1000);
+    CHECK(RenderSegments::canSegment(consumer));
+    CHECK_FALSE(RenderSegments::hasAudio(consumer));
+    consumer.removeAttribute(QStringLiteral("an"));
+    CHECK(RenderSegments::hasAudio(consumer));
+
+    QDomElement twoPass = consumer.cloneNode().toElement();
+    twoPass.setAttribute(QStringLiteral("pass"), 2);
+    CHECK_FALSE(RenderSegments::canSegment(twoPass));
+    QDomElement sequence = consumer.cloneNode().toElement();
+    sequence.setAttribute(QStringLiteral("target"), QStringLiteral("/tmp/image_%05d.png"));
+    CHECK_FALSE(RenderSegments::canSegment(sequence));
+    QDomElement gif = consumer.cloneNode().toElement();
+    gif.setAttribute(QStringLiteral("f"), QStringLiteral("gif"));
+    CHECK_FALSE(RenderSegments::canSegment(gif));
+    QDomElement audioOnly = consumer.cloneNode().toElement();
+    audioOnly.setAttribute(QStringLiteral("vn"), 1);
+    CHECK_FALSE(RenderSegments::canSegment(audioOnly));
+    QDomElement noRange = consumer.cloneNode().toElement();
+    noRange.removeAttribute(QStringLiteral("out"));
+    CHECK_FALSE(RenderSegments::canSegment(noRange));
+}
+
+TEST_CASE("Segment playlists and join command", "[RenderSegments]")
+{
+    QDomDocument doc = colorPlaylist(10, QStringLiteral("/tmp/out.mkv"));
+    QDomElement original = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    original.removeAttribute(QStringLiteral("an"));
+    original.setAttribute(QStringLiteral("acodec"), QStringLiteral("aac"));
+
+    QDomElement video = RenderSegments::segmentPlaylist(doc, {2, 5}, QStringLiteral("/tmp/part.mkv"), RenderSegments::Stream::VideoOnly)
+                            .documentElement()
+                            .firstChildElement(QStringLiteral("consumer"));
+    CHECK(video.attribute(QStringLiteral("in")) == QLatin1String("2"));
+    CHECK(video.attribute(QStringLiteral("out")) == QLatin1String("5"));
+    CHECK(video.attribute(QStringLiteral("target")) == QLatin1String("/tmp/part.mkv"));
+    CHECK(video.attribute(QStringLiteral("an")) == QLatin1String("1"));
+    CHECK_FALSE(video.hasAttribute(QStringLiteral("acodec")));
+    CHECK(video.attribute(QStringLiteral("vcodec")) == QLatin1String("ffv1"));
+
+    QDomElement audio = RenderSegments::segmentPlaylist(doc, {0, 9}, QStringLiteral("/tmp/audio.mkv"), RenderSegments::Stream::AudioOnly)
+                            .documentElement()
+                            .firstChildElement(QStringLiteral("consumer"));
+    CHECK(audio.attribute(QStringLiteral("vn")) == QLatin1String("1"));
+    CHECK_FALSE(audio.hasAttribute(QStringLiteral("vcodec")));
+    CHECK(audio.attribute(QStringLiteral("acodec")) == QLatin1String("aac"));
+    // The original playlist is left untouched
+    CHECK(original.attribute(QStringLiteral("target")) == QLatin1String("/tmp/out.mkv"));
+
+    CHECK(RenderSegments::concatList({QStringLiteral("/a/b.mkv"), QStringLiteral("/a/it's.mkv")}) ==
+          QByteArray("ffconcat version 1.0\nfile '/a/b.mkv'\nfile '/a/it'\\''s.mkv'\n"));
+    const QStringList args =
+        RenderSegments::joinArguments(QStringLiteral("list"), QStringLiteral("audio.mkv"), QStringLiteral("matroska"), QStringLiteral("out.mkv"));
+    CHECK(args.join(QLatin1Char(' ')) == QLatin1String("-y -v error -f concat -safe 0 -i list -i audio.mkv -map 0:v -map 1:a -c copy -f matroska out.mkv"));
+}
+
+TEST_CASE("Segmented render matches a single process render", "[RenderSegments]")
+{
+    QString melt = QStandardPaths::findExecutable(QStringLiteral("melt"));
+    if (melt.isEmpty()) {
+        melt = QStandardPaths::findExecutable(QStringLiteral("melt-7"));
+    }
+    if (melt.isEmpty() || QStandardPaths::findExecutable(QStringLiteral("ffmpeg")).isEmpty()) {
+        WARN("melt or FFmpeg not found, skipping the segmented render");
+        return;
+    }
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    Mlt::Profile profile;
+    profile.set_width(160);
+    profile.set_height(120);
+    profile.set_frame_rate(25, 1);
+    profile.set_progressive(1);
+    profile.set_sample_aspect(1, 1);
+    profile.set_display_aspect(4, 3);
+    profile.set_explicit(1);
+
+    // Long enough for 3 segments of the default minimum length, the first boundary is moved off the GOP grid by a guide
+    const int frames = 900;
+    const int gopSize = 12;
+    const int guide = 310;
+    const QDomDocument doc = interFramePlaylist(colorPlaylist(frames, QString()), gopSize);
+    const QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    QDomElement segmentable = consumer.cloneNode().toElement();
+    segmentable.setAttribute(QStringLiteral("target"), dir.filePath(QStringLiteral("segmented.mkv")));
+    REQUIRE(RenderSegments::canSegment(segmentable));
+    REQUIRE(RenderSegments::hasAudio(segmentable));
+    const QVector<RenderSegments::Segment> segments = RenderSegments::split(0, frames - 1, 3, gopSize, {guide});
+    REQUIRE(segments.size() == 3);
+    REQUIRE(segments.at(1).in == guide);
+
+    const QString single = renderDelivery(melt, doc, dir.filePath(QStringLiteral("single.mkv")), 1, QString::number(guide));
+    const QString segmented = renderDelivery(melt, doc, dir.filePath(QStringLiteral("segmented.mkv")), 3, QString::number(guide));
+
+    QVector<QRgb> reference;
+    QVector<int> referencePeaks;
+    decode(profile, single, reference, referencePeaks);
+    QVector<QRgb> colors;
+    QVector<int> peaks;
+    decode(profile, segmented, colors, peaks);
+    REQUIRE(reference.size() == frames);
+    REQUIRE(colors.size() == frames);
+    // The encoding is lossy, but a missing, repeated or reordered frame at a seam changes the color by more than the tolerance
+    for (int i = 0; i < frames; ++i) {
+        INFO("Frame " << i);
+        CHECK(closeColors(reference.at(i), frameColor(i)));
+        CHECK(closeColors(colors.at(i), frameColor(i)));
+    }
+    // The audio is continuous across the seams
+    for (const auto &segment : segments) {
+        for (int i = qMax(1, segment.in - 2); i <= qMin(frames - 1, segment.in + 2); ++i) {
+            INFO("Frame " << i);
+            CHECK(referencePeaks.at(i) > 1000);
+            CHECK(peaks.at(i) > 1000);
+            CHECK(qAbs(peaks.at(i) - referencePeaks.at(i)) < referencePeaks.at(i) / 10);
+        }
+    }
+
+    const QString referenceTypes = pictureTypes(single);
+    const QString types = pictureTypes(segmented);
+    if (types.isEmpty()) {
+        WARN("FFprobe not found, skipping the check of the picture types");
+        return;
+    }
+    REQUIRE(referenceTypes.size() == frames);
+    REQUIRE(types.size() == frames);
+    CHECK(referenceTypes.count(QLatin1Char('B')) > frames / 2);
+    CHECK(types.count(QLatin1Char('B')) > frames / 2);
+    // The single render has no keyframe at the guide, each segment of the segmented one starts with a keyframe
+    CHECK(referenceTypes.at(guide) != QLatin1Char('I'));
+    for (const auto &segment : segments) {
+        INFO("Segment starting at " << segment.in);
+        CHECK(types.at(segment.in) == QLatin1Char('I'));
+    }
+}
@@ -0,0 +1,142 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "jobs/abstracttask.h"
+#include "jobs/taskmanager.h"
+
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+#include <functional>
+
+namespace {
+/** @brief A task running a function, reporting to a local task manager */
+class TestTask : public AbstractTask
+{
+public:
+    TestTask(TaskManager &manager, int clipId, JOBTYPE type, std::function<void(TestTask *)> work)
+        : AbstractTask(ObjectId(ObjectType::BinClip, clipId), type, nullptr)
+        , m_manager(manager)
+        , m_work(std::move(work))
+    {
+    }
+    void run() override
+    {
+        m_manager.taskStarted(this);
+        m_work(this);
+        m_progress = 100;
+        m_manager.taskDone(m_owner.second, this);
+    }
+
+private:
+    TaskManager &m_manager;
+    std::function<void(TestTask *)> m_work;
+};
+} // namespace
+
+TEST_CASE("Task scheduling priorities", "[TaskManager]")
+{
+    TaskManager manager(nullptr);
+    // A single thread, so that tasks are processed in priority order
+    manager.m_taskPool.setMaxThreadCount(1);
+
+    SECTION("Displayed and visible clips come first")
+    {
+        QSemaphore blocker;
+        QMutex orderMutex;
+        std::vector<int> order;
+        auto record = [&orderMutex, &order](TestTask *task) {
+            QMutexLocker lock(&orderMutex);
+            order.push_back(task->m_owner.second);
+        };
+        manager.startTask(1, new TestTask(manager, 1, AbstractTask::LOADJOB, [&blocker](TestTask *) { blocker.acquire(); }));
+        while (manager.statistics().started < 1) {
+            QThread::msleep(5);
+        }
+        // The import backlog
+        for (int clipId = 2; clipId < 42; ++clipId) {
+            manager.startTask(clipId, new TestTask(manager, clipId, AbstractTask::LOADJOB, record));
+        }
+        manager.startTask(2, new TestTask(manager, 2, AbstractTask::CACHEJOB, record));
+        REQUIRE(manager.statistics().pending == 41);
+        REQUIRE(manager.statistics().urgent == 0);
+        manager.setVisibleClips({30});
+        manager.setDisplayedClip(41);
+        REQUIRE(manager.statistics().urgent == 2);
+        blocker.release();
+        manager.m_taskPool.waitForDone();
+        REQUIRE(order.size() == 41);
+        REQUIRE(order.at(0) == 41);
+        REQUIRE(order.at(1) == 30);
+        REQUIRE(order.at(2) == 2);
+        // Thumbnail caching comes after all clip loading tasks
+        REQUIRE(order.back() == 2);
+        const TaskManagerStatistics stats = manager.statistics();
+        REQUIRE(stats.pending == 0);
+        REQUIRE(stats.urgent == 0);
+        REQUIRE(stats.started == 42);
+        REQUIRE(stats.displayedClipWait >= 0);
+        REQUIRE(stats.maxWait >= stats.averageWait);
+    }
+
+    SECTION("Background tasks pause for urgent tasks")
+    {
+        QSemaphore started;
+        std::atomic<bool> urgentDone{false};
+        std::atomic<bool> backgroundFinishedFirst{false};
+        manager.startTask(1, new TestTask(manager, 1, AbstractTask::CACHEJOB, [&](TestTask *task) {
+            started.release();
+            for (int i = 0; i < 200 && !urgentDone; ++i) {
+                manager.yieldToUrgentTasks(task);
+                QThread::msleep(5);
+            }
+            backgroundFinishedFirst = !urgentDone;
+        }));
+        started.acquire();
+        // The only thread is busy, the urgent task can only run if the background task gives its thread
+        manager.setDisplayedClip(2);
+        manager.startTask(2, new TestTask(manager, 2, AbstractTask::LOADJOB, [&urgentDone](TestTask *) { urgentDone = true; }));
+        manager.m_taskPool.waitForDone();
+        REQUIRE(urgentDone);
+        REQUIRE_FALSE(backgroundFinishedFirst);
+        REQUIRE(manager.statistics().preempted == 0);
+    }
+
+    SECTION("Paused tasks keep their thread when no urgent task is queued")
+    {
+        manager.m_taskPool.setMaxThreadCount(2);
+        QSemaphore gate;
+        QSemaphore started;
+        std::atomic<int> running{0};
+        std::atomic<int> maxRunning{0};
+        manager.setDisplayedClip(2);
+        manager.startTask(2, new TestTask(manager, 2, AbstractTask::LOADJOB, [&](TestTask *) {
+            started.release();
+            gate.acquire();
+        }));
+        started.acquire();
+        // The urgent task is already running, pausing the background tasks must not start the next ones
+        for (int clipId = 3; clipId < 7; ++clipId) {
+            manager.startTask(clipId, new TestTask(manager, clipId, AbstractTask::CACHEJOB, [&](TestTask *task) {
+                int count = ++running;
+                int previous = maxRunning;
+                while (count > previous && !maxRunning.compare_exchange_weak(previous, count)) {
+                }
+                for (int i = 0; i < 10; ++i) {
+                    manager.yieldToUrgentTasks(task);
+                    QThread::msleep(5);
+                }
+                running--;
+            }));
+        }
+        QThread::msleep(300);
+        REQUIRE(maxRunning == 1);
+        REQUIRE(manager.statistics().preempted == 1);
+        gate.release();
+        manager.m_taskPool.waitForDone();
+        REQUIRE(manager.statistics().preempted == 0);
+        REQUIRE(manager.m_releasedThreads[&manager.m_taskPool] == 0);
+    }
+}
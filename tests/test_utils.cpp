@@ -5,6 +5,10 @@
 */
 #include "test_utils.hpp"
 
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+
 QString createProducer(Mlt::Profile &prof, std::string color, std::shared_ptr<ProjectItemModel> binModel, int length, bool limited)
 {
     std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(prof, "color", color.c_str());
@@ -108,3 +112,38 @@ std::unique_ptr<QDomElement> getProperty(const QDomElement &doc, const QString &
     }
     return nullptr;
 }
+
+PreviewTestDocument::PreviewTestDocument(std::shared_ptr<DocUndoStack> undoStack)
+    : document(undoStack)
+    , docMock(document)
+{
+    KdenliveDoc &mockedDoc = docMock.get();
+    // We mock the project class so that the undoStack function returns our undoStack, and our mocked document
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+    When(Method(pmMock, current)).AlwaysReturn(&mockedDoc);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    mocked.m_project = &mockedDoc;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    mocked.updateTimeline(0, false, QString(), QString(), documentDate, 0);
+    timeline = mockedDoc.getTimeline(mockedDoc.uuid());
+    mocked.m_activeTimelineModel = timeline;
+    mocked.testSetActiveDocument(&mockedDoc, timeline);
+
+    QString documentId = QString::number(QDateTime::currentMSecsSinceEpoch());
+    mockedDoc.setDocumentProperty(QStringLiteral("documentid"), documentId);
+    mockedDoc.setDocumentProperty(QStringLiteral("previewextension"), QStringLiteral("avi"));
+    mockedDoc.setDocumentProperty(QStringLiteral("previewparameters"), QStringLiteral("vcodec=mjpeg progressive=1 qscale=10"));
+
+    // Create base tmp folder
+    bool ok = false;
+    cacheDir = mockedDoc.getCacheDir(CacheBase, &ok);
+    cacheDir.mkpath(QStringLiteral("."));
+    cacheDir.mkdir(QLatin1String("preview"));
+}
+
+PreviewTestDocument::~PreviewTestDocument()
+{
+    pCore->m_projectManager = nullptr;
+}
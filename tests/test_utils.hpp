@@ -31,6 +31,7 @@
 #include "bin/projectfolder.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
+#include "doc/kdenlivedoc.h"
 #include "effects/effectsrepository.hpp"
 #include "effects/effectstack/model/effectitemmodel.hpp"
 #include "effects/effectstack/model/effectstackmodel.hpp"
@@ -97,3 +98,17 @@ QString createTextProducer(Mlt::Profile &prof, std::shared_ptr<ProjectItemModel>
 QString createAVProducer(Mlt::Profile &prof, std::shared_ptr<ProjectItemModel> binModel);
 
 std::unique_ptr<QDomElement> getProperty(const QDomElement& element, const QString& name);
+
+/** @brief A document made current through a mocked project manager, with the timeline preview settings. Used by the timeline preview tests */
+struct PreviewTestDocument
+{
+    explicit PreviewTestDocument(std::shared_ptr<DocUndoStack> undoStack);
+    ~PreviewTestDocument();
+
+    KdenliveDoc document;
+    Mock<KdenliveDoc> docMock;
+    Mock<ProjectManager> pmMock;
+    std::shared_ptr<TimelineItemModel> timeline;
+    /** @brief The document cache folder, which contains the preview folder */
+    QDir cacheDir;
+};
@@ -0,0 +1,227 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+#include "utils/thumbnailproducerpool.hpp"
+
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+#include <thread>
+
+namespace {
+// Number of distinct frames waiting in the pool
+int pendingRequests(ThumbnailProducerPool &pool)
+{
+    QMutexLocker lock(&pool.m_mutex);
+    return int(pool.m_requests.size());
+}
+
+// Number of requests that joined another request for the same frame
+int coalescedRequests(ThumbnailProducerPool &pool)
+{
+    QMutexLocker lock(&pool.m_mutex);
+    return pool.m_coalesced;
+}
+
+// An image encoding the frame in its width, so that we can check which frame was returned
+QImage frameImage(int frame)
+{
+    QImage image(frame + 1, 1, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    return image;
+}
+} // namespace
+
+TEST_CASE("Thumbnail producer pool", "[ThumbnailProducerPool]")
+{
+    std::atomic<int> created(0);
+    auto factory = [&created]() {
+        created++;
+        return std::make_shared<Mlt::Producer>(*pCore->getProjectProfile(), "color", "red");
+    };
+
+    SECTION("Pending requests are served in ascending order and coalesced")
+    {
+        QSemaphore entered;
+        QSemaphore blocker;
+        QMutex orderMutex;
+        std::vector<int> order;
+        ThumbnailProducerPool pool(
+            factory,
+            [&](Mlt::Producer &, int frame) {
+                {
+                    QMutexLocker lock(&orderMutex);
+                    order.push_back(frame);
+                }
+                if (frame == 100) {
+                    entered.release();
+                    blocker.acquire();
+                }
+                return frameImage(frame);
+            },
+            1);
+        std::vector<std::thread> threads;
+        std::vector<int> widths(5, 0);
+        threads.emplace_back([&]() { widths[0] = pool.requestFrame(100).width(); });
+        entered.acquire();
+        // Queue requests while the single producer is busy, including twice the same frame
+        const std::vector<int> frames = {30, 10, 20, 30};
+        for (size_t i = 0; i < frames.size(); ++i) {
+            threads.emplace_back([&, i]() { widths[i + 1] = pool.requestFrame(frames.at(i)).width(); });
+        }
+        while (pendingRequests(pool) < 4 || coalescedRequests(pool) < 1) {
+            QThread::msleep(5);
+        }
+        blocker.release();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        REQUIRE(created == 1);
+        // A single backward seek, then the pending frames in ascending order, frame 30 decoded once
+        REQUIRE(order == std::vector<int>({100, 10, 20, 30}));
+        REQUIRE(widths == std::vector<int>({101, 31, 11, 21, 31}));
+        REQUIRE(pendingRequests(pool) == 0);
+    }
+
+    SECTION("Producers are bounded and used in parallel")
+    {
+        std::atomic<int> running(0);
+        std::atomic<int> peak(0);
+        ThumbnailProducerPool pool(
+            factory,
+            [&](Mlt::Producer &, int frame) {
+                int current = ++running;
+                int previous = peak;
+                while (current > previous && !peak.compare_exchange_weak(previous, current)) {
+                }
+                QThread::msleep(20);
+                running--;
+                return frameImage(frame);
+            },
+            3);
+        std::vector<std::thread> threads;
+        std::atomic<int> valid(0);
+        for (int i = 0; i < 12; ++i) {
+            threads.emplace_back([&, i]() {
+                if (pool.requestFrame(25 * i).width() == 25 * i + 1) {
+                    valid++;
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        REQUIRE(valid == 12);
+        REQUIRE(created <= 3);
+        REQUIRE(pool.producerCount() == created);
+        REQUIRE(peak <= 3);
+        REQUIRE(peak > 1);
+
+        // Clearing drops the producers and applies the new limit
+        pool.clear(1);
+        REQUIRE(pool.producerCount() == 0);
+        REQUIRE(pool.maxProducers() == 1);
+        REQUIRE(pool.requestFrame(5).width() == 6);
+        REQUIRE(pool.producerCount() == 1);
+    }
+
+    SECTION("Clearing while a producer is created")
+    {
+        QSemaphore creating;
+        QSemaphore blocker;
+        std::atomic<int> calls(0);
+        ThumbnailProducerPool pool(
+            [&]() {
+                if (calls++ == 0) {
+                    creating.release();
+                    blocker.acquire();
+                }
+                return factory();
+            },
+            [](Mlt::Producer &, int frame) { return frameImage(frame); }, 1);
+        int width = 0;
+        std::thread thread([&]() { width = pool.requestFrame(10).width(); });
+        creating.acquire();
+        // The producer being created is outdated, the request must create a new one instead of waiting forever
+        pool.clear();
+        blocker.release();
+        thread.join();
+        REQUIRE(width == 11);
+        REQUIRE(calls == 2);
+        REQUIRE(pool.producerCount() == 1);
+    }
+
+    SECTION("A frame decoded while its producer is created is not decoded again")
+    {
+        QSemaphore creating;
+        QSemaphore factoryBlocker;
+        QSemaphore entered;
+        QSemaphore renderBlocker;
+        std::atomic<int> calls(0);
+        QMutex orderMutex;
+        std::vector<int> order;
+        ThumbnailProducerPool pool(
+            [&]() {
+                if (calls++ == 1) {
+                    creating.release();
+                    factoryBlocker.acquire();
+                }
+                return factory();
+            },
+            [&](Mlt::Producer &, int frame) {
+                {
+                    QMutexLocker lock(&orderMutex);
+                    order.push_back(frame);
+                }
+                if (frame == 100) {
+                    entered.release();
+                    renderBlocker.acquire();
+                }
+                return frameImage(frame);
+            },
+            2);
+        int firstWidth = 0;
+        int secondWidth = 0;
+        std::thread first([&]() { firstWidth = pool.requestFrame(100).width(); });
+        entered.acquire();
+        // The first producer is busy, the second request creates another one
+        std::thread second([&]() { secondWidth = pool.requestFrame(10).width(); });
+        creating.acquire();
+        // The first producer serves the pending frame while the second one is still being created
+        renderBlocker.release();
+        first.join();
+        factoryBlocker.release();
+        second.join();
+        REQUIRE(firstWidth == 101);
+        REQUIRE(secondWidth == 11);
+        REQUIRE(order == std::vector<int>({100, 10}));
+        REQUIRE(pendingRequests(pool) == 0);
+        // The new producer is kept for the next requests
+        REQUIRE(pool.producerCount() == 2);
+    }
+
+    SECTION("Idle producers are released")
+    {
+        ThumbnailProducerPool pool(factory, [](Mlt::Producer &, int frame) { return frameImage(frame); }, 2);
+        REQUIRE(pool.requestFrame(1).width() == 2);
+        REQUIRE(pool.producerCount() == 1);
+        REQUIRE(pool.releaseIdle(60000) == 0);
+        REQUIRE(pool.producerCount() == 1);
+        QThread::msleep(20);
+        REQUIRE(pool.releaseIdle(10) == 1);
+        REQUIRE(pool.producerCount() == 0);
+        // A new producer is created on the next request
+        REQUIRE(pool.requestFrame(2).width() == 3);
+        REQUIRE(pool.producerCount() == 1);
+    }
+
+    SECTION("Failing factory")
+    {
+        ThumbnailProducerPool pool([]() { return std::shared_ptr<Mlt::Producer>(); }, [](Mlt::Producer &, int frame) { return frameImage(frame); }, 2);
+        REQUIRE(pool.requestFrame(10).isNull());
+        REQUIRE(pool.producerCount() == 0);
+        REQUIRE(pendingRequests(pool) == 0);
+    }
+}
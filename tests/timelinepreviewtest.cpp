@@ -6,7 +6,11 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
 #include <QString>
+#include <QThread>
 #include <cmath>
 #include <iostream>
 #include <tuple>
@@ -17,6 +21,7 @@
 #define protected public
 #include "bin/binplaylist.hpp"
 #include "doc/kdenlivedoc.h"
+#include "kdenlivesettings.h"
 #include "timeline2/model/builders/meltBuilder.hpp"
 #include "timeline2/view/previewmanager.h"
 #include "xml/xml.hpp"
@@ -30,35 +35,9 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     pCore->setCurrentProfile("atsc_1080p_25");
 
     // Create document
-    KdenliveDoc document(undoStack);
-    Mock<KdenliveDoc> docMock(document);
-    KdenliveDoc &mockedDoc = docMock.get();
-
-    // We mock the project class so that the undoStack function returns our undoStack, and our mocked document
-    Mock<ProjectManager> pmMock;
-    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
-    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
-    When(Method(pmMock, current)).AlwaysReturn(&mockedDoc);
-    ProjectManager &mocked = pmMock.get();
-    pCore->m_projectManager = &mocked;
-    mocked.m_project = &mockedDoc;
-    QDateTime documentDate = QDateTime::currentDateTime();
-    mocked.updateTimeline(0, false, QString(), QString(), documentDate, 0);
-    auto timeline = mockedDoc.getTimeline(mockedDoc.uuid());
-    mocked.m_activeTimelineModel = timeline;
-
-    mocked.testSetActiveDocument(&mockedDoc, timeline);
-
-    QString documentId = QString::number(QDateTime::currentMSecsSinceEpoch());
-    mockedDoc.setDocumentProperty(QStringLiteral("documentid"), documentId);
-    mockedDoc.setDocumentProperty(QStringLiteral("previewextension"), QStringLiteral("avi"));
-    mockedDoc.setDocumentProperty(QStringLiteral("previewparameters"), QStringLiteral("vcodec=mjpeg progressive=1 qscale=10"));
-
-    // Create base tmp folder
-    bool ok = false;
-    QDir dir = mockedDoc.getCacheDir(CacheBase, &ok);
-    dir.mkpath(QStringLiteral("."));
-    dir.mkdir(QLatin1String("preview"));
+    PreviewTestDocument testDoc(undoStack);
+    auto timeline = testDoc.timeline;
+    QDir dir = testDoc.cacheDir;
 
     int tid3 = timeline->getTrackIndexFromPosition(2);
     QString binId = createProducer(*timeline->getProfile(), "red", binModel);
@@ -82,7 +61,7 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     for (auto &file : list) {
         qDebug() << "::: FOUND FILE: " << dir.absoluteFilePath(file.fileName());
     }
-    if (list.size() != 3) {
+    if (list.size() != 1) {
         QProcess p;
         const QString ffpath = QStandardPaths::findExecutable(QStringLiteral("melt"));
         p.start(ffpath, {QStringLiteral("-query"), QStringLiteral("formats")});
@@ -91,8 +70,9 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
                  << p.readAllStandardOutput() << "\n----------\n"
                  << p.readAllStandardError();
     }
-    // This should create 3 output chunks
-    REQUIRE(list.size() == 3);
+    // This should create 3 output chunks. They have the same content on an empty timeline, so they share one file
+    REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 3);
+    REQUIRE(list.size() == 1);
 
     // Create and insert clip
     int cid1 = -1;
@@ -107,11 +87,237 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     for (auto &file : list) {
         qDebug() << "::: FOUND FILE AFTER: " << file.fileName();
     }
-    // 2 chunks should remain
-    REQUIRE(list.size() == 2);
+    // 2 chunks should remain, still sharing their file
+    REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 2);
+    REQUIRE(list.size() == 1);
+
+    // Undo the insertion, the chunk file matching the previous content is reused without rendering
+    undoStack->undo();
+    REQUIRE(timeline->getClipsCount() == 0);
+    timeline->previewManager()->invalidatePreviews();
+    REQUIRE_FALSE(timeline->previewManager()->isRunning());
+    REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 3);
+    REQUIRE(timeline->previewManager()->m_dirtyChunks.isEmpty());
+    list = dir.entryInfoList(QDir::Files, QDir::Time);
+    REQUIRE(list.size() == 1);
+
+    // The audio of a track whose video is hidden is still rendered in the chunks, a fully hidden track is not
+    auto chunkContent = [&timeline]() {
+        QStringList files;
+        return timeline->previewManager()->chunkContent(0, files);
+    };
+    auto track = timeline->getTrackById(tid3);
+    track->setProperty(QStringLiteral("hide"), QStringLiteral("3"));
+    const QByteArray hiddenTrack = chunkContent();
+    REQUIRE(timeline->requestClipInsertion(binId, tid3, 0, cid1, false, true, false));
+    REQUIRE(chunkContent() == hiddenTrack);
+    track->setProperty(QStringLiteral("hide"), QStringLiteral("1"));
+    const QByteArray hiddenVideo = chunkContent();
+    REQUIRE(hiddenVideo != hiddenTrack);
+    REQUIRE(timeline->requestItemDeletion(cid1, false));
+    REQUIRE(chunkContent() != hiddenVideo);
+    track->setProperty(QStringLiteral("hide"), QStringLiteral("0"));
     timeline->resetPreviewManager();
     // Ensure preview project folder is deleted on close
     REQUIRE(dir.exists() == false);
     binModel->clean();
-    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Timeline preview chunks reused after a move", "[TimelinePreview]")
+{
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    pCore->setCurrentProfile("atsc_1080p_25");
+
+    PreviewTestDocument testDoc(undoStack);
+    auto timeline = testDoc.timeline;
+    QDir dir = testDoc.cacheDir;
+
+    // A clip filling the first chunk
+    const int chunkSize = KdenliveSettings::timelinechunks();
+    int tid3 = timeline->getTrackIndexFromPosition(2);
+    QString binId = createProducer(*timeline->getProfile(), "red", binModel, chunkSize);
+    int cid1 = -1;
+    REQUIRE(timeline->requestClipInsertion(binId, tid3, 0, cid1, true, true, false));
+
+    timeline->initializePreviewManager();
+    timeline->buildPreviewTrack();
+    dir.cd(QLatin1String("preview"));
+    timeline->previewManager()->addPreviewRange({0, 2 * chunkSize}, true);
+    timeline->previewManager()->startPreviewRender();
+    while (timeline->previewManager()->isRunning()) {
+        sleep(1);
+        qApp->processEvents();
+    }
+    const QUuid uuid = timeline->uuid();
+    REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 3);
+    const QString clipChunk = PreviewManager::renderedChunkFile(uuid, 0);
+    const QString emptyChunk = PreviewManager::renderedChunkFile(uuid, chunkSize);
+    REQUIRE_FALSE(clipChunk.isEmpty());
+    REQUIRE_FALSE(emptyChunk.isEmpty());
+    REQUIRE(clipChunk != emptyChunk);
+    // The two empty chunks share a file
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, 2 * chunkSize) == emptyChunk);
+    REQUIRE(dir.entryList(QDir::Files).size() == 2);
+
+    auto checkReused = [&]() {
+        timeline->previewManager()->invalidatePreviews();
+        REQUIRE_FALSE(timeline->previewManager()->isRunning());
+        REQUIRE(timeline->previewManager()->m_dirtyChunks.isEmpty());
+        REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 3);
+        REQUIRE(dir.entryList(QDir::Files).size() == 2);
+    };
+
+    // Move the clip to the last chunk: both invalidated chunks are found among the rendered files
+    REQUIRE(timeline->requestClipMove(cid1, tid3, 2 * chunkSize, true, true, true, true));
+    checkReused();
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, 0) == emptyChunk);
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, 2 * chunkSize) == clipChunk);
+
+    // A copy of the clip in the middle chunk reuses the same file
+    int cid2 = -1;
+    REQUIRE(timeline->requestClipInsertion(binId, tid3, chunkSize, cid2, true, true, false));
+    checkReused();
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, chunkSize) == clipChunk);
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, 2 * chunkSize) == clipChunk);
+
+    timeline->resetPreviewManager();
+    binModel->clean();
+}
+
+TEST_CASE("Nested sequence thumbnails from preview chunks", "[TimelinePreview]")
+{
+    // Create timeline
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    pCore->setCurrentProfile("atsc_1080p_25");
+
+    // Create document
+    PreviewTestDocument testDoc(undoStack);
+    auto timeline = testDoc.timeline;
+    QDir dir = testDoc.cacheDir;
+
+    int tid3 = timeline->getTrackIndexFromPosition(2);
+    QString redId = createProducer(*timeline->getProfile(), "red", binModel, 100, false);
+    QString blueId = createProducer(*timeline->getProfile(), "blue", binModel, 100, false);
+    int cid1 = -1;
+    REQUIRE(timeline->requestClipInsertion(redId, tid3, 0, cid1, true, true, false));
+
+    // The timeline as a sequence clip of the bin, as ClipCreator::createPlaylistClip builds it
+    const QUuid uuid = timeline->uuid();
+    std::shared_ptr<Mlt::Producer> sequence(new Mlt::Producer(timeline->tractor()->get_producer()));
+    sequence->set("kdenlive:uuid", uuid.toString().toUtf8().constData());
+    sequence->set("kdenlive:clipname", "Sequence");
+    sequence->set("kdenlive:producer_type", ClipType::Timeline);
+    const QString sequenceId = QString::number(binModel->getFreeClipId());
+    auto sequenceClip = ProjectClip::construct(sequenceId, QIcon(), binModel, sequence);
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    REQUIRE(binModel->addItem(sequenceClip, binModel->getRootFolder()->clipId(), undo, redo));
+    REQUIRE(sequenceClip->clipType() == ClipType::Timeline);
+    REQUIRE(sequenceClip->getSequenceUuid() == uuid);
+
+    auto renderPreview = [&timeline]() {
+        timeline->previewManager()->addPreviewRange({0, 50}, true);
+        timeline->previewManager()->startPreviewRender();
+        while (timeline->previewManager()->isRunning()) {
+            sleep(1);
+            qApp->processEvents();
+        }
+    };
+    // The color at the center of a thumbnail
+    auto color = [](const QImage &image) {
+        REQUIRE_FALSE(image.isNull());
+        return image.pixel(image.width() / 2, image.height() / 2);
+    };
+    auto isRed = [](QRgb rgb) { return qRed(rgb) > 180 && qGreen(rgb) < 80 && qBlue(rgb) < 80; };
+    auto isBlue = [](QRgb rgb) { return qRed(rgb) < 80 && qGreen(rgb) < 80 && qBlue(rgb) > 180; };
+
+    timeline->initializePreviewManager();
+    timeline->buildPreviewTrack();
+    renderPreview();
+    const int chunkSize = KdenliveSettings::timelinechunks();
+    const int frame = chunkSize + chunkSize / 2;
+    int offset = -1;
+    const QString chunk = PreviewManager::renderedChunkFile(uuid, frame, &offset);
+    REQUIRE_FALSE(chunk.isEmpty());
+    REQUIRE(QFileInfo::exists(chunk));
+    REQUIRE(offset == chunkSize / 2);
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, 10 * chunkSize).isEmpty());
+    REQUIRE(PreviewManager::renderedChunkFile(QUuid::createUuid(), frame).isEmpty());
+
+    // The thumbnail is decoded from the chunk, the sequence is not serialized to render its tracks
+    REQUIRE(isRed(color(sequenceClip->fetchThumbnail(frame))));
+    REQUIRE(sequenceClip->m_sequenceXml.isEmpty());
+
+    // Edit the sequence: its chunks are invalidated and cannot be used for thumbnails anymore
+    REQUIRE(timeline->requestItemDeletion(cid1));
+    int cid2 = -1;
+    REQUIRE(timeline->requestClipInsertion(blueId, tid3, 0, cid2, true, true, false));
+    timeline->previewManager()->invalidatePreviews();
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, frame).isEmpty());
+    // The thumbnails are reset as Bin does for a modified sequence, they are rendered from a new copy of the sequence
+    sequenceClip->resetSequenceThumbnails();
+    REQUIRE(isBlue(color(sequenceClip->fetchThumbnail(frame))));
+    REQUIRE_FALSE(sequenceClip->m_sequenceXml.isEmpty());
+
+    // Once rendered again, the new chunk is used
+    renderPreview();
+    const QString newChunk = PreviewManager::renderedChunkFile(uuid, frame, &offset);
+    REQUIRE_FALSE(newChunk.isEmpty());
+    REQUIRE(newChunk != chunk);
+    REQUIRE(offset == chunkSize / 2);
+    sequenceClip->resetSequenceThumbnails();
+    REQUIRE(isBlue(color(sequenceClip->fetchThumbnail(frame))));
+    REQUIRE(sequenceClip->m_sequenceXml.isEmpty());
+
+    // Closing the preview unregisters its chunks
+    timeline->resetPreviewManager();
+    REQUIRE(PreviewManager::renderedChunkFile(uuid, frame).isEmpty());
+    binModel->clean();
+}
+
+TEST_CASE("Timeline preview worker scaling", "[TimelinePreview][.benchmark]")
+{
+    // Create timeline
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    pCore->setCurrentProfile("atsc_1080p_25");
+
+    // Create document
+    PreviewTestDocument testDoc(undoStack);
+    auto timeline = testDoc.timeline;
+    QDir dir = testDoc.cacheDir;
+
+    // Fixed test project: a 600 frames clip, so 24 chunks to render
+    int tid3 = timeline->getTrackIndexFromPosition(2);
+    QString binId = createProducer(*timeline->getProfile(), "red", binModel, 600);
+    int cid1 = -1;
+    REQUIRE(timeline->requestClipInsertion(binId, tid3, 0, cid1, true, true, false));
+
+    timeline->initializePreviewManager();
+    timeline->buildPreviewTrack();
+    dir.cd(QLatin1String("preview"));
+    const int previousWorkers = KdenliveSettings::previewworkers();
+    for (int workers : {1, 2, 4, 8}) {
+        KdenliveSettings::setPreviewworkers(workers);
+        timeline->previewManager()->clearPreviewRange(true);
+        REQUIRE(dir.entryList(QDir::Files).isEmpty());
+        QElapsedTimer timer;
+        timer.start();
+        timeline->previewManager()->addPreviewRange({0, 575}, true);
+        timeline->previewManager()->startPreviewRender();
+        while (timeline->previewManager()->isRunning()) {
+            QThread::msleep(20);
+            qApp->processEvents();
+        }
+        const qint64 elapsed = timer.elapsed();
+        REQUIRE(dir.entryList(QDir::Files).size() == 24);
+        REQUIRE(timeline->previewManager()->m_renderedChunks.size() == 24);
+        REQUIRE(timeline->previewManager()->m_dirtyChunks.isEmpty());
+        qDebug() << "Timeline preview of 24 chunks with" << workers << "workers:" << elapsed << "ms";
+    }
+    KdenliveSettings::setPreviewworkers(previousWorkers);
+    timeline->resetPreviewManager();
+    binModel->clean();
 }
@@ -0,0 +1,196 @@
+/*
+    SPDX-FileCopyrightText: 2024 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "doc/kdenlivedoc.h"
+#include "test_utils.hpp"
+#include "doc/docundostack.hpp"
+#include "undohelper.hpp"
+
+#include <QCoreApplication>
+#include <thread>
+
+TEST_CASE("Undo history memory budget", "[DocUndoStack]")
+{
+    // Attribute the payload of lambdas built before this test to a throwaway command
+    FunctionalUndoCommand flush([]() { return true; }, []() { return true; }, QString());
+    DocUndoStack stack(nullptr);
+    stack.setMemoryBudget(0);
+    int value = 0;
+    const qint64 payload = 100000;
+    // Each command sets value to its number, undoing it restores the previous number
+    auto pushCommand = [&stack, &value, payload](int number) {
+        Fun redo = [&value, number]() {
+            value = number;
+            return true;
+        };
+        Fun undo = [&value, number]() {
+            value = number - 1;
+            return true;
+        };
+        redo();
+        addUndoPayload(payload);
+        stack.push(new FunctionalUndoCommand(undo, redo, QStringLiteral("Command %1").arg(number)));
+    };
+    // The running total must match the cost of the commands still in the stack
+    auto totalCost = [&stack]() {
+        qint64 total = 0;
+        for (int i = 0; i < stack.count(); ++i) {
+            total += DocUndoStack::commandCost(stack.command(i));
+        }
+        return total;
+    };
+
+    SECTION("Commands report their payload")
+    {
+        pushCommand(1);
+        REQUIRE(stack.count() == 1);
+        qint64 cost = DocUndoStack::commandCost(stack.command(0));
+        REQUIRE(cost >= payload);
+        REQUIRE(cost < 2 * payload);
+        REQUIRE(stack.memoryUsage() == cost);
+        // The payload is only counted once
+        pushCommand(2);
+        REQUIRE(DocUndoStack::commandCost(stack.command(1)) == cost);
+    }
+
+    SECTION("Oldest commands are discarded above the budget")
+    {
+        for (int i = 1; i <= 10; ++i) {
+            pushCommand(i);
+        }
+        REQUIRE(stack.discardedCount() == 0);
+        REQUIRE(stack.memoryUsage() > 10 * payload);
+        stack.setMemoryBudget(5 * payload);
+        REQUIRE(stack.memoryUsage() <= 5 * payload);
+        int discarded = stack.discardedCount();
+        REQUIRE(discarded > 0);
+        REQUIRE(stack.count() == 10);
+        // A new command does not discard more while the history fits the budget
+        pushCommand(11);
+        REQUIRE(stack.discardedCount() == discarded);
+        REQUIRE(stack.memoryUsage() <= 5 * payload);
+
+        // The remaining commands can be undone and redone
+        int undoable = 11 - discarded;
+        for (int i = 0; i < undoable; ++i) {
+            stack.undo();
+        }
+        REQUIRE(value == discarded);
+        stack.redo();
+        REQUIRE(value == discarded + 1);
+        stack.undo();
+        // Undoing a discarded command removes the discarded history without changing the state
+        stack.undo();
+        QCoreApplication::processEvents();
+        REQUIRE(value == discarded);
+        REQUIRE(stack.index() == 0);
+        REQUIRE(stack.discardedCount() == 0);
+        REQUIRE(stack.count() == undoable);
+        REQUIRE(stack.memoryUsage() == totalCost());
+        REQUIRE_FALSE(stack.canUndo());
+        for (int i = 0; i < undoable; ++i) {
+            stack.redo();
+        }
+        REQUIRE(value == 11);
+    }
+
+    SECTION("The last command is never discarded")
+    {
+        pushCommand(1);
+        pushCommand(2);
+        stack.setMemoryBudget(payload / 2);
+        REQUIRE(stack.discardedCount() == 1);
+        stack.undo();
+        REQUIRE(value == 1);
+    }
+
+    SECTION("Pushing after an undo removes the redo history from the usage")
+    {
+        for (int i = 1; i <= 5; ++i) {
+            pushCommand(i);
+        }
+        stack.undo();
+        stack.undo();
+        pushCommand(4);
+        REQUIRE(stack.count() == 4);
+        REQUIRE(stack.memoryUsage() == totalCost());
+        stack.clear();
+        REQUIRE(stack.memoryUsage() == 0);
+        pushCommand(1);
+        REQUIRE(stack.memoryUsage() == totalCost());
+    }
+
+    SECTION("Payload built in a thread without event loop is not charged to a later command")
+    {
+        qint64 cost = 0;
+        qint64 baseCost = 0;
+        std::thread worker([&cost, &baseCost, payload]() {
+            FunctionalUndoCommand base([]() { return true; }, []() { return true; }, QString());
+            baseCost = base.memoryCost();
+            // Payload of lambdas that never become a command
+            addUndoPayload(payload);
+            FunctionalUndoCommand command([]() { return true; }, []() { return true; }, QString());
+            cost = command.memoryCost();
+        });
+        worker.join();
+        REQUIRE(cost == baseCost);
+    }
+}
+
+TEST_CASE("Undo history accounts for timeline operations", "[DocUndoStack]")
+{
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    undoStack->setMemoryBudget(0);
+    KdenliveDoc document(undoStack);
+    Mock<KdenliveDoc> docMock(document);
+    KdenliveDoc &mockedDoc = docMock.get();
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+    When(Method(pmMock, current)).AlwaysReturn(&mockedDoc);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    mocked.m_project = &mockedDoc;
+    QDateTime documentDate = QDateTime::currentDateTime();
+    mocked.updateTimeline(0, false, QString(), QString(), documentDate, 0);
+    auto timeline = mockedDoc.getTimeline(mockedDoc.uuid());
+    mocked.m_activeTimelineModel = timeline;
+    mocked.testSetActiveDocument(&mockedDoc, timeline);
+
+    int tid1;
+    REQUIRE(timeline->requestTrackInsertion(-1, tid1));
+    QString binId = createProducer(*timeline->getProfile(), "red", binModel);
+    int cid1;
+    REQUIRE(timeline->requestClipInsertion(binId, tid1, 100, cid1));
+    auto stack = timeline->getClipPtr(cid1)->m_effectStack;
+    for (int i = 0; i < 5; ++i) {
+        REQUIRE(stack->appendEffect(QStringLiteral("sepia")));
+    }
+    REQUIRE(stack->rowCount() == 5);
+    // Each effect kept alive by its undo command is counted
+    const qint64 effectCost = std::static_pointer_cast<EffectItemModel>(stack->rootItem->child(0))->memoryCost();
+    REQUIRE(DocUndoStack::commandCost(undoStack->command(undoStack->count() - 1)) >= effectCost);
+    // The deleted clip and its effects are kept by the deletion command
+    const qint64 clipCost = timeline->getClipPtr(cid1)->memoryCost();
+    REQUIRE(clipCost > 5 * effectCost);
+    REQUIRE(timeline->requestItemDeletion(cid1));
+    const qint64 deletionCost = DocUndoStack::commandCost(undoStack->command(undoStack->count() - 1));
+    REQUIRE(deletionCost >= clipCost);
+    REQUIRE(undoStack->memoryUsage() >= deletionCost + 5 * effectCost);
+
+    // Lambdas that never become a command are not charged to the next command
+    undoStack->undo();
+    REQUIRE(timeline->isClip(cid1));
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    REQUIRE(timeline->requestClipDeletion(cid1, undo, redo));
+    REQUIRE(undo());
+    QCoreApplication::processEvents();
+    REQUIRE(timeline->requestClipMove(cid1, tid1, 200));
+    REQUIRE(DocUndoStack::commandCost(undoStack->command(undoStack->index() - 1)) < clipCost);
+
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}